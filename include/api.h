@@ -0,0 +1,34 @@
+#pragma once
+// REST API для опроса узлов: /api/current, /api/config, /api/status (история — /api/history, history.h).
+// Ответ собирается в StaticJsonDocument фиксированного размера. ETag — идентификатор
+// загрузки и номер показания (для /api/config — номер ревизии настроек): опросчик
+// с If-None-Match получает пустой 304, пока не появится новое показание.
+#include <stddef.h>
+#include <stdint.h>
+#include "sensors.h"
+
+#define API_JSON_SIZE 2048 // документ ArduinoJson (/api/status с задачами, датчиками и приёмниками — ~100 узлов)
+#define API_BODY_SIZE 2048 // сериализованный ответ (/api/config с длинными URL, /api/status)
+#define API_ETAG_SIZE 32
+
+enum ApiEndpoint : uint8_t
+{
+  API_CURRENT = 0, // последнее показание
+  API_CONFIG,      // настройки без паролей
+  API_STATUS,      // состояние узла на момент последнего показания
+  API_ENDPOINT_COUNT
+};
+
+struct ApiStats
+{
+  uint32_t responses;   // 200
+  uint32_t notModified; // 304
+};
+
+extern ApiStats apiStats[API_ENDPOINT_COUNT];
+
+void apiBegin(uint32_t bootId);
+const char *apiEndpointPath(ApiEndpoint endpoint);
+size_t apiEtag(ApiEndpoint endpoint, const SensorReading &reading, char *buf, size_t size);
+bool apiEtagMatches(const char *ifNoneMatch, const char *etag);
+size_t apiBody(ApiEndpoint endpoint, const SensorReading &reading, char *buf, size_t size);
@@ -1,6 +1,16 @@
 #pragma once
+#include <stdint.h>
+#include "sink.h"
 
 #define CONFIG_FILE "/config.json"
+#define CONFIG_JSON_SIZE 2048
+#define WIFI_EXTRA_NETWORKS 2 // запасные сети: прежние основные, новые — первыми
+
+struct WifiCredentials
+{
+  char ssid[33];
+  char password[64];
+};
 
 struct Config
 {
@@ -14,12 +24,29 @@ struct Config
   unsigned long publishingInterval = 10000; // Интервал отправки данных (в миллисекундах)
   float temp_offset = 0.0;                  // Калибровка температуры
   char post_url[64] = "";                   // POST
+  char influx_host[64] = "";                // InfluxDB line protocol по UDP (пусто — выключено)
+  uint16_t influx_port = INFLUX_UDP_PORT;
+  unsigned long sink_min_interval[SINK_COUNT] = {}; // Мин. интервал отправки по приёмникам (мс, 0 — по темпу измерений)
   char ota_url[64] = "";                    // OTA
   char ota_result_url[64] = "";             // OTA RESULT
   char uid[32] = "";
+  uint8_t payload_format = 0;               // Формат данных MQTT/HTTP (PayloadFormat)
+  bool adaptive_interval = false;           // Адаптивный интервал опроса
+  bool align_interval = false;              // Измерения по границам интервала, отправка в слоте узла (publish_slot.h)
+  unsigned long interval_min = 5000;        // Границы интервала в обычном режиме (мс)
+  unsigned long interval_max = 60000;
+  unsigned long sleep_min = 60;             // Границы глубокого сна (с)
+  unsigned long sleep_max = 3600;
+  bool ulp_wake = false;                    // Глубокий сон: будить по порогу напряжения (ULP)
+  bool low_power = false;                   // Обычный режим: modem sleep, light sleep, DFS
+  uint8_t espnow_mode = 0;                  // EspNowMode: узел на батарее или шлюз
+  uint8_t espnow_channel = 1;               // Канал Wi-Fi шлюза (узлы не сканируют)
+  WifiCredentials wifi_extra[WIFI_EXTRA_NETWORKS] = {};
 };
 
 extern Config config;
+extern uint32_t configRevision; // растёт при каждой загрузке и сохранении (ETag /api/config)
 
 void saveConfig();
-void loadConfig();
\ No newline at end of file
+void loadConfig();
+void configSetNetwork(const char *ssid, const char *password); // прежняя основная сеть — в запасные
\ No newline at end of file
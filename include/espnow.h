@@ -0,0 +1,68 @@
+#pragma once
+// Узлы на батарее без подключения к Wi-Fi: кадр с показаниями по ESP-NOW за несколько мс.
+// Узел с сетевым питанием (та же прошивка) работает шлюзом: отбрасывает повторы,
+// хранит последнее показание каждого узла и пересылает их через приёмники sink.h (MQTT, HTTP, UDP).
+//
+// Кадр (little-endian, ESPNOW_FRAME_SIZE байт) — поля SensorReading как есть:
+//   0  magic ESPNOW_FRAME_MAGIC    1  версия             2  флаги SampleFlag
+//   3  seq (u16)                   5  t, 0.01 °C (i16)   7  h, 0.1 % (u16)
+//   9  p, Па (u32)                 13 vcc, мВ (u16)      15 метка времени, мс (u64, 0 — нет)
+// Значение без флага канала не передано (датчика нет или он не ответил).
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+
+#define ESPNOW_FRAME_MAGIC 0xE5
+#define ESPNOW_FRAME_VERSION 2
+#define ESPNOW_FRAME_SIZE 23
+#define ESPNOW_NODE_REPEATS 3         // широковещательные кадры не подтверждаются — шлём повторы
+#define GATEWAY_MAX_NODES 32
+#define GATEWAY_QUEUE_SIZE 32         // кадров между двумя разборами очереди
+#define GATEWAY_POLL_MS 1000          // период разбора очереди на шлюзе
+#define GATEWAY_DUPLICATE_MS 5000     // тот же seq позже — новый цикл узла после сброса
+#define GATEWAY_SEQ_WINDOW 64         // скачок seq больше окна — перезапуск узла, а не потери
+
+enum EspNowMode : uint8_t
+{
+  ESPNOW_OFF = 0,
+  ESPNOW_NODE = 1,    // глубокий сон: кадр вместо Wi-Fi + MQTT
+  ESPNOW_GATEWAY = 2  // обычный режим: приём и пересылка
+};
+
+struct GatewayNode
+{
+  uint8_t mac[6];
+  int8_t rssi;
+  bool pending;      // есть показание, ещё не поставленное в очереди всех приёмников
+  uint8_t queuedSinks; // маска приёмников (sink.h), уже принявших показание
+  uint32_t lastSeenMs;
+  uint32_t frames;
+  uint32_t lost;     // пропуски seq
+  uint16_t seq;      // номер последнего принятого кадра
+  SensorReading reading;
+};
+
+struct GatewayStats
+{
+  uint32_t received;   // все кадры из эфира
+  uint32_t accepted;
+  uint32_t duplicates;
+  uint32_t lost;
+  uint32_t malformed;
+  uint32_t overflows;  // очередь приёма была полна
+  uint32_t evicted;    // таблица узлов была полна
+  uint32_t forwarded;
+};
+
+extern GatewayNode gatewayNodes[GATEWAY_MAX_NODES];
+extern uint8_t gatewayNodeCount;
+extern GatewayStats gatewayStats;
+
+size_t encodeNodeFrame(uint8_t *buf, size_t size, uint16_t seq, const SensorReading &reading);
+bool decodeNodeFrame(const uint8_t *buf, size_t len, uint16_t &seq, SensorReading &reading);
+
+void gatewayReset();
+void gatewayReceive(const uint8_t mac[6], int rssi, const uint8_t *data, size_t len);
+uint8_t gatewayPoll(uint32_t nowMs, uint64_t nowTimestamp);
+uint8_t gatewayForward();
+size_t encodeGatewayStats(char *buf, size_t size);
@@ -0,0 +1,39 @@
+#pragma once
+// Состав прошивки на этапе сборки: модуль отключается флагом окружения в platformio.ini,
+// например -DFEATURE_WEB=0. По умолчанию собирается всё.
+// Отключённый модуль не компилируется (тело файла под #if) и не тянет свою библиотеку;
+// для MQTT и HTTP POST заголовки подставляют пустые inline-заглушки, и вызовы
+// в остальном коде сворачиваются компилятором без #if на месте вызова.
+
+#ifndef FEATURE_WEB
+#define FEATURE_WEB 1 // веб-интерфейс и REST API (ESPAsyncWebServer, AsyncTCP)
+#endif
+
+#ifndef FEATURE_MQTT
+#define FEATURE_MQTT 1 // публикация и команды MQTT (PubSubClient)
+#endif
+
+#ifndef FEATURE_HTTP_POST
+#define FEATURE_HTTP_POST 1 // отправка показаний POST-запросом на post_url (HTTPClient, TLS)
+#endif
+
+#ifndef FEATURE_OTA
+#define FEATURE_OTA 1 // проверка и загрузка обновлений (HTTPClient, Update)
+#endif
+
+#ifndef FEATURE_TRACE
+#define FEATURE_TRACE 0 // трассировка задач и участков кода (trace.h): 12 КБ RAM, хук тика
+#endif
+
+// Драйверы датчиков (sensor_drivers.cpp)
+#ifndef FEATURE_DHT22
+#define FEATURE_DHT22 1 // библиотека Adafruit DHT
+#endif
+
+#ifndef FEATURE_BMP180
+#define FEATURE_BMP180 1
+#endif
+
+#ifndef FEATURE_SHT3X
+#define FEATURE_SHT3X 1
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+// Тонкий слой абстракции оборудования.
+// hal_esp32.cpp — реальная плата (DHT22, шина I2C, LittleFS, WiFi, ESP-NOW, PubSubClient, HTTPClient);
+// hal_native.cpp — сборка [env:native]: симулированные датчики (DHT22 и BMP180 на шине I2C), файловая система в памяти,
+// MQTT/HTTP поверх сокетов Linux.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// === Часы ===
+uint32_t halMillis();
+uint32_t halMicros();
+void halDelay(uint32_t ms);
+uint64_t halClockUs(); // свободно идущие часы для timebase.cpp; не сбрасываются глубоким сном
+
+// === Журнал (Serial на плате, stdout на Linux); строки готовит log.cpp ===
+void halLogWrite(const char *text, size_t len);
+
+uint32_t halFreeHeap(); // свободная куча, байт
+uint32_t halRandom();   // аппаратный ГСЧ на плате, rand() на Linux (повторяемо для симуляции)
+
+// === Задачи (trace.cpp) ===
+uint8_t halCpuCore();
+uint32_t halTaskId(); // текущая задача: хендл FreeRTOS на плате
+typedef void (*HalTaskFn)(uint32_t id, const char *name, void *ctx);
+void halTaskForEach(HalTaskFn fn, void *ctx); // существующие задачи
+
+// === Датчики ===
+bool halDhtBegin();
+bool halReadDht(float &temperature, float &humidity);
+int halReadBatteryRaw();                 // 12-бит АЦП, делитель 100k+100k
+
+// === Шина I2C (драйверы в sensor_drivers.cpp); false — NACK или ошибка шины ===
+bool halI2cBegin(uint32_t frequencyHz);
+bool halI2cWrite(uint8_t address, const uint8_t *data, size_t len);
+bool halI2cRead(uint8_t address, uint8_t *data, size_t len);
+// Запись (обычно адрес регистра) и чтение одной транзакцией с repeated start
+bool halI2cWriteRead(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+
+// === Файловая система ===
+bool halFsBegin();
+void halFsEnd();
+bool halFsExists(const char *path);
+size_t halFsRead(const char *path, char *buf, size_t size); // 0 — файла нет или пуст
+bool halFsWrite(const char *path, const char *data, size_t len);
+bool halFsRemove(const char *path);
+// Файлы истории: дозапись в конец и чтение с произвольного смещения без загрузки файла целиком
+bool halFsAppend(const char *path, const uint8_t *data, size_t len);
+size_t halFsReadAt(const char *path, size_t offset, uint8_t *buf, size_t size); // 0 — конец файла или ошибка
+size_t halFsSize(const char *path);                                              // 0 — файла нет
+bool halFsRename(const char *from, const char *to);
+
+// === Сеть ===
+bool halNetConnected();
+int halNetRssi();
+void halMacAddress(uint8_t mac[6]);
+
+void halMqttBegin(const char *host, uint16_t port);
+bool halMqttConnect(const char *clientId, const char *user, const char *password);
+bool halMqttConnected();
+int halMqttState();
+void halMqttLoop();
+bool halMqttPublish(const char *topic, const uint8_t *payload, size_t len, bool retain);
+// Сообщение известной длины порциями, без буфера на всё сообщение
+bool halMqttPublishBegin(const char *topic, size_t len, bool retain);
+bool halMqttPublishWrite(const uint8_t *data, size_t len);
+bool halMqttPublishEnd();
+// Входящие сообщения (QoS 0) доставляются колбэком из halMqttLoop()
+typedef void (*HalMqttReceiveFn)(const char *topic, const uint8_t *payload, size_t len);
+void halMqttOnMessage(HalMqttReceiveFn onMessage);
+bool halMqttSubscribe(const char *topic);
+
+// Одна датаграмма и ожидание ответа; длина ответа или -1 (ошибка, тайм-аут)
+int halUdpRequest(const char *host, uint16_t port, const uint8_t *tx, size_t txLen,
+                  uint8_t *rx, size_t rxSize, uint32_t timeoutMs);
+// Датаграмма без ответа: сокет остаётся открытым, адрес разрешается заново только при смене host
+bool halUdpSend(const char *host, uint16_t port, const uint8_t *data, size_t len);
+
+// http:// или https:// (проверка сервера по halCaBundle(), возобновление сессии из tlsSession)
+int halHttpPost(const char *url, const char *contentType, const uint8_t *body, size_t len, uint32_t timeoutMs);
+const char *halCaBundle(); // PEM из TLS_CA_BUNDLE_FILE (читается один раз) или nullptr
+
+// === Радио без ассоциации с AP (ESP-NOW на плате, общий эфир в процессе на Linux) ===
+// Колбэк приёма вызывается из потока радио; rssi = 0, если неизвестен
+typedef void (*HalRadioReceiveFn)(const uint8_t mac[6], int rssi, const uint8_t *data, size_t len);
+bool halRadioBegin(uint8_t channel, HalRadioReceiveFn onReceive); // channel = 0 — канал текущего AP
+bool halRadioSend(const uint8_t *data, size_t len);                // широковещательно, ждёт окончания передачи
+void halRadioEnd();
+
+// strlcpy/strlcat есть в newlib, но в glibc появились только в 2.38
+#if !defined(ARDUINO) && defined(__GLIBC__)
+#if !__GLIBC_PREREQ(2, 38)
+#define HAL_NEED_STRLCPY 1
+size_t strlcpy(char *dst, const char *src, size_t size);
+size_t strlcat(char *dst, const char *src, size_t size);
+#endif
+#endif
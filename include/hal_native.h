@@ -0,0 +1,38 @@
+#pragma once
+// Управление симуляцией в сборке [env:native] (только для Linux)
+#include <stdint.h>
+
+// Состояние одного узла (MAC, файлы, датчики, MQTT-сокет); по умолчанию выбран встроенный
+struct NativeNode;
+
+// Счётчики трафика по всем узлам
+struct HalSimTraffic
+{
+  uint64_t mqttMessages;
+  uint64_t mqttBytes;
+  uint64_t httpRequests;
+  uint64_t httpBytes;
+  uint64_t httpErrors;
+  uint64_t udpDatagrams; // halUdpSend()
+  uint64_t udpBytes;
+  uint64_t connectAttempts;
+  uint64_t connects;
+  uint64_t disconnects;
+  uint64_t radioFrames; // отправленные кадры ESP-NOW
+  uint64_t radioLost;   // не доставленные получателю (halSimSetRadioLoss)
+};
+
+NativeNode *halSimCreateNode();
+void halSimSelectNode(NativeNode *node);
+void halSimDropConnection();
+const HalSimTraffic &halSimTraffic();
+
+void halSimSetLogEnabled(bool enabled);
+void halSimSetNullNetwork(bool enabled);
+void halSimSetVirtualDelays(bool enabled); // halDelay() без ожидания (бенчмарки, парк узлов)
+void halSimSetMac(const uint8_t mac[6]);
+void halSimSetSensorFault(bool dhtFailed, bool bmpFailed);
+void halSimSetBatteryVoltage(float volts);
+void halSimSetClockDrift(float ppm); // halClockUs() отстаёт от реального времени на ppm
+void halSimSetRadioLoss(float probability); // доля кадров радио, потерянных для каждого получателя
+void halSimSetWeather(float meanTemp, float tempAmplitude, float pressurePa);
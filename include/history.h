@@ -0,0 +1,107 @@
+#pragma once
+// История показаний во флеше (LittleFS) с выборкой по интервалу времени.
+// Показания сжимаются блоками (history_codec.h, CODEC_BLOCK_SIZE байт, 5–7 байт на показание
+// вместо 24) в сегменты по суткам UTC: /h<сутки>.dat — заполненные блоки по возрастанию
+// метки времени. Каждый блок декодируется сам по себе, а его заголовок начинается с
+// метки первого показания, поэтому индекс не нужен: поиск начала интервала — двоичный
+// поиск по заголовкам блоков. Заполняемый блок — в памяти и в HISTORY_OPEN_FILE
+// (перезаписывается на каждое показание). Записи читаются по блоку прямо из файла,
+// так что память на запрос не зависит от длины интервала.
+// Границы хранимых суток — в HISTORY_META_FILE; старейшие сутки удаляются сверх HISTORY_SEGMENTS.
+#include <stddef.h>
+#include <stdint.h>
+#include "history_codec.h"
+#include "sample.h"
+
+#define HISTORY_META_FILE "/hist.meta"
+#define HISTORY_SEGMENT_MS 86400000ULL // сутки
+#define HISTORY_OPEN_FILE "/h.open"
+#define HISTORY_SEGMENTS 90            // ~8 КБ на сутки при показании раз в минуту
+#define HISTORY_CHUNK_RECORDS 16       // записей за один вызов historyRead()
+#define HISTORY_TEXT_SIZE 256          // заголовок или строка ответа
+#define HISTORY_ID_SIZE 24
+#define HISTORY_MQTT_LIMIT 2000        // строк в ответе MQTT без явного limit
+
+struct HistoryStats
+{
+  uint32_t appended;
+  uint32_t outOfOrder;  // метка раньше последней записанной (шаг часов назад)
+  uint32_t unsynced;    // время неизвестно — не записано
+  uint32_t writeErrors;
+  uint32_t repaired;    // сегменты с оборванным последним блоком
+  uint32_t sealedBlocks;  // блоков записано в сегменты с загрузки
+  uint32_t sealedRecords; // показаний в этих блоках
+  uint32_t queries;
+  uint32_t rowsServed;
+};
+
+extern HistoryStats historyStats;
+
+// Позиция чтения: сегменты [segment, lastSegment], блок block в segment.
+// to ограничен последней записанной меткой на момент поиска — показания, дописанные
+// позже, в выборку не попадают (повторный проход по тому же запросу даёт тот же ответ)
+struct HistoryCursor
+{
+  uint32_t segment;
+  uint32_t lastSegment;
+  uint32_t openSegment; // сегмент заполняемого блока на момент поиска
+  uint32_t block;       // следующий блок в segment
+  uint64_t from;
+  uint64_t to;
+  bool done;
+  bool loaded;          // data декодируется
+  bool openRead;        // заполняемый блок уже прочитан
+  CodecState state;
+  uint8_t data[CODEC_BLOCK_SIZE];
+};
+
+// Параметры запроса — одинаковые в URL /api/history и в теле запроса MQTT
+struct HistoryQuery
+{
+  uint64_t from;  // мс от эпохи Unix, включительно
+  uint64_t to;    // включительно
+  uint32_t limit; // 0 — без ограничения
+  char id[HISTORY_ID_SIZE]; // возвращается в ответе (сопоставление запроса и ответа MQTT)
+};
+
+enum HistoryStreamPhase : uint8_t
+{
+  HISTORY_HEADER = 0,
+  HISTORY_ROWS,
+  HISTORY_FOOTER,
+  HISTORY_DONE
+};
+
+// JSON-ответ, собираемый порциями:
+// {"uid":..,"from":..,"to":..,"columns":[...],"rows":[[t,°C,%,мм рт. ст.,В],...],"count":N,"truncated":false}
+struct HistoryStream
+{
+  HistoryQuery query;
+  HistoryCursor cursor;
+  SensorReading chunk[HISTORY_CHUNK_RECORDS];
+  uint8_t chunkLen;
+  uint8_t chunkPos;
+  uint8_t phase; // HistoryStreamPhase
+  bool truncated;
+  uint32_t rows;
+  uint16_t textLen;
+  uint16_t textPos;
+  char text[HISTORY_TEXT_SIZE];
+};
+
+bool historyBegin();
+void historyReset(); // забыть состояние в памяти, как при перезагрузке; файлы остаются
+bool historyAppend(const SensorReading &reading);
+uint32_t historyBlockCount(); // заполненных блоков в текущих сутках
+
+bool historySeek(HistoryCursor &cursor, uint64_t from, uint64_t to);
+size_t historyRead(HistoryCursor &cursor, SensorReading *out, size_t max); // 0 — интервал исчерпан
+
+void historyQueryInit(HistoryQuery &query);
+bool historySetParam(HistoryQuery &query, const char *name, const char *value);
+bool historyParseQuery(const char *text, size_t len, HistoryQuery &query); // "from=..&to=..&limit=..&id=.."
+
+void historyStreamBegin(HistoryStream &stream, const HistoryQuery &query);
+size_t historyStreamRead(HistoryStream &stream, char *buf, size_t size); // 0 — ответ закончен
+// Длина ответа без вывода (для заголовка MQTT); поток возвращается к началу
+size_t historyStreamMeasure(HistoryStream &stream);
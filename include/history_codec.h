@@ -0,0 +1,52 @@
+#pragma once
+// Сжатие показаний для истории во флеше (по мотивам Gorilla).
+// Блок фиксированного размера декодируется независимо от остальных:
+//   0  метка времени первого показания, мс (u64)   8  показаний (u16)   10 занято бит (u16)
+//   12 поток бит (старший бит первым):
+//      метка — разность разностей (первого показания — 0),
+//      флаги — «0» (как у предыдущего) или «1» + 8 бит,
+//      номер показания — разность разностей,
+//      каналы с флагом SAMPLE_* — разность с последним действительным значением канала.
+// Значения уже целые (фиксированная точка), поэтому вместо XOR для float —
+// разности целых в корзинах переменной длины. Значение недействительного канала
+// не хранится (после декодирования — 0, как после sampleSet*()).
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+
+#define CODEC_BLOCK_SIZE 256
+#define CODEC_HEADER_SIZE 12
+#define CODEC_BLOCK_BITS ((CODEC_BLOCK_SIZE - CODEC_HEADER_SIZE) * 8)
+
+enum CodecChannel : uint8_t
+{
+  CODEC_TEMPERATURE = 0,
+  CODEC_HUMIDITY,
+  CODEC_PRESSURE,
+  CODEC_VCC,
+  CODEC_CHANNEL_COUNT
+};
+
+// Состояние после последнего показания блока (общее для кодера и декодера)
+struct CodecState
+{
+  uint64_t timestamp;
+  int64_t timeDelta;
+  uint32_t sample;
+  int32_t sampleDelta;
+  int32_t values[CODEC_CHANNEL_COUNT]; // последние действительные значения
+  uint8_t flags;
+  uint16_t count;  // показаний пройдено
+  uint16_t bitPos; // позиция в потоке бит
+};
+
+void codecBlockBegin(uint8_t *block, CodecState &state);
+bool codecBlockAppend(uint8_t *block, CodecState &state, const SensorReading &reading); // false — не помещается
+bool codecBlockResume(const uint8_t *block, CodecState &state); // состояние кодера по готовому блоку
+
+uint64_t codecBlockFirstTimestamp(const uint8_t *block);
+uint16_t codecBlockCount(const uint8_t *block);
+uint16_t codecBlockBits(const uint8_t *block);
+
+void codecDecodeBegin(const uint8_t *block, CodecState &state);
+bool codecDecodeNext(const uint8_t *block, CodecState &state, SensorReading &reading); // false — показания кончились
@@ -0,0 +1,40 @@
+#pragma once
+// Потоковый рендеринг HTML-шаблонов: статические фрагменты читаются прямо из флеша,
+// поля {{name}} форматируются по одному в небольшой буфер рендерера.
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+#define HTML_VALUE_SIZE 192
+
+// Значение поля name (индекс index для списков) в out; *len — длина.
+// Возвращает true, если у поля есть следующий элемент.
+typedef bool (*HtmlFieldFn)(void *ctx, const char *name, size_t nameLen, uint16_t index,
+                            char *out, size_t size, size_t *len);
+
+struct HtmlRenderer
+{
+  const char *const *parts; // фрагменты страницы, заканчиваются nullptr
+  HtmlFieldFn field;
+  void *ctx;
+  uint16_t part;
+  uint32_t pos;
+  const char *name;
+  uint8_t nameLen;
+  uint16_t index;
+  bool more;
+  uint16_t valueLen;
+  uint16_t valuePos;
+  uint32_t total; // байт отдано
+  char value[HTML_VALUE_SIZE];
+};
+
+void htmlBegin(HtmlRenderer &r, const char *const *parts, HtmlFieldFn field, void *ctx);
+size_t htmlRender(HtmlRenderer &r, uint8_t *buf, size_t size);
+
+bool htmlFieldIs(const char *name, size_t nameLen, const char *expected);
+size_t htmlFormat(char *out, size_t size, const char *format, ...) __attribute__((format(printf, 3, 4)));
+size_t htmlEscape(char *out, size_t size, const char *src);
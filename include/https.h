@@ -0,0 +1,53 @@
+#pragma once
+// HTTPS для POST и OTA: проверка сервера по пакету корневых сертификатов во флеше
+// (TLS_CA_BUNDLE_FILE в LittleFS) и возобновление TLS-сессии (тикет или ID).
+// Сериализованная сессия лежит в памяти RTC и переживает глубокий сон:
+// после пробуждения — сокращённое рукопожатие без проверки цепочки и обмена ключами.
+#include <stddef.h>
+#include <stdint.h>
+
+#define TLS_CA_BUNDLE_FILE "/ca_bundle.pem"
+#define TLS_CA_BUNDLE_MAX 8192
+// Сериализованная сессия: на плате — без сертификата сервера (тикет/ID, ключи; ~200-400 байт),
+// OpenSSL в симуляторе хранит и сертификат. Не влезла — в лог нужный размер, следующее рукопожатие полное
+#define TLS_SESSION_MAX 2048
+#define HTTPS_HOST_SIZE 64
+
+struct HttpUrl
+{
+  bool secure;
+  char host[HTTPS_HOST_SIZE];
+  uint16_t port;
+  const char *path; // указатель в исходную строку
+};
+
+// Последняя сессия (одна: post_url и ota_url обычно на одном сервере)
+struct TlsSessionCache
+{
+  char host[HTTPS_HOST_SIZE];
+  uint16_t port;
+  uint16_t len; // 0 — сессии нет
+  uint8_t data[TLS_SESSION_MAX];
+};
+
+struct TlsStats
+{
+  uint32_t fullHandshakes;
+  uint32_t resumedHandshakes;
+  uint32_t failures;
+  uint32_t lastHandshakeUs;
+  uint32_t maxFullUs;
+  uint32_t maxResumedUs;
+  uint32_t lastHeapBytes; // память на соединение (пик во время рукопожатия)
+  uint32_t peakHeapBytes;
+};
+
+extern TlsSessionCache tlsSession; // RTC_DATA_ATTR на плате (hal_esp32.cpp)
+extern TlsStats tlsStats;
+
+bool httpParseUrl(const char *url, HttpUrl &out);
+
+const uint8_t *tlsSessionFor(const char *host, uint16_t port, size_t *len);
+void tlsSessionStore(const char *host, uint16_t port, const uint8_t *data, size_t len);
+void tlsSessionClear();
+void tlsRecordHandshake(const char *host, bool resumed, uint32_t handshakeUs, uint32_t heapBytes);
@@ -0,0 +1,195 @@
+#pragma once
+// Журнал с уровнями по модулям.
+// Вызов logInfo()/logWarn()… не форматирует текст: в запись кольцевого буфера в RAM кладутся
+// указатель на строку формата (литерал во флеше), метка времени и аргументы с их типами,
+// строки-аргументы копируются. Буфер без блокировок (несколько писателей — задачи и колбэки
+// AsyncTCP, один читатель); если он полон, запись отбрасывается и учитывается в logStats.dropped —
+// вызывающий не ждёт никогда. Из обработчиков прерываний не вызывать: пробуждение задачи вывода —
+// xTaskNotifyGive().
+// Форматирует и выводит читатель — logDrain(): на плате из задачи низкого приоритета
+// (logBegin(), log_esp32.cpp), до её запуска и на Linux — сразу в вызове журнала.
+// Готовые строки остаются в истории последних LOG_HISTORY_LINES строк: её читают
+// /api/logs и публикация в топик <base>/log (mqtt.cpp).
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_RING_SLOTS 32     // степень двойки
+#define LOG_MAX_ARGS 8
+#define LOG_TEXT_SIZE 64      // строки-аргументы одной записи вместе (с нулями), дальше — обрезаются
+#define LOG_LINE_SIZE 160     // строка после форматирования
+#define LOG_HISTORY_LINES 48
+
+enum LogLevel : uint8_t
+{
+  LOG_NONE = 0, // только для порога: модуль молчит
+  LOG_ERROR,
+  LOG_WARN,
+  LOG_INFO,
+  LOG_DEBUG
+};
+
+// Модуль — метка строки ([MQTT] …) и свой порог уровня
+enum LogModule : uint8_t
+{
+  LOG_BOOT = 0,
+  LOG_CONFIG,
+  LOG_FS,
+  LOG_WIFI,
+  LOG_MQTT,
+  LOG_HTTP,
+  LOG_TLS,
+  LOG_WEB,
+  LOG_API,
+  LOG_SENSORS,
+  LOG_SCHED,
+  LOG_HIST,
+  LOG_TIME,
+  LOG_TASK,
+  LOG_POWER,
+  LOG_ULP,
+  LOG_ESPNOW,
+  LOG_PAYLOAD,
+  LOG_SINK,
+  LOG_OTA,
+  LOG_LOG,
+  LOG_SIM,
+  LOG_MODULE_COUNT
+};
+
+#define LOG_LEVEL_DEFAULT LOG_INFO
+#define LOG_MQTT_LEVEL_DEFAULT LOG_WARN // в топик <base>/log — только предупреждения и ошибки
+
+enum LogArgType : uint8_t
+{
+  LOG_ARG_INT = 0,
+  LOG_ARG_UINT,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_TEXT, // смещение в LogRecord::text
+  LOG_ARG_POINTER
+};
+
+struct LogRecord
+{
+  uint32_t seq; // очередь Вьюкова: позиция, для которой слот свободен / заполнен (log.cpp)
+  uint32_t timeMs;
+  const char *format;
+  uint8_t level;
+  uint8_t module;
+  uint8_t argCount;
+  uint8_t textLen;
+  uint8_t types[LOG_MAX_ARGS];
+  union
+  {
+    int64_t i;
+    uint64_t u;
+    double d;
+  } args[LOG_MAX_ARGS];
+  char text[LOG_TEXT_SIZE];
+};
+
+// Строка истории; version — защёлка, как у снимка показаний (sensors.cpp)
+struct LogLine
+{
+  uint32_t version; // нечётная — строка переписывается
+  uint32_t seq;     // номер строки с загрузки
+  uint8_t level;
+  uint8_t module;
+  char text[LOG_LINE_SIZE];
+};
+
+// Чтение истории порциями (/api/logs) — как HistoryStream: строки не собираются в памяти целиком
+struct LogCursor
+{
+  uint32_t next;   // номер следующей строки
+  uint32_t end;    // строки с номером >= end появились после начала чтения
+  uint8_t level;   // строки с уровнем выше — пропускаются
+  bool loaded;     // line прочитана, выдано offset байт
+  uint16_t offset;
+  uint32_t skipped; // вытеснены до того, как до них дошло чтение
+  LogLine line;
+};
+
+struct LogStats
+{
+  uint32_t written;  // записей в буфер
+  uint32_t dropped;  // буфер был полон
+  uint32_t truncated; // строки-аргументы или готовая строка не поместились
+  uint32_t lines;    // строк выведено (номер следующей строки истории)
+};
+
+typedef void (*LogWakeFn)();
+
+extern uint8_t logLevels[LOG_MODULE_COUNT];
+extern uint8_t logMqttLevel;
+extern LogStats logStats;
+
+// === Запись ===
+LogRecord *logReserve(uint8_t level, uint8_t module, const char *format, uint32_t &pos); // nullptr — полон
+void logCommit(LogRecord *record, uint32_t pos);
+
+inline void logPack(LogRecord &r, uint8_t i, int v) { r.types[i] = LOG_ARG_INT; r.args[i].i = v; }
+inline void logPack(LogRecord &r, uint8_t i, long v) { r.types[i] = LOG_ARG_INT; r.args[i].i = v; }
+inline void logPack(LogRecord &r, uint8_t i, long long v) { r.types[i] = LOG_ARG_INT; r.args[i].i = v; }
+inline void logPack(LogRecord &r, uint8_t i, unsigned v) { r.types[i] = LOG_ARG_UINT; r.args[i].u = v; }
+inline void logPack(LogRecord &r, uint8_t i, unsigned long v) { r.types[i] = LOG_ARG_UINT; r.args[i].u = v; }
+inline void logPack(LogRecord &r, uint8_t i, unsigned long long v) { r.types[i] = LOG_ARG_UINT; r.args[i].u = v; }
+inline void logPack(LogRecord &r, uint8_t i, double v) { r.types[i] = LOG_ARG_DOUBLE; r.args[i].d = v; }
+inline void logPack(LogRecord &r, uint8_t i, const void *v) { r.types[i] = LOG_ARG_POINTER; r.args[i].u = (uintptr_t)v; }
+void logPack(LogRecord &r, uint8_t i, const char *v); // копия в r.text
+inline void logPack(LogRecord &r, uint8_t i, char *v) { logPack(r, i, (const char *)v); }
+
+inline void logPackAll(LogRecord &, uint8_t) {}
+
+template <typename T, typename... Rest>
+inline void logPackAll(LogRecord &r, uint8_t i, T first, Rest... rest)
+{
+  logPack(r, i, first);
+  logPackAll(r, i + 1, rest...);
+}
+
+/**
+ * @brief Запись в журнал: проверка порога, слот буфера, копия аргументов — без форматирования
+ */
+template <typename... Args>
+inline void logWrite(uint8_t level, uint8_t module, const char *format, Args... args)
+{
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  if (level > logLevels[module])
+    return;
+  uint32_t pos;
+  LogRecord *r = logReserve(level, module, format, pos);
+  if (!r)
+    return;
+  r->argCount = sizeof...(Args);
+  logPackAll(*r, 0, args...);
+  logCommit(r, pos);
+}
+
+template <typename... Args>
+inline void logError(uint8_t module, const char *format, Args... args) { logWrite(LOG_ERROR, module, format, args...); }
+template <typename... Args>
+inline void logWarn(uint8_t module, const char *format, Args... args) { logWrite(LOG_WARN, module, format, args...); }
+template <typename... Args>
+inline void logInfo(uint8_t module, const char *format, Args... args) { logWrite(LOG_INFO, module, format, args...); }
+template <typename... Args>
+inline void logDebug(uint8_t module, const char *format, Args... args) { logWrite(LOG_DEBUG, module, format, args...); }
+
+// === Вывод (один читатель) ===
+void logSetWake(LogWakeFn wake); // nullptr — выводить сразу в вызове журнала
+size_t logDrain();               // записи буфера → halLogWrite() и история; число строк
+bool logConsumerIdle();          // задаче вывода: true — очередь пуста, спать до вызова LogWakeFn
+size_t logFormat(const LogRecord &r, char *out, size_t size);
+
+// === История и уровни ===
+bool logReadLine(uint32_t seq, LogLine &line); // false — строки нет (ещё не было или уже вытеснена)
+uint32_t logOldestLine();
+void logCursorBegin(LogCursor &cursor, uint32_t since, uint8_t level);
+size_t logCursorRead(LogCursor &cursor, char *buf, size_t size); // строки с '\n'; 0 — конец
+const char *logModuleName(uint8_t module);
+const char *logLevelName(uint8_t level);
+int logParseModule(const char *name); // -1 — неизвестен
+int logParseLevel(const char *name);
+bool logApplySetting(const char *setting, size_t len); // "mqtt=debug", "*=warn", "topic=info"
+
+// Только на плате (log_esp32.cpp)
+void logBegin();
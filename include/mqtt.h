@@ -1,13 +1,56 @@
 #pragma once
-#include <WiFi.h>
-#include <PubSubClient.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "feature_flags.h"
 
-extern WiFiClient espClient;
-extern PubSubClient mqttClient;
+#define MQTT_TOPIC_SIZE 64
+#define MQTT_LOOP_PERIOD_MS 5000 // handleMqtt() между измерениями: keepalive PubSubClient — 15 с
+// Переподключение: пауза удваивается от MIN до MAX и берётся случайной в [пауза/2, пауза],
+// первая попытка после потери связи — в случайный момент до MIN: узлы парка не стучатся разом
+#define MQTT_RECONNECT_MIN_MS 2000UL
+#define MQTT_RECONNECT_MAX_MS 60000UL
 
+// Состояние соединения (отдельной структурой — симулятор парка узлов подменяет его на каждый узел)
+struct MqttSession
+{
+  unsigned long lastReconnectAttempt;
+  uint32_t reconnectDelayMs; // до следующей попытки из handleMqtt()
+  uint8_t reconnectFailures; // неудачных попыток подряд
+};
+
+extern MqttSession mqttSession;
+
+struct SensorReading;
+struct UlpHistory;
+
+#if FEATURE_MQTT
 void initMqtt();
 void reconnectMqtt();
 void handleMqtt();
-void publishSensorData(float currentTemp, float currentHumidity, float currentPressure);
-String generateMqttBaseTopic();
+uint32_t mqttServiceWaitMs(); // когда handleMqtt() нужен снова: keepalive или срок попытки подключения
+bool publishSensorData(const SensorReading &reading); // приёмник SINK_MQTT (sink.h)
+bool publishUlpHistory(const UlpHistory &history, uint64_t firstTimestamp);
+bool publishNodeReading(const uint8_t mac[6], const SensorReading &reading);
+bool publishGatewayStats();
+size_t generateMqttBaseTopic(char *buf, size_t size);
 bool isMqttConfigured();
+bool isMqttConnected();
+#else
+// Сборка без MQTT (feature_flags.h): узел «не настроен», публикации — пустые
+inline void initMqtt() {}
+inline void reconnectMqtt() {}
+inline void handleMqtt() {}
+inline uint32_t mqttServiceWaitMs() { return MQTT_LOOP_PERIOD_MS; }
+inline bool publishSensorData(const SensorReading &) { return false; }
+inline bool publishUlpHistory(const UlpHistory &, uint64_t) { return false; }
+inline bool publishNodeReading(const uint8_t[6], const SensorReading &) { return false; }
+inline bool publishGatewayStats() { return false; }
+inline size_t generateMqttBaseTopic(char *buf, size_t size)
+{
+  if (size > 0)
+    buf[0] = '\0';
+  return 0;
+}
+inline bool isMqttConfigured() { return false; }
+inline bool isMqttConnected() { return false; }
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+struct SensorReading;
+
+// Формат полезной нагрузки для MQTT и HTTP
+enum PayloadFormat : uint8_t
+{
+  PAYLOAD_TEXT = 0,    // текстовые значения в MQTT, JSON в POST (как раньше)
+  PAYLOAD_MSGPACK = 1, // MessagePack с фиксированной схемой
+  PAYLOAD_FORMAT_COUNT
+};
+
+// Версия фиксированной схемы MessagePack (первый элемент массива).
+// 2: [версия, t, h, p, vcc, метка времени мс]; недействительное значение — nil
+#define PAYLOAD_SCHEMA_VERSION 2
+#define PAYLOAD_MAX_SIZE 256
+#define PAYLOAD_VALUE_SIZE 12
+#define MAC_UID_SIZE 13 // uid по MAC: 12 шестнадцатеричных цифр
+
+// Индексы каналов в текстовом MQTT-представлении
+enum MqttChannel : uint8_t
+{
+  MQTT_CH_TEMPERATURE = 0,
+  MQTT_CH_HUMIDITY,
+  MQTT_CH_PRESSURE,
+  MQTT_CH_COUNT
+};
+
+extern const char *const MQTT_CHANNEL_TOPICS[MQTT_CH_COUNT];
+
+// Статистика кодирования последнего сообщения (с учётом топиков для MQTT)
+struct PayloadStats
+{
+  uint32_t bytes;    // размер сообщения, байт
+  uint32_t encodeUs; // время кодирования, мкс
+};
+
+extern PayloadStats mqttPayloadStats[PAYLOAD_FORMAT_COUNT];
+extern PayloadStats httpPayloadStats[PAYLOAD_FORMAT_COUNT];
+
+const char *payloadFormatName(uint8_t format);
+
+bool isValidTemperature(float value);
+bool isValidHumidity(float value);
+bool isValidPressure(float value);
+
+size_t formatSensorValue(char *buf, size_t size, float value, uint8_t decimals);
+
+size_t encodeMqttText(char values[MQTT_CH_COUNT][PAYLOAD_VALUE_SIZE], const SensorReading &reading);
+size_t encodeMqttPacked(uint8_t *buf, size_t size, const SensorReading &reading);
+size_t encodePostPayload(uint8_t format, uint8_t *buf, size_t size,
+                         const char *uid, int rssi, const SensorReading &reading);
+size_t encodeLineProtocol(char *buf, size_t size, const char *uid, int rssi, const SensorReading &reading);
+size_t formatMacUid(char *buf, size_t size, const uint8_t mac[6]);
+
+void measurePayloadEncodings(size_t baseTopicLen, const char *uid, int rssi, const SensorReading &reading);
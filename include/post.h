@@ -0,0 +1,19 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "feature_flags.h"
+
+#define HTTP_POST_TIMEOUT_MS 10000
+
+struct SensorReading;
+
+#if FEATURE_HTTP_POST
+bool isPostConfigured();
+bool sendPostRequest(const SensorReading &reading); // приёмник SINK_HTTP (sink.h)
+bool sendNodePostRequest(const uint8_t mac[6], int rssi, const SensorReading &reading); // узел ESP-NOW (SINK_HTTP)
+#else
+// Сборка без HTTP POST (feature_flags.h)
+inline bool isPostConfigured() { return false; }
+inline bool sendPostRequest(const SensorReading &) { return false; }
+inline bool sendNodePostRequest(const uint8_t[6], int, const SensorReading &) { return false; }
+#endif
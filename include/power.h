@@ -0,0 +1,20 @@
+#pragma once
+// Энергосберегающий обычный режим (узлы на солнечной панели): modem sleep Wi-Fi,
+// автоматический light sleep между измерениями и DFS. Только для платы (power_esp32.cpp).
+//
+// Граница задержки: радио просыпается раз в POWER_LISTEN_INTERVAL интервалов маяка
+// (102.4 мс), AP копит кадры до этого момента. Веб-интерфейс и входящие TCP-пакеты
+// обслуживаются не позже POWER_LATENCY_BOUND_MS, MQTT (keepalive, входящие) —
+// не реже MQTT_LOOP_PERIOD_MS (mqtt.h).
+#include <stdint.h>
+
+#define POWER_LISTEN_INTERVAL 3     // в интервалах маяка; кратно DTIM 1 и 3 — типичным для AP
+#define POWER_LATENCY_BOUND_MS 400  // 3 × 102.4 мс + пробуждение радио
+#define POWER_CPU_MAX_MHZ 160
+#define POWER_CPU_MIN_MHZ 80        // APB остаётся 80 МГц: UART и I2C не перенастраиваются
+
+bool powerBegin(bool lowPower);
+void powerPrepareWifiConnect(); // перед esp_wifi_connect()
+void powerConfigureWifi();      // после подключения
+void powerBusyBegin();
+void powerBusyEnd();
@@ -0,0 +1,14 @@
+#pragma once
+// Разнесение нагрузки на брокер по парку узлов (config.align_interval).
+// Измерения идут по границам интервала на шкале эпохи (:00, :10, :20… при 10 с) —
+// корзины времени одинаковы у всех узлов и не зависят от момента загрузки.
+// Отправка сдвинута от границы на слот узла: смещение — хеш MAC, поэтому узлы,
+// перезапущенные вместе (общее отключение питания), выходят на связь не разом,
+// а равномерно по окну, и каждый — всегда в одно и то же время.
+#include <stdint.h>
+
+#define PUBLISH_SLOT_MS 100                // шаг слотов
+#define PUBLISH_SLOT_WINDOW_MAX_MS 30000UL // окно — не больше половины интервала и не больше этого
+
+uint32_t publishSlotOffsetMs(const uint8_t mac[6], uint32_t intervalMs); // от границы до отправки
+uint32_t alignedWaitMs(uint64_t epochMs, uint32_t intervalMs);          // до следующей границы, (0, intervalMs]
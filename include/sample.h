@@ -0,0 +1,49 @@
+#pragma once
+// Показание в фиксированной точке: 24 байта вместо float с условным «-999».
+// Значение канала есть, только если установлен его флаг SAMPLE_*; флаг SAMPLE_*_ERROR —
+// датчик канала есть, но не ответил или выдал значение вне допустимого диапазона.
+// Канал без обоих флагов не измерялся (датчика нет). Наружу (MQTT, HTTP, веб)
+// значения выходят через sampleTemperature() и т. п.: NAN для недействительного канала.
+#include <stddef.h>
+#include <stdint.h>
+
+enum SampleFlag : uint8_t
+{
+  SAMPLE_TEMPERATURE = 0x01,
+  SAMPLE_HUMIDITY = 0x02,
+  SAMPLE_PRESSURE = 0x04,
+  SAMPLE_VCC = 0x08,
+  SAMPLE_TEMPERATURE_ERROR = 0x10,
+  SAMPLE_HUMIDITY_ERROR = 0x20,
+  SAMPLE_PRESSURE_ERROR = 0x40,
+  SAMPLE_VCC_ERROR = 0x80
+};
+
+#define SAMPLE_VALID_MASK 0x0F
+#define SAMPLE_ERROR_SHIFT 4 // флаг ошибки = флаг канала << SAMPLE_ERROR_SHIFT
+
+#define PA_PER_MMHG 133.322f
+
+struct SensorReading
+{
+  uint64_t timestamp;   // момент измерения, мс от эпохи Unix (0 — время неизвестно)
+  uint32_t sample;      // номер показания с загрузки (0 — показаний ещё не было)
+  uint32_t pressurePa;  // Па
+  int16_t tempCenti;    // 0.01 °C
+  uint16_t humPermille; // 0.1 %
+  uint16_t vccMv;       // мВ
+  uint8_t flags;        // SampleFlag
+  uint8_t reserved;
+};
+
+// Запись канала: NAN или значение вне диапазона помечается ошибкой, а не сохраняется
+void sampleSetTemperature(SensorReading &reading, float celsius);
+void sampleSetHumidity(SensorReading &reading, float percent);
+void sampleSetPressure(SensorReading &reading, float pascals);
+void sampleSetVcc(SensorReading &reading, float volts);
+
+// Чтение в единицах публикации; NAN — канал недействителен
+float sampleTemperature(const SensorReading &reading); // °C
+float sampleHumidity(const SensorReading &reading);    // %
+float samplePressure(const SensorReading &reading);    // мм рт. ст.
+float sampleVcc(const SensorReading &reading);         // В
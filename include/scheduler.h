@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+
+// Уровень активности погоды (определяет интервал опроса)
+enum ScheduleLevel : uint8_t
+{
+  SCHEDULE_FAST = 0,   // фронт/гроза — опрос с минимальным интервалом
+  SCHEDULE_NORMAL = 1, // базовый интервал
+  SCHEDULE_QUIET = 2   // спокойная погода — максимальный интервал
+};
+
+// Состояние батареи (пороги как у прежнего режима сна: 2.8 В и 2.7 В)
+enum BatteryLevel : uint8_t
+{
+  BATTERY_OK = 0,
+  BATTERY_LOW = 1,
+  BATTERY_CRITICAL = 2
+};
+
+// Границы интервала, мс
+struct ScheduleLimits
+{
+  unsigned long minMs;
+  unsigned long baseMs;
+  unsigned long maxMs;
+};
+
+// Состояние планировщика; в режиме сна хранится в RTC-памяти
+struct SchedulerState
+{
+  bool hasPrev;
+  float prevTemp;
+  float prevHum;
+  float prevPres;
+  float tempRate;    // |°C/ч|, сглаженное
+  float humRate;     // |%/ч|, сглаженное
+  float presRate;    // |мм.рт.ст./ч|, сглаженное
+  float activity;    // max(rate / порог) по всем каналам
+  uint32_t windowMs; // время, накопленное с последнего расчёта скорости
+  uint8_t level;     // ScheduleLevel
+  uint8_t battery;   // BatteryLevel
+  uint32_t intervalMs;
+};
+
+extern SchedulerState sampleScheduler;
+
+void schedulerReset(SchedulerState &state, uint32_t baseMs);
+uint32_t schedulerUpdate(SchedulerState &state, const ScheduleLimits &limits, uint32_t elapsedMs,
+                         float temp, float hum, float pres, float vcc);
+const char *scheduleLevelName(uint8_t level);
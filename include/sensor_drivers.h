@@ -0,0 +1,26 @@
+#pragma once
+// Драйверы датчиков для реестра (sensor_registry.h).
+// DHT22 — через HAL (однопроводный протокол), BMP180 и SHT3x — напрямую по шине I2C.
+#include "sensor_registry.h"
+
+extern const SensorDriver DHT22_DRIVER;
+extern const SensorDriver BMP180_DRIVER;
+extern const SensorDriver SHT3X_DRIVER;
+
+// === BMP180: калибровка и пересчёт по даташиту (используется и моделью в hal_native) ===
+#define BMP180_ADDRESS 0x77
+#define BMP180_CHIP_ID 0x55
+#define BMP180_OSS 3 // ultra high resolution, как у прежней библиотеки
+
+struct Bmp180Calibration
+{
+  int16_t ac1, ac2, ac3;
+  uint16_t ac4, ac5, ac6;
+  int16_t b1, b2, mb, mc, md;
+};
+
+void bmp180ParseCalibration(Bmp180Calibration &cal, const uint8_t raw[22]);
+int32_t bmp180Temperature(const Bmp180Calibration &cal, int32_t ut); // 0.1 °C
+int32_t bmp180Pressure(const Bmp180Calibration &cal, int32_t ut, int32_t up, uint8_t oss); // Па
+
+#define SHT3X_ADDRESS 0x44
@@ -0,0 +1,85 @@
+#pragma once
+// Реестр драйверов датчиков и планировщик измерений.
+// Каждый драйвер объявляет свои каналы, время преобразования и желаемый период опроса.
+// Преобразования запускаются сразу у всех датчиков, которым пора, и ожидаются параллельно,
+// поэтому цикл опроса длится столько, сколько самый медленный датчик, а не сумму времён.
+// У каждого датчика — состояние исправности: после SENSOR_FAIL_THRESHOLD неудач подряд
+// (или если датчик не найден) он не опрашивается, а заново ищется begin() с паузой,
+// удваивающейся от SENSOR_BACKOFF_MIN_MS до SENSOR_BACKOFF_MAX_MS. Остальные датчики
+// опрашиваются по расписанию и не ждут тайм-аутов неисправного.
+#include <stdint.h>
+
+#define SENSOR_MAX_DRIVERS 8
+#define SENSOR_FAIL_THRESHOLD 3       // неудач подряд до SENSOR_FAILED
+#define SENSOR_BACKOFF_MIN_MS 30000UL
+#define SENSOR_BACKOFF_MAX_MS 900000UL
+#define I2C_BUS_FREQUENCY 400000 // Fast mode: BMP180, SHT3x и BME280 поддерживают 400 кГц
+
+enum SensorChannel : uint8_t
+{
+  SENSOR_CH_TEMPERATURE = 0, // °C
+  SENSOR_CH_HUMIDITY = 1,    // %
+  SENSOR_CH_PRESSURE = 2,    // Па
+  SENSOR_CH_COUNT
+};
+
+#define SENSOR_CHANNEL_BIT(ch) (1u << (ch))
+
+// Результат шага драйвера
+enum SensorStep : uint8_t
+{
+  SENSOR_STEP_DONE = 0,  // значения записаны
+  SENSOR_STEP_WAIT = 1,  // следующая фаза запущена, повторить через *waitMs
+  SENSOR_STEP_ERROR = 2
+};
+
+#define SENSOR_START_FAILED 0xFFFF
+
+enum SensorHealth : uint8_t
+{
+  SENSOR_HEALTHY = 0,  // последнее измерение успешно
+  SENSOR_DEGRADED = 1, // неудачи подряд, но меньше SENSOR_FAIL_THRESHOLD — опрос по расписанию
+  SENSOR_FAILED = 2    // не найден или отказал — повторный поиск с нарастающей паузой
+};
+
+struct SensorDriver
+{
+  const char *name;
+  uint8_t channels;      // битовая маска SENSOR_CHANNEL_BIT()
+  uint16_t conversionMs; // полное время измерения (справочно, для журнала)
+  uint32_t periodMs;     // не опрашивать чаще
+  bool (*begin)();
+  // Запуск преобразования; возвращает время до первого step() или SENSOR_START_FAILED
+  uint16_t (*start)();
+  // Чтение результата (или переход к следующей фазе преобразования)
+  SensorStep (*step)(float values[SENSOR_CH_COUNT], uint16_t *waitMs);
+};
+
+struct SensorSlot
+{
+  const SensorDriver *driver;
+  bool ready;    // begin() успешен
+  bool active;   // идёт преобразование
+  bool valid;    // последнее измерение успешно
+  uint8_t health;   // SensorHealth
+  uint8_t failures; // неудач подряд
+  uint32_t nextDue;
+  uint32_t readyAt;
+  uint32_t backoffMs; // пауза до следующего поиска (SENSOR_FAILED)
+  uint32_t reads;     // успешных измерений
+  uint32_t errors;    // неудачных измерений и поисков
+  uint32_t probes;    // повторных вызовов begin()
+  uint32_t recoveries;
+  float values[SENSOR_CH_COUNT];
+};
+
+extern SensorSlot sensorSlots[SENSOR_MAX_DRIVERS];
+extern uint8_t sensorSlotCount;
+extern uint32_t sensorCycleMs; // длительность последнего цикла sensorsSample()
+
+bool sensorRegister(const SensorDriver *driver, bool optional = false); // optional: не найден — не добавляется
+void sensorsStart(uint32_t now);
+bool sensorsPoll(uint32_t now, uint32_t *waitMs);
+void sensorsSample();
+float sensorValue(SensorChannel channel); // NAN — нет ни одного исправного источника
+const char *sensorHealthName(uint8_t health);
@@ -0,0 +1,83 @@
+#pragma once
+// Рассылка показаний по приёмникам: каждое показание предлагается всем настроенным —
+// MQTT, HTTP POST на post_url, InfluxDB line protocol по UDP (influx_host).
+// У приёмника своя очередь, ограничение темпа и счётчики — медленный приёмник не задерживает
+// остальные:
+// - очередь — кольцо SINK_QUEUE_SIZE показаний с одним писателем (sinkPublish) и одним читателем
+//   (sinkServe), без блокировок; в полную очередь новое показание не ставится (оно есть в истории);
+// - темп — не чаще config.sink_min_interval[приёмник] мс; 0 — по темпу измерений
+//   (publishingInterval или interval_min в адаптивном режиме, с допуском на дрожание);
+// - без связи показания ждут в очереди; неудачная отправка MQTT и HTTP повторяется через паузу
+//   (удвоение от SINK_RETRY_MIN_MS до SINK_RETRY_MAX_MS), UDP — «отправил и забыл», без повторов.
+// На плате HTTP обслуживает своя задача (sink_esp32.cpp): POST с TLS до HTTP_POST_TIMEOUT_MS
+// не задерживает измерение, MQTT и UDP; те отправляются из задачи измерения.
+// Шлюз ESP-NOW ставит в те же очереди показания узлов (sinkPublishNode): uid — MAC узла,
+// темп не ограничивается (у каждого узла свой), полная очередь примет показание при следующей пересылке.
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+
+#define SINK_QUEUE_SIZE 8 // степень двойки
+#define SINK_RETRY_MIN_MS 5000UL
+#define SINK_RETRY_MAX_MS 300000UL
+#define SINK_OFFLINE_POLL_MS 5000 // задача HTTP без связи проверяет очередь не чаще
+#define SINK_IDLE UINT32_MAX      // sinkServe(): очередь пуста, ждать нечего
+#define INFLUX_UDP_PORT 8089
+
+enum SinkId : uint8_t
+{
+  SINK_MQTT = 0,
+  SINK_HTTP,
+  SINK_UDP,
+  SINK_COUNT
+};
+
+struct SinkStats
+{
+  uint32_t queued;  // поставлено в очередь
+  uint32_t limited; // пропущено ограничением темпа
+  uint32_t dropped; // очередь была полна
+  uint32_t sent;
+  uint32_t failed;  // неудачных попыток, с повторами
+  uint32_t lastUs;  // длительность последней отправки
+  uint32_t maxUs;
+};
+
+// Показание в очереди: своё или узла ESP-NOW, пересылаемое шлюзом
+struct SinkEntry
+{
+  SensorReading reading;
+  uint8_t mac[6]; // узел: MAC — его uid
+  int8_t rssi;    // узел: уровень его кадра
+  bool node;
+};
+
+struct Sink
+{
+  SinkEntry queue[SINK_QUEUE_SIZE];
+  uint32_t head;         // пишет только sinkPublish()/sinkPublishNode()
+  uint32_t tail;         // пишет только sinkServe()
+  uint32_t lastAcceptMs; // темп: время последнего своего показания, принятого в очередь
+  uint32_t retryAtMs;    // повтор после неудачи — не раньше
+  uint8_t failures;      // неудач подряд
+  bool paced;            // своё показание уже предлагалось: темп отсчитывается от lastAcceptMs
+  SinkStats stats;
+};
+
+extern Sink sinks[SINK_COUNT];
+
+typedef void (*SinkWakeFn)();
+
+const char *sinkName(uint8_t sink);
+bool sinkEnabled(uint8_t sink); // приёмник настроен (и собран, feature_flags.h)
+void sinksReset();              // с загрузки и после сна: очереди пусты, первое показание проходит сразу
+void sinkSetWake(SinkWakeFn wake); // будит задачу HTTP, когда в её очереди появилось показание
+uint8_t sinkPublish(const SensorReading &reading); // маска приёмников, принявших показание
+// Показание узла ESP-NOW; accepted — маска приёмников, уже принявших его. true — приняли все настроенные
+bool sinkPublishNode(const uint8_t mac[6], int rssi, const SensorReading &reading, uint8_t &accepted);
+uint32_t sinkServe(uint8_t sink); // отправка очереди; мс до следующей попытки или SINK_IDLE
+uint32_t sinkPending(uint8_t sink);
+void sinkServeAll(); // все приёмники в вызывающей задаче: глубокий сон, симулятор
+
+// Только на плате (sink_esp32.cpp)
+bool sinkStart(); // задача HTTP; false — HTTP обслуживает задача измерения
@@ -0,0 +1,40 @@
+#pragma once
+// Периодические задачи с абсолютными дедлайнами (vTaskDelayUntil на плате)
+// и статистика для мониторинга: дрожание старта, перерасходы, WCET.
+#include <stdint.h>
+
+// Что делать, если итерация не уложилась в период
+enum TaskOverrunPolicy : uint8_t
+{
+  TASK_OVERRUN_SKIP = 0,     // пропустить просроченные запуски, сохранив сетку дедлайнов
+  TASK_OVERRUN_CATCH_UP = 1  // выполнить пропущенные подряд (не больше TASK_MAX_CATCH_UP)
+};
+
+#define TASK_MAX_CATCH_UP 3
+#define TASK_TIMING_REPORT_RUNS 60 // сводка в журнал раз в N запусков
+
+struct TaskTiming
+{
+  const char *name;
+  uint8_t policy;
+  uint32_t periodMs;   // последний заданный период
+  uint32_t deadlineMs; // плановый момент текущего запуска
+  uint32_t startUs;
+  uint32_t runs;
+  uint32_t overruns;   // итерация закончилась после следующего дедлайна
+  uint32_t skipped;    // пропущенные запуски
+  uint32_t jitterLastMs; // опоздание старта относительно дедлайна
+  uint32_t jitterMaxMs;
+  uint64_t jitterSumMs;
+  uint32_t execLastUs;
+  uint32_t execMaxUs;  // наблюдаемое худшее время выполнения
+};
+
+extern TaskTiming sensorTaskTiming;
+extern TaskTiming systemTaskTiming;
+
+void taskTimingBegin(TaskTiming &t, const char *name, uint8_t policy, uint32_t nowMs);
+void taskTimingStart(TaskTiming &t, uint32_t nowMs, uint32_t nowUs);
+uint32_t taskTimingEnd(TaskTiming &t, uint32_t periodMs, uint32_t nowMs, uint32_t nowUs);
+uint32_t taskTimingWaitMs(const TaskTiming &t, uint32_t nowMs);
+uint32_t taskTimingJitterAvgMs(const TaskTiming &t);
@@ -0,0 +1,35 @@
+#pragma once
+// Шкала времени для меток измерений.
+// Системные часы прошивкой не переводятся: SNTP измеряет смещение эпохи относительно
+// локальных часов (halClockUs, идут и в глубоком сне), а между синхронизациями
+// поправка учитывает измеренный уход частоты этих часов.
+#include <stdint.h>
+
+#define SNTP_SERVER "pool.ntp.org"
+#define SNTP_PORT 123
+#define SNTP_TIMEOUT_MS 1000
+
+#define TIME_SYNC_FIRST_INTERVAL_S 3600 // вторая синхронизация — для измерения ухода
+#define TIME_SYNC_INTERVAL_S 21600      // дальше — раз в 6 часов
+#define TIME_DRIFT_MIN_SPAN_S 600       // на меньшем интервале уход не оценивается
+#define TIME_DRIFT_MAX_PPM 100000.0f    // RC-генератор RTC: до ±5%
+
+// В режиме сна хранится в RTC-памяти
+struct TimeBase
+{
+  bool synced;
+  bool driftKnown;
+  uint64_t syncClockUs; // локальные часы в момент последней синхронизации
+  int64_t offsetUs;     // эпоха (мкс) − локальные часы в тот же момент
+  float driftPpm;       // на сколько локальные часы отстают от эпохи, ppm
+  int32_t lastErrorUs;  // ошибка прогноза, обнаруженная последней синхронизацией
+  uint32_t lastDelayUs; // круговая задержка последнего запроса SNTP
+  uint16_t syncCount;
+};
+
+extern TimeBase timeBase;
+
+bool timeSync(const char *server);
+bool timeSyncDue();
+uint64_t timeNowUs(); // 0 — время неизвестно
+uint64_t timeNowMs();
@@ -0,0 +1,149 @@
+#pragma once
+// Трассировка задач (сборка с -DFEATURE_TRACE=1, окружение [env:trace]).
+// События пишутся в кольцо TRACE_EVENTS записей в RAM (старые затираются):
+// - смена задачи на ядре — из хука тика FreeRTOS (trace_esp32.cpp), с точностью до тика;
+// - участки кода (опрос датчиков, публикация, POST, запись во флеш) — traceBegin()/traceEnd();
+// - вход и выход из обработчиков прерываний прошивки — traceIsrEnter()/traceIsrExit().
+// Запись — одно атомарное приращение индекса и 12 байт, без блокировок, в том числе из ISR.
+// Выгрузка (/api/trace, /api/trace.bin) приостанавливает запись до конца ответа.
+// Двоичный образ (TraceFileHeader, задачи, события) переводится в JSON Chrome/Perfetto тем же
+// кодом на узле (/api/trace) и на компьютере: [env:native_trace], trace_native.cpp.
+#include <stddef.h>
+#include <stdint.h>
+#include "feature_flags.h"
+
+#define TRACE_EVENTS 1024 // степень двойки; 12 КБ
+#define TRACE_TASKS_MAX 24
+#define TRACE_CORES 2
+#define TRACE_TASK_NAME_SIZE 16
+#define TRACE_TEXT_SIZE 256
+#define TRACE_MAGIC 0x31435254 // "TRC1"
+#define TRACE_VERSION 1
+
+enum TraceEventType : uint8_t
+{
+  TRACE_SWITCH = 0, // arg — задача, ставшая текущей на ядре
+  TRACE_BEGIN,      // arg — задача, id — TraceSpan
+  TRACE_END,
+  TRACE_ISR_ENTER,  // id — номер обработчика
+  TRACE_ISR_EXIT
+};
+
+// Участки кода; имена — TRACE_SPAN_NAMES (trace.cpp), порядок входит в формат TRACE_VERSION
+enum TraceSpan : uint16_t
+{
+  TRACE_SENSOR_READ = 0,
+  TRACE_MQTT_PUBLISH,
+  TRACE_HTTP_POST,
+  TRACE_FLASH_WRITE,
+  TRACE_SPAN_COUNT
+};
+
+struct TraceEvent
+{
+  uint32_t timeUs; // halMicros(), переполняется через 71 мин — при переводе разворачивается
+  uint32_t arg;    // идентификатор задачи (хендл FreeRTOS на плате)
+  uint8_t type;    // TraceEventType
+  uint8_t core;
+  uint16_t id;
+};
+static_assert(sizeof(TraceEvent) == 12, "TraceEvent is part of the file format");
+
+struct TraceTask
+{
+  uint32_t id;
+  char name[TRACE_TASK_NAME_SIZE];
+};
+
+// Двоичный образ: заголовок, taskCount × TraceTask, eventCount × TraceEvent (little-endian, как на ESP32)
+struct TraceFileHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t taskCount;
+  uint32_t eventCount;
+  uint32_t lost; // событий затёрто до выгрузки
+};
+
+// События для перевода: кольцо на узле или прочитанный файл на компьютере
+struct TraceImage
+{
+  const TraceEvent *events;
+  uint32_t capacity; // степень двойки; событие i — events[(first + i) & (capacity - 1)]
+  uint32_t first;
+  uint32_t count;
+  uint32_t lost;
+  uint16_t taskCount;
+  TraceTask tasks[TRACE_TASKS_MAX];
+};
+
+enum TraceStreamPhase : uint8_t
+{
+  TRACE_PHASE_HEADER = 0,
+  TRACE_PHASE_TASKS,
+  TRACE_PHASE_EVENTS,
+  TRACE_PHASE_FOOTER,
+  TRACE_PHASE_DONE
+};
+
+// Выгрузка порциями, как HistoryStream: двоичный образ или JSON Chrome trace
+struct TraceStream
+{
+  const TraceImage *image;
+  bool json;
+  uint8_t phase; // TraceStreamPhase
+  uint32_t index;
+  uint64_t nowUs; // развёрнутое время последнего события, от первого
+  uint32_t lastUs;
+  uint16_t running[TRACE_CORES]; // задача на ядре: индекс в tasks + 1, 0 — неизвестна
+  uint64_t runningSince[TRACE_CORES];
+  uint16_t textLen;
+  uint16_t textPos;
+  char text[TRACE_TEXT_SIZE];
+};
+
+#if FEATURE_TRACE
+extern TraceEvent traceBuffer[TRACE_EVENTS];
+extern uint32_t traceWriteIndex;
+extern bool traceEnabled;
+
+/**
+ * @brief Запись события. Всегда встраивается: хук тика (trace_esp32.cpp) работает и при отключённом
+ *        кэше флеш-памяти (запись LittleFS), а копия вне строки при -Os оказалась бы во флеш .text
+ */
+__attribute__((always_inline)) inline void traceRecord(uint32_t timeUs, uint8_t type, uint8_t core, uint32_t arg, uint16_t id)
+{
+  if (!__atomic_load_n(&traceEnabled, __ATOMIC_RELAXED))
+    return;
+  TraceEvent &e = traceBuffer[__atomic_fetch_add(&traceWriteIndex, 1, __ATOMIC_RELAXED) & (TRACE_EVENTS - 1)];
+  e.timeUs = timeUs;
+  e.arg = arg;
+  e.type = type;
+  e.core = core;
+  e.id = id;
+}
+
+void traceBegin(TraceSpan span);
+void traceEnd(TraceSpan span);
+void traceSetEnabled(bool enabled);
+void traceSnapshot(TraceImage &image); // запись должна быть приостановлена (traceSetEnabled(false))
+#else
+// Сборка без трассировки: вызовы сворачиваются компилятором
+inline void traceBegin(TraceSpan) {}
+inline void traceEnd(TraceSpan) {}
+inline void traceIsrEnter(uint16_t) {}
+inline void traceIsrExit(uint16_t) {}
+#endif
+
+// === Перевод (без зависимостей от платы) ===
+const char *traceSpanName(uint16_t span);
+bool traceLoad(TraceImage &image, const uint8_t *data, size_t len); // образ из файла; events указывает в data
+void traceStreamBegin(TraceStream &stream, const TraceImage &image, bool json);
+size_t traceStreamRead(TraceStream &stream, uint8_t *buf, size_t size); // 0 — конец
+
+// Только на плате (trace_esp32.cpp)
+#if FEATURE_TRACE
+void traceStart(); // хуки тика на обоих ядрах и запись с загрузки
+void traceIsrEnter(uint16_t isr); // IRAM: можно звать из обработчика прерывания
+void traceIsrExit(uint16_t isr);
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+// Пробуждение по порогу от сопроцессора ULP в режиме глубокого сна.
+// ULP раз в ULP_SAMPLE_PERIOD_S измеряет напряжение батареи (ADC1, GPIO34), пишет
+// историю в RTC-память и будит основной процессор, только если значение вышло
+// за окно [low, high] или история заполнилась.
+//
+// Раскладка области данных в RTC_SLOW_MEM (32-битные слова, ULP использует младшие 16 бит).
+// Её разделяют программа ULP (ulp_esp32.cpp), её эталонная модель ulpStep()
+// и разбор на основном процессоре ulpReadHistory().
+#include <stddef.h>
+#include <stdint.h>
+
+#define ULP_PROGRAM_MAX_WORDS 64 // программа — с начала RTC_SLOW_MEM
+#define ULP_DATA_OFFSET 64       // данные — сразу за ней (в словах)
+#define ULP_HISTORY_SIZE 32
+#define ULP_SAMPLE_PERIOD_S 60
+#define ULP_WAKE_DELTA_MV 100    // окно порогов вокруг последнего значения
+#define ULP_HISTORY_JSON_SIZE 256
+
+enum UlpVar : uint8_t
+{
+  ULP_VAR_LOW = 0,    // будить, если отсчёт < low
+  ULP_VAR_HIGH = 1,   // будить, если отсчёт > high
+  ULP_VAR_COUNT = 2,  // отсчётов в истории
+  ULP_VAR_LAST = 3,   // последний отсчёт
+  ULP_VAR_REASON = 4, // UlpWakeReason
+  ULP_VAR_HISTORY = 5 // ULP_HISTORY_SIZE отсчётов
+};
+
+#define ULP_DATA_WORDS (ULP_VAR_HISTORY + ULP_HISTORY_SIZE)
+
+enum UlpWakeReason : uint8_t
+{
+  ULP_WAKE_NONE = 0,
+  ULP_WAKE_THRESHOLD = 1,
+  ULP_WAKE_FULL = 2
+};
+
+// История, переданная основному процессору
+struct UlpHistory
+{
+  uint8_t reason;
+  uint8_t count;
+  uint16_t samples[ULP_HISTORY_SIZE]; // сырые отсчёты АЦП (12 бит, среднее из 4)
+};
+
+uint16_t ulpMillivoltsToRaw(uint16_t mv);
+uint16_t ulpRawToMillivolts(uint16_t raw);
+
+void ulpArm(uint32_t *data, uint16_t lastRaw);
+bool ulpReadHistory(const uint32_t *data, UlpHistory &history);
+uint8_t ulpStep(uint32_t *data, uint16_t raw);
+const char *ulpWakeReasonName(uint8_t reason);
+
+size_t encodeUlpHistory(char *buf, size_t size, const UlpHistory &history, uint64_t firstTimestamp);
+
+// Только на плате (ulp_esp32.cpp)
+bool ulpStart(uint16_t lastRaw);
+uint32_t *ulpData();
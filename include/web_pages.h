@@ -0,0 +1,21 @@
+#pragma once
+// Шаблоны страниц веб-интерфейса (во флеше) и подстановка общих полей
+#include "html.h"
+#include "sensors.h"
+
+// Фрагменты страниц, заканчиваются nullptr
+extern const char *const PAGE_ROOT[];
+extern const char *const PAGE_BASE[];
+extern const char *const PAGE_WIFI[];
+extern const char *const PAGE_MQTT[];
+
+// Контекст страницы: показания снимаются один раз на запрос — все поля из одного цикла
+struct WebPageContext
+{
+  const char *title;
+  SensorReading reading;
+};
+
+// Поля показаний, конфигурации и статуса; ctx — WebPageContext
+bool webPageField(void *ctx, const char *name, size_t nameLen, uint16_t index,
+                  char *out, size_t size, size_t *len);
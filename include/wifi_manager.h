@@ -0,0 +1,107 @@
+#pragma once
+// Подключение к Wi-Fi по событиям, без ожидания в цикле.
+// Сети из настроек (основная и запасные), найденные сканированием, перебираются по убыванию RSSI.
+// Если ни одна не подключилась — повтор через паузу, удваивающуюся от WIFI_BACKOFF_MIN_MS
+// до WIFI_BACKOFF_MAX_MS. Если связи нет дольше WIFI_AP_AFTER_MS, поднимается точка
+// доступа настройки, а попытки в режиме STA продолжаются; после подключения AP гасится.
+// Без настроенных сетей — только AP.
+//
+// Сети последнего сканирования хранятся здесь же для страницы настроек Wi-Fi: веб сам не сканирует
+// и не читает результаты драйвера — их забирает и освобождает задача Wi-Fi. Из состояний без
+// обхода (CONNECTED, AP_ONLY) страница может запросить сканирование, не чаще WIFI_SCAN_REFRESH_MS.
+//
+// Автомат не вызывает Wi-Fi сам: события и таймеры возвращают битовую маску WifiAction,
+// которую выполняет обвязка платы (wifi_esp32.cpp) — из одной задачи, в порядке событий.
+#include <stdint.h>
+
+#define WIFI_NETWORKS_MAX 3             // основная сеть + WIFI_EXTRA_NETWORKS (config.h)
+#define WIFI_CONNECT_TIMEOUT_MS 15000UL // сканирование или от WiFi.begin() до адреса
+#define WIFI_BACKOFF_MIN_MS 2000UL
+#define WIFI_BACKOFF_MAX_MS 60000UL     // перезагрузка роутера — около минуты
+#define WIFI_AP_AFTER_MS 30000UL
+#define WIFI_RSSI_UNSEEN -128           // сеть не найдена сканированием
+#define WIFI_SCAN_LIST_MAX 12           // сетей на странице настроек
+#define WIFI_SCAN_REFRESH_MS 15000UL    // сканирование по запросу страницы — не чаще
+#define WIFI_SSID_SIZE 33
+
+enum WifiState : uint8_t
+{
+  WIFI_STATE_AP_ONLY = 0, // сетей нет — только точка доступа
+  WIFI_STATE_SCANNING,
+  WIFI_STATE_CONNECTING,
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_WAITING      // пауза перед новым обходом
+};
+
+enum WifiAction : uint8_t
+{
+  WIFI_ACTION_NONE = 0,
+  WIFI_ACTION_SCAN = 0x01,
+  WIFI_ACTION_CONNECT = 0x02, // к сети WifiManager::network
+  WIFI_ACTION_AP_START = 0x04,
+  WIFI_ACTION_AP_STOP = 0x08
+};
+
+struct WifiScanEntry
+{
+  char ssid[WIFI_SSID_SIZE];
+  int8_t rssi;
+};
+
+// Найденные сети по убыванию RSSI, SSID без повторов (сильнейшая точка доступа)
+struct WifiScanList
+{
+  WifiScanEntry entries[WIFI_SCAN_LIST_MAX];
+  uint8_t count;
+};
+
+struct WifiManager
+{
+  uint8_t state;          // WifiState
+  uint8_t networkCount;
+  uint8_t network;        // сеть текущей попытки или подключения
+  uint8_t candidates[WIFI_NETWORKS_MAX]; // порядок попыток (по RSSI)
+  uint8_t candidateCount;
+  uint8_t candidatePos;
+  uint8_t failures;       // обходов без подключения подряд
+  bool apActive;
+  int8_t rssi[WIFI_NETWORKS_MAX]; // из последнего сканирования
+  bool listScan;          // сканирование по запросу страницы, вне обхода
+  uint32_t scanAtMs;      // начало последнего сканирования
+  // Список для страницы: две копии и счётчик, как снимок показаний (sensors.cpp) — писатель
+  // (задача Wi-Fi) и читатель (веб) не ждут друг друга
+  WifiScanList scanCopies[2];
+  uint32_t scanSeq;
+  uint32_t stateSinceMs;
+  uint32_t downSinceMs;   // связь потеряна (или загрузка)
+  uint32_t retryAtMs;
+  uint32_t backoffMs;
+  // Метрики
+  uint32_t attempts;
+  uint32_t connects;
+  uint32_t disconnects;
+  uint32_t lastConnectMs; // от WiFi.begin() до адреса
+  uint32_t lastOutageMs;  // от потери связи до адреса
+  uint32_t maxOutageMs;
+};
+
+extern WifiManager wifiManager;
+
+uint8_t wifiManagerBegin(WifiManager &m, uint8_t networkCount, uint32_t now);
+uint8_t wifiManagerScanDone(WifiManager &m, const int8_t rssi[], uint32_t now); // rssi[networkCount]
+uint8_t wifiManagerConnected(WifiManager &m, uint32_t now);
+uint8_t wifiManagerDisconnected(WifiManager &m, uint32_t now);
+uint8_t wifiManagerPoll(WifiManager &m, uint32_t now); // тайм-ауты и паузы
+uint8_t wifiManagerRequestScan(WifiManager &m, uint32_t now); // страница настроек
+bool wifiManagerScanExpected(const WifiManager &m); // событие конца сканирования — наше
+void wifiScanListAdd(WifiScanList &list, const char *ssid, int rssi);
+void wifiManagerStoreScan(WifiManager &m, const WifiScanList &list); // только задача Wi-Fi
+uint8_t wifiManagerScanEntry(const WifiManager &m, uint8_t index, WifiScanEntry &entry); // число сетей; из любой задачи
+uint32_t wifiManagerWaitMs(const WifiManager &m, uint32_t now); // до следующего wifiManagerPoll()
+const char *wifiStateName(uint8_t state);
+
+// Только на плате (wifi_esp32.cpp)
+void wifiBegin();
+void wifiRequestScan(); // из веб-обработчика: обновить список сетей
+bool wifiIsConnected();
+bool wifiWaitConnected(uint32_t timeoutMs);
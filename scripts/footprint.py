@@ -0,0 +1,27 @@
+# Размер прошивки окружения после сборки: строка [FOOTPRINT] в выводе и JSON-строка
+# в .pio/build/footprint.jsonl — для сравнения профилей (platformio.ini, feature_flags.h).
+# Секции считаются так же, как в сводке «RAM/Flash» PlatformIO (SIZEPROGREGEXP/SIZEDATAREGEXP платформы).
+import json
+import re
+import subprocess
+import time
+
+Import("env")
+
+
+def section_bytes(sections, regexp):
+    return sum(int(m.group(1)) for m in re.finditer(regexp, sections, re.M))
+
+
+def report_footprint(source, target, env):
+    elf = str(target[0])
+    sections = subprocess.check_output([env.subst("$SIZETOOL"), "-A", "-d", elf]).decode()
+    flash = section_bytes(sections, env.subst("$SIZEPROGREGEXP"))
+    ram = section_bytes(sections, env.subst("$SIZEDATAREGEXP"))
+    line = {"env": env.subst("$PIOENV"), "flash": flash, "ram": ram, "built": int(time.time())}
+    print("[FOOTPRINT] %s: flash %d B, ram %d B" % (line["env"], flash, ram))
+    with open(env.subst("$PROJECT_BUILD_DIR/footprint.jsonl"), "a") as out:
+        out.write(json.dumps(line) + "\n")
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report_footprint)
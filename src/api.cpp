@@ -0,0 +1,257 @@
+#include "api.h"
+#include "config.h"
+#include "payload.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "task_timing.h"
+#include "mqtt.h"
+#include "https.h"
+#include "espnow.h"
+#include "history.h"
+#include "sensor_registry.h"
+#include "wifi_manager.h"
+#include "publish_slot.h"
+#include "hal.h"
+#include "log.h"
+#include "sink.h"
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "0.0.0"
+#endif
+
+extern SchedulerState sampleScheduler;
+
+ApiStats apiStats[API_ENDPOINT_COUNT] = {};
+
+// Номер показания начинается с 1 после каждой загрузки — без идентификатора
+// загрузки ETag до перезагрузки совпал бы с ETag другого показания после неё
+static uint32_t apiBootId = 0;
+
+void apiBegin(uint32_t bootId)
+{
+    apiBootId = bootId;
+}
+
+const char *apiEndpointPath(ApiEndpoint endpoint)
+{
+    static const char *const paths[API_ENDPOINT_COUNT] = {"/api/current", "/api/config", "/api/status"};
+    return endpoint < API_ENDPOINT_COUNT ? paths[endpoint] : "";
+}
+
+/**
+ * @brief ETag ответа: зависит только от номера показания или ревизии настроек,
+ *        поэтому проверяется без сборки JSON
+ */
+size_t apiEtag(ApiEndpoint endpoint, const SensorReading &reading, char *buf, size_t size)
+{
+    int len;
+    if (endpoint == API_CONFIG)
+        len = snprintf(buf, size, "\"%08lx-c%lu\"", (unsigned long)apiBootId, (unsigned long)configRevision);
+    else
+        len = snprintf(buf, size, "\"%08lx-%lu\"", (unsigned long)apiBootId, (unsigned long)reading.sample);
+    return len > 0 && (size_t)len < size ? (size_t)len : 0;
+}
+
+/**
+ * @brief If-None-Match: "*" или список ETag через запятую (слабые W/"..." тоже)
+ */
+bool apiEtagMatches(const char *ifNoneMatch, const char *etag)
+{
+    if (!ifNoneMatch || !etag || etag[0] == '\0')
+        return false;
+    while (*ifNoneMatch == ' ')
+        ifNoneMatch++;
+    if (strcmp(ifNoneMatch, "*") == 0)
+        return true;
+    return strstr(ifNoneMatch, etag) != nullptr; // ETag в кавычках — совпадение только целиком
+}
+
+// Недействительный канал — null, а не число-заглушка
+static void setReading(JsonDocument &doc, const char *key, const SensorReading &reading, uint8_t flag,
+                       float (*value)(const SensorReading &))
+{
+    if (reading.flags & flag)
+        doc[key] = value(reading);
+    else
+        doc[key] = nullptr;
+}
+
+static void currentJson(JsonDocument &doc, const SensorReading &reading)
+{
+    doc["uid"] = config.uid;
+    doc["sample"] = reading.sample;
+    if (reading.timestamp)
+        doc["timestamp"] = reading.timestamp; // мс от эпохи Unix, момент измерения
+    setReading(doc, "temperature", reading, SAMPLE_TEMPERATURE, sampleTemperature);
+    setReading(doc, "humidity", reading, SAMPLE_HUMIDITY, sampleHumidity);
+    setReading(doc, "pressure", reading, SAMPLE_PRESSURE, samplePressure);
+    setReading(doc, "vcc", reading, SAMPLE_VCC, sampleVcc);
+    doc["rssi"] = halNetRssi();
+}
+
+// Ключи как в CONFIG_FILE; пароли не отдаются
+static void configJson(JsonDocument &doc)
+{
+    doc["uid"] = config.uid;
+    doc["ssid"] = config.ssid;
+    JsonArray networks = doc.createNestedArray("networks"); // запасные, без паролей
+    for (uint8_t i = 0; i < WIFI_EXTRA_NETWORKS; i++)
+    {
+        if (config.wifi_extra[i].ssid[0] != '\0')
+            networks.add(config.wifi_extra[i].ssid);
+    }
+    doc["mqtt_server"] = config.mqtt_server;
+    doc["mqtt_port"] = config.mqtt_port;
+    doc["mqtt_user"] = config.mqtt_user;
+    doc["post_url"] = config.post_url;
+    doc["influx_host"] = config.influx_host;
+    doc["influx_port"] = config.influx_port;
+    JsonObject intervals = doc.createNestedObject("sink_min_interval");
+    for (uint8_t i = 0; i < SINK_COUNT; i++)
+        intervals[sinkName(i)] = config.sink_min_interval[i];
+    doc["ota_url"] = config.ota_url;
+    doc["ota_result_url"] = config.ota_result_url;
+    doc["publishingInterval"] = config.publishingInterval;
+    doc["temp_offset"] = config.temp_offset;
+    doc["payload_format"] = payloadFormatName(config.payload_format);
+    doc["adaptive_interval"] = config.adaptive_interval;
+    doc["align_interval"] = config.align_interval;
+    doc["interval_min"] = config.interval_min;
+    doc["interval_max"] = config.interval_max;
+    doc["sleep_min"] = config.sleep_min;
+    doc["sleep_max"] = config.sleep_max;
+    doc["ulp_wake"] = config.ulp_wake;
+    doc["low_power"] = config.low_power;
+    doc["espnow_mode"] = config.espnow_mode;
+    doc["espnow_channel"] = config.espnow_channel;
+}
+
+static void taskJson(JsonArray tasks, const TaskTiming &t)
+{
+    if (!t.name)
+        return;
+    JsonObject task = tasks.createNestedObject();
+    task["name"] = t.name;
+    task["runs"] = t.runs;
+    task["overruns"] = t.overruns;
+    task["skipped"] = t.skipped;
+    task["jitter_max_ms"] = t.jitterMaxMs;
+    task["exec_max_us"] = t.execMaxUs;
+}
+
+static void statusJson(JsonDocument &doc, const SensorReading &reading)
+{
+    doc["uid"] = config.uid;
+    doc["fw"] = FIRMWARE_VERSION;
+    doc["uptime_s"] = halMillis() / 1000;
+    doc["heap_free"] = halFreeHeap();
+    doc["sample"] = reading.sample;
+    doc["interval_ms"] = config.adaptive_interval ? sampleScheduler.intervalMs : config.publishingInterval;
+    if (config.align_interval)
+    {
+        uint8_t mac[6];
+        halMacAddress(mac);
+        doc["publish_slot_ms"] = publishSlotOffsetMs(mac, config.publishingInterval);
+    }
+
+    JsonArray sensors = doc.createNestedArray("sensors");
+    for (uint8_t i = 0; i < sensorSlotCount; i++)
+    {
+        const SensorSlot &slot = sensorSlots[i];
+        JsonObject sensor = sensors.createNestedObject();
+        sensor["name"] = slot.driver->name;
+        sensor["health"] = sensorHealthName(slot.health);
+        sensor["reads"] = slot.reads;
+        sensor["errors"] = slot.errors;
+        sensor["probes"] = slot.probes;
+    }
+
+    JsonObject wifi = doc.createNestedObject("wifi");
+    wifi["connected"] = halNetConnected();
+    wifi["rssi"] = halNetRssi();
+    wifi["state"] = wifiStateName(wifiManager.state);
+    wifi["connects"] = wifiManager.connects;
+    wifi["disconnects"] = wifiManager.disconnects;
+    wifi["connect_ms"] = wifiManager.lastConnectMs;
+    wifi["outage_ms"] = wifiManager.lastOutageMs;
+    wifi["outage_max_ms"] = wifiManager.maxOutageMs;
+    doc["mqtt"] = isMqttConnected();
+
+    JsonObject time = doc.createNestedObject("time");
+    time["synced"] = timeBase.synced;
+    time["syncs"] = timeBase.syncCount;
+    time["drift_ppm"] = timeBase.driftPpm;
+
+    JsonArray tasks = doc.createNestedArray("tasks");
+    taskJson(tasks, sensorTaskTiming);
+    taskJson(tasks, systemTaskTiming);
+
+    JsonObject history = doc.createNestedObject("history");
+    history["blocks_today"] = historyBlockCount();
+    if (historyStats.sealedRecords > 0)
+        history["bytes_per_reading"] = (float)historyStats.sealedBlocks * CODEC_BLOCK_SIZE / historyStats.sealedRecords;
+    history["appended"] = historyStats.appended;
+    history["dropped"] = historyStats.outOfOrder + historyStats.unsynced + historyStats.writeErrors;
+    history["queries"] = historyStats.queries;
+
+    JsonObject tls = doc.createNestedObject("tls");
+    tls["full"] = tlsStats.fullHandshakes;
+    tls["resumed"] = tlsStats.resumedHandshakes;
+    tls["failures"] = tlsStats.failures;
+
+    JsonObject sinkStats = doc.createNestedObject("sinks"); // настроенные приёмники
+    for (uint8_t i = 0; i < SINK_COUNT; i++)
+    {
+        if (!sinkEnabled(i))
+            continue;
+        const SinkStats &stats = sinks[i].stats;
+        JsonObject sink = sinkStats.createNestedObject(sinkName(i));
+        sink["pending"] = sinkPending(i);
+        sink["sent"] = stats.sent;
+        sink["failed"] = stats.failed;
+        sink["dropped"] = stats.dropped;
+        sink["limited"] = stats.limited;
+        sink["last_us"] = stats.lastUs;
+        sink["max_us"] = stats.maxUs;
+    }
+
+    JsonObject log = doc.createNestedObject("log");
+    log["lines"] = logStats.lines;
+    log["dropped"] = logStats.dropped;
+    log["truncated"] = logStats.truncated;
+
+    if (config.espnow_mode == ESPNOW_GATEWAY)
+    {
+        JsonObject gateway = doc.createNestedObject("gateway");
+        gateway["nodes"] = gatewayNodeCount;
+        gateway["accepted"] = gatewayStats.accepted;
+        gateway["duplicates"] = gatewayStats.duplicates;
+        gateway["lost"] = gatewayStats.lost;
+    }
+}
+
+/**
+ * @brief Тело ответа (JSON); 0 — документ или буфер малы
+ */
+size_t apiBody(ApiEndpoint endpoint, const SensorReading &reading, char *buf, size_t size)
+{
+    StaticJsonDocument<API_JSON_SIZE> doc;
+    if (endpoint == API_CURRENT)
+        currentJson(doc, reading);
+    else if (endpoint == API_CONFIG)
+        configJson(doc);
+    else if (endpoint == API_STATUS)
+        statusJson(doc, reading);
+    else
+        return 0;
+    if (doc.overflowed())
+    {
+        logError(LOG_API, "%s: document overflow", apiEndpointPath(endpoint));
+        return 0;
+    }
+    size_t len = serializeJson(doc, buf, size);
+    return len > 0 && len < size ? len : 0;
+}
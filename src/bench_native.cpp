@@ -0,0 +1,324 @@
+// bench_native.cpp — микробенчмарки телеметрии на Linux ([env:native_bench])
+// Вывод: одна JSON-строка на тест, например
+// {"fw":"3.1.0","bench":"mqtt_encode_text","iterations":200000,"ns_per_op":95.2,"allocs_per_op":0.00,"bytes_per_op":0.0}
+#include "config.h"
+#include "sensors.h"
+#include "mqtt.h"
+#include "post.h"
+#include "payload.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "html.h"
+#include "sensor_registry.h"
+#include "web_pages.h"
+#include "api.h"
+#include "history.h"
+#include "log.h"
+#include "sink.h"
+#include "hal.h"
+#include "hal_native.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "0.0.0"
+#endif
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+// === Подсчёт выделений памяти ===
+// malloc/calloc/realloc перехватываются через -Wl,--wrap (см. platformio.ini),
+// operator new — переопределением.
+static unsigned long allocCount = 0;
+static unsigned long allocBytes = 0;
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_calloc(size_t n, size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    allocCount++;
+    allocBytes += size;
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t n, size_t size)
+{
+    allocCount++;
+    allocBytes += n * size;
+    return __real_calloc(n, size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+    allocCount++;
+    allocBytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = __wrap_malloc(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+// === Запуск теста ===
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static volatile size_t sink; // не даёт компилятору выбросить результат
+
+static void report(const char *name, long iterations, uint64_t elapsed, unsigned long allocs, unsigned long bytes)
+{
+    printf("{\"fw\":\"%s\",\"bench\":\"%s\",\"iterations\":%ld,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f}\n",
+           FIRMWARE_VERSION, name, iterations, (double)elapsed / iterations, (double)allocs / iterations,
+           (double)bytes / iterations);
+    fflush(stdout);
+}
+
+template <typename F>
+static void bench(const char *name, long iterations, F fn)
+{
+    for (long i = 0; i < iterations / 10 + 1; i++)
+        fn();
+
+    unsigned long allocsBefore = allocCount;
+    unsigned long bytesBefore = allocBytes;
+    uint64_t start = nowNs();
+    for (long i = 0; i < iterations; i++)
+        fn();
+    uint64_t elapsed = nowNs() - start;
+    report(name, iterations, elapsed, allocCount - allocsBefore, allocBytes - bytesBefore);
+}
+
+static void wakeNobody() {}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 100000;
+    if (iterations <= 0)
+        iterations = 100000;
+
+    halSimSetLogEnabled(false);
+    halSimSetNullNetwork(true);
+    halSimSetVirtualDelays(true);
+
+    loadConfig();
+    strlcpy(config.mqtt_server, "bench", sizeof(config.mqtt_server));
+    strlcpy(config.post_url, "http://bench/api", sizeof(config.post_url));
+    strlcpy(config.uid, "bench-node-0001", sizeof(config.uid));
+    config.publishingInterval = 0; // sinkPublish() без ограничения темпа
+    initSensors();
+    readSensors();
+    initMqtt();
+    reconnectMqtt();
+
+    SensorReading reading = {};
+    reading.timestamp = 1700000000123ULL;
+    reading.sample = 1;
+    sampleSetTemperature(reading, 21.37f);
+    sampleSetHumidity(reading, 48.2f);
+    sampleSetPressure(reading, 755.4f * PA_PER_MMHG);
+    sampleSetVcc(reading, 3.71f);
+
+    // === Форматирование полезной нагрузки (publishSensorData) ===
+    bench("mqtt_encode_text", iterations, [&]() {
+        char values[MQTT_CH_COUNT][PAYLOAD_VALUE_SIZE];
+        sink = encodeMqttText(values, reading);
+    });
+    bench("mqtt_encode_msgpack", iterations, [&]() {
+        uint8_t buf[PAYLOAD_MAX_SIZE];
+        sink = encodeMqttPacked(buf, sizeof(buf), reading);
+    });
+    bench("mqtt_base_topic", iterations, [&]() {
+        char topic[MQTT_TOPIC_SIZE];
+        sink = generateMqttBaseTopic(topic, sizeof(topic));
+    });
+
+    config.payload_format = PAYLOAD_TEXT;
+    bench("mqtt_publish_text", iterations, [&]() { publishSensorData(reading); });
+    config.payload_format = PAYLOAD_MSGPACK;
+    bench("mqtt_publish_msgpack", iterations, [&]() { publishSensorData(reading); });
+
+    // === Тело POST (sendPostRequest) ===
+    bench("post_encode_json", iterations, [&]() {
+        uint8_t buf[PAYLOAD_MAX_SIZE];
+        sink = encodePostPayload(PAYLOAD_TEXT, buf, sizeof(buf), config.uid, -61, reading);
+    });
+    bench("post_encode_msgpack", iterations, [&]() {
+        uint8_t buf[PAYLOAD_MAX_SIZE];
+        sink = encodePostPayload(PAYLOAD_MSGPACK, buf, sizeof(buf), config.uid, -61, reading);
+    });
+    config.payload_format = PAYLOAD_TEXT;
+    bench("post_request_json", iterations, [&]() { sendPostRequest(reading); });
+
+    // === Приёмники (sink.h): line protocol по UDP и рассылка показания по всем очередям ===
+    bench("influx_encode_line", iterations, [&]() {
+        char line[PAYLOAD_MAX_SIZE];
+        sink = encodeLineProtocol(line, sizeof(line), config.uid, -61, reading);
+    });
+    strlcpy(config.influx_host, "bench", sizeof(config.influx_host));
+    bench("sink_fanout", iterations, [&]() {
+        sink = sinkPublish(reading);
+        sinkServeAll();
+    });
+
+    // === Опрос датчиков (реестр драйверов, модель BMP180 на I2C) ===
+    bench("sensors_read", iterations / 10 + 1, [&]() {
+        for (uint8_t i = 0; i < sensorSlotCount; i++)
+            sensorSlots[i].nextDue = halMillis(); // опрашивать все датчики в каждой итерации
+        readSensors();
+    });
+    bench("sensors_snapshot", iterations, [&]() { sink = (size_t)latestReading().timestamp; });
+
+    // === Конфигурация (файловая система в памяти) ===
+    long configIterations = iterations / 10 + 1;
+    bench("config_save", configIterations, [&]() { saveConfig(); });
+    bench("config_load", configIterations, [&]() { loadConfig(); });
+
+    // === Веб-интерфейс: потоковый рендеринг порциями по 1 КБ ===
+    long pageIterations = iterations / 10 + 1;
+    uint8_t chunk[1024];
+    auto renderPage = [&](const char *const *parts, const char *title) {
+        HtmlRenderer r;
+        WebPageContext page = {title, latestReading()};
+        htmlBegin(r, parts, webPageField, &page);
+        while (htmlRender(r, chunk, sizeof(chunk)) > 0)
+            ;
+        sink = r.total;
+    };
+    bench("html_render_root", pageIterations, [&]() { renderPage(PAGE_ROOT, "Дашборд"); });
+    bench("html_render_base", pageIterations, [&]() { renderPage(PAGE_BASE, "Базовые настройки"); });
+    bench("html_render_mqtt", pageIterations, [&]() { renderPage(PAGE_MQTT, "Настройки MQTT"); });
+
+    // === REST API: опрос без изменений (ETag) и полный ответ ===
+    SensorReading latest = latestReading();
+    char etag[API_ETAG_SIZE];
+    apiEtag(API_CURRENT, latest, etag, sizeof(etag));
+    bench("api_not_modified", iterations, [&]() {
+        char current[API_ETAG_SIZE];
+        SensorReading r = latestReading();
+        apiEtag(API_CURRENT, r, current, sizeof(current));
+        sink = apiEtagMatches(etag, current);
+    });
+    char body[API_BODY_SIZE];
+    bench("api_current", iterations, [&]() { sink = apiBody(API_CURRENT, latest, body, sizeof(body)); });
+    bench("api_status", iterations / 10 + 1, [&]() { sink = apiBody(API_STATUS, latest, body, sizeof(body)); });
+
+    // === Сжатие истории: месяц показаний раз в минуту, проверка кодирования и декодирования ===
+    static SensorReading month[30 * 1440];
+    const size_t monthCount = sizeof(month) / sizeof(month[0]);
+    static uint8_t blocks[30 * 1440 / 8][CODEC_BLOCK_SIZE]; // не меньше 8 показаний на блок
+    uint32_t seed = 12345;
+    auto random = [&seed](int range) { // [-range, range]
+        seed = seed * 1103515245u + 12345u;
+        return (int)((seed >> 16) % (2 * range + 1)) - range;
+    };
+    float temp = 21.0f, hum = 45.0f, pres = 755.0f;
+    for (size_t i = 0; i < monthCount; i++)
+    {
+        SensorReading &r = month[i];
+        r = {};
+        r.timestamp = 1700000000000ULL + i * 60000ULL + random(40); // джиттер опроса
+        r.sample = (uint32_t)i + 1;
+        temp += random(5) * 0.01f;
+        hum += random(3) * 0.1f;
+        pres += random(2) * 0.05f;
+        sampleSetTemperature(r, temp);
+        sampleSetHumidity(r, hum < 0 ? 0 : hum > 100 ? 100 : hum);
+        sampleSetPressure(r, pres * PA_PER_MMHG);
+        sampleSetVcc(r, 3.7f + random(10) * 0.001f);
+        if (i % 997 == 0)
+            sampleSetHumidity(r, NAN); // редкий сбой датчика
+    }
+    size_t blockCount = 0;
+    CodecState state;
+    codecBlockBegin(blocks[0], state);
+    for (size_t i = 0; i < monthCount; i++)
+    {
+        if (!codecBlockAppend(blocks[blockCount], state, month[i]))
+        {
+            codecBlockBegin(blocks[++blockCount], state);
+            codecBlockAppend(blocks[blockCount], state, month[i]);
+        }
+    }
+    blockCount++; // декодирование без потерь проверяет test/test_history_codec
+    printf("{\"fw\":\"%s\",\"bench\":\"history_codec_size\",\"readings\":%lu,\"blocks\":%lu,\"bytes_per_reading\":%.2f}\n",
+           FIRMWARE_VERSION, (unsigned long)monthCount, (unsigned long)blockCount,
+           (double)blockCount * CODEC_BLOCK_SIZE / monthCount);
+    const uint16_t perBlock = codecBlockCount(blocks[0]);
+    bench("history_codec_encode_block", iterations / 100 + 1, [&]() {
+        uint8_t block[CODEC_BLOCK_SIZE];
+        CodecState s;
+        codecBlockBegin(block, s);
+        for (uint16_t i = 0; i < perBlock; i++)
+            codecBlockAppend(block, s, month[i]);
+        sink = s.bitPos;
+    });
+    bench("history_codec_decode_block", iterations / 100 + 1, [&]() {
+        CodecState s;
+        SensorReading r;
+        codecDecodeBegin(blocks[0], s);
+        while (codecDecodeNext(blocks[0], s, r))
+            ;
+        sink = r.sample;
+    });
+
+    // === История: неделя показаний раз в минуту, выборка часа из середины ===
+    SensorReading stored = latest;
+    for (uint32_t i = 0; i < 7 * 1440; i++)
+    {
+        stored.timestamp = 1700000000000ULL + i * 60000ULL;
+        historyAppend(stored);
+    }
+    HistoryQuery hour;
+    historyQueryInit(hour);
+    hour.from = 1700000000000ULL + 3 * HISTORY_SEGMENT_MS;
+    hour.to = hour.from + 3600000ULL;
+    static HistoryStream stream;
+    bench("history_query_hour", iterations / 10 + 1, [&]() {
+        historyStreamBegin(stream, hour);
+        while (historyStreamRead(stream, (char *)chunk, sizeof(chunk)) > 0)
+            ;
+        sink = stream.rows;
+    });
+
+    // === Журнал: вызов в горячем пути (без вывода) и полная стоимость строки ===
+    logSetWake(wakeNobody); // записи копятся в буфере до logDrain(), как при задаче вывода на плате
+    unsigned long allocsBefore = allocCount, bytesBefore = allocBytes;
+    uint64_t writeNs = 0;
+    long written = 0;
+    while (written < iterations)
+    {
+        uint64_t start = nowNs();
+        for (uint8_t i = 0; i < LOG_RING_SLOTS; i++)
+            logInfo(LOG_MQTT, "%s: %lu rows, %lu B in %lu ms", "bench", (unsigned long)i, 512UL, 3UL);
+        writeNs += nowNs() - start;
+        written += LOG_RING_SLOTS;
+        logDrain(); // вне замера
+    }
+    report("log_write", written, writeNs, allocCount - allocsBefore, allocBytes - bytesBefore);
+    bench("log_filtered", iterations, [&]() { logDebug(LOG_MQTT, "%s: %lu rows", "bench", 1UL); });
+    logSetWake(nullptr);
+    bench("log_write_drain", iterations / 10 + 1, [&]() {
+        logInfo(LOG_MQTT, "%s: %lu rows, %lu B in %lu ms", "bench", 100UL, 512UL, 3UL);
+    });
+    sink = logStats.dropped;
+
+    return 0;
+}
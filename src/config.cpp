@@ -1,20 +1,24 @@
 // config.cpp
-#include <Arduino.h>
 #include "config.h"
-#include <LittleFS.h>
+#include "hal.h"
+#include "log.h"
+#include "trace.h"
 #include <ArduinoJson.h>
 #include <cstring>
 
 Config config;
+uint32_t configRevision = 0;
 
 void loadConfig()
 {
-    if (!LittleFS.begin(true))
-    { // true = format on fail
-        Serial.println("[FS] LittleFS Mount Failed");
+    if (!halFsBegin())
+    { // format on fail
+        logError(LOG_FS, "LittleFS Mount Failed");
         return;
     }
 
+    configRevision++;
+
     // === Шаг 1: Устанавливаем значения по умолчанию ===
     memset(&config, 0, sizeof(Config));
     strcpy(config.ssid, "");
@@ -26,20 +30,35 @@ void loadConfig()
     strcpy(config.web_password, "admin"); // ← КЛЮЧЕВОЕ: пароль по умолчанию
     strcpy(config.uid, "");
     strcpy(config.post_url, "");
+    strcpy(config.influx_host, "");
+    config.influx_port = INFLUX_UDP_PORT;
+    memset(config.sink_min_interval, 0, sizeof(config.sink_min_interval));
     strcpy(config.ota_url, "");
     strcpy(config.ota_result_url, "");
     config.publishingInterval = 10000;
     config.temp_offset = 0.0f;
+    config.payload_format = 0;
+    config.adaptive_interval = false;
+    config.align_interval = false;
+    config.interval_min = 5000;
+    config.interval_max = 60000;
+    config.sleep_min = 60;
+    config.sleep_max = 3600;
+    config.ulp_wake = false;
+    config.low_power = false;
+    config.espnow_mode = 0;
+    config.espnow_channel = 1;
+    memset(config.wifi_extra, 0, sizeof(config.wifi_extra));
 
     // === Шаг 2: Если файл существует — перезаписываем значения из него ===
-    if (LittleFS.exists(CONFIG_FILE))
+    if (halFsExists(CONFIG_FILE))
     {
-        File file = LittleFS.open(CONFIG_FILE, "r");
-        if (file)
+        char buf[CONFIG_JSON_SIZE];
+        size_t len = halFsRead(CONFIG_FILE, buf, sizeof(buf));
+        if (len > 0)
         {
-            DynamicJsonDocument doc(1024);
-            DeserializationError error = deserializeJson(doc, file);
-            file.close();
+            DynamicJsonDocument doc(CONFIG_JSON_SIZE);
+            DeserializationError error = deserializeJson(doc, buf, len);
 
             if (!error)
             {
@@ -52,40 +71,64 @@ void loadConfig()
                 strlcpy(config.web_password, doc["web_password"] | "admin", sizeof(config.web_password));
                 strlcpy(config.uid, doc["uid"] | "", sizeof(config.uid));
                 strlcpy(config.post_url, doc["post_url"] | "", sizeof(config.post_url));
+                strlcpy(config.influx_host, doc["influx_host"] | "", sizeof(config.influx_host));
+                config.influx_port = doc["influx_port"] | INFLUX_UDP_PORT;
+                JsonArrayConst intervals = doc["sink_min_interval"];
+                for (uint8_t i = 0; i < SINK_COUNT && i < intervals.size(); i++)
+                    config.sink_min_interval[i] = intervals[i] | 0UL;
                 strlcpy(config.ota_url, doc["ota_url"] | "", sizeof(config.ota_url));
                 strlcpy(config.ota_result_url, doc["ota_result_url"] | "", sizeof(config.ota_result_url));
                 config.publishingInterval = doc["publishingInterval"] | 10000UL;
                 config.temp_offset = doc["temp_offset"] | 0.0f;
+                config.payload_format = doc["payload_format"] | 0;
+                config.adaptive_interval = doc["adaptive_interval"] | false;
+                config.align_interval = doc["align_interval"] | false;
+                config.interval_min = doc["interval_min"] | 5000UL;
+                config.interval_max = doc["interval_max"] | 60000UL;
+                config.sleep_min = doc["sleep_min"] | 60UL;
+                config.sleep_max = doc["sleep_max"] | 3600UL;
+                config.ulp_wake = doc["ulp_wake"] | false;
+                config.low_power = doc["low_power"] | false;
+                config.espnow_mode = doc["espnow_mode"] | 0;
+                config.espnow_channel = doc["espnow_channel"] | 1;
+                JsonArrayConst networks = doc["networks"];
+                for (uint8_t i = 0; i < WIFI_EXTRA_NETWORKS && i < networks.size(); i++)
+                {
+                    strlcpy(config.wifi_extra[i].ssid, networks[i]["ssid"] | "", sizeof(config.wifi_extra[i].ssid));
+                    strlcpy(config.wifi_extra[i].password, networks[i]["password"] | "",
+                            sizeof(config.wifi_extra[i].password));
+                }
             }
             else
             {
-                Serial.printf("[CONFIG] JSON parse error: %s\n", error.c_str());
+                logError(LOG_CONFIG, "JSON parse error: %s", error.c_str());
             }
         }
         else
         {
-            Serial.println("[CONFIG] Failed to open config file for reading");
+            logError(LOG_CONFIG, "Failed to open config file for reading");
         }
     }
     else
     {
         // === Шаг 3: Файл не существует → создаём его с настройками по умолчанию ===
-        Serial.println("[CONFIG] Config file not found — saving defaults");
+        logWarn(LOG_CONFIG, "Config file not found — saving defaults");
         saveConfig();
     }
 
-    LittleFS.end();
+    halFsEnd();
 }
 
 void saveConfig()
 {
-    if (!LittleFS.begin(true))
-    { // true = format on fail
-        Serial.println("[FS] LittleFS Mount Failed");
+    if (!halFsBegin())
+    { // format on fail
+        logError(LOG_FS, "LittleFS Mount Failed");
         return;
     }
 
-    DynamicJsonDocument doc(1024);
+    configRevision++;
+    DynamicJsonDocument doc(CONFIG_JSON_SIZE);
     doc["ssid"] = config.ssid;
     doc["password"] = config.password;
     doc["mqtt_server"] = config.mqtt_server;
@@ -95,21 +138,74 @@ void saveConfig()
     doc["web_password"] = config.web_password;
     doc["uid"] = config.uid;
     doc["post_url"] = config.post_url;
+    doc["influx_host"] = config.influx_host;
+    doc["influx_port"] = config.influx_port;
+    JsonArray intervals = doc.createNestedArray("sink_min_interval"); // по SinkId
+    for (uint8_t i = 0; i < SINK_COUNT; i++)
+        intervals.add(config.sink_min_interval[i]);
     doc["ota_url"] = config.ota_url;
     doc["ota_result_url"] = config.ota_result_url;
     doc["publishingInterval"] = config.publishingInterval;
     doc["temp_offset"] = config.temp_offset;
+    doc["payload_format"] = config.payload_format;
+    doc["adaptive_interval"] = config.adaptive_interval;
+    doc["align_interval"] = config.align_interval;
+    doc["interval_min"] = config.interval_min;
+    doc["interval_max"] = config.interval_max;
+    doc["sleep_min"] = config.sleep_min;
+    doc["sleep_max"] = config.sleep_max;
+    doc["ulp_wake"] = config.ulp_wake;
+    doc["low_power"] = config.low_power;
+    doc["espnow_mode"] = config.espnow_mode;
+    doc["espnow_channel"] = config.espnow_channel;
+    JsonArray networks = doc.createNestedArray("networks");
+    for (uint8_t i = 0; i < WIFI_EXTRA_NETWORKS; i++)
+    {
+        if (config.wifi_extra[i].ssid[0] == '\0')
+            continue;
+        JsonObject network = networks.createNestedObject();
+        network["ssid"] = config.wifi_extra[i].ssid;
+        network["password"] = config.wifi_extra[i].password;
+    }
 
-    File file = LittleFS.open(CONFIG_FILE, "w");
-    if (file)
+    char buf[CONFIG_JSON_SIZE];
+    size_t len = serializeJson(doc, buf, sizeof(buf));
+    traceBegin(TRACE_FLASH_WRITE);
+    bool written = halFsWrite(CONFIG_FILE, buf, len);
+    traceEnd(TRACE_FLASH_WRITE);
+    if (written)
     {
-        serializeJson(doc, file);
-        file.close();
-        Serial.println("[CONFIG] Config saved to LittleFS");
+        logInfo(LOG_CONFIG, "Config saved to LittleFS");
     }
     else
     {
-        Serial.println("[CONFIG] Failed to open config file for writing");
+        logError(LOG_CONFIG, "Failed to open config file for writing");
+    }
+    halFsEnd();
+}
+
+/**
+ * @brief Новая основная сеть; прежняя становится первой запасной (повторы убираются)
+ */
+void configSetNetwork(const char *ssid, const char *password)
+{
+    WifiCredentials previous = {};
+    strlcpy(previous.ssid, config.ssid, sizeof(previous.ssid));
+    strlcpy(previous.password, config.password, sizeof(previous.password));
+    strlcpy(config.ssid, ssid, sizeof(config.ssid));
+    strlcpy(config.password, password, sizeof(config.password));
+    if (previous.ssid[0] == '\0' || strcmp(previous.ssid, config.ssid) == 0)
+        return;
+
+    // Запасные без новой основной сети, прежняя основная — первой
+    WifiCredentials extra[WIFI_EXTRA_NETWORKS] = {};
+    uint8_t count = 0;
+    extra[count++] = previous;
+    for (uint8_t i = 0; i < WIFI_EXTRA_NETWORKS && count < WIFI_EXTRA_NETWORKS; i++)
+    {
+        const WifiCredentials &network = config.wifi_extra[i];
+        if (network.ssid[0] != '\0' && strcmp(network.ssid, config.ssid) != 0 && strcmp(network.ssid, previous.ssid) != 0)
+            extra[count++] = network;
     }
-    LittleFS.end();
+    memcpy(config.wifi_extra, extra, sizeof(extra));
 }
@@ -0,0 +1,262 @@
+#include "espnow.h"
+#include "mqtt.h"
+#include "sink.h"
+#include "payload.h"
+#include "config.h"
+#include "hal.h"
+#include "log.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+GatewayNode gatewayNodes[GATEWAY_MAX_NODES];
+uint8_t gatewayNodeCount = 0;
+GatewayStats gatewayStats;
+
+// Очередь приёма: один писатель (колбэк радио), один читатель (gatewayPoll)
+struct RadioFrame
+{
+    uint8_t mac[6];
+    int8_t rssi;
+    uint8_t len;
+    uint8_t data[ESPNOW_FRAME_SIZE];
+};
+
+static RadioFrame radioQueue[GATEWAY_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueTail = 0;
+
+// === Кадр ===
+static void putU16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t getU16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static void putLe(uint8_t *p, uint64_t v, uint8_t bytes)
+{
+    for (uint8_t i = 0; i < bytes; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t getLe(const uint8_t *p, uint8_t bytes)
+{
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < bytes; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+/**
+ * @brief Кадр узла: показание в фиксированной точке без преобразований
+ * @return ESPNOW_FRAME_SIZE или 0, если буфер мал
+ */
+size_t encodeNodeFrame(uint8_t *buf, size_t size, uint16_t seq, const SensorReading &reading)
+{
+    if (size < ESPNOW_FRAME_SIZE)
+        return 0;
+    buf[0] = ESPNOW_FRAME_MAGIC;
+    buf[1] = ESPNOW_FRAME_VERSION;
+    buf[2] = reading.flags;
+    putU16(buf + 3, seq);
+    putU16(buf + 5, (uint16_t)reading.tempCenti);
+    putU16(buf + 7, reading.humPermille);
+    putLe(buf + 9, reading.pressurePa, 4);
+    putU16(buf + 13, reading.vccMv);
+    putLe(buf + 15, reading.timestamp, 8);
+    return ESPNOW_FRAME_SIZE;
+}
+
+bool decodeNodeFrame(const uint8_t *buf, size_t len, uint16_t &seq, SensorReading &reading)
+{
+    if (len < ESPNOW_FRAME_SIZE || buf[0] != ESPNOW_FRAME_MAGIC || buf[1] != ESPNOW_FRAME_VERSION)
+        return false;
+
+    memset(&reading, 0, sizeof(reading));
+    seq = getU16(buf + 3);
+    // Значения каналов без флага не переносятся
+    reading.flags = buf[2];
+    if (reading.flags & SAMPLE_TEMPERATURE)
+        reading.tempCenti = (int16_t)getU16(buf + 5);
+    if (reading.flags & SAMPLE_HUMIDITY)
+        reading.humPermille = getU16(buf + 7);
+    if (reading.flags & SAMPLE_PRESSURE)
+        reading.pressurePa = (uint32_t)getLe(buf + 9, 4);
+    if (reading.flags & SAMPLE_VCC)
+        reading.vccMv = getU16(buf + 13);
+    reading.timestamp = getLe(buf + 15, 8);
+    return true;
+}
+
+// === Шлюз ===
+void gatewayReset()
+{
+    memset(gatewayNodes, 0, sizeof(gatewayNodes));
+    gatewayNodeCount = 0;
+    memset(&gatewayStats, 0, sizeof(gatewayStats));
+    __atomic_store_n(&queueHead, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&queueTail, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Колбэк приёма радио: только копирование в очередь
+ */
+void gatewayReceive(const uint8_t mac[6], int rssi, const uint8_t *data, size_t len)
+{
+    gatewayStats.received++;
+    uint8_t head = __atomic_load_n(&queueHead, __ATOMIC_RELAXED);
+    uint8_t next = (uint8_t)((head + 1) % GATEWAY_QUEUE_SIZE);
+    if (next == __atomic_load_n(&queueTail, __ATOMIC_ACQUIRE))
+    {
+        gatewayStats.overflows++;
+        return;
+    }
+    RadioFrame &frame = radioQueue[head];
+    memcpy(frame.mac, mac, 6);
+    frame.rssi = (int8_t)rssi;
+    frame.len = (uint8_t)(len < ESPNOW_FRAME_SIZE ? len : ESPNOW_FRAME_SIZE);
+    memcpy(frame.data, data, frame.len);
+    __atomic_store_n(&queueHead, next, __ATOMIC_RELEASE);
+}
+
+static GatewayNode *findNode(const uint8_t mac[6])
+{
+    for (uint8_t i = 0; i < gatewayNodeCount; i++)
+    {
+        if (memcmp(gatewayNodes[i].mac, mac, 6) == 0)
+            return &gatewayNodes[i];
+    }
+    return nullptr;
+}
+
+// Новая запись; при полной таблице вытесняется узел, молчавший дольше всех
+static GatewayNode *addNode(const uint8_t mac[6], uint32_t nowMs)
+{
+    GatewayNode *node;
+    if (gatewayNodeCount < GATEWAY_MAX_NODES)
+    {
+        node = &gatewayNodes[gatewayNodeCount++];
+    }
+    else
+    {
+        node = &gatewayNodes[0];
+        for (uint8_t i = 1; i < GATEWAY_MAX_NODES; i++)
+        {
+            if (nowMs - gatewayNodes[i].lastSeenMs > nowMs - node->lastSeenMs)
+                node = &gatewayNodes[i];
+        }
+        gatewayStats.evicted++;
+    }
+    memset(node, 0, sizeof(*node));
+    memcpy(node->mac, mac, 6);
+    return node;
+}
+
+/**
+ * @brief Повтор кадра (тот же или недавний seq вскоре после приёма) отбрасывается;
+ *        пропуски seq в пределах окна считаются потерями
+ */
+static bool acceptFrame(const RadioFrame &frame, uint16_t seq, const SensorReading &reading, uint32_t nowMs,
+                        uint64_t nowTimestamp)
+{
+    GatewayNode *node = findNode(frame.mac);
+    if (node)
+    {
+        uint16_t ahead = (uint16_t)(seq - node->seq);
+        uint16_t behind = (uint16_t)(node->seq - seq);
+        bool recent = nowMs - node->lastSeenMs < GATEWAY_DUPLICATE_MS;
+        if (recent && behind <= GATEWAY_SEQ_WINDOW)
+        {
+            gatewayStats.duplicates++;
+            return false;
+        }
+        if (ahead > 1 && ahead <= GATEWAY_SEQ_WINDOW)
+        {
+            node->lost += ahead - 1;
+            gatewayStats.lost += ahead - 1;
+        }
+    }
+    else
+    {
+        node = addNode(frame.mac, nowMs);
+    }
+
+    node->seq = seq;
+    node->reading = reading;
+    if (!reading.timestamp)
+        node->reading.timestamp = nowTimestamp; // часы узла не синхронизированы — время приёма
+    node->rssi = frame.rssi;
+    node->lastSeenMs = nowMs;
+    node->frames++;
+    node->pending = true;
+    node->queuedSinks = 0;
+    gatewayStats.accepted++;
+    return true;
+}
+
+/**
+ * @brief Разбор очереди приёма (из задачи, владеющей MQTT)
+ * @return число принятых (не повторных) кадров
+ */
+uint8_t gatewayPoll(uint32_t nowMs, uint64_t nowTimestamp)
+{
+    uint8_t accepted = 0;
+    uint8_t tail = __atomic_load_n(&queueTail, __ATOMIC_RELAXED);
+    while (tail != __atomic_load_n(&queueHead, __ATOMIC_ACQUIRE))
+    {
+        const RadioFrame &frame = radioQueue[tail];
+        uint16_t seq;
+        SensorReading reading;
+        if (!decodeNodeFrame(frame.data, frame.len, seq, reading))
+            gatewayStats.malformed++;
+        else if (acceptFrame(frame, seq, reading, nowMs, nowTimestamp))
+            accepted++;
+        tail = (uint8_t)((tail + 1) % GATEWAY_QUEUE_SIZE);
+        __atomic_store_n(&queueTail, tail, __ATOMIC_RELEASE);
+    }
+    return accepted;
+}
+
+/**
+ * @brief Новые показания узлов — в очереди приёмников (MQTT в топики узла, POST и UDP с uid по MAC);
+ *        отправляют и повторяют их приёмники. Приёмник с полной очередью получит показание в следующий раз
+ * @return число узлов, чьи показания приняли все приёмники
+ */
+uint8_t gatewayForward()
+{
+    uint8_t forwarded = 0;
+    for (uint8_t i = 0; i < gatewayNodeCount; i++)
+    {
+        GatewayNode &node = gatewayNodes[i];
+        if (!node.pending || !sinkPublishNode(node.mac, node.rssi, node.reading, node.queuedSinks))
+            continue;
+        node.pending = false;
+        forwarded++;
+    }
+    if (forwarded)
+    {
+        gatewayStats.forwarded += forwarded;
+        publishGatewayStats();
+        logInfo(LOG_ESPNOW, "Forwarded %u nodes (frames %lu, duplicates %lu, lost %lu)", forwarded,
+                (unsigned long)gatewayStats.accepted, (unsigned long)gatewayStats.duplicates,
+                (unsigned long)gatewayStats.lost);
+    }
+    return forwarded;
+}
+
+size_t encodeGatewayStats(char *buf, size_t size)
+{
+    int len = snprintf(buf, size,
+                       "{\"nodes\":%u,\"received\":%lu,\"accepted\":%lu,\"duplicates\":%lu,\"lost\":%lu,"
+                       "\"malformed\":%lu,\"overflows\":%lu,\"evicted\":%lu,\"forwarded\":%lu}",
+                       gatewayNodeCount, (unsigned long)gatewayStats.received, (unsigned long)gatewayStats.accepted,
+                       (unsigned long)gatewayStats.duplicates, (unsigned long)gatewayStats.lost,
+                       (unsigned long)gatewayStats.malformed, (unsigned long)gatewayStats.overflows,
+                       (unsigned long)gatewayStats.evicted, (unsigned long)gatewayStats.forwarded);
+    return len > 0 && (size_t)len < size ? (size_t)len : 0;
+}
@@ -0,0 +1,369 @@
+// fleet_native.cpp — нагрузочный генератор: парк виртуальных узлов в одном процессе ([env:native_fleet])
+// Каждый узел исполняет настоящие readSensors()/publishSensorData()/sendPostRequest()
+// со своим MAC, погодой, MQTT-соединением и состоянием публикации.
+//
+// С -e узлы шлют кадры ESP-NOW через общий эфир одному шлюзу, и в брокер ходит только он.
+// С -A узлы работают по границам интервала и шлют в своём слоте (publish_slot.h) — сравнение с -S.
+//
+// Пример: .pio/build/native_fleet/program -m localhost:1883 -n 5000 -i 10000 -j 2000 -d 300 -r 120
+#include "config.h"
+#include "sensors.h"
+#include "mqtt.h"
+#include "post.h"
+#include "payload.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "espnow.h"
+#include "sink.h"
+#include "publish_slot.h"
+#include "hal.h"
+#include "hal_native.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <vector>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+struct VirtualNode
+{
+    NativeNode *hal;
+    MqttSession mqtt;
+    SchedulerState scheduler;
+    uint32_t nextCycle;
+    uint32_t nextMqtt; // следующий handleMqtt(): по mqttServiceWaitMs(), как в прошивке
+    uint16_t seq; // номер кадра ESP-NOW
+    uint32_t slotMs; // смещение отправки от границы интервала (-A)
+};
+
+struct FleetOptions
+{
+    long nodes = 100;
+    unsigned long intervalMs = 10000;
+    unsigned long jitterMs = 1000;
+    long durationS = 60;
+    long restartAtS = -1;      // момент имитации перезапуска брокера (обрыв всех соединений)
+    double dropRate = 0;       // вероятность обрыва соединения узла перед циклом
+    double sensorFailRate = 0; // доля узлов с неисправными датчиками
+    bool synchronized = false; // все узлы стартуют одновременно (как после отключения питания)
+    bool espNow = false;       // узлы — через шлюз ESP-NOW
+    double radioLoss = 0;      // доля потерянных кадров ESP-NOW
+    bool aligned = false;      // границы интервала + слот узла вместо случайного дрожания
+};
+
+static void usage(const char *name)
+{
+    printf("Usage: %s -m host[:port] [-p post_url] [-n nodes] [-i interval_ms] [-j jitter_ms]\n"
+           "          [-d duration_s] [-r restart_at_s] [-x drop_rate] [-s sensor_fail_rate] [-f 0|1] [-S]\n"
+           "          [-e] [-l radio_loss] [-A]\n",
+           name);
+}
+
+static double random01()
+{
+    return (double)rand() / RAND_MAX;
+}
+
+static uint32_t nextDelay(const FleetOptions &opt, const VirtualNode &vn, uint32_t now)
+{
+    if (opt.aligned)
+        return alignedWaitMs(now - vn.slotMs, opt.intervalMs); // часы симуляции вместо эпохи
+
+    long jitter = opt.jitterMs ? (long)(random01() * 2 * opt.jitterMs) - (long)opt.jitterMs : 0;
+    long delay = (long)opt.intervalMs + jitter;
+    return delay > 0 ? (uint32_t)delay : 1;
+}
+
+// Подстановка состояния узла в глобальные переменные прошивки и обратно
+static void enterNode(VirtualNode &vn)
+{
+    halSimSelectNode(vn.hal);
+    mqttSession = vn.mqtt;
+    sampleScheduler = vn.scheduler;
+}
+
+static void leaveNode(VirtualNode &vn)
+{
+    vn.mqtt = mqttSession;
+    vn.scheduler = sampleScheduler;
+}
+
+// Узел ESP-NOW: кадр с повторами вместо MQTT/HTTP
+static void sendFrame(VirtualNode &vn, const SensorReading &reading)
+{
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    size_t len = encodeNodeFrame(frame, sizeof(frame), ++vn.seq, reading);
+    for (uint8_t i = 0; i < ESPNOW_NODE_REPEATS; i++)
+        halRadioSend(frame, len);
+}
+
+// Шлюз: своё MQTT-соединение, разбор очереди и пересылка через приёмники (очереди sink.h — только его)
+static void serveGateway(VirtualNode &gateway)
+{
+    enterNode(gateway);
+    handleMqtt();
+    gatewayPoll(halMillis(), timeNowMs());
+    gatewayForward();
+    sinkServeAll();
+    leaveNode(gateway);
+}
+
+int main(int argc, char **argv)
+{
+    FleetOptions opt;
+    char mqttServer[64] = "";
+    int mqttPort = 1883;
+    char postUrl[64] = "";
+    int format = PAYLOAD_TEXT;
+
+    int c;
+    while ((c = getopt(argc, argv, "m:p:n:i:j:d:r:x:s:f:Sel:Ah")) != -1)
+    {
+        switch (c)
+        {
+        case 'm':
+        {
+            strlcpy(mqttServer, optarg, sizeof(mqttServer));
+            char *colon = strchr(mqttServer, ':');
+            if (colon)
+            {
+                *colon = '\0';
+                mqttPort = atoi(colon + 1);
+            }
+            break;
+        }
+        case 'p':
+            strlcpy(postUrl, optarg, sizeof(postUrl));
+            break;
+        case 'n':
+            opt.nodes = atol(optarg);
+            break;
+        case 'i':
+            opt.intervalMs = strtoul(optarg, nullptr, 10);
+            break;
+        case 'j':
+            opt.jitterMs = strtoul(optarg, nullptr, 10);
+            break;
+        case 'd':
+            opt.durationS = atol(optarg);
+            break;
+        case 'r':
+            opt.restartAtS = atol(optarg);
+            break;
+        case 'x':
+            opt.dropRate = atof(optarg);
+            break;
+        case 's':
+            opt.sensorFailRate = atof(optarg);
+            break;
+        case 'f':
+            format = atoi(optarg);
+            break;
+        case 'S':
+            opt.synchronized = true;
+            break;
+        case 'e':
+            opt.espNow = true;
+            break;
+        case 'l':
+            opt.radioLoss = atof(optarg);
+            break;
+        case 'A':
+            opt.aligned = true;
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+    if (opt.nodes <= 0 || (mqttServer[0] == '\0' && postUrl[0] == '\0'))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // По одному сокету на узел
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)opt.nodes + 64)
+    {
+        limit.rlim_cur = limit.rlim_max < (rlim_t)opt.nodes + 64 ? limit.rlim_max : (rlim_t)opt.nodes + 64;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    halSimSetLogEnabled(false);
+    halSimSetVirtualDelays(true); // ожидание преобразований датчиков не тормозит парк
+    loadConfig();
+    strlcpy(config.mqtt_server, mqttServer, sizeof(config.mqtt_server));
+    config.mqtt_port = mqttPort;
+    strlcpy(config.post_url, postUrl, sizeof(config.post_url));
+    strlcpy(config.uid, "fleet", sizeof(config.uid));
+    config.publishingInterval = 0; // темп задаёт генератор
+    config.payload_format = (uint8_t)format;
+
+    std::vector<VirtualNode> fleet(opt.nodes);
+    for (long i = 0; i < opt.nodes; i++)
+    {
+        VirtualNode &vn = fleet[i];
+        vn.hal = halSimCreateNode();
+        vn.mqtt = {0, 0, 0};
+        schedulerReset(vn.scheduler, opt.intervalMs);
+        vn.nextCycle = opt.synchronized ? 0 : (uint32_t)(random01() * opt.intervalMs);
+
+        halSimSelectNode(vn.hal);
+        const uint8_t mac[6] = {0x02, 0x4d, 0x45, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i};
+        halSimSetMac(mac);
+        vn.slotMs = publishSlotOffsetMs(mac, opt.intervalMs);
+        if (opt.aligned)
+            vn.nextCycle = vn.slotMs; // все стартуют вместе, первая отправка — в своём слоте
+        halSimSetWeather(5.0f + 20.0f * random01(), 2.0f + 6.0f * random01(), 99000.0f + 4000.0f * random01());
+        bool failed = random01() < opt.sensorFailRate;
+        halSimSetSensorFault(failed, failed);
+        initMqtt();
+        if (opt.espNow)
+            halRadioBegin(1, nullptr);
+    }
+
+    VirtualNode gateway = {};
+    if (opt.espNow)
+    {
+        gateway.hal = halSimCreateNode();
+        gateway.mqtt = {0, 0, 0};
+        halSimSelectNode(gateway.hal);
+        const uint8_t mac[6] = {0x02, 0x47, 0x57, 0x00, 0x00, 0x01};
+        halSimSetMac(mac);
+        halSimSetRadioLoss((float)opt.radioLoss);
+        gatewayReset();
+        initMqtt();
+        reconnectMqtt(); // дальше соединение поддерживает handleMqtt()
+        halRadioBegin(1, gatewayReceive);
+    }
+    initSensors();
+
+    printf("t_s,connected,msg_s,bytes_s,http_s,http_err_s,connect_attempts_s,connects_s,disconnects_s\n");
+
+    uint32_t start = halMillis();
+    uint32_t lastReport = start;
+    uint32_t restartTime = 0;
+    bool restarted = false;
+    HalSimTraffic prev = halSimTraffic();
+    uint64_t peakConnectAttempts = 0;
+    long recoverySeconds = -1;
+
+    while (halMillis() - start < (uint32_t)opt.durationS * 1000)
+    {
+        uint32_t now = halMillis() - start;
+        bool busy = false;
+
+        if (opt.restartAtS >= 0 && !restarted && now >= (uint32_t)opt.restartAtS * 1000)
+        {
+            for (VirtualNode &vn : fleet)
+            {
+                halSimSelectNode(vn.hal);
+                halSimDropConnection();
+            }
+            restarted = true;
+            restartTime = now;
+        }
+
+        for (VirtualNode &vn : fleet)
+        {
+            if ((int32_t)(now - vn.nextCycle) < 0)
+                continue;
+            busy = true;
+            enterNode(vn);
+            if (opt.dropRate > 0 && random01() < opt.dropRate)
+                halSimDropConnection();
+
+            readSensors();
+            SensorReading reading = latestReading();
+            if (opt.espNow)
+            {
+                sendFrame(vn, reading);
+            }
+            else
+            {
+                // Напрямую, без очередей sink.h (они общие на процесс); без соединения MQTT пропускается —
+                // подключение только из handleMqtt() ниже, с паузой и разбросом
+                publishSensorData(reading);
+                sendPostRequest(reading);
+            }
+
+            leaveNode(vn);
+            vn.nextCycle = now + nextDelay(opt, vn, now);
+            if (opt.espNow)
+                serveGateway(gateway); // очередь приёма не успевает переполниться
+        }
+
+        if (opt.espNow)
+            serveGateway(gateway);
+        else
+        {
+            // Обслуживание соединения между измерениями, как delayUntilServingMqtt() в main.cpp
+            for (VirtualNode &vn : fleet)
+            {
+                if ((int32_t)(now - vn.nextMqtt) < 0)
+                    continue;
+                busy = true;
+                enterNode(vn);
+                handleMqtt();
+                vn.nextMqtt = halMillis() - start + mqttServiceWaitMs();
+                leaveNode(vn);
+            }
+        }
+
+        if (halMillis() - lastReport >= 1000)
+        {
+            lastReport += 1000;
+            long connectedNow = 0;
+            for (VirtualNode &vn : fleet)
+            {
+                halSimSelectNode(vn.hal);
+                connectedNow += halMqttConnected();
+            }
+            const HalSimTraffic &t = halSimTraffic();
+            uint64_t attempts = t.connectAttempts - prev.connectAttempts;
+            printf("%lu,%ld,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+                   (unsigned long)((lastReport - start) / 1000), connectedNow,
+                   (unsigned long long)(t.mqttMessages - prev.mqttMessages),
+                   (unsigned long long)(t.mqttBytes - prev.mqttBytes + t.httpBytes - prev.httpBytes),
+                   (unsigned long long)(t.httpRequests - prev.httpRequests),
+                   (unsigned long long)(t.httpErrors - prev.httpErrors),
+                   (unsigned long long)attempts,
+                   (unsigned long long)(t.connects - prev.connects),
+                   (unsigned long long)(t.disconnects - prev.disconnects));
+            fflush(stdout);
+            if (restarted)
+            {
+                if (attempts > peakConnectAttempts)
+                    peakConnectAttempts = attempts;
+                if (recoverySeconds < 0 && connectedNow * 100 >= opt.nodes * 95)
+                    recoverySeconds = (long)((halMillis() - start - restartTime) / 1000);
+            }
+            prev = t;
+        }
+
+        if (!busy)
+            usleep(1000);
+    }
+
+    const HalSimTraffic &t = halSimTraffic();
+    double seconds = (halMillis() - start) / 1000.0;
+    printf("# nodes=%ld duration_s=%.1f msg_s=%.1f bytes_s=%.1f http_s=%.1f connects=%llu disconnects=%llu",
+           opt.nodes, seconds, t.mqttMessages / seconds, (t.mqttBytes + t.httpBytes) / seconds,
+           t.httpRequests / seconds, (unsigned long long)t.connects, (unsigned long long)t.disconnects);
+    if (restarted)
+        printf(" restart_peak_connect_attempts_s=%llu recovery_95pct_s=%ld",
+               (unsigned long long)peakConnectAttempts, recoverySeconds);
+    if (opt.espNow)
+        printf(" radio_frames=%llu radio_lost=%llu gateway_nodes=%u accepted=%lu duplicates=%lu lost=%lu"
+               " overflows=%lu evicted=%lu forwarded=%lu",
+               (unsigned long long)t.radioFrames, (unsigned long long)t.radioLost, gatewayNodeCount,
+               (unsigned long)gatewayStats.accepted, (unsigned long)gatewayStats.duplicates,
+               (unsigned long)gatewayStats.lost, (unsigned long)gatewayStats.overflows,
+               (unsigned long)gatewayStats.evicted, (unsigned long)gatewayStats.forwarded);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,655 @@
+// hal_esp32.cpp — реализация HAL для платы (env:d1_mini_esp32)
+#include <Arduino.h>
+#include <Wire.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <sys/time.h>
+#include <LittleFS.h>
+#include "feature_flags.h"
+#if FEATURE_HTTP_POST
+#include <HTTPClient.h>
+#endif
+#if FEATURE_MQTT
+#include <PubSubClient.h>
+#endif
+#if FEATURE_DHT22
+#include <DHT.h>             // ← для DHT22
+#endif
+#include <esp_heap_caps.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/platform.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+#include "hal.h"
+#include "https.h"
+#include "log.h"
+
+// === ПИНЫ ===
+// DHT22 подключён к GPIO18, I2C: SDA=21, SCL=22, делитель батареи на GPIO34
+const uint8_t DHT_PIN = 18;
+const uint8_t I2C_SDA_PIN = 21;
+const uint8_t I2C_SCL_PIN = 22;
+const uint8_t VBAT_PIN = 34;
+
+#if FEATURE_DHT22
+DHT dht22(DHT_PIN, DHT22);
+#endif
+
+#if FEATURE_MQTT
+WiFiClient espClient;
+PubSubClient mqttClient(espClient);
+#endif
+
+// === Часы ===
+uint32_t halMillis() { return millis(); }
+uint32_t halMicros() { return micros(); }
+void halDelay(uint32_t ms) { delay(ms); }
+
+uint64_t halClockUs()
+{
+    // Системное время ведётся от RTC и продолжает идти в глубоком сне;
+    // прошивка его не устанавливает, поэтому это монотонный счётчик от включения питания
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+void halLogWrite(const char *text, size_t len)
+{
+    Serial.write((const uint8_t *)text, len);
+}
+
+uint32_t halFreeHeap() { return ESP.getFreeHeap(); }
+uint32_t halRandom() { return esp_random(); }
+
+// === Задачи ===
+uint8_t halCpuCore() { return (uint8_t)xPortGetCoreID(); }
+uint32_t halTaskId() { return (uint32_t)xTaskGetCurrentTaskHandle(); }
+
+void halTaskForEach(HalTaskFn fn, void *ctx)
+{
+    UBaseType_t count = uxTaskGetNumberOfTasks() + 2; // задачи, созданные между вызовами
+    TaskStatus_t *tasks = (TaskStatus_t *)malloc(count * sizeof(TaskStatus_t));
+    if (!tasks)
+        return;
+    count = uxTaskGetSystemState(tasks, count, nullptr);
+    for (UBaseType_t i = 0; i < count; i++)
+        fn((uint32_t)tasks[i].xHandle, tasks[i].pcTaskName, ctx);
+    free(tasks);
+}
+
+// === Датчики ===
+#if FEATURE_DHT22
+bool halDhtBegin()
+{
+    dht22.begin();
+    return true; // DHT22 не отвечает до первого чтения
+}
+
+bool halReadDht(float &temperature, float &humidity)
+{
+    humidity = dht22.readHumidity();
+    temperature = dht22.readTemperature();
+    return !isnan(humidity) && !isnan(temperature);
+}
+#endif
+
+int halReadBatteryRaw()
+{
+    return analogRead(VBAT_PIN);
+}
+
+// === Шина I2C ===
+bool halI2cBegin(uint32_t frequencyHz)
+{
+    // явно указываем пины для MH-ET LIVE D1 Mini ESP32
+    return Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, frequencyHz);
+}
+
+bool halI2cWrite(uint8_t address, const uint8_t *data, size_t len)
+{
+    Wire.beginTransmission(address);
+    Wire.write(data, len);
+    return Wire.endTransmission() == 0;
+}
+
+bool halI2cRead(uint8_t address, uint8_t *data, size_t len)
+{
+    if (Wire.requestFrom(address, (uint8_t)len) != len)
+        return false;
+    return Wire.readBytes(data, len) == len;
+}
+
+bool halI2cWriteRead(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+    Wire.beginTransmission(address);
+    Wire.write(tx, txLen);
+    if (Wire.endTransmission(false) != 0) // без STOP: чтение продолжает ту же транзакцию
+        return false;
+    return halI2cRead(address, rx, rxLen);
+}
+
+// === Файловая система ===
+bool halFsBegin() { return LittleFS.begin(true); } // true = format on fail
+void halFsEnd() { LittleFS.end(); }
+bool halFsExists(const char *path) { return LittleFS.exists(path); }
+bool halFsRemove(const char *path) { return LittleFS.remove(path); }
+
+size_t halFsRead(const char *path, char *buf, size_t size)
+{
+    File file = LittleFS.open(path, "r");
+    if (!file)
+        return 0;
+    size_t len = file.readBytes(buf, size);
+    file.close();
+    return len;
+}
+
+bool halFsWrite(const char *path, const char *data, size_t len)
+{
+    File file = LittleFS.open(path, "w");
+    if (!file)
+        return false;
+    size_t written = file.write((const uint8_t *)data, len);
+    file.close();
+    return written == len;
+}
+
+bool halFsAppend(const char *path, const uint8_t *data, size_t len)
+{
+    File file = LittleFS.open(path, "a");
+    if (!file)
+        return false;
+    size_t written = file.write(data, len);
+    file.close();
+    return written == len;
+}
+
+size_t halFsReadAt(const char *path, size_t offset, uint8_t *buf, size_t size)
+{
+    File file = LittleFS.open(path, "r");
+    if (!file)
+        return 0;
+    size_t len = file.seek(offset) ? file.read(buf, size) : 0;
+    file.close();
+    return len;
+}
+
+size_t halFsSize(const char *path)
+{
+    File file = LittleFS.open(path, "r");
+    if (!file)
+        return 0;
+    size_t size = file.size();
+    file.close();
+    return size;
+}
+
+bool halFsRename(const char *from, const char *to) { return LittleFS.rename(from, to); }
+
+// === Сеть ===
+bool halNetConnected() { return WiFi.status() == WL_CONNECTED; }
+int halNetRssi() { return WiFi.RSSI(); }
+void halMacAddress(uint8_t mac[6]) { WiFi.macAddress(mac); }
+
+#if FEATURE_MQTT
+void halMqttBegin(const char *host, uint16_t port)
+{
+    mqttClient.setServer(host, port);
+    mqttClient.setBufferSize(256);
+}
+
+bool halMqttConnect(const char *clientId, const char *user, const char *password)
+{
+    if (user && password)
+        return mqttClient.connect(clientId, user, password);
+    return mqttClient.connect(clientId);
+}
+
+bool halMqttConnected() { return mqttClient.connected(); }
+int halMqttState() { return mqttClient.state(); }
+void halMqttLoop() { mqttClient.loop(); }
+
+bool halMqttPublish(const char *topic, const uint8_t *payload, size_t len, bool retain)
+{
+    return mqttClient.publish(topic, payload, len, retain);
+}
+
+// Заголовок и данные уходят в сокет сразу, мимо буфера PubSubClient (256 байт)
+bool halMqttPublishBegin(const char *topic, size_t len, bool retain)
+{
+    return mqttClient.beginPublish(topic, len, retain);
+}
+
+bool halMqttPublishWrite(const uint8_t *data, size_t len)
+{
+    return mqttClient.write(data, len) == len;
+}
+
+bool halMqttPublishEnd() { return mqttClient.endPublish() == 1; }
+
+static HalMqttReceiveFn mqttReceive = nullptr;
+
+static void mqttCallback(char *topic, uint8_t *payload, unsigned int len)
+{
+    if (mqttReceive)
+        mqttReceive(topic, payload, len);
+}
+
+void halMqttOnMessage(HalMqttReceiveFn onMessage)
+{
+    mqttReceive = onMessage;
+    mqttClient.setCallback(mqttCallback);
+}
+
+bool halMqttSubscribe(const char *topic) { return mqttClient.subscribe(topic); }
+#endif
+
+int halUdpRequest(const char *host, uint16_t port, const uint8_t *tx, size_t txLen,
+                  uint8_t *rx, size_t rxSize, uint32_t timeoutMs)
+{
+    WiFiUDP udp;
+    if (!udp.beginPacket(host, port))
+        return -1;
+    udp.write(tx, txLen);
+    if (!udp.endPacket())
+    {
+        udp.stop();
+        return -1;
+    }
+    uint32_t start = millis();
+    int len = -1;
+    while (millis() - start < timeoutMs)
+    {
+        if (udp.parsePacket() > 0)
+        {
+            len = udp.read(rx, rxSize);
+            break;
+        }
+        delay(1);
+    }
+    udp.stop();
+    return len;
+}
+
+bool halUdpSend(const char *host, uint16_t port, const uint8_t *data, size_t len)
+{
+    static WiFiUDP udp;
+    static char resolvedHost[64] = "";
+    static IPAddress address;
+    if (strcmp(host, resolvedHost) != 0)
+    {
+        if (!WiFi.hostByName(host, address))
+            return false;
+        strlcpy(resolvedHost, host, sizeof(resolvedHost));
+    }
+    if (!udp.beginPacket(address, port))
+        return false;
+    udp.write(data, len);
+    return udp.endPacket();
+}
+
+// === HTTPS ===
+// mbedTLS напрямую: WiFiClientSecure не даёт доступа к сессии для сохранения в RTC
+RTC_DATA_ATTR TlsSessionCache tlsSession;
+
+const char *halCaBundle()
+{
+    static char *bundle = nullptr;
+    if (bundle || !halFsBegin())
+        return bundle;
+    char *buf = (char *)malloc(TLS_CA_BUNDLE_MAX + 1);
+    if (!buf)
+        return nullptr;
+    size_t len = halFsRead(TLS_CA_BUNDLE_FILE, buf, TLS_CA_BUNDLE_MAX);
+    if (len == 0)
+    {
+        free(buf);
+        return nullptr;
+    }
+    buf[len] = '\0';
+    bundle = (char *)realloc(buf, len + 1);
+    return bundle;
+}
+
+#if FEATURE_HTTP_POST
+// Цепочка доверия разбирается один раз за загрузку
+static mbedtls_x509_crt *tlsCaChain()
+{
+    static mbedtls_x509_crt chain;
+    static bool parsed = false;
+    if (parsed)
+        return &chain;
+    const char *bundle = halCaBundle();
+    if (!bundle)
+        return nullptr;
+    mbedtls_x509_crt_init(&chain);
+    // Положительный результат — число пропущенных сертификатов, остальные загружены
+    if (mbedtls_x509_crt_parse(&chain, (const uint8_t *)bundle, strlen(bundle) + 1) < 0)
+    {
+        mbedtls_x509_crt_free(&chain);
+        return nullptr;
+    }
+    parsed = true;
+    return &chain;
+}
+
+/**
+ * @brief TCP-подключение не дольше timeoutMs и тайм-аут записи на сокете: mbedtls_net_connect()
+ * ждёт все повторы SYN lwIP, а mbedtls_net_send — без ограничения (тайм-аут есть только у чтения)
+ */
+static bool tlsConnect(mbedtls_net_context &net, const char *host, const char *port, uint32_t timeoutMs)
+{
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    struct addrinfo *list = nullptr;
+    if (getaddrinfo(host, port, &hints, &list) != 0 || !list)
+        return false;
+
+    uint32_t start = millis();
+    bool connected = false;
+    for (struct addrinfo *ai = list; ai && !connected; ai = ai->ai_next)
+    {
+        net.fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (net.fd < 0)
+            continue;
+        mbedtls_net_set_nonblock(&net);
+        if (connect(net.fd, ai->ai_addr, ai->ai_addrlen) == 0)
+        {
+            connected = true;
+        }
+        else if (errno == EINPROGRESS)
+        {
+            // Готовность к записи — подключение завершилось (успешно или нет — в SO_ERROR)
+            uint32_t elapsed = millis() - start;
+            int err = -1;
+            socklen_t errLen = sizeof(err);
+            connected = elapsed < timeoutMs && mbedtls_net_poll(&net, MBEDTLS_NET_POLL_WRITE, timeoutMs - elapsed) > 0 &&
+                        getsockopt(net.fd, SOL_SOCKET, SO_ERROR, &err, &errLen) == 0 && err == 0;
+        }
+        if (!connected)
+        {
+            close(net.fd);
+            net.fd = -1;
+        }
+    }
+    freeaddrinfo(list);
+    if (!connected)
+        return false;
+
+    mbedtls_net_set_block(&net);
+    struct timeval tv = {(time_t)(timeoutMs / 1000), (suseconds_t)((timeoutMs % 1000) * 1000)};
+    setsockopt(net.fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return true;
+}
+
+static bool tlsWriteAll(mbedtls_ssl_context *ssl, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        int ret = mbedtls_ssl_write(ssl, data, len);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+            continue;
+        if (ret <= 0)
+            return false;
+        data += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+// Поля сессии в mbedTLS 3 (ESP-IDF 5) закрыты: доступ через MBEDTLS_PRIVATE, в 2.x его нет
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+/**
+ * @brief Сертификат сервера из сессии — долой: для возобновления он не нужен (цепочка проверена
+ * при полном рукопожатии), а в сериализованной сессии занимает больше, чем тикет/ID с ключами
+ */
+static void tlsSessionDropPeerCert(mbedtls_ssl_session &session)
+{
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+    if (session.MBEDTLS_PRIVATE(peer_cert))
+    {
+        mbedtls_x509_crt_free(session.MBEDTLS_PRIVATE(peer_cert));
+        mbedtls_free(session.MBEDTLS_PRIVATE(peer_cert));
+        session.MBEDTLS_PRIVATE(peer_cert) = nullptr;
+    }
+#endif
+}
+
+/**
+ * @brief Рукопожатие (сокращённое при сохранённой сессии), POST и код ответа
+ */
+static int tlsPost(const HttpUrl &url, const char *contentType, const uint8_t *body, size_t len, uint32_t timeoutMs)
+{
+    mbedtls_x509_crt *ca = tlsCaChain();
+    if (!ca)
+    {
+        logError(LOG_TLS, "No CA bundle in %s, HTTPS refused", TLS_CA_BUNDLE_FILE);
+        tlsStats.failures++;
+        return -1;
+    }
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    size_t lowBefore = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_ssl_session offered;
+    mbedtls_net_init(&net);
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_ssl_session_init(&offered);
+
+    char port[8];
+    snprintf(port, sizeof(port), "%u", url.port);
+    size_t savedLen = 0;
+    const uint8_t *saved = tlsSessionFor(url.host, url.port, &savedLen);
+    bool resuming = false;
+    int code = -1;
+
+    do
+    {
+        if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, nullptr, 0) != 0 ||
+            mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                        MBEDTLS_SSL_PRESET_DEFAULT) != 0)
+            break;
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_ca_chain(&conf, ca, nullptr);
+        mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+        mbedtls_ssl_conf_read_timeout(&conf, timeoutMs);
+        mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+        if (mbedtls_ssl_setup(&ssl, &conf) != 0 || mbedtls_ssl_set_hostname(&ssl, url.host) != 0)
+            break;
+        if (saved && mbedtls_ssl_session_load(&offered, saved, savedLen) == 0 &&
+            mbedtls_ssl_set_session(&ssl, &offered) == 0)
+            resuming = true;
+
+        if (!tlsConnect(net, url.host, port, timeoutMs))
+        {
+            logWarn(LOG_TLS, "%s:%u: connect failed or timed out (%lu ms)", url.host, url.port,
+                    (unsigned long)timeoutMs);
+            break;
+        }
+        mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, nullptr, mbedtls_net_recv_timeout);
+
+        uint32_t start = micros();
+        int ret;
+        while ((ret = mbedtls_ssl_handshake(&ssl)) == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+            ;
+        uint32_t handshakeUs = micros() - start;
+        if (ret != 0)
+        {
+            logWarn(LOG_TLS, "%s: handshake failed -0x%04x, verify 0x%lx", url.host, -ret,
+                    (unsigned long)mbedtls_ssl_get_verify_result(&ssl));
+            if (resuming)
+                tlsSessionClear(); // сервер мог сменить ключ тикетов — в следующий раз полное
+            break;
+        }
+
+        // Пик кучи: новый минимум за рукопожатие, иначе — занятое после него (оценка снизу)
+        size_t lowAfter = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+        uint32_t heapAfter = lowAfter < lowBefore ? lowAfter : ESP.getFreeHeap();
+        uint32_t heapBytes = heapBefore > heapAfter ? heapBefore - heapAfter : 0;
+
+        // Сервер принял сессию — вернул предложенный ID (для тикета — ID, выбранный клиентом)
+        mbedtls_ssl_session current;
+        mbedtls_ssl_session_init(&current);
+        bool resumed = false;
+        if (mbedtls_ssl_get_session(&ssl, &current) == 0)
+        {
+            size_t idLen = current.MBEDTLS_PRIVATE(id_len);
+            resumed = resuming && idLen > 0 && idLen == offered.MBEDTLS_PRIVATE(id_len) &&
+                      memcmp(current.MBEDTLS_PRIVATE(id), offered.MBEDTLS_PRIVATE(id), idLen) == 0;
+            tlsSessionDropPeerCert(current);
+            size_t sessionLen = 0;
+            int saveRet = mbedtls_ssl_session_save(&current, tlsSession.data, TLS_SESSION_MAX, &sessionLen);
+            if (saveRet == 0)
+            {
+                tlsSessionStore(url.host, url.port, tlsSession.data, sessionLen);
+            }
+            else
+            {
+                // BUFFER_TOO_SMALL: sessionLen — нужный размер
+                logWarn(LOG_TLS, "%s: session not saved -0x%04x, needs %u of %u bytes", url.host, -saveRet,
+                        (unsigned)sessionLen, (unsigned)TLS_SESSION_MAX);
+                tlsSessionClear();
+            }
+        }
+        mbedtls_ssl_session_free(&current);
+        tlsRecordHandshake(url.host, resumed, handshakeUs, heapBytes);
+
+        char header[384];
+        int headerLen = snprintf(header, sizeof(header),
+                                 "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+                                 "Connection: close\r\n\r\n",
+                                 url.path, url.host, contentType, (unsigned)len);
+        if (headerLen <= 0 || (size_t)headerLen >= sizeof(header) ||
+            !tlsWriteAll(&ssl, (const uint8_t *)header, headerLen) || !tlsWriteAll(&ssl, body, len))
+            break;
+
+        char status[32] = "";
+        do
+            ret = mbedtls_ssl_read(&ssl, (uint8_t *)status, sizeof(status) - 1);
+        while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+        if (ret > 12 && strncmp(status, "HTTP/1.", 7) == 0)
+        {
+            status[ret] = '\0';
+            code = atoi(status + 9);
+        }
+        mbedtls_ssl_close_notify(&ssl);
+    } while (false);
+
+    mbedtls_ssl_session_free(&offered);
+    mbedtls_net_free(&net);
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+    if (code < 0)
+        tlsStats.failures++;
+    return code;
+}
+
+int halHttpPost(const char *url, const char *contentType, const uint8_t *body, size_t len, uint32_t timeoutMs)
+{
+    HttpUrl parsed;
+    if (!httpParseUrl(url, parsed))
+        return -1;
+    if (parsed.secure)
+        return tlsPost(parsed, contentType, body, len, timeoutMs);
+
+    HTTPClient http;
+    http.setTimeout(timeoutMs);
+    if (!http.begin(url))
+        return -1;
+    http.addHeader("Content-Type", contentType);
+    int code = http.POST((uint8_t *)body, len);
+    http.end();
+    return code;
+}
+#endif
+
+// === ESP-NOW ===
+static const uint8_t RADIO_BROADCAST[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static HalRadioReceiveFn radioReceive = nullptr;
+static volatile bool radioSendDone = false;
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+static void onRadioReceive(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (radioReceive)
+        radioReceive(info->src_addr, info->rx_ctrl ? info->rx_ctrl->rssi : 0, data, (size_t)len);
+}
+#else
+static void onRadioReceive(const uint8_t *mac, const uint8_t *data, int len)
+{
+    if (radioReceive)
+        radioReceive(mac, 0, data, (size_t)len);
+}
+#endif
+
+static void onRadioSent(const uint8_t *, esp_now_send_status_t)
+{
+    radioSendDone = true;
+}
+
+bool halRadioBegin(uint8_t channel, HalRadioReceiveFn onReceive)
+{
+    if (WiFi.getMode() == WIFI_OFF)
+        WiFi.mode(WIFI_STA);
+    if (channel)
+        esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE); // узел без ассоциации: канал шлюза
+    if (onReceive)
+        WiFi.setSleep(false); // шлюз: modem sleep пропускал бы кадры узлов
+
+    if (esp_now_init() != ESP_OK)
+        return false;
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, RADIO_BROADCAST, 6);
+    peer.channel = 0; // текущий канал интерфейса
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = false;
+    if (!esp_now_is_peer_exist(RADIO_BROADCAST) && esp_now_add_peer(&peer) != ESP_OK)
+        return false;
+
+    radioReceive = onReceive;
+    esp_now_register_send_cb(onRadioSent);
+    if (onReceive)
+        esp_now_register_recv_cb(onRadioReceive);
+    return true;
+}
+
+bool halRadioSend(const uint8_t *data, size_t len)
+{
+    radioSendDone = false;
+    if (esp_now_send(RADIO_BROADCAST, data, len) != ESP_OK)
+        return false;
+    // Широковещательный кадр не подтверждается: ждём только окончания передачи
+    uint32_t start = millis();
+    while (!radioSendDone && millis() - start < 10)
+        delay(1);
+    return radioSendDone;
+}
+
+void halRadioEnd()
+{
+    radioReceive = nullptr;
+    esp_now_deinit();
+}
@@ -0,0 +1,968 @@
+// hal_native.cpp — реализация HAL для [env:native] (Linux)
+#include "hal.h"
+#include "hal_native.h"
+#include "sensor_drivers.h"
+#include "https.h"
+#include "log.h"
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <map>
+#include <string>
+#include <vector>
+
+const uint16_t MQTT_KEEPALIVE_S = 15;
+const size_t MQTT_TOPIC_MAX = 128;
+const uint32_t MQTT_TIMEOUT_MS = 5000;
+
+// Состояние одного симулированного узла
+struct NativeNode
+{
+    uint8_t mac[6] = {0x24, 0x6f, 0x28, 0x00, 0x00, 0x01};
+    std::map<std::string, std::string> files; // файловая система в памяти
+
+    bool dhtFailed = false;
+    bool bmpFailed = false;
+    float batteryVolts = 3.3f;
+    float meanTemp = 15.0f;
+    float tempAmplitude = 6.0f;
+    float pressurePa = 101325.0f;
+
+    char mqttHost[64] = "";
+    uint16_t mqttPort = 1883;
+    int mqttSocket = -1;
+    int mqttState = -1; // коды как у PubSubClient
+    uint32_t mqttLastSend = 0;
+    uint16_t mqttPacketId = 0;
+    std::vector<uint8_t> mqttRx; // принятые байты до конца пакета
+    size_t mqttPublishLeft = 0;  // недописанный остаток halMqttPublishBegin()
+
+    bool nullNetwork = false; // MQTT/HTTP без ввода-вывода (для бенчмарков)
+    bool nullConnected = false;
+
+    uint8_t radioChannel = 0; // 0 — радио выключено
+    HalRadioReceiveFn radioReceive = nullptr;
+};
+
+static NativeNode defaultNode;
+static NativeNode *node = &defaultNode;
+static bool logEnabled = true;
+static bool virtualDelays = false;
+static float clockDriftPpm = 0;
+static HalSimTraffic traffic = {};
+static std::vector<NativeNode *> radioNodes; // общий эфир: узлы с включённым радио
+static float radioLoss = 0;
+
+// === Часы ===
+static uint64_t monotonicUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static const uint64_t bootUs = monotonicUs();
+
+uint32_t halMillis() { return (uint32_t)((monotonicUs() - bootUs) / 1000); }
+uint32_t halMicros() { return (uint32_t)(monotonicUs() - bootUs); }
+uint64_t halClockUs()
+{
+    uint64_t elapsed = monotonicUs() - bootUs;
+    return elapsed - (uint64_t)((double)elapsed * clockDriftPpm / 1e6);
+}
+
+void halDelay(uint32_t ms)
+{
+    if (!virtualDelays)
+        usleep(ms * 1000);
+}
+
+void halLogWrite(const char *text, size_t len)
+{
+    if (logEnabled)
+        fwrite(text, 1, len, stdout);
+}
+
+uint32_t halFreeHeap() { return (uint32_t)mallinfo2().fordblks; }
+uint32_t halRandom() { return (uint32_t)rand() << 16 ^ (uint32_t)rand(); }
+
+// === Задачи: симулятор однопоточный ===
+uint8_t halCpuCore() { return 0; }
+uint32_t halTaskId() { return 1; }
+void halTaskForEach(HalTaskFn fn, void *ctx) { fn(1, "main", ctx); }
+
+#ifdef HAL_NEED_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size > 0)
+    {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+size_t strlcat(char *dst, const char *src, size_t size)
+{
+    size_t used = strnlen(dst, size);
+    if (used == size)
+        return size + strlen(src);
+    return used + strlcpy(dst + used, src, size - used);
+}
+#endif
+
+// === Симуляция ===
+void halSimSetLogEnabled(bool enabled) { logEnabled = enabled; }
+void halSimSetNullNetwork(bool enabled) { node->nullNetwork = enabled; }
+void halSimSetVirtualDelays(bool enabled) { virtualDelays = enabled; }
+void halSimSetClockDrift(float ppm) { clockDriftPpm = ppm; }
+void halSimSetRadioLoss(float probability) { radioLoss = probability; }
+
+NativeNode *halSimCreateNode() { return new NativeNode(); }
+void halSimSelectNode(NativeNode *selected) { node = selected ? selected : &defaultNode; }
+const HalSimTraffic &halSimTraffic() { return traffic; }
+
+void halSimSetMac(const uint8_t mac[6]) { memcpy(node->mac, mac, 6); }
+
+void halSimSetSensorFault(bool dhtFailed, bool bmpFailed)
+{
+    node->dhtFailed = dhtFailed;
+    node->bmpFailed = bmpFailed;
+}
+
+void halSimSetBatteryVoltage(float volts) { node->batteryVolts = volts; }
+
+void halSimSetWeather(float meanTemp, float tempAmplitude, float pressurePa)
+{
+    node->meanTemp = meanTemp;
+    node->tempAmplitude = tempAmplitude;
+    node->pressurePa = pressurePa;
+}
+
+static float noise(float amplitude)
+{
+    return amplitude * ((float)rand() / RAND_MAX * 2.0f - 1.0f);
+}
+
+// === Датчики: суточный ход температуры, влажность в противофазе ===
+bool halDhtBegin()
+{
+    return true;
+}
+
+bool halReadDht(float &temperature, float &humidity)
+{
+    if (node->dhtFailed)
+    {
+        temperature = NAN;
+        humidity = NAN;
+        return false;
+    }
+    float phase = (float)(time(nullptr) % 86400) / 86400.0f * 2.0f * (float)M_PI;
+    temperature = node->meanTemp + node->tempAmplitude * sinf(phase) + noise(0.1f);
+    humidity = 60.0f - 3.0f * node->tempAmplitude * sinf(phase) + noise(0.5f);
+    return true;
+}
+
+// === Шина I2C: модель BMP180 ===
+// Калибровка из примера даташита; сырые UT/UP подбираются двоичным поиском так,
+// чтобы пересчёт драйвера дал температуру и давление узла. Преобразование мгновенное.
+static const uint8_t BMP180_SIM_CALIBRATION[22] = {
+    0x01, 0x98, 0xFF, 0xB8, 0xC7, 0xD1, 0x7F, 0xE5, 0x7F, 0xF5, 0x5A, 0x71,
+    0x18, 0x2E, 0x00, 0x04, 0x80, 0x00, 0xDD, 0xF9, 0x0B, 0x34};
+
+static uint8_t bmpRegister = 0;
+static uint8_t bmpResult[3] = {};
+static int32_t bmpUt = 0;
+
+// Наименьшее значение raw в [0, limit), при котором f(raw) >= target
+template <typename F>
+static int32_t searchRaw(int32_t limit, int32_t target, F f)
+{
+    int32_t low = 0, high = limit - 1;
+    while (low < high)
+    {
+        int32_t mid = low + (high - low) / 2;
+        if (f(mid) < target)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static void bmpConvert(uint8_t command)
+{
+    Bmp180Calibration cal;
+    bmp180ParseCalibration(cal, BMP180_SIM_CALIBRATION);
+    if (command == 0x2E)
+    {
+        int32_t target = (int32_t)(node->meanTemp * 10.0f);
+        bmpUt = searchRaw(1 << 16, target, [&](int32_t ut) { return bmp180Temperature(cal, ut); });
+        bmpResult[0] = (uint8_t)(bmpUt >> 8);
+        bmpResult[1] = (uint8_t)bmpUt;
+        return;
+    }
+    uint8_t oss = command >> 6;
+    int32_t target = (int32_t)(node->pressurePa + noise(10.0f));
+    int32_t up = searchRaw(1 << (16 + oss), target, [&](int32_t raw) { return bmp180Pressure(cal, bmpUt, raw, oss); });
+    uint32_t reg = (uint32_t)up << (8 - oss);
+    bmpResult[0] = (uint8_t)(reg >> 16);
+    bmpResult[1] = (uint8_t)(reg >> 8);
+    bmpResult[2] = (uint8_t)reg;
+}
+
+static bool i2cPresent(uint8_t address)
+{
+    return address == BMP180_ADDRESS && !node->bmpFailed;
+}
+
+bool halI2cBegin(uint32_t) { return true; }
+
+bool halI2cWrite(uint8_t address, const uint8_t *data, size_t len)
+{
+    if (!i2cPresent(address) || len == 0)
+        return false;
+    bmpRegister = data[0];
+    if (len >= 2 && bmpRegister == 0xF4)
+        bmpConvert(data[1]);
+    return true;
+}
+
+bool halI2cRead(uint8_t address, uint8_t *data, size_t len)
+{
+    if (!i2cPresent(address))
+        return false;
+    for (size_t i = 0; i < len; i++, bmpRegister++)
+    {
+        if (bmpRegister == 0xD0)
+            data[i] = BMP180_CHIP_ID;
+        else if (bmpRegister >= 0xAA && bmpRegister < 0xAA + sizeof(BMP180_SIM_CALIBRATION))
+            data[i] = BMP180_SIM_CALIBRATION[bmpRegister - 0xAA];
+        else if (bmpRegister >= 0xF6 && bmpRegister <= 0xF8)
+            data[i] = bmpResult[bmpRegister - 0xF6];
+        else
+            data[i] = 0;
+    }
+    return true;
+}
+
+bool halI2cWriteRead(uint8_t address, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+    return halI2cWrite(address, tx, txLen) && halI2cRead(address, rx, rxLen);
+}
+
+int halReadBatteryRaw()
+{
+    return (int)(node->batteryVolts / 2.0f / 3.3f * 4095.0f);
+}
+
+// === Файловая система в памяти ===
+bool halFsBegin() { return true; }
+void halFsEnd() {}
+bool halFsExists(const char *path) { return node->files.count(path) > 0; }
+bool halFsRemove(const char *path) { return node->files.erase(path) > 0; }
+
+size_t halFsRead(const char *path, char *buf, size_t size)
+{
+    auto it = node->files.find(path);
+    if (it == node->files.end())
+        return 0;
+    size_t len = it->second.size() < size ? it->second.size() : size;
+    memcpy(buf, it->second.data(), len);
+    return len;
+}
+
+bool halFsWrite(const char *path, const char *data, size_t len)
+{
+    node->files[path].assign(data, len);
+    return true;
+}
+
+bool halFsAppend(const char *path, const uint8_t *data, size_t len)
+{
+    node->files[path].append((const char *)data, len);
+    return true;
+}
+
+size_t halFsReadAt(const char *path, size_t offset, uint8_t *buf, size_t size)
+{
+    auto it = node->files.find(path);
+    if (it == node->files.end() || offset >= it->second.size())
+        return 0;
+    size_t len = it->second.size() - offset < size ? it->second.size() - offset : size;
+    memcpy(buf, it->second.data() + offset, len);
+    return len;
+}
+
+size_t halFsSize(const char *path)
+{
+    auto it = node->files.find(path);
+    return it == node->files.end() ? 0 : it->second.size();
+}
+
+bool halFsRename(const char *from, const char *to)
+{
+    auto it = node->files.find(from);
+    if (it == node->files.end())
+        return false;
+    node->files[to] = std::move(it->second);
+    node->files.erase(from);
+    return true;
+}
+
+// === Сеть: TCP-сокеты ===
+bool halNetConnected() { return true; }
+int halNetRssi() { return -55; }
+void halMacAddress(uint8_t mac[6]) { memcpy(mac, node->mac, 6); }
+
+static int tcpConnect(const char *host, uint16_t port, uint32_t timeoutMs)
+{
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%u", port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = nullptr;
+    if (getaddrinfo(host, portStr, &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        struct timeval tv = {(time_t)(timeoutMs / 1000), (suseconds_t)((timeoutMs % 1000) * 1000)};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static bool sendAll(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// === MQTT 3.1.1 (QoS 0): публикация, подписка и разбор входящих PUBLISH ===
+static size_t mqttPutLength(uint8_t *buf, size_t len)
+{
+    size_t pos = 0;
+    do
+    {
+        uint8_t digit = len % 128;
+        len /= 128;
+        buf[pos++] = len > 0 ? (digit | 0x80) : digit;
+    } while (len > 0);
+    return pos;
+}
+
+static size_t mqttPutString(uint8_t *buf, const char *str)
+{
+    size_t len = strlen(str);
+    buf[0] = len >> 8;
+    buf[1] = len & 0xFF;
+    memcpy(buf + 2, str, len);
+    return len + 2;
+}
+
+static void mqttDisconnect(int state)
+{
+    if (node->mqttSocket >= 0)
+    {
+        close(node->mqttSocket);
+        if (state == -3)
+            traffic.disconnects++;
+    }
+    node->mqttSocket = -1;
+    node->mqttState = state;
+    node->mqttRx.clear();
+    node->mqttPublishLeft = 0;
+}
+
+static HalMqttReceiveFn mqttReceive = nullptr;
+
+void halMqttOnMessage(HalMqttReceiveFn onMessage) { mqttReceive = onMessage; }
+
+// Разбор целых пакетов из node->mqttRx; PINGRESP, SUBACK и т.п. пропускаются
+static void mqttDispatch()
+{
+    std::vector<uint8_t> &rx = node->mqttRx;
+    size_t pos = 0;
+    while (rx.size() - pos >= 2)
+    {
+        size_t len = 0, header = 1;
+        uint32_t multiplier = 1;
+        bool complete = false;
+        while (pos + header < rx.size() && header <= 4)
+        {
+            uint8_t digit = rx[pos + header++];
+            len += (digit & 0x7F) * multiplier;
+            multiplier *= 128;
+            if (!(digit & 0x80))
+            {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete || rx.size() - pos - header < len)
+            break;
+
+        const uint8_t *packet = rx.data() + pos;
+        const uint8_t *body = packet + header;
+        if ((packet[0] >> 4) == 3 && len >= 2 && mqttReceive)
+        {
+            size_t topicLen = ((size_t)body[0] << 8) | body[1];
+            size_t offset = 2 + topicLen + (packet[0] & 0x06 ? 2 : 0); // QoS > 0 — идентификатор пакета
+            if (offset <= len)
+            {
+                std::string topic((const char *)body + 2, topicLen);
+                mqttReceive(topic.c_str(), body + offset, len - offset);
+            }
+        }
+        pos += header + len;
+    }
+    rx.erase(rx.begin(), rx.begin() + pos);
+}
+
+void halMqttBegin(const char *host, uint16_t port)
+{
+    strlcpy(node->mqttHost, host, sizeof(node->mqttHost));
+    node->mqttPort = port;
+}
+
+bool halMqttConnect(const char *clientId, const char *user, const char *password)
+{
+    traffic.connectAttempts++;
+    if (node->nullNetwork)
+    {
+        node->nullConnected = true;
+        node->mqttState = 0;
+        traffic.connects++;
+        return true;
+    }
+    mqttDisconnect(-1);
+    node->mqttSocket = tcpConnect(node->mqttHost, node->mqttPort, MQTT_TIMEOUT_MS);
+    if (node->mqttSocket < 0)
+    {
+        node->mqttState = -2; // MQTT_CONNECT_FAILED
+        return false;
+    }
+
+    uint8_t body[256];
+    size_t pos = mqttPutString(body, "MQTT");
+    body[pos++] = 4; // MQTT 3.1.1
+    uint8_t flags = 0x02; // clean session
+    if (user && password)
+        flags |= 0xC0;
+    body[pos++] = flags;
+    body[pos++] = MQTT_KEEPALIVE_S >> 8;
+    body[pos++] = MQTT_KEEPALIVE_S & 0xFF;
+    pos += mqttPutString(body + pos, clientId);
+    if (user && password)
+    {
+        pos += mqttPutString(body + pos, user);
+        pos += mqttPutString(body + pos, password);
+    }
+
+    uint8_t packet[264];
+    packet[0] = 0x10;
+    size_t headerLen = 1 + mqttPutLength(packet + 1, pos);
+    memcpy(packet + headerLen, body, pos);
+    if (!sendAll(node->mqttSocket, packet, headerLen + pos))
+    {
+        mqttDisconnect(-2);
+        return false;
+    }
+
+    uint8_t connack[4];
+    if (recv(node->mqttSocket, connack, sizeof(connack), MSG_WAITALL) != (ssize_t)sizeof(connack) || connack[0] != 0x20)
+    {
+        mqttDisconnect(-4); // MQTT_CONNECTION_TIMEOUT
+        return false;
+    }
+    if (connack[3] != 0)
+    {
+        mqttDisconnect(connack[3]);
+        return false;
+    }
+    node->mqttState = 0;
+    node->mqttLastSend = halMillis();
+    traffic.connects++;
+    return true;
+}
+
+void halSimDropConnection()
+{
+    if (node->nullConnected)
+        traffic.disconnects++;
+    node->nullConnected = false;
+    mqttDisconnect(-3);
+}
+
+bool halMqttConnected() { return node->nullNetwork ? node->nullConnected : node->mqttSocket >= 0; }
+int halMqttState() { return node->mqttState; }
+
+void halMqttLoop()
+{
+    if (node->nullNetwork || node->mqttSocket < 0)
+        return;
+    uint8_t buf[256];
+    ssize_t n;
+    while ((n = recv(node->mqttSocket, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        node->mqttRx.insert(node->mqttRx.end(), buf, buf + n);
+    mqttDispatch();
+    if (n == 0)
+    {
+        mqttDisconnect(-3); // MQTT_CONNECTION_LOST
+        return;
+    }
+    if (halMillis() - node->mqttLastSend > MQTT_KEEPALIVE_S * 1000UL / 2)
+    {
+        const uint8_t pingreq[2] = {0xC0, 0x00};
+        if (!sendAll(node->mqttSocket, pingreq, sizeof(pingreq)))
+            mqttDisconnect(-3);
+        node->mqttLastSend = halMillis();
+    }
+}
+
+bool halMqttPublish(const char *topic, const uint8_t *payload, size_t len, bool retain)
+{
+    if (node->nullNetwork)
+    {
+        if (node->nullConnected)
+        {
+            traffic.mqttMessages++;
+            traffic.mqttBytes += strlen(topic) + len;
+        }
+        return node->nullConnected;
+    }
+    if (node->mqttSocket < 0)
+        return false;
+    size_t topicLen = strlen(topic);
+    uint8_t packet[512];
+    if (topicLen + len + 8 > sizeof(packet))
+        return false;
+    packet[0] = 0x30 | (retain ? 0x01 : 0x00);
+    size_t pos = 1 + mqttPutLength(packet + 1, 2 + topicLen + len);
+    pos += mqttPutString(packet + pos, topic);
+    memcpy(packet + pos, payload, len);
+    pos += len;
+    if (!sendAll(node->mqttSocket, packet, pos))
+    {
+        mqttDisconnect(-3);
+        return false;
+    }
+    node->mqttLastSend = halMillis();
+    traffic.mqttMessages++;
+    traffic.mqttBytes += pos;
+    return true;
+}
+
+bool halMqttPublishBegin(const char *topic, size_t len, bool retain)
+{
+    if (node->nullNetwork)
+    {
+        if (node->nullConnected)
+        {
+            traffic.mqttMessages++;
+            traffic.mqttBytes += strlen(topic) + len;
+        }
+        return node->nullConnected;
+    }
+    if (node->mqttSocket < 0)
+        return false;
+    uint8_t header[8 + MQTT_TOPIC_MAX];
+    size_t topicLen = strlen(topic);
+    if (topicLen > MQTT_TOPIC_MAX)
+        return false;
+    header[0] = 0x30 | (retain ? 0x01 : 0x00);
+    size_t pos = 1 + mqttPutLength(header + 1, 2 + topicLen + len);
+    pos += mqttPutString(header + pos, topic);
+    if (!sendAll(node->mqttSocket, header, pos))
+    {
+        mqttDisconnect(-3);
+        return false;
+    }
+    node->mqttPublishLeft = len;
+    traffic.mqttMessages++;
+    traffic.mqttBytes += pos;
+    return true;
+}
+
+bool halMqttPublishWrite(const uint8_t *data, size_t len)
+{
+    if (node->nullNetwork)
+        return node->nullConnected;
+    if (node->mqttSocket < 0 || len > node->mqttPublishLeft)
+        return false;
+    if (!sendAll(node->mqttSocket, data, len))
+    {
+        mqttDisconnect(-3);
+        return false;
+    }
+    node->mqttPublishLeft -= len;
+    traffic.mqttBytes += len;
+    return true;
+}
+
+bool halMqttPublishEnd()
+{
+    if (node->nullNetwork)
+        return node->nullConnected;
+    if (node->mqttSocket < 0 || node->mqttPublishLeft != 0)
+        return false; // длина в заголовке не совпала с записанным — поток рассинхронизирован
+    node->mqttLastSend = halMillis();
+    return true;
+}
+
+bool halMqttSubscribe(const char *topic)
+{
+    if (node->nullNetwork)
+        return node->nullConnected;
+    if (node->mqttSocket < 0 || strlen(topic) > MQTT_TOPIC_MAX)
+        return false;
+    uint8_t body[5 + MQTT_TOPIC_MAX];
+    node->mqttPacketId = node->mqttPacketId == 0xFFFF ? 1 : node->mqttPacketId + 1;
+    body[0] = node->mqttPacketId >> 8;
+    body[1] = node->mqttPacketId & 0xFF;
+    size_t pos = 2 + mqttPutString(body + 2, topic);
+    body[pos++] = 0; // QoS 0
+    uint8_t packet[sizeof(body) + 5];
+    packet[0] = 0x82;
+    size_t headerLen = 1 + mqttPutLength(packet + 1, pos);
+    memcpy(packet + headerLen, body, pos);
+    if (!sendAll(node->mqttSocket, packet, headerLen + pos))
+    {
+        mqttDisconnect(-3);
+        return false;
+    }
+    node->mqttLastSend = halMillis();
+    return true;
+}
+
+// === HTTP/1.1 POST, только http:// ===
+int halUdpRequest(const char *host, uint16_t port, const uint8_t *tx, size_t txLen,
+                  uint8_t *rx, size_t rxSize, uint32_t timeoutMs)
+{
+    if (node->nullNetwork)
+        return -1;
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%u", port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo *res = nullptr;
+    if (getaddrinfo(host, portStr, &hints, &res) != 0)
+        return -1;
+
+    int len = -1;
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0)
+    {
+        struct timeval tv = {(time_t)(timeoutMs / 1000), (suseconds_t)(timeoutMs % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (sendto(fd, tx, txLen, 0, res->ai_addr, res->ai_addrlen) == (ssize_t)txLen)
+            len = (int)recv(fd, rx, rxSize, 0);
+        close(fd);
+    }
+    freeaddrinfo(res);
+    return len < 0 ? -1 : len;
+}
+
+bool halUdpSend(const char *host, uint16_t port, const uint8_t *data, size_t len)
+{
+    traffic.udpDatagrams++;
+    traffic.udpBytes += len;
+    if (node->nullNetwork)
+        return true;
+    static int fd = -1;
+    static char resolvedHost[64] = "";
+    static uint16_t resolvedPort = 0;
+    static struct sockaddr_storage address;
+    static socklen_t addressLen = 0;
+    if (strcmp(host, resolvedHost) != 0 || port != resolvedPort)
+    {
+        char portStr[8];
+        snprintf(portStr, sizeof(portStr), "%u", port);
+        struct addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo *res = nullptr;
+        if (getaddrinfo(host, portStr, &hints, &res) != 0)
+            return false;
+        if (fd >= 0)
+            close(fd);
+        fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        memcpy(&address, res->ai_addr, res->ai_addrlen);
+        addressLen = res->ai_addrlen;
+        freeaddrinfo(res);
+        if (fd < 0)
+            return false;
+        strlcpy(resolvedHost, host, sizeof(resolvedHost));
+        resolvedPort = port;
+    }
+    return sendto(fd, data, len, MSG_DONTWAIT, (struct sockaddr *)&address, addressLen) == (ssize_t)len;
+}
+
+// === HTTPS: OpenSSL вместо mbedTLS, TLS 1.2 как у платы ===
+TlsSessionCache tlsSession;
+
+const char *halCaBundle()
+{
+    static char bundle[TLS_CA_BUNDLE_MAX + 1];
+    size_t len = halFsRead(TLS_CA_BUNDLE_FILE, bundle, TLS_CA_BUNDLE_MAX);
+    bundle[len] = '\0';
+    return len ? bundle : nullptr;
+}
+
+static SSL_CTX *tlsContext()
+{
+    const char *bundle = halCaBundle();
+    if (!bundle)
+        return nullptr;
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx)
+        return nullptr;
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+
+    BIO *bio = BIO_new_mem_buf(bundle, -1);
+    X509_STORE *store = SSL_CTX_get_cert_store(ctx);
+    int count = 0;
+    X509 *cert;
+    while ((cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)) != nullptr)
+    {
+        count += X509_STORE_add_cert(store, cert);
+        X509_free(cert);
+    }
+    BIO_free(bio);
+    ERR_clear_error(); // конец PEM
+    if (count == 0)
+    {
+        SSL_CTX_free(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+// Занятая куча процесса (на плате — ESP.getFreeHeap)
+static size_t heapInUse()
+{
+    return mallinfo2().uordblks;
+}
+
+static int tlsPost(const HttpUrl &url, const char *contentType, const uint8_t *body, size_t len, uint32_t timeoutMs)
+{
+    SSL_CTX *ctx = tlsContext();
+    if (!ctx)
+    {
+        logError(LOG_TLS, "No CA bundle in %s, HTTPS refused", TLS_CA_BUNDLE_FILE);
+        tlsStats.failures++;
+        return -1;
+    }
+    int fd = tcpConnect(url.host, url.port, timeoutMs);
+    if (fd < 0)
+    {
+        logWarn(LOG_TLS, "%s:%u: connect failed", url.host, url.port);
+        SSL_CTX_free(ctx);
+        tlsStats.failures++;
+        return -1;
+    }
+
+    size_t heapBefore = heapInUse();
+    SSL *ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, url.host);
+    SSL_set1_host(ssl, url.host);
+    size_t savedLen = 0;
+    const uint8_t *saved = tlsSessionFor(url.host, url.port, &savedLen);
+    bool resuming = false;
+    if (saved)
+    {
+        SSL_SESSION *session = d2i_SSL_SESSION(nullptr, &saved, (long)savedLen);
+        if (session)
+        {
+            resuming = SSL_set_session(ssl, session) == 1;
+            SSL_SESSION_free(session);
+        }
+    }
+
+    int code = -1;
+    uint32_t start = halMicros();
+    if (SSL_connect(ssl) != 1)
+    {
+        logWarn(LOG_TLS, "%s: handshake failed, verify %ld", url.host, SSL_get_verify_result(ssl));
+        ERR_clear_error();
+        if (resuming)
+            tlsSessionClear();
+    }
+    else
+    {
+        uint32_t handshakeUs = halMicros() - start;
+        size_t heapAfter = heapInUse();
+        bool resumed = SSL_session_reused(ssl);
+
+        SSL_SESSION *session = SSL_get1_session(ssl);
+        int sessionLen = session ? i2d_SSL_SESSION(session, nullptr) : 0;
+        if (sessionLen > 0 && sessionLen <= TLS_SESSION_MAX)
+        {
+            uint8_t *out = tlsSession.data;
+            i2d_SSL_SESSION(session, &out);
+            tlsSessionStore(url.host, url.port, tlsSession.data, sessionLen);
+        }
+        else
+        {
+            logWarn(LOG_TLS, "%s: session not saved, needs %d of %u bytes", url.host, sessionLen,
+                    (unsigned)TLS_SESSION_MAX);
+            tlsSessionClear();
+        }
+        SSL_SESSION_free(session);
+        tlsRecordHandshake(url.host, resumed, handshakeUs,
+                           (uint32_t)(heapAfter > heapBefore ? heapAfter - heapBefore : 0));
+
+        char header[384];
+        int headerLen = snprintf(header, sizeof(header),
+                                 "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+                                 "Connection: close\r\n\r\n",
+                                 url.path, url.host, contentType, (unsigned)len);
+        if (headerLen > 0 && (size_t)headerLen < sizeof(header) && SSL_write(ssl, header, headerLen) == headerLen &&
+            (len == 0 || SSL_write(ssl, body, (int)len) == (int)len))
+        {
+            char status[32] = "";
+            int n = SSL_read(ssl, status, sizeof(status) - 1);
+            if (n > 12 && strncmp(status, "HTTP/1.", 7) == 0)
+            {
+                status[n] = '\0';
+                code = atoi(status + 9);
+            }
+            traffic.httpBytes += headerLen + len;
+        }
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    close(fd);
+    SSL_CTX_free(ctx);
+    if (code < 0)
+        tlsStats.failures++;
+    return code;
+}
+
+int halHttpPost(const char *url, const char *contentType, const uint8_t *body, size_t len, uint32_t timeoutMs)
+{
+    traffic.httpRequests++;
+    if (node->nullNetwork)
+    {
+        traffic.httpBytes += len;
+        return 200;
+    }
+    HttpUrl parsed;
+    if (!httpParseUrl(url, parsed))
+        return -1;
+    if (parsed.secure)
+    {
+        int code = tlsPost(parsed, contentType, body, len, timeoutMs);
+        if (code < 200 || code >= 300)
+            traffic.httpErrors++;
+        return code;
+    }
+
+    int fd = tcpConnect(parsed.host, parsed.port, timeoutMs);
+    if (fd < 0)
+    {
+        traffic.httpErrors++;
+        return -1;
+    }
+
+    char header[384];
+    int headerLen = snprintf(header, sizeof(header),
+                             "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                             parsed.path, parsed.host, contentType, (unsigned)len);
+    int code = -1;
+    if (headerLen > 0 && (size_t)headerLen < sizeof(header) &&
+        sendAll(fd, (const uint8_t *)header, headerLen) && sendAll(fd, body, len))
+    {
+        char status[32] = "";
+        ssize_t n = recv(fd, status, sizeof(status) - 1, 0);
+        if (n > 12 && strncmp(status, "HTTP/1.", 7) == 0)
+        {
+            status[n] = '\0';
+            code = atoi(status + 9);
+        }
+    }
+    close(fd);
+    if (code > 0)
+        traffic.httpBytes += headerLen + len;
+    if (code < 200 || code >= 300)
+        traffic.httpErrors++;
+    return code;
+}
+
+// === Радио: эфир внутри процесса, каждый кадр получают все узлы на том же канале ===
+bool halRadioBegin(uint8_t channel, HalRadioReceiveFn onReceive)
+{
+    node->radioChannel = channel ? channel : 1;
+    node->radioReceive = onReceive;
+    for (NativeNode *n : radioNodes)
+    {
+        if (n == node)
+            return true;
+    }
+    radioNodes.push_back(node);
+    return true;
+}
+
+bool halRadioSend(const uint8_t *data, size_t len)
+{
+    if (node->radioChannel == 0)
+        return false;
+    traffic.radioFrames++;
+    for (NativeNode *n : radioNodes)
+    {
+        if (n == node || n->radioChannel != node->radioChannel || !n->radioReceive)
+            continue;
+        if (radioLoss > 0 && (float)rand() / RAND_MAX < radioLoss)
+        {
+            traffic.radioLost++;
+            continue;
+        }
+        n->radioReceive(node->mac, -60, data, len);
+    }
+    return true;
+}
+
+void halRadioEnd()
+{
+    node->radioChannel = 0;
+    node->radioReceive = nullptr;
+}
@@ -0,0 +1,627 @@
+#include "history.h"
+#include "config.h"
+#include "hal.h"
+#include "log.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HISTORY_PATH_SIZE 24
+
+HistoryStats historyStats = {};
+
+// Хранимые сутки [first, last]; пишется только при смене суток
+struct HistoryMeta
+{
+    uint32_t first;
+    uint32_t last;
+};
+
+// Заполняемый блок в HISTORY_OPEN_FILE: сутки, к которым он относится, и сам блок
+struct HistoryOpenBlock
+{
+    uint32_t segment;
+    uint8_t data[CODEC_BLOCK_SIZE];
+};
+
+static bool historyReady = false;
+static bool historyEmpty = true;
+static HistoryMeta meta = {};
+static uint32_t segmentBlocks = 0; // заполненных блоков в сутках meta.last
+static uint64_t lastTimestamp = 0;
+static HistoryOpenBlock openBlock = {};
+static CodecState openState = {};
+
+static void segmentPath(char *buf, uint32_t segment)
+{
+    snprintf(buf, HISTORY_PATH_SIZE, "/h%lu.dat", (unsigned long)segment);
+}
+
+static bool saveMeta()
+{
+    return halFsWrite(HISTORY_META_FILE, (const char *)&meta, sizeof(meta));
+}
+
+static bool saveOpen()
+{
+    traceBegin(TRACE_FLASH_WRITE);
+    bool written = halFsWrite(HISTORY_OPEN_FILE, (const char *)&openBlock, sizeof(openBlock));
+    traceEnd(TRACE_FLASH_WRITE);
+    return written;
+}
+
+static bool readBlock(const char *path, uint32_t block, uint8_t *data)
+{
+    return halFsReadAt(path, (size_t)block * CODEC_BLOCK_SIZE, data, CODEC_BLOCK_SIZE) == CODEC_BLOCK_SIZE;
+}
+
+static void dropSegment(uint32_t segment)
+{
+    char path[HISTORY_PATH_SIZE];
+    segmentPath(path, segment);
+    halFsRemove(path);
+}
+
+/**
+ * @brief Отрезает оборванный последний блок: целые блоки копируются во временный файл
+ * @return число целых блоков
+ */
+static uint32_t repairSegment(uint32_t segment, size_t size)
+{
+    char dat[HISTORY_PATH_SIZE];
+    const char *tmp = "/h.tmp";
+    segmentPath(dat, segment);
+    uint32_t blocks = (uint32_t)(size / CODEC_BLOCK_SIZE);
+    uint8_t buf[CODEC_BLOCK_SIZE];
+
+    halFsRemove(tmp);
+    for (uint32_t i = 0; i < blocks; i++)
+    {
+        if (!readBlock(dat, i, buf) || !halFsAppend(tmp, buf, sizeof(buf)))
+        {
+            blocks = i; // дальше прочитать не удалось — сохраняем то, что скопировано
+            break;
+        }
+    }
+    halFsRemove(dat);
+    if (blocks > 0)
+        halFsRename(tmp, dat);
+    halFsRemove(tmp);
+    historyStats.repaired++;
+    logWarn(LOG_HIST, "Day %lu: torn block dropped, %lu blocks kept", (unsigned long)segment, (unsigned long)blocks);
+    return blocks;
+}
+
+static void resetOpen(uint32_t segment)
+{
+    codecBlockBegin(openBlock.data, openState);
+    openBlock.segment = segment;
+}
+
+/**
+ * @brief Заполняемый блок из HISTORY_OPEN_FILE; уже записанный в сегмент или повреждённый отбрасывается
+ */
+static void restoreOpen(const char *dat)
+{
+    resetOpen(meta.last);
+    HistoryOpenBlock stored;
+    if (halFsRead(HISTORY_OPEN_FILE, (char *)&stored, sizeof(stored)) != sizeof(stored))
+        return;
+    uint8_t sealed[CODEC_BLOCK_SIZE];
+    if (stored.segment != meta.last)
+    {
+        // Прошлые сутки: сбой сразу после смены суток, блок уже в их сегменте
+    }
+    else if (!codecBlockResume(stored.data, openState))
+    {
+        codecBlockBegin(openBlock.data, openState);
+        logWarn(LOG_HIST, "Open block corrupted, dropped");
+    }
+    else if (segmentBlocks > 0 && readBlock(dat, segmentBlocks - 1, sealed) &&
+             memcmp(sealed, stored.data, sizeof(sealed)) == 0)
+    {
+        codecBlockBegin(openBlock.data, openState); // сбой между записью блока в сегмент и новым блоком
+    }
+    else
+    {
+        memcpy(openBlock.data, stored.data, sizeof(openBlock.data));
+        return;
+    }
+    halFsRemove(HISTORY_OPEN_FILE); // читатели берут заполняемый блок из файла
+}
+
+/**
+ * @brief Восстановление состояния по файлам (однократно; на плате — при каждом пробуждении)
+ */
+bool historyBegin()
+{
+    if (historyReady)
+        return true;
+    if (!halFsBegin())
+        return false;
+    historyReady = true;
+
+    HistoryMeta stored;
+    if (halFsRead(HISTORY_META_FILE, (char *)&stored, sizeof(stored)) != sizeof(stored) || stored.first > stored.last)
+    {
+        historyEmpty = true;
+        return true;
+    }
+    meta = stored;
+    historyEmpty = false;
+
+    char dat[HISTORY_PATH_SIZE];
+    segmentPath(dat, meta.last);
+    size_t size = halFsSize(dat);
+    segmentBlocks = size % CODEC_BLOCK_SIZE ? repairSegment(meta.last, size) : (uint32_t)(size / CODEC_BLOCK_SIZE);
+    restoreOpen(dat);
+
+    lastTimestamp = openState.timestamp;
+    uint8_t sealed[CODEC_BLOCK_SIZE];
+    CodecState state;
+    if (openState.count == 0 && segmentBlocks > 0 && readBlock(dat, segmentBlocks - 1, sealed) &&
+        codecBlockResume(sealed, state))
+        lastTimestamp = state.timestamp;
+
+    logInfo(LOG_HIST, "Days %lu..%lu, %lu blocks + %u records today", (unsigned long)meta.first,
+            (unsigned long)meta.last, (unsigned long)segmentBlocks, openState.count);
+    return true;
+}
+
+/**
+ * @brief Следующий historyBegin() восстановит состояние по файлам (пробуждение в симуляторе, тесты)
+ */
+void historyReset()
+{
+    historyReady = false;
+    historyEmpty = true;
+    meta = {};
+    segmentBlocks = 0;
+    lastTimestamp = 0;
+    openBlock = {};
+    openState = {};
+}
+
+uint32_t historyBlockCount()
+{
+    return historyEmpty ? 0 : segmentBlocks;
+}
+
+// Новые сутки; сутки старше HISTORY_SEGMENTS удаляются
+static bool startSegment(uint32_t segment)
+{
+    uint32_t keepFrom = segment >= HISTORY_SEGMENTS - 1 ? segment - (HISTORY_SEGMENTS - 1) : 0;
+    if (historyEmpty)
+    {
+        meta.first = segment;
+    }
+    else
+    {
+        // Файлы есть только в [first, last] — перебор ограничен окном хранения
+        uint32_t oldLast = meta.last;
+        while (meta.first < keepFrom && meta.first <= oldLast)
+            dropSegment(meta.first++);
+        if (meta.first < keepFrom)
+            meta.first = keepFrom;
+    }
+    meta.last = segment;
+    historyEmpty = false;
+    segmentBlocks = 0;
+    resetOpen(segment);
+    return saveMeta();
+}
+
+static bool appendBlock()
+{
+    char dat[HISTORY_PATH_SIZE];
+    segmentPath(dat, meta.last);
+    traceBegin(TRACE_FLASH_WRITE);
+    bool written = halFsAppend(dat, openBlock.data, sizeof(openBlock.data));
+    traceEnd(TRACE_FLASH_WRITE);
+    if (!written)
+    {
+        // Частичная запись при заполненном флеше сдвинула бы все следующие блоки
+        size_t size = halFsSize(dat);
+        if (size != (size_t)segmentBlocks * CODEC_BLOCK_SIZE)
+            segmentBlocks = repairSegment(meta.last, size);
+        return false;
+    }
+    segmentBlocks++;
+    return true;
+}
+
+/**
+ * @brief Заполненный блок — в файл суток; при заполненном флеше освобождаются старейшие сутки
+ */
+static bool sealBlock()
+{
+    bool written = appendBlock();
+    if (!written && meta.first < meta.last)
+    {
+        dropSegment(meta.first++);
+        saveMeta();
+        written = appendBlock();
+    }
+    if (written)
+    {
+        historyStats.sealedBlocks++;
+        historyStats.sealedRecords += openState.count;
+    }
+    else
+    {
+        historyStats.writeErrors++;
+        logError(LOG_HIST, "Block of %u records lost: flash write failed", openState.count);
+    }
+    resetOpen(meta.last);
+    return written;
+}
+
+/**
+ * @brief Запись показания; метки времени должны не убывать
+ */
+bool historyAppend(const SensorReading &reading)
+{
+    if (!reading.timestamp)
+    {
+        historyStats.unsynced++;
+        return false;
+    }
+    if (!historyBegin())
+    {
+        historyStats.writeErrors++;
+        return false;
+    }
+
+    uint32_t segment = (uint32_t)(reading.timestamp / HISTORY_SEGMENT_MS);
+    if (!historyEmpty && (segment < meta.last || reading.timestamp < lastTimestamp))
+    {
+        historyStats.outOfOrder++;
+        return false;
+    }
+    if (historyEmpty || segment != meta.last)
+    {
+        // Блок не пересекает границу суток: сегмент — только его сутки
+        if (!historyEmpty && openState.count > 0)
+            sealBlock();
+        if (!startSegment(segment))
+        {
+            historyStats.writeErrors++;
+            return false;
+        }
+    }
+
+    if (!codecBlockAppend(openBlock.data, openState, reading))
+    {
+        sealBlock();
+        codecBlockAppend(openBlock.data, openState, reading); // в пустой блок помещается всегда
+    }
+    bool written = saveOpen();
+    if (!written && meta.first < meta.last)
+    {
+        dropSegment(meta.first++);
+        saveMeta();
+        written = saveOpen();
+    }
+    if (!written)
+        historyStats.writeErrors++; // показание в памяти, потеряется только при перезагрузке до следующей записи
+    lastTimestamp = reading.timestamp;
+    historyStats.appended++;
+    return true;
+}
+
+/**
+ * @brief Первый блок сегмента, который может содержать метку >= from: двоичный поиск по заголовкам
+ */
+static uint32_t seekBlock(uint32_t segment, uint64_t from)
+{
+    char dat[HISTORY_PATH_SIZE];
+    segmentPath(dat, segment);
+    uint32_t low = 0, high = (uint32_t)(halFsSize(dat) / CODEC_BLOCK_SIZE);
+    while (low < high) // число блоков, начинающихся раньше from
+    {
+        uint32_t mid = low + (high - low) / 2;
+        uint8_t header[8];
+        if (halFsReadAt(dat, (size_t)mid * CODEC_BLOCK_SIZE, header, sizeof(header)) != sizeof(header))
+            break;
+        if (codecBlockFirstTimestamp(header) < from)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low > 0 ? low - 1 : 0;
+}
+
+/**
+ * @brief Курсор на первую запись с меткой >= from
+ * @return false — история недоступна или from > to; пустой интервал — курсор сразу исчерпан
+ */
+bool historySeek(HistoryCursor &cursor, uint64_t from, uint64_t to)
+{
+    memset(&cursor, 0, sizeof(cursor));
+    cursor.done = true;
+    if (from > to || !historyBegin())
+        return false;
+    if (historyEmpty)
+        return true;
+
+    // Снимок: показания, дописанные параллельно, в выборку не попадают
+    uint32_t first = meta.first, last = meta.last;
+    if (to > lastTimestamp)
+        to = lastTimestamp;
+    uint64_t fromSegment = from / HISTORY_SEGMENT_MS, toSegment = to / HISTORY_SEGMENT_MS;
+    if (from > to || toSegment < first || fromSegment > last)
+        return true;
+
+    cursor.segment = fromSegment > first ? (uint32_t)fromSegment : first;
+    cursor.lastSegment = toSegment < last ? (uint32_t)toSegment : last;
+    cursor.openSegment = last;
+    cursor.block = cursor.segment == fromSegment ? seekBlock(cursor.segment, from) : 0;
+    cursor.from = from;
+    cursor.to = to;
+    cursor.done = false;
+    return true;
+}
+
+/**
+ * @brief Следующий блок курсора в cursor.data
+ * @return false — в сегменте блоков больше нет
+ */
+static bool loadBlock(HistoryCursor &cursor)
+{
+    if (cursor.openRead)
+        return false; // заполняемый блок — последний; в файле суток после него только более новые
+    char dat[HISTORY_PATH_SIZE];
+    segmentPath(dat, cursor.segment);
+    HistoryOpenBlock next;
+    if (!readBlock(dat, cursor.block, next.data))
+    {
+        // После заполненных блоков текущих суток — заполняемый. Если он ушёл в сегмент
+        // после поиска, он уже прочитан из файла суток, а HISTORY_OPEN_FILE ещё может
+        // хранить его копию (запись нового блока не закончена)
+        if (cursor.segment != cursor.openSegment ||
+            halFsRead(HISTORY_OPEN_FILE, (char *)&next, sizeof(next)) != sizeof(next) ||
+            next.segment != cursor.segment ||
+            (cursor.block > 0 && memcmp(next.data, cursor.data, sizeof(next.data)) == 0))
+            return false;
+        cursor.openRead = true;
+    }
+    memcpy(cursor.data, next.data, sizeof(cursor.data));
+    cursor.block++;
+    codecDecodeBegin(cursor.data, cursor.state);
+    cursor.loaded = true;
+    return true;
+}
+
+/**
+ * @brief Следующие записи интервала (до max); файл читается по блоку
+ */
+size_t historyRead(HistoryCursor &cursor, SensorReading *out, size_t max)
+{
+    size_t count = 0;
+    while (!cursor.done && count < max)
+    {
+        if (!cursor.loaded)
+        {
+            if (count > 0)
+                break; // не больше одного чтения файла на вызов
+            if (cursor.segment > cursor.lastSegment)
+            {
+                cursor.done = true;
+                break;
+            }
+            if (!loadBlock(cursor))
+            {
+                // Конец сегмента (или сегмента нет — сутки без показаний, удалён по сроку хранения)
+                cursor.segment++;
+                cursor.block = 0;
+                continue;
+            }
+        }
+        SensorReading &reading = out[count];
+        if (!codecDecodeNext(cursor.data, cursor.state, reading))
+        {
+            cursor.loaded = false;
+            continue;
+        }
+        if (reading.timestamp > cursor.to)
+            cursor.done = true;
+        else if (reading.timestamp >= cursor.from) // начало блока до from пропускается
+            count++;
+    }
+    return count;
+}
+
+// === Параметры запроса ===
+void historyQueryInit(HistoryQuery &query)
+{
+    query.from = 0;
+    query.to = UINT64_MAX;
+    query.limit = 0;
+    query.id[0] = '\0';
+}
+
+static bool parseNumber(const char *value, uint64_t &out)
+{
+    char *end;
+    if (value[0] < '0' || value[0] > '9')
+        return false;
+    out = strtoull(value, &end, 10);
+    return *end == '\0';
+}
+
+/**
+ * @brief Один параметр (from, to, limit, id); неизвестные игнорируются
+ * @return false — значение некорректно
+ */
+bool historySetParam(HistoryQuery &query, const char *name, const char *value)
+{
+    uint64_t number;
+    if (strcmp(name, "from") == 0 || strcmp(name, "to") == 0)
+    {
+        if (!parseNumber(value, number))
+            return false;
+        (name[0] == 'f' ? query.from : query.to) = number;
+    }
+    else if (strcmp(name, "limit") == 0)
+    {
+        if (!parseNumber(value, number) || number > UINT32_MAX)
+            return false;
+        query.limit = (uint32_t)number;
+    }
+    else if (strcmp(name, "id") == 0)
+    {
+        // Возвращается в JSON без экранирования — допускаются только [A-Za-z0-9_-]
+        size_t len = strlen(value);
+        if (len >= sizeof(query.id) || strspn(value, "0123456789abcdefghijklmnopqrstuvwxyz"
+                                                     "ABCDEFGHIJKLMNOPQRSTUVWXYZ_-") != len)
+            return false;
+        memcpy(query.id, value, len + 1);
+    }
+    return true;
+}
+
+bool historyParseQuery(const char *text, size_t len, HistoryQuery &query)
+{
+    historyQueryInit(query);
+    const char *end = text + len;
+    while (text < end)
+    {
+        const char *amp = (const char *)memchr(text, '&', end - text);
+        const char *stop = amp ? amp : end;
+        const char *eq = (const char *)memchr(text, '=', stop - text);
+        char name[16], value[32];
+        if (eq && (size_t)(eq - text) < sizeof(name) && (size_t)(stop - eq - 1) < sizeof(value))
+        {
+            memcpy(name, text, eq - text);
+            name[eq - text] = '\0';
+            memcpy(value, eq + 1, stop - eq - 1);
+            value[stop - eq - 1] = '\0';
+            if (!historySetParam(query, name, value))
+                return false;
+        }
+        else if (stop > text)
+        {
+            return false;
+        }
+        text = stop + 1;
+    }
+    return query.from <= query.to;
+}
+
+// === Ответ JSON порциями ===
+static void streamReset(HistoryStream &stream)
+{
+    stream.chunkLen = 0;
+    stream.chunkPos = 0;
+    stream.phase = HISTORY_HEADER;
+    stream.truncated = false;
+    stream.rows = 0;
+    stream.textLen = 0;
+    stream.textPos = 0;
+}
+
+void historyStreamBegin(HistoryStream &stream, const HistoryQuery &query)
+{
+    stream.query = query;
+    historySeek(stream.cursor, query.from, query.to);
+    streamReset(stream);
+    historyStats.queries++;
+}
+
+// Значения в фиксированной точке выводятся без float; недействительный канал — null
+static int formatRow(char *buf, size_t size, const SensorReading &r, bool first)
+{
+    char temp[12] = "null", hum[8] = "null", pres[12] = "null", vcc[8] = "null";
+    if (r.flags & SAMPLE_TEMPERATURE)
+    {
+        unsigned magnitude = (unsigned)(r.tempCenti < 0 ? -r.tempCenti : r.tempCenti);
+        snprintf(temp, sizeof(temp), "%s%u.%02u", r.tempCenti < 0 ? "-" : "", magnitude / 100, magnitude % 100);
+    }
+    if (r.flags & SAMPLE_HUMIDITY)
+        snprintf(hum, sizeof(hum), "%u.%u", r.humPermille / 10, r.humPermille % 10);
+    if (r.flags & SAMPLE_PRESSURE)
+        snprintf(pres, sizeof(pres), "%.1f", samplePressure(r));
+    if (r.flags & SAMPLE_VCC)
+        snprintf(vcc, sizeof(vcc), "%u.%03u", r.vccMv / 1000, r.vccMv % 1000);
+    return snprintf(buf, size, "%s[%llu,%s,%s,%s,%s]", first ? "" : ",", (unsigned long long)r.timestamp,
+                    temp, hum, pres, vcc);
+}
+
+// Следующий фрагмент ответа в stream.text; false — ответ закончен
+static bool nextText(HistoryStream &stream)
+{
+    int len = 0;
+    stream.textPos = 0;
+    switch (stream.phase)
+    {
+    case HISTORY_HEADER:
+        len = snprintf(stream.text, sizeof(stream.text),
+                       "{\"uid\":\"%s\"%s%s%s,\"from\":%llu,\"to\":%llu,"
+                       "\"columns\":[\"timestamp\",\"temperature\",\"humidity\",\"pressure\",\"vcc\"],\"rows\":[",
+                       config.uid, stream.query.id[0] ? ",\"id\":\"" : "", stream.query.id,
+                       stream.query.id[0] ? "\"" : "", (unsigned long long)stream.query.from,
+                       (unsigned long long)stream.query.to);
+        stream.phase = HISTORY_ROWS;
+        break;
+    case HISTORY_ROWS:
+        if (stream.chunkPos == stream.chunkLen)
+        {
+            stream.chunkLen = (uint8_t)historyRead(stream.cursor, stream.chunk, HISTORY_CHUNK_RECORDS);
+            stream.chunkPos = 0;
+        }
+        if (stream.chunkLen == 0 || (stream.query.limit && stream.rows >= stream.query.limit))
+        {
+            stream.truncated = stream.chunkLen > 0; // есть строки сверх limit
+            stream.phase = HISTORY_FOOTER;
+            return nextText(stream);
+        }
+        len = formatRow(stream.text, sizeof(stream.text), stream.chunk[stream.chunkPos++], stream.rows == 0);
+        stream.rows++;
+        break;
+    case HISTORY_FOOTER:
+        len = snprintf(stream.text, sizeof(stream.text), "],\"count\":%lu,\"truncated\":%s}",
+                       (unsigned long)stream.rows, stream.truncated ? "true" : "false");
+        historyStats.rowsServed += stream.rows;
+        stream.phase = HISTORY_DONE;
+        break;
+    default:
+        stream.textLen = 0;
+        return false;
+    }
+    stream.textLen = len > 0 ? (uint16_t)(len < (int)sizeof(stream.text) ? len : sizeof(stream.text) - 1) : 0;
+    return true;
+}
+
+/**
+ * @brief Очередная порция ответа в buf (не больше size)
+ */
+size_t historyStreamRead(HistoryStream &stream, char *buf, size_t size)
+{
+    size_t len = 0;
+    while (len < size)
+    {
+        if (stream.textPos == stream.textLen && !nextText(stream))
+            break;
+        size_t n = stream.textLen - stream.textPos;
+        if (n > size - len)
+            n = size - len;
+        memcpy(buf + len, stream.text + stream.textPos, n);
+        stream.textPos += (uint16_t)n;
+        len += n;
+    }
+    return len;
+}
+
+size_t historyStreamMeasure(HistoryStream &stream)
+{
+    HistoryCursor start = stream.cursor;
+    uint32_t served = historyStats.rowsServed;
+    size_t total = 0;
+    while (nextText(stream))
+        total += stream.textLen;
+    stream.cursor = start;
+    streamReset(stream);
+    historyStats.rowsServed = served;
+    return total;
+}
@@ -0,0 +1,272 @@
+#include "history_codec.h"
+#include <string.h>
+
+// Корзины «префикс + значение со знаком»: ширина значения по длине префикса
+struct CodecBucket
+{
+    uint8_t prefixBits;
+    uint8_t prefix;
+    uint8_t valueBits;
+};
+
+// Разность разностей меток, мс: 0 при ровном периоде, джиттер опроса — десятки мс
+static const CodecBucket TIME_BUCKETS[] = {{1, 0x0, 0}, {2, 0x2, 7}, {3, 0x6, 9}, {4, 0xE, 12}, {4, 0xF, 32}};
+// Разности значений: шум датчиков — единицы и десятки младших разрядов
+static const CodecBucket VALUE_BUCKETS[] = {{1, 0x0, 0}, {2, 0x2, 5}, {3, 0x6, 9}, {4, 0xE, 16}, {4, 0xF, 32}};
+static const uint8_t BUCKET_COUNT = 5;
+
+#define CODEC_FAIL 0xFFFF
+
+static void putLe(uint8_t *p, uint64_t v, uint8_t bytes)
+{
+    for (uint8_t i = 0; i < bytes; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t getLe(const uint8_t *p, uint8_t bytes)
+{
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < bytes; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+uint64_t codecBlockFirstTimestamp(const uint8_t *block) { return getLe(block, 8); }
+uint16_t codecBlockCount(const uint8_t *block) { return (uint16_t)getLe(block + 8, 2); }
+uint16_t codecBlockBits(const uint8_t *block) { return (uint16_t)getLe(block + 10, 2); }
+
+// === Поток бит ===
+// Запись в пустой (обнулённый) хвост блока; data = nullptr — только подсчёт длины
+static uint16_t putBits(uint8_t *data, uint16_t pos, uint32_t value, uint8_t n)
+{
+    if (pos == CODEC_FAIL || pos + n > CODEC_BLOCK_BITS)
+        return CODEC_FAIL;
+    if (data)
+    {
+        uint8_t *bits = data + CODEC_HEADER_SIZE;
+        for (int8_t i = (int8_t)n - 1; i >= 0; i--, pos++)
+        {
+            if ((value >> i) & 1)
+                bits[pos >> 3] |= (uint8_t)(0x80 >> (pos & 7));
+        }
+        return pos;
+    }
+    return pos + n;
+}
+
+static bool getBits(const uint8_t *block, uint16_t &pos, uint16_t end, uint8_t n, uint32_t &value)
+{
+    if (pos + n > end)
+        return false;
+    const uint8_t *bits = block + CODEC_HEADER_SIZE;
+    value = 0;
+    for (uint8_t i = 0; i < n; i++, pos++)
+        value = (value << 1) | ((bits[pos >> 3] >> (7 - (pos & 7))) & 1);
+    return true;
+}
+
+static uint16_t putSigned(uint8_t *data, uint16_t pos, const CodecBucket *buckets, int64_t value)
+{
+    for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        const CodecBucket &b = buckets[i];
+        int64_t limit = b.valueBits ? (int64_t)1 << (b.valueBits - 1) : 0;
+        if (b.valueBits ? (value >= -limit && value < limit) : value == 0)
+        {
+            pos = putBits(data, pos, b.prefix, b.prefixBits);
+            return b.valueBits ? putBits(data, pos, (uint32_t)value & (uint32_t)(((uint64_t)1 << b.valueBits) - 1), b.valueBits) : pos;
+        }
+    }
+    return CODEC_FAIL; // вне 32 бит — блок не может продолжаться
+}
+
+static bool getSigned(const uint8_t *block, uint16_t &pos, uint16_t end, const CodecBucket *buckets, int64_t &value)
+{
+    uint32_t prefix = 0;
+    uint8_t prefixBits = 0;
+    for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        const CodecBucket &b = buckets[i];
+        uint32_t bit;
+        while (prefixBits < b.prefixBits)
+        {
+            if (!getBits(block, pos, end, 1, bit))
+                return false;
+            prefix = (prefix << 1) | bit;
+            prefixBits++;
+        }
+        if (prefix != b.prefix)
+            continue;
+        if (b.valueBits == 0)
+        {
+            value = 0;
+            return true;
+        }
+        uint32_t raw;
+        if (!getBits(block, pos, end, b.valueBits, raw))
+            return false;
+        uint32_t sign = (uint32_t)1 << (b.valueBits - 1);
+        value = (int32_t)((raw ^ sign) - sign); // расширение знака
+        return true;
+    }
+    return false;
+}
+
+// === Показание ===
+static int32_t channelValue(const SensorReading &reading, uint8_t channel)
+{
+    switch (channel)
+    {
+    case CODEC_TEMPERATURE:
+        return reading.tempCenti;
+    case CODEC_HUMIDITY:
+        return reading.humPermille;
+    case CODEC_PRESSURE:
+        return (int32_t)reading.pressurePa;
+    default:
+        return reading.vccMv;
+    }
+}
+
+static void setChannelValue(SensorReading &reading, uint8_t channel, int32_t value)
+{
+    switch (channel)
+    {
+    case CODEC_TEMPERATURE:
+        reading.tempCenti = (int16_t)value;
+        break;
+    case CODEC_HUMIDITY:
+        reading.humPermille = (uint16_t)value;
+        break;
+    case CODEC_PRESSURE:
+        reading.pressurePa = (uint32_t)value;
+        break;
+    default:
+        reading.vccMv = (uint16_t)value;
+        break;
+    }
+}
+
+/**
+ * @brief Кодирование показания после state; обновляет state
+ * @return новая позиция или CODEC_FAIL (не помещается)
+ */
+static uint16_t encodeSample(uint8_t *data, CodecState &state, const SensorReading &reading)
+{
+    uint16_t pos = state.bitPos;
+    int64_t timeDelta = (int64_t)(reading.timestamp - state.timestamp);
+    pos = putSigned(data, pos, TIME_BUCKETS, timeDelta - state.timeDelta);
+
+    if (reading.flags == state.flags)
+        pos = putBits(data, pos, 0, 1);
+    else
+        pos = putBits(data, pos, 0x100 | reading.flags, 9);
+
+    int32_t sampleDelta = (int32_t)(reading.sample - state.sample); // по модулю 2^32
+    pos = putSigned(data, pos, VALUE_BUCKETS, (int64_t)sampleDelta - state.sampleDelta);
+
+    for (uint8_t ch = 0; ch < CODEC_CHANNEL_COUNT; ch++)
+    {
+        if (reading.flags & (1 << ch))
+        {
+            int32_t value = channelValue(reading, ch);
+            pos = putSigned(data, pos, VALUE_BUCKETS, (int64_t)value - state.values[ch]);
+            state.values[ch] = value;
+        }
+    }
+    state.timestamp = reading.timestamp;
+    state.timeDelta = timeDelta;
+    state.sample = reading.sample;
+    state.sampleDelta = sampleDelta;
+    state.flags = reading.flags;
+    state.count++;
+    state.bitPos = pos;
+    return pos;
+}
+
+void codecBlockBegin(uint8_t *block, CodecState &state)
+{
+    memset(block, 0, CODEC_BLOCK_SIZE);
+    memset(&state, 0, sizeof(state));
+}
+
+/**
+ * @brief Дописать показание; блок не меняется, если оно не помещается
+ */
+bool codecBlockAppend(uint8_t *block, CodecState &state, const SensorReading &reading)
+{
+    if (state.count == 0)
+    {
+        putLe(block, reading.timestamp, 8);
+        state.timestamp = reading.timestamp;
+    }
+    else if (reading.timestamp < state.timestamp)
+    {
+        return false;
+    }
+
+    CodecState next = state;
+    if (encodeSample(nullptr, next, reading) == CODEC_FAIL)
+        return false;
+    encodeSample(block, state, reading);
+    putLe(block + 8, state.count, 2);
+    putLe(block + 10, state.bitPos, 2);
+    return true;
+}
+
+void codecDecodeBegin(const uint8_t *block, CodecState &state)
+{
+    memset(&state, 0, sizeof(state));
+    state.timestamp = codecBlockFirstTimestamp(block);
+}
+
+bool codecDecodeNext(const uint8_t *block, CodecState &state, SensorReading &reading)
+{
+    uint16_t end = codecBlockBits(block);
+    if (state.count >= codecBlockCount(block) || end > CODEC_BLOCK_BITS)
+        return false;
+
+    uint16_t pos = state.bitPos;
+    int64_t dod, sampleDod;
+    uint32_t changed, flags = state.flags;
+    if (!getSigned(block, pos, end, TIME_BUCKETS, dod) || !getBits(block, pos, end, 1, changed) ||
+        (changed && !getBits(block, pos, end, 8, flags)) ||
+        !getSigned(block, pos, end, VALUE_BUCKETS, sampleDod))
+        return false;
+
+    memset(&reading, 0, sizeof(reading));
+    state.timeDelta += dod;
+    state.timestamp += (uint64_t)state.timeDelta;
+    state.sampleDelta = (int32_t)(state.sampleDelta + sampleDod);
+    state.sample += (uint32_t)state.sampleDelta;
+    state.flags = (uint8_t)flags;
+    for (uint8_t ch = 0; ch < CODEC_CHANNEL_COUNT; ch++)
+    {
+        if (!(flags & (1 << ch)))
+            continue;
+        int64_t delta;
+        if (!getSigned(block, pos, end, VALUE_BUCKETS, delta))
+            return false;
+        state.values[ch] = (int32_t)(state.values[ch] + delta);
+        setChannelValue(reading, ch, state.values[ch]);
+    }
+    reading.timestamp = state.timestamp;
+    reading.sample = state.sample;
+    reading.flags = state.flags;
+    state.count++;
+    state.bitPos = pos;
+    return true;
+}
+
+/**
+ * @brief Состояние кодера в конце блока (продолжение после перезагрузки)
+ * @return false — блок повреждён
+ */
+bool codecBlockResume(const uint8_t *block, CodecState &state)
+{
+    SensorReading reading;
+    codecDecodeBegin(block, state);
+    while (codecDecodeNext(block, state, reading))
+        ;
+    return state.count == codecBlockCount(block) && state.bitPos == codecBlockBits(block);
+}
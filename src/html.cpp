@@ -0,0 +1,153 @@
+#include "html.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+void htmlBegin(HtmlRenderer &r, const char *const *parts, HtmlFieldFn field, void *ctx)
+{
+    r.parts = parts;
+    r.field = field;
+    r.ctx = ctx;
+    r.part = 0;
+    r.pos = 0;
+    r.name = nullptr;
+    r.nameLen = 0;
+    r.index = 0;
+    r.more = false;
+    r.valueLen = 0;
+    r.valuePos = 0;
+    r.total = 0;
+}
+
+static void htmlResolve(HtmlRenderer &r)
+{
+    size_t len = 0;
+    r.more = r.field(r.ctx, r.name, r.nameLen, r.index, r.value, sizeof(r.value), &len);
+    r.valueLen = len < sizeof(r.value) ? len : sizeof(r.value) - 1;
+    r.valuePos = 0;
+}
+
+/**
+ * @brief Следующая порция страницы (не больше size байт)
+ * @return 0 — страница закончилась
+ */
+size_t htmlRender(HtmlRenderer &r, uint8_t *buf, size_t size)
+{
+    size_t out = 0;
+    while (out < size)
+    {
+        // Остаток значения поля
+        if (r.valuePos < r.valueLen)
+        {
+            size_t n = r.valueLen - r.valuePos;
+            if (n > size - out)
+                n = size - out;
+            memcpy(buf + out, r.value + r.valuePos, n);
+            r.valuePos += n;
+            out += n;
+            continue;
+        }
+        // Следующий элемент списка
+        if (r.more)
+        {
+            r.index++;
+            htmlResolve(r);
+            continue;
+        }
+
+        const char *part = r.parts[r.part];
+        if (!part)
+            break;
+        const char *p = part + r.pos;
+        if (*p == '\0')
+        {
+            r.part++;
+            r.pos = 0;
+            continue;
+        }
+
+        const char *next = strstr(p, "{{");
+        if (next == p)
+        {
+            // Имя поля: [a-z0-9_], сразу за ним "}}"
+            size_t nameLen = strspn(p + 2, "abcdefghijklmnopqrstuvwxyz0123456789_");
+            if (nameLen > 0 && nameLen < 64 && p[2 + nameLen] == '}' && p[3 + nameLen] == '}')
+            {
+                r.name = p + 2;
+                r.nameLen = (uint8_t)nameLen;
+                r.pos += r.nameLen + 4;
+                r.index = 0;
+                htmlResolve(r);
+                continue;
+            }
+        }
+
+        // Текст до следующего "{{"; незакрытые "{{" выводятся как есть
+        size_t run = next == p ? 2 : next ? (size_t)(next - p) : strlen(p);
+        if (run > size - out)
+            run = size - out;
+        memcpy(buf + out, p, run);
+        r.pos += run;
+        out += run;
+    }
+    r.total += out;
+    return out;
+}
+
+bool htmlFieldIs(const char *name, size_t nameLen, const char *expected)
+{
+    return strlen(expected) == nameLen && memcmp(name, expected, nameLen) == 0;
+}
+
+size_t htmlFormat(char *out, size_t size, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(out, size, format, args);
+    va_end(args);
+    if (len < 0)
+        return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+/**
+ * @brief Экранирование для текста и значений атрибутов
+ */
+size_t htmlEscape(char *out, size_t size, const char *src)
+{
+    size_t len = 0;
+    for (; *src && len + 1 < size; src++)
+    {
+        const char *entity = nullptr;
+        switch (*src)
+        {
+        case '"':
+            entity = "&quot;";
+            break;
+        case '&':
+            entity = "&amp;";
+            break;
+        case '<':
+            entity = "&lt;";
+            break;
+        case '>':
+            entity = "&gt;";
+            break;
+        }
+        if (entity)
+        {
+            size_t n = strlen(entity);
+            if (len + n + 1 > size)
+                break;
+            memcpy(out + len, entity, n);
+            len += n;
+        }
+        else
+        {
+            out[len++] = *src;
+        }
+    }
+    if (size > 0)
+        out[len] = '\0';
+    return len;
+}
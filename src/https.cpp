@@ -0,0 +1,102 @@
+#include "https.h"
+#include "hal.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+TlsStats tlsStats;
+
+/**
+ * @brief Разбор http(s)://host[:port][/path]
+ */
+bool httpParseUrl(const char *url, HttpUrl &out)
+{
+    const char *hostStart;
+    if (strncmp(url, "https://", 8) == 0)
+    {
+        out.secure = true;
+        out.port = 443;
+        hostStart = url + 8;
+    }
+    else if (strncmp(url, "http://", 7) == 0)
+    {
+        out.secure = false;
+        out.port = 80;
+        hostStart = url + 7;
+    }
+    else
+    {
+        return false;
+    }
+
+    const char *path = strchr(hostStart, '/');
+    size_t hostLen = path ? (size_t)(path - hostStart) : strlen(hostStart);
+    out.path = path ? path : "/";
+    if (hostLen == 0 || hostLen >= sizeof(out.host))
+        return false;
+    memcpy(out.host, hostStart, hostLen);
+    out.host[hostLen] = '\0';
+
+    char *colon = strchr(out.host, ':');
+    if (colon)
+    {
+        *colon = '\0';
+        long port = atol(colon + 1);
+        if (port <= 0 || port > 65535)
+            return false;
+        out.port = (uint16_t)port;
+    }
+    return true;
+}
+
+/**
+ * @brief Сохранённая сессия для этого сервера или nullptr
+ */
+const uint8_t *tlsSessionFor(const char *host, uint16_t port, size_t *len)
+{
+    if (tlsSession.len == 0 || tlsSession.len > TLS_SESSION_MAX || tlsSession.port != port ||
+        strncmp(tlsSession.host, host, sizeof(tlsSession.host)) != 0)
+        return nullptr;
+    *len = tlsSession.len;
+    return tlsSession.data;
+}
+
+void tlsSessionStore(const char *host, uint16_t port, const uint8_t *data, size_t len)
+{
+    if (len == 0 || len > TLS_SESSION_MAX)
+    {
+        tlsSessionClear();
+        return;
+    }
+    strlcpy(tlsSession.host, host, sizeof(tlsSession.host));
+    tlsSession.port = port;
+    memmove(tlsSession.data, data, len); // data может указывать в tlsSession.data
+    tlsSession.len = (uint16_t)len;
+}
+
+void tlsSessionClear()
+{
+    tlsSession.len = 0;
+}
+
+void tlsRecordHandshake(const char *host, bool resumed, uint32_t handshakeUs, uint32_t heapBytes)
+{
+    tlsStats.lastHandshakeUs = handshakeUs;
+    tlsStats.lastHeapBytes = heapBytes;
+    if (heapBytes > tlsStats.peakHeapBytes)
+        tlsStats.peakHeapBytes = heapBytes;
+    if (resumed)
+    {
+        tlsStats.resumedHandshakes++;
+        if (handshakeUs > tlsStats.maxResumedUs)
+            tlsStats.maxResumedUs = handshakeUs;
+    }
+    else
+    {
+        tlsStats.fullHandshakes++;
+        if (handshakeUs > tlsStats.maxFullUs)
+            tlsStats.maxFullUs = handshakeUs;
+    }
+    logDebug(LOG_TLS, "%s: %s handshake %lu ms, heap %lu B", host, resumed ? "resumed" : "full",
+             (unsigned long)(handshakeUs / 1000), (unsigned long)heapBytes);
+}
@@ -0,0 +1,472 @@
+#include "log.h"
+#include "hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+static const char *const MODULE_NAMES[LOG_MODULE_COUNT] = {
+    "BOOT", "CONFIG", "FS", "WIFI", "MQTT", "HTTP", "TLS", "WEB", "API", "SENSORS", "SCHED",
+    "HIST", "TIME", "TASK", "POWER", "ULP", "ESPNOW", "PAYLOAD", "SINK", "OTA", "LOG", "SIM"};
+static const char *const LEVEL_NAMES[] = {"none", "error", "warn", "info", "debug"};
+static const char LEVEL_LETTERS[] = "-EWID";
+
+uint8_t logLevels[LOG_MODULE_COUNT] = {
+    LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT,
+    LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT,
+    LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT,
+    LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT,
+    LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT};
+static_assert(sizeof(MODULE_NAMES) / sizeof(MODULE_NAMES[0]) == LOG_MODULE_COUNT, "module names");
+uint8_t logMqttLevel = LOG_MQTT_LEVEL_DEFAULT;
+LogStats logStats = {};
+
+// === Кольцевой буфер записей ===
+// Ограниченная очередь Вьюкова: писатель занимает позицию CAS-ом enqueuePos и заполняет свой
+// слот, ни с кем не синхронизируясь; готовность слота читатель узнаёт по его seq
+// (pos — свободен для записи pos, pos + 1 — запись pos готова).
+// В слоте хранится seq минус его индекс: нулевой буфер уже готов к работе, даже если первая
+// запись придёт из конструктора статического объекта раньше setup().
+static LogRecord ring[LOG_RING_SLOTS];
+static uint32_t enqueuePos = 0;
+static uint32_t dequeuePos = 0; // только читатель
+static uint8_t drainLock = 0;     // читатель один: logDrain() из задачи и синхронный вывод не пересекаются
+static uint32_t consumerIdle = 0; // задача вывода спит и ждёт пробуждения от писателя
+static LogWakeFn wakeConsumer = nullptr;
+static uint32_t reportedDrops = 0;
+
+// === История готовых строк ===
+static LogLine history[LOG_HISTORY_LINES];
+
+static inline uint32_t slotSeq(const LogRecord &r, uint32_t pos)
+{
+    return __atomic_load_n(&r.seq, __ATOMIC_ACQUIRE) + (pos & (LOG_RING_SLOTS - 1));
+}
+
+static inline void setSlotSeq(LogRecord &r, uint32_t pos, uint32_t seq)
+{
+    __atomic_store_n(&r.seq, seq - (pos & (LOG_RING_SLOTS - 1)), __ATOMIC_RELEASE);
+}
+
+LogRecord *logReserve(uint8_t level, uint8_t module, const char *format, uint32_t &pos)
+{
+    LogRecord *r;
+    pos = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        r = &ring[pos & (LOG_RING_SLOTS - 1)];
+        int32_t dif = (int32_t)(slotSeq(*r, pos) - pos);
+        if (dif == 0)
+        {
+            if (__atomic_compare_exchange_n(&enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (dif < 0)
+        {
+            // Слот ещё не выведен: буфер полон, запись теряется
+            __atomic_fetch_add(&logStats.dropped, 1, __ATOMIC_RELAXED);
+            return nullptr;
+        }
+        else
+        {
+            pos = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+
+    r->timeMs = halMillis();
+    r->format = format;
+    r->level = level;
+    r->module = module;
+    r->argCount = 0;
+    r->textLen = 0;
+    return r;
+}
+
+void logPack(LogRecord &r, uint8_t i, const char *v)
+{
+    if (!v)
+        v = "(null)";
+    size_t room = LOG_TEXT_SIZE - r.textLen;
+    size_t len = strnlen(v, room > 0 ? room - 1 : 0);
+    r.types[i] = LOG_ARG_TEXT;
+    r.args[i].u = r.textLen;
+    if (room == 0)
+    {
+        r.args[i].u = LOG_TEXT_SIZE - 1; // пустая строка: последний байт всегда ноль
+        __atomic_fetch_add(&logStats.truncated, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (v[len] != '\0')
+        __atomic_fetch_add(&logStats.truncated, 1, __ATOMIC_RELAXED);
+    memcpy(r.text + r.textLen, v, len);
+    r.text[r.textLen + len] = '\0';
+    r.textLen += len + 1;
+}
+
+void logCommit(LogRecord *record, uint32_t pos)
+{
+    record->text[LOG_TEXT_SIZE - 1] = '\0';
+    setSlotSeq(*record, pos, pos + 1);
+    __atomic_fetch_add(&logStats.written, 1, __ATOMIC_RELAXED);
+
+    LogWakeFn wake = __atomic_load_n(&wakeConsumer, __ATOMIC_ACQUIRE);
+    if (!wake)
+    {
+        logDrain();
+        return;
+    }
+    // Будим задачу вывода, только если она уснула (её проверка очереди — после своей записи consumerIdle)
+    if (__atomic_load_n(&consumerIdle, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&consumerIdle, 0, __ATOMIC_SEQ_CST))
+        wake();
+}
+
+void logSetWake(LogWakeFn wake)
+{
+    __atomic_store_n(&wakeConsumer, wake, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Готова ли очередная запись (вызывает только читатель)
+ */
+static bool nextReady()
+{
+    return slotSeq(ring[dequeuePos & (LOG_RING_SLOTS - 1)], dequeuePos) == dequeuePos + 1;
+}
+
+bool logConsumerIdle()
+{
+    __atomic_store_n(&consumerIdle, 1, __ATOMIC_SEQ_CST);
+    if (!nextReady())
+        return true;
+    __atomic_store_n(&consumerIdle, 0, __ATOMIC_SEQ_CST);
+    return false;
+}
+
+// === Форматирование ===
+static size_t appendText(size_t size, size_t len, int written)
+{
+    if (written < 0)
+        return len;
+    len += (size_t)written;
+    return len < size ? len : size - 1;
+}
+
+/**
+ * @brief printf по сохранённым аргументам: модификатор длины в спецификации заменяется на тип,
+ * с которым аргумент лёг в запись (ll для целых, без модификатора для double)
+ */
+static size_t formatMessage(const LogRecord &r, char *out, size_t size, size_t len)
+{
+    uint8_t arg = 0;
+    for (const char *f = r.format; *f && len < size - 1;)
+    {
+        if (*f != '%')
+        {
+            out[len++] = *f++;
+            continue;
+        }
+        if (f[1] == '%')
+        {
+            out[len++] = '%';
+            f += 2;
+            continue;
+        }
+
+        char spec[24];
+        size_t specLen = 0;
+        spec[specLen++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && specLen < sizeof(spec) - 4)
+            spec[specLen++] = *f++;
+        while (*f && strchr("hljztLq", *f))
+            f++;
+        char conv = *f;
+        if (!conv)
+            break;
+        f++;
+
+        if (arg >= r.argCount)
+        {
+            len = appendText(size, len, snprintf(out + len, size - len, "?"));
+            continue;
+        }
+        uint8_t type = r.types[arg];
+        const auto &value = r.args[arg++];
+        int written;
+        if (strchr("diuxXoc", conv))
+        {
+            bool isSigned = conv == 'd' || conv == 'i' || conv == 'c';
+            long long integer = type == LOG_ARG_DOUBLE ? (long long)value.d : value.i;
+            if (type == LOG_ARG_TEXT)
+            {
+                written = snprintf(out + len, size - len, "?");
+            }
+            else if (conv == 'c')
+            {
+                spec[specLen++] = 'c';
+                spec[specLen] = '\0';
+                written = snprintf(out + len, size - len, spec, (int)integer);
+            }
+            else
+            {
+                spec[specLen++] = 'l';
+                spec[specLen++] = 'l';
+                spec[specLen++] = conv;
+                spec[specLen] = '\0';
+                if (isSigned)
+                    written = snprintf(out + len, size - len, spec, integer);
+                else
+                    written = snprintf(out + len, size - len, spec, (unsigned long long)integer);
+            }
+        }
+        else if (strchr("fFeEgGaA", conv))
+        {
+            double real = type == LOG_ARG_DOUBLE ? value.d : type == LOG_ARG_UINT ? (double)value.u : (double)value.i;
+            spec[specLen++] = conv;
+            spec[specLen] = '\0';
+            written = type == LOG_ARG_TEXT ? snprintf(out + len, size - len, "?") : snprintf(out + len, size - len, spec, real);
+        }
+        else if (conv == 's')
+        {
+            spec[specLen++] = 's';
+            spec[specLen] = '\0';
+            const char *text = type == LOG_ARG_TEXT ? r.text + value.u : "?";
+            written = snprintf(out + len, size - len, spec, text);
+        }
+        else if (conv == 'p')
+        {
+            written = snprintf(out + len, size - len, "%p", (void *)(uintptr_t)value.u);
+        }
+        else
+        {
+            written = snprintf(out + len, size - len, "%%%c", conv);
+        }
+        len = appendText(size, len, written);
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief Строка журнала: "секунды.мс уровень [МОДУЛЬ] текст" без перевода строки
+ */
+size_t logFormat(const LogRecord &r, char *out, size_t size)
+{
+    if (size == 0)
+        return 0;
+    int prefix = snprintf(out, size, "%lu.%03lu %c [%s] ", (unsigned long)(r.timeMs / 1000),
+                          (unsigned long)(r.timeMs % 1000), LEVEL_LETTERS[r.level < sizeof(LEVEL_LETTERS) - 1 ? r.level : 0],
+                          logModuleName(r.module));
+    size_t len = appendText(size, 0, prefix);
+    len = formatMessage(r, out, size, len);
+    if (len == size - 1)
+        __atomic_fetch_add(&logStats.truncated, 1, __ATOMIC_RELAXED);
+    while (len > 0 && (out[len - 1] == '\n' || out[len - 1] == '\r'))
+        out[--len] = '\0';
+    return len;
+}
+
+/**
+ * @brief Строка в историю; читатели без блокировок узнают о перезаписи по version
+ */
+static void storeLine(const char *text, size_t len, uint8_t level, uint8_t module)
+{
+    uint32_t seq = logStats.lines;
+    LogLine &line = history[seq % LOG_HISTORY_LINES];
+    __atomic_store_n(&line.version, line.version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    line.seq = seq;
+    line.level = level;
+    line.module = module;
+    memcpy(line.text, text, len + 1);
+    __atomic_store_n(&line.version, line.version + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&logStats.lines, seq + 1, __ATOMIC_RELEASE);
+}
+
+static void emitLine(char *line, size_t len, uint8_t level, uint8_t module)
+{
+    storeLine(line, len, level, module);
+    line[len] = '\n';
+    halLogWrite(line, len + 1);
+}
+
+static size_t drainOnce()
+{
+    size_t count = 0;
+    char line[LOG_LINE_SIZE + 1]; // + '\n'
+    while (nextReady())
+    {
+        LogRecord &r = ring[dequeuePos & (LOG_RING_SLOTS - 1)];
+        size_t len = logFormat(r, line, LOG_LINE_SIZE);
+        uint8_t level = r.level, module = r.module;
+        setSlotSeq(r, dequeuePos, dequeuePos + LOG_RING_SLOTS);
+        dequeuePos++;
+        emitLine(line, len, level, module);
+        count++;
+    }
+
+    uint32_t dropped = __atomic_load_n(&logStats.dropped, __ATOMIC_RELAXED);
+    if (dropped != reportedDrops)
+    {
+        uint32_t now = halMillis();
+        size_t len = (size_t)snprintf(line, LOG_LINE_SIZE, "%lu.%03lu W [LOG] %lu records dropped, buffer full",
+                                      (unsigned long)(now / 1000), (unsigned long)(now % 1000),
+                                      (unsigned long)(dropped - reportedDrops));
+        reportedDrops = dropped;
+        emitLine(line, len < LOG_LINE_SIZE ? len : LOG_LINE_SIZE - 1, LOG_WARN, LOG_LOG);
+        count++;
+    }
+    return count;
+}
+
+size_t logDrain()
+{
+    size_t count = 0;
+    // Писатель, не взявший замок, полагается на владельца; тот после освобождения смотрит очередь ещё раз
+    do
+    {
+        if (__atomic_test_and_set(&drainLock, __ATOMIC_ACQUIRE))
+            return count;
+        count += drainOnce();
+        __atomic_clear(&drainLock, __ATOMIC_RELEASE);
+    } while (nextReady());
+    return count;
+}
+
+// === История и уровни ===
+bool logReadLine(uint32_t seq, LogLine &line)
+{
+    if (seq >= __atomic_load_n(&logStats.lines, __ATOMIC_ACQUIRE))
+        return false;
+    const LogLine &slot = history[seq % LOG_HISTORY_LINES];
+    // Строка в слоте меняется только на более новую: любая смена version — запрошенной больше нет
+    uint32_t version = __atomic_load_n(&slot.version, __ATOMIC_ACQUIRE);
+    if (version & 1)
+        return false;
+    memcpy(&line, &slot, sizeof(line));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot.version, __ATOMIC_RELAXED) != version || line.seq != seq)
+        return false;
+    line.text[LOG_LINE_SIZE - 1] = '\0';
+    return true;
+}
+
+uint32_t logOldestLine()
+{
+    uint32_t lines = __atomic_load_n(&logStats.lines, __ATOMIC_ACQUIRE);
+    return lines > LOG_HISTORY_LINES ? lines - LOG_HISTORY_LINES : 0;
+}
+
+void logCursorBegin(LogCursor &cursor, uint32_t since, uint8_t level)
+{
+    cursor.end = __atomic_load_n(&logStats.lines, __ATOMIC_ACQUIRE);
+    cursor.next = since < logOldestLine() ? logOldestLine() : since;
+    cursor.level = level;
+    cursor.loaded = false;
+    cursor.offset = 0;
+    cursor.skipped = 0;
+}
+
+size_t logCursorRead(LogCursor &cursor, char *buf, size_t size)
+{
+    size_t len = 0;
+    while (len < size)
+    {
+        if (!cursor.loaded)
+        {
+            if (cursor.next >= cursor.end)
+                break;
+            if (!logReadLine(cursor.next++, cursor.line))
+            {
+                cursor.skipped++;
+                continue;
+            }
+            if (cursor.line.level > cursor.level)
+                continue;
+            cursor.loaded = true;
+            cursor.offset = 0;
+        }
+        // Строка целиком вместе с '\n' — перевод строки выдаётся как символ за концом текста
+        size_t lineLen = strlen(cursor.line.text) + 1;
+        size_t n = lineLen - cursor.offset;
+        if (n > size - len)
+            n = size - len;
+        memcpy(buf + len, cursor.line.text + cursor.offset, n);
+        if (cursor.offset + n == lineLen)
+        {
+            buf[len + n - 1] = '\n';
+            cursor.loaded = false;
+        }
+        cursor.offset += n;
+        len += n;
+    }
+    return len;
+}
+
+const char *logModuleName(uint8_t module)
+{
+    return module < LOG_MODULE_COUNT ? MODULE_NAMES[module] : "?";
+}
+
+const char *logLevelName(uint8_t level)
+{
+    return level <= LOG_DEBUG ? LEVEL_NAMES[level] : "?";
+}
+
+int logParseModule(const char *name)
+{
+    for (uint8_t i = 0; i < LOG_MODULE_COUNT; i++)
+    {
+        if (strcasecmp(name, MODULE_NAMES[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int logParseLevel(const char *name)
+{
+    for (uint8_t i = 0; i <= LOG_DEBUG; i++)
+    {
+        if (strcasecmp(name, LEVEL_NAMES[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief "модуль=уровень": модуль из MODULE_NAMES, "*" — все модули, "topic" — порог топика <base>/log
+ */
+bool logApplySetting(const char *setting, size_t len)
+{
+    char buf[32];
+    if (len >= sizeof(buf))
+        return false;
+    memcpy(buf, setting, len);
+    buf[len] = '\0';
+    char *eq = strchr(buf, '=');
+    if (!eq)
+        return false;
+    *eq = '\0';
+    int level = logParseLevel(eq + 1);
+    if (level < 0)
+        return false;
+
+    if (strcmp(buf, "*") == 0)
+    {
+        for (uint8_t i = 0; i < LOG_MODULE_COUNT; i++)
+            logLevels[i] = level;
+    }
+    else if (strcasecmp(buf, "topic") == 0)
+    {
+        logMqttLevel = level;
+    }
+    else
+    {
+        int module = logParseModule(buf);
+        if (module < 0)
+            return false;
+        logLevels[module] = level;
+    }
+    logInfo(LOG_LOG, "%s level set to %s", buf, logLevelName(level));
+    return true;
+}
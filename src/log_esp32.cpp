@@ -0,0 +1,38 @@
+// Вывод журнала на плате: задача с приоритетом idle форматирует записи и пишет их в UART
+#include <Arduino.h>
+#include "log.h"
+
+#define LOG_TASK_STACK 3072
+
+static TaskHandle_t logTask = nullptr;
+
+static void wakeLogTask()
+{
+    xTaskNotifyGive(logTask);
+}
+
+static void logTaskLoop(void *)
+{
+    for (;;)
+    {
+        logDrain();
+        // Писатель будит задачу после своей записи, если видит consumerIdle (log.cpp)
+        if (logConsumerIdle())
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Запуск задачи вывода; до него (и в режиме глубокого сна) строки выводятся сразу в вызове
+ */
+void logBegin()
+{
+    if (logTask)
+        return;
+    if (xTaskCreate(logTaskLoop, "LogTask", LOG_TASK_STACK, NULL, tskIDLE_PRIORITY, &logTask) != pdPASS)
+    {
+        logError(LOG_LOG, "LogTask not started, logging stays synchronous");
+        return;
+    }
+    logSetWake(wakeLogTask);
+}
@@ -1,12 +1,34 @@
 #include <Arduino.h>
 #include <WiFi.h>
+#include "feature_flags.h"
+#if FEATURE_OTA
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <Update.h>
+#endif
 #include <LittleFS.h>
 #include "config.h"
 #include "sensors.h"
 #include "mqtt.h"
+#if FEATURE_WEB
 #include "web.h"
+#endif
+#include "payload.h"
+#include "scheduler.h"
+#include "post.h"
+#include "timebase.h"
+#include "task_timing.h"
+#include "ulp.h"
+#include "power.h"
+#include "espnow.h"
+#include "https.h"
+#include "history.h"
+#include "wifi_manager.h"
+#include "publish_slot.h"
+#include "hal.h"
+#include "log.h"
+#include "trace.h"
+#include "sink.h"
 #include <ArduinoJson.h>
 #include "fw_version.h"
 
@@ -15,31 +37,52 @@
 const uint8_t sleep_on = 23;
 const uint8_t LED_PIN = 2;
 const unsigned long OTA_CHECK_INTERVAL = 3600000;
-const unsigned long AP_RETRY_DELAY = 600000;
+const unsigned long WIFI_BOOT_WAIT_MS = 10000; // синхронизация времени до первого измерения
+const unsigned long DEEP_SLEEP_BASE_MS = 5UL * 60 * 1000;
+const uint32_t SYSTEM_TASK_PERIOD_MS = 10000;
 
 String CURRENT_FIRMWARE_VERSION = FIRMWARE_VERSION;
 const char *VERSION_FILE = "/version.txt";
 const char *OTA_PENDING_FILE = "/ota_pending.txt";
 
 unsigned long lastOtaCheck = 0;
-unsigned long apStartTime = 0;
-bool forcedApMode = false;
-bool wifiConnected = false;
-SemaphoreHandle_t sensorMutex;
 
-// --- Все вспомогательные функции: http_url, saveFirmwareVersion, loadFirmwareVersion,
-//     sendPostRequest, sendOtaResult, checkAndReportPendingOta, checkFirmwareVersion,
+// Состояние адаптивного планировщика переживает глубокий сон
+RTC_DATA_ATTR SchedulerState sampleScheduler;
+RTC_DATA_ATTR bool schedulerInitialized = false;
+
+// Шкала времени (смещение SNTP и уход часов RTC) — тоже
+RTC_DATA_ATTR TimeBase timeBase;
+
+// ULP ведёт историю напряжения во сне; t0 — момент первого отсчёта (мс от эпохи, 0 — неизвестен)
+RTC_DATA_ATTR bool ulpArmed = false;
+RTC_DATA_ATTR uint64_t ulpStartMs = 0;
+
+// Номер кадра узла ESP-NOW (шлюз отбрасывает повторы с тем же номером)
+RTC_DATA_ATTR uint16_t espNowSeq = 0;
+
+// --- Все вспомогательные функции: beginHttp, saveFirmwareVersion, loadFirmwareVersion,
+//     sendOtaResult, checkAndReportPendingOta, checkFirmwareVersion,
 //     parseVersionFromJson — вставьте их сюда (они не изменились) ---
 
-String http_url(const char *url)
+#if FEATURE_OTA
+/**
+ * @brief HTTPClient поверх TLS для https:// (сервер проверяется по пакету сертификатов) или TCP
+ */
+bool beginHttp(HTTPClient &http, WiFiClientSecure &secure, WiFiClient &plain, const String &url)
 {
-    String postUrl = String(url);
-    if (postUrl.startsWith("https://"))
+    if (!url.startsWith("https://"))
+        return http.begin(plain, url);
+    const char *bundle = halCaBundle();
+    if (!bundle)
     {
-        postUrl = "http://" + postUrl.substring(8);
+        logError(LOG_TLS, "No CA bundle in %s, HTTPS refused", TLS_CA_BUNDLE_FILE);
+        return false;
     }
-    return postUrl;
+    secure.setCACert(bundle);
+    return http.begin(secure, url);
 }
+#endif
 
 void saveFirmwareVersion()
 {
@@ -85,37 +128,16 @@ void loadFirmwareVersion()
     LittleFS.end();
 }
 
-void sendPostRequest()
-{
-    if (strlen(config.post_url) == 0 || WiFi.status() != WL_CONNECTED)
-        return;
-    String postUrl = http_url(config.post_url);
-    HTTPClient http;
-    http.setTimeout(10000);
-    if (!http.begin(postUrl.c_str()))
-        return;
-    DynamicJsonDocument doc(512);
-    doc["uid"] = config.uid;
-    JsonArray items = doc.createNestedArray("items");
-    items.createNestedObject()["name"] = "rssi";
-    items[0]["value"] = String(WiFi.RSSI());
-    items.createNestedObject()["name"] = "vcc";
-    items[1]["value"] = String(currentVcc, 2);
-    String json;
-    serializeJson(doc, json);
-    http.addHeader("Content-Type", "application/json");
-    int code = http.POST(json);
-    http.end();
-}
-
+#if FEATURE_OTA
 void sendOtaResult(const String &status, const String &oldVersion = "", const String &newVersion = "", int errorCode = 0, const String &errorMessage = "")
 {
     if (WiFi.status() != WL_CONNECTED || strlen(config.uid) == 0 || strlen(config.ota_result_url) == 0)
         return;
-    String postUrl = http_url(config.ota_result_url);
+    WiFiClientSecure secure;
+    WiFiClient plain;
     HTTPClient http;
     http.setTimeout(10000);
-    if (!http.begin(postUrl.c_str()))
+    if (!beginHttp(http, secure, plain, config.ota_result_url))
         return;
     DynamicJsonDocument doc(512);
     doc["uid"] = config.uid;
@@ -174,10 +196,12 @@ String checkFirmwareVersion()
 {
     if (strlen(config.uid) == 0 || strlen(config.ota_url) == 0)
         return "";
-    String checkUrl = http_url(config.ota_url) + "?uid=" + String(config.uid) + "&check_version=true";
+    String checkUrl = String(config.ota_url) + "?uid=" + String(config.uid) + "&check_version=true";
+    WiFiClientSecure secure;
+    WiFiClient plain;
     HTTPClient http;
     http.setTimeout(10000);
-    if (!http.begin(checkUrl.c_str()))
+    if (!beginHttp(http, secure, plain, checkUrl))
         return "";
     int code = http.GET();
     String response = (code == 200) ? http.getString() : "";
@@ -200,12 +224,13 @@ bool performOTAUpdate(const String &newVersion)
 {
     if (strlen(config.uid) == 0 || strlen(config.ota_url) == 0)
         return false;
-    String firmwareUrl = http_url(config.ota_url) + "?uid=" + String(config.uid) +
+    String firmwareUrl = String(config.ota_url) + "?uid=" + String(config.uid) +
                          "&current_version=" + CURRENT_FIRMWARE_VERSION + "&check_version=false";
-    WiFiClient client;
+    WiFiClientSecure secure;
+    WiFiClient plain;
     HTTPClient http;
     http.setTimeout(15000);
-    if (!http.begin(client, firmwareUrl.c_str()))
+    if (!beginHttp(http, secure, plain, firmwareUrl))
         return false;
     int code = http.GET();
     if (code != 200)
@@ -245,82 +270,202 @@ bool performOTAUpdate(const String &newVersion)
         CURRENT_FIRMWARE_VERSION = newVersion;
         saveFirmwareVersion();
         delay(2000);
+        logDrain();
         ESP.restart();
         return true;
     }
     return false;
 }
+#endif
+
+// HTTP — в задаче SinkTask, если она запущена (sink_esp32.cpp)
+bool httpSinkTask = false;
 
-void setupWifi()
+// Очереди приёмников, обслуживаемых задачей измерения: отправка и повторы после восстановления связи
+void serveSinks()
 {
-    if (strlen(config.ssid) == 0 || strlen(config.password) == 0)
-    {
-        String mac = WiFi.macAddress();
-        mac.replace(":", "");
-        String apName = "Sensor_" + mac;
-        WiFi.softAP(apName.c_str());
-        forcedApMode = true;
-        apStartTime = millis();
-        wifiConnected = false;
-        return;
-    }
+    sinkServe(SINK_MQTT);
+    sinkServe(SINK_UDP);
+    if (!httpSinkTask)
+        sinkServe(SINK_HTTP);
+}
 
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(config.ssid, config.password);
-    int attempt = 0;
-    while (attempt < 5 && WiFi.status() != WL_CONNECTED)
+// Ожидание дедлайна; соединение MQTT (keepalive, входящие) обслуживается не реже MQTT_LOOP_PERIOD_MS,
+// попытка переподключения — в свой срок (mqttServiceWaitMs), очередь шлюза ESP-NOW — раз в GATEWAY_POLL_MS
+void delayUntilServingMqtt(TickType_t &lastWake, uint32_t incrementMs)
+{
+    TickType_t deadline = lastWake + pdMS_TO_TICKS(incrementMs);
+    while (true)
     {
-        delay(2000);
-        attempt++;
+        uint32_t sliceMs = MQTT_LOOP_PERIOD_MS;
+        if (config.espnow_mode == ESPNOW_GATEWAY)
+            sliceMs = GATEWAY_POLL_MS;
+        else if (wifiIsConnected())
+            sliceMs = mqttServiceWaitMs();
+        if ((int32_t)(deadline - xTaskGetTickCount()) <= (int32_t)pdMS_TO_TICKS(sliceMs))
+            break;
+        vTaskDelay(pdMS_TO_TICKS(sliceMs));
+        if (wifiIsConnected())
+        {
+            handleMqtt();
+            serveSinks();
+        }
+        serveGateway();
     }
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(incrementMs));
+}
+
+// Время от старта до готовности (или до сна) и состав сборки — для сравнения окружений platformio.ini
+void logBootTime(const char *stage)
+{
+    logInfo(LOG_BOOT, "%s in %lu ms (web %d, mqtt %d, http %d, ota %d; dht22 %d, bmp180 %d, sht3x %d)", stage,
+            millis(), FEATURE_WEB, FEATURE_MQTT, FEATURE_HTTP_POST, FEATURE_OTA, FEATURE_DHT22, FEATURE_BMP180,
+            FEATURE_SHT3X);
+}
 
-    if (WiFi.status() == WL_CONNECTED)
+// Адаптивный интервал глубокого сна по только что снятым показаниям
+void updateSleepSchedule(const SensorReading &reading)
+{
+    if (!config.adaptive_interval)
+        return;
+    if (!schedulerInitialized)
     {
-        wifiConnected = true;
-        forcedApMode = false;
+        schedulerReset(sampleScheduler, DEEP_SLEEP_BASE_MS);
+        schedulerInitialized = true;
     }
-    else
+    // Прошедшее время ≈ длительность предыдущего сна
+    ScheduleLimits limits = {config.sleep_min * 1000, DEEP_SLEEP_BASE_MS, config.sleep_max * 1000};
+    schedulerUpdate(sampleScheduler, limits, sampleScheduler.intervalMs,
+                    sampleTemperature(reading), sampleHumidity(reading), samplePressure(reading), sampleVcc(reading));
+}
+
+// Узел ESP-NOW: кадр шлюзу вместо Wi-Fi + MQTT; повторы с тем же номером — широковещание без подтверждений
+bool sendEspNowReading(const SensorReading &reading)
+{
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    size_t len = encodeNodeFrame(frame, sizeof(frame), ++espNowSeq, reading);
+    unsigned long start = micros();
+    if (!halRadioBegin(config.espnow_channel, nullptr))
     {
-        String mac = WiFi.macAddress();
-        mac.replace(":", "");
-        String apName = "Sensor_" + mac;
-        WiFi.softAP(apName.c_str());
-        forcedApMode = true;
-        apStartTime = millis();
-        wifiConnected = false;
+        logError(LOG_ESPNOW, "Init failed");
+        return false;
     }
+    uint8_t sent = 0;
+    for (uint8_t i = 0; i < ESPNOW_NODE_REPEATS; i++)
+        sent += halRadioSend(frame, len);
+    halRadioEnd();
+    logInfo(LOG_ESPNOW, "seq %u: %u/%u frames on channel %u in %lu us", espNowSeq, sent, ESPNOW_NODE_REPEATS,
+            config.espnow_channel, micros() - start);
+    return sent > 0;
+}
+
+// Шлюз ESP-NOW: разбор принятых кадров и пересылка через приёмники (из задачи, владеющей MQTT)
+void serveGateway()
+{
+    if (config.espnow_mode != ESPNOW_GATEWAY || !wifiIsConnected())
+        return;
+    gatewayPoll(millis(), timeNowMs());
+    if (gatewayForward())
+        serveSinks(); // HTTP разбудит свою задачу сам
+}
+
+// Выравнивание по часам (publish_slot.h): нужна синхронизация SNTP, темп адаптивного режима — свой
+bool alignedPublishing()
+{
+    return config.align_interval && !config.adaptive_interval && timeBase.synced && config.publishingInterval > 0;
 }
 
 // === ЗАДАЧА 1: Чтение датчиков и отправка данных ===
 void sensorTask(void *parameter)
 {
+    unsigned long lastSampleTime = millis();
+    schedulerReset(sampleScheduler, config.publishingInterval);
+    uint8_t mac[6];
+    halMacAddress(mac);
+
+    // Абсолютные дедлайны: период не растягивается на время измерения и отправки
+    TickType_t lastWake = xTaskGetTickCount();
+    if (alignedPublishing())
+        delayUntilServingMqtt(lastWake, alignedWaitMs(timeNowMs(), config.publishingInterval)); // первое — на границе
+    taskTimingBegin(sensorTaskTiming, "sensor", TASK_OVERRUN_SKIP, millis());
+
     while (true)
     {
-        if (wifiConnected)
+        taskTimingStart(sensorTaskTiming, millis(), micros());
+        powerBusyBegin();
+        unsigned long interval = config.publishingInterval;
+        bool aligned = alignedPublishing();
+
+        if (wifiIsConnected())
         {
-            if (xSemaphoreTake(sensorMutex, portMAX_DELAY) == pdTRUE)
+            // Показание публикуется снимком: веб и остальные читатели не блокируют измерение
+            readSensors();
+            SensorReading reading = latestReading();
+            historyAppend(reading); // до отправки: при недоступном сервере показание остаётся во флеше
+
+            if (config.adaptive_interval)
             {
-                readSensors();
-                float temp = currentTemp;
-                float hum = currentHumidity;
-                float pres = currentPressure;
-                xSemaphoreGive(sensorMutex);
-
-                publishSensorData(temp, hum, pres);
-                sendPostRequest();
+                unsigned long now = millis();
+                ScheduleLimits limits = {config.interval_min, config.publishingInterval, config.interval_max};
+                interval = schedulerUpdate(sampleScheduler, limits, now - lastSampleTime,
+                                           sampleTemperature(reading), sampleHumidity(reading),
+                                           samplePressure(reading), sampleVcc(reading));
+                lastSampleTime = now;
+                logDebug(LOG_SCHED, "Next sample in %lu ms (%s, activity %.2f)",
+                         interval, scheduleLevelName(sampleScheduler.level), sampleScheduler.activity);
             }
+
+#if FEATURE_WEB
+            // Однократное сравнение форматов для выбора на странице настроек
+            static bool payloadMeasured = false;
+            if (!payloadMeasured)
+            {
+                char baseTopic[MQTT_TOPIC_SIZE];
+                measurePayloadEncodings(generateMqttBaseTopic(baseTopic, sizeof(baseTopic)), config.uid, WiFi.RSSI(),
+                                        reading);
+                payloadMeasured = true;
+            }
+#endif
+
+            if (aligned)
+            {
+                // Измерение — на границе, отправка — в слоте узла; пока ждём, MQTT обслуживается
+                uint32_t elapsed = millis() - sensorTaskTiming.deadlineMs;
+                uint32_t slot = publishSlotOffsetMs(mac, interval);
+                if (elapsed < slot)
+                {
+                    TickType_t slotWake = xTaskGetTickCount();
+                    delayUntilServingMqtt(slotWake, slot - elapsed);
+                }
+            }
+
+            sinkPublish(reading); // в очереди приёмников: медленный не задерживает остальные
+            serveSinks();
+            serveGateway();
         }
 
-        vTaskDelay(config.publishingInterval / portTICK_PERIOD_MS);
+        // Следующий дедлайн — на ближайшей границе по часам: уход локальных часов не накапливается
+        if (aligned)
+            interval = millis() + alignedWaitMs(timeNowMs(), interval) - sensorTaskTiming.deadlineMs;
+        uint32_t increment = taskTimingEnd(sensorTaskTiming, interval, millis(), micros());
+        powerBusyEnd(); // до следующего измерения — light sleep
+        delayUntilServingMqtt(lastWake, increment);
     }
 }
 
-// === ЗАДАЧА 2: OTA и управление Wi-Fi ===
+// === ЗАДАЧА 2: OTA и синхронизация времени ===
 void systemTask(void *parameter)
 {
+    TickType_t lastWake = xTaskGetTickCount();
+    taskTimingBegin(systemTaskTiming, "system", TASK_OVERRUN_SKIP, millis());
+
     while (true)
     {
-        if (wifiConnected && (millis() - lastOtaCheck > OTA_CHECK_INTERVAL))
+        taskTimingStart(systemTaskTiming, millis(), micros());
+        powerBusyBegin();
+
+#if FEATURE_OTA
+        if (wifiIsConnected() && (millis() - lastOtaCheck > OTA_CHECK_INTERVAL))
         {
             lastOtaCheck = millis();
             String response = checkFirmwareVersion();
@@ -333,18 +478,16 @@ void systemTask(void *parameter)
                 }
             }
         }
+#endif
 
-        if (forcedApMode &&
-            strlen(config.ssid) > 0 &&
-            strlen(config.password) > 0 &&
-            (millis() - apStartTime > AP_RETRY_DELAY))
+        if (wifiIsConnected() && timeSyncDue())
         {
-            forcedApMode = false;
-            setupWifi();
-            wifiConnected = (WiFi.status() == WL_CONNECTED);
+            timeSync(SNTP_SERVER);
         }
 
-        vTaskDelay(10000 / portTICK_PERIOD_MS);
+        uint32_t increment = taskTimingEnd(systemTaskTiming, SYSTEM_TASK_PERIOD_MS, millis(), micros());
+        powerBusyEnd();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(increment));
     }
 }
 
@@ -364,7 +507,7 @@ void setup()
     if (digitalRead(sleep_on) == LOW)
     {
         Serial.begin(115200);
-        Serial.println("\n\n[DEEP SLEEP MODE] GPIO23 grounded");
+        logInfo(LOG_BOOT, "Deep sleep mode: GPIO23 grounded");
 
         if (LittleFS.begin(FORMAT_LITTLEFS_IF_FAILED))
         {
@@ -372,26 +515,63 @@ void setup()
             LittleFS.end();
         }
 
-        // Подключаемся к Wi-Fi
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(config.ssid, config.password);
-        int wifiAttempts = 0;
-        while (WiFi.status() != WL_CONNECTED && wifiAttempts++ < 20) // 20 сек
+        // История ULP за прошедший сон (до ulpStart(), который её сбрасывает)
+        UlpHistory ulpHistory;
+        bool haveUlpHistory = false;
+        esp_sleep_wakeup_cause_t wakeCause = esp_sleep_get_wakeup_cause();
+        if (ulpArmed && (wakeCause == ESP_SLEEP_WAKEUP_ULP || wakeCause == ESP_SLEEP_WAKEUP_TIMER))
         {
-            delay(1000);
+            haveUlpHistory = ulpReadHistory(ulpData(), ulpHistory) && ulpHistory.count > 0;
+            logInfo(LOG_ULP, "Woken by %s, %u samples",
+                    wakeCause == ESP_SLEEP_WAKEUP_ULP ? ulpWakeReasonName(ulpHistory.reason) : "timer",
+                    haveUlpHistory ? ulpHistory.count : 0);
+        }
+        ulpArmed = false;
+
+        // Подключаемся к Wi-Fi (узлу ESP-NOW ассоциация с AP не нужна)
+        bool espNowNode = config.espnow_mode == ESPNOW_NODE;
+        if (!espNowNode)
+        {
+            WiFi.mode(WIFI_STA);
+            WiFi.begin(config.ssid, config.password);
+            int wifiAttempts = 0;
+            while (WiFi.status() != WL_CONNECTED && wifiAttempts++ < 20) // 20 сек
+            {
+                delay(1000);
+            }
         }
 
         float vcc_for_sleep = 3.3f;
         bool dataSent = false;
 
-        if (WiFi.status() == WL_CONNECTED)
+        if (espNowNode)
+        {
+            initSensors();
+            readSensors();
+            SensorReading reading = latestReading();
+            historyAppend(reading);
+            if (reading.flags & SAMPLE_VCC)
+                vcc_for_sleep = sampleVcc(reading);
+            updateSleepSchedule(reading);
+            dataSent = sendEspNowReading(reading);
+        }
+        else if (WiFi.status() == WL_CONNECTED)
         {
-            Serial.println("✓ Wi-Fi connected");
+            logInfo(LOG_WIFI, "Connected");
+
+            // Между синхронизациями время ведут часы RTC с поправкой на уход
+            if (timeSyncDue())
+                timeSync(SNTP_SERVER);
 
             initSensors();
             readSensors();
-            vcc_for_sleep = currentVcc;
+            SensorReading reading = latestReading();
+            historyAppend(reading);
+            if (reading.flags & SAMPLE_VCC)
+                vcc_for_sleep = sampleVcc(reading);
+            updateSleepSchedule(reading);
 
+#if FEATURE_MQTT
             // Инициализируем MQTT
             initMqtt();
 
@@ -400,10 +580,12 @@ void setup()
             while (mqttAttempts < 10)
             {
                 reconnectMqtt(); // ваша функция
-                if (mqttClient.connected())
+                if (isMqttConnected())
                 {
-                    publishSensorData(currentTemp, currentHumidity, currentPressure);
-                    sendPostRequest();
+                    sinkPublish(reading);
+                    sinkServeAll(); // без задачи SinkTask: до сна всё отправляется здесь
+                    if (haveUlpHistory)
+                        publishUlpHistory(ulpHistory, ulpStartMs);
                     dataSent = true;
                     break;
                 }
@@ -413,46 +595,90 @@ void setup()
 
             if (!dataSent)
             {
-                Serial.println("✗ MQTT failed after retries");
+                logError(LOG_MQTT, "Failed after retries");
             }
+#else
+            sinkPublish(reading);
+            sinkServeAll();
+            dataSent = sinks[SINK_HTTP].stats.sent + sinks[SINK_UDP].stats.sent > 0;
+#endif
         }
 
         WiFi.disconnect(true);
         WiFi.mode(WIFI_OFF);
         delay(100);
 
-        uint64_t sleep_us = 5ULL * 60 * 1000000;
-        if (vcc_for_sleep < 2.7f)
+        uint64_t sleep_us = DEEP_SLEEP_BASE_MS * 1000ULL;
+        if (config.adaptive_interval && schedulerInitialized)
+        {
+            sleep_us = sampleScheduler.intervalMs * 1000ULL;
+            logInfo(LOG_SCHED, "%s, activity %.2f",
+                    scheduleLevelName(sampleScheduler.level), sampleScheduler.activity);
+        }
+        else if (vcc_for_sleep < 2.7f)
             sleep_us = 3600ULL * 1000000;
         else if (vcc_for_sleep < 2.8f)
             sleep_us = 1800ULL * 1000000;
 
-        Serial.printf("Going to deep sleep for %.1f min...\n", sleep_us / 60e6);
+        // Режим ULP: таймер — только страховка на макс. сон, будит выход напряжения из окна
+        if (config.ulp_wake)
+        {
+            uint16_t lastRaw = (uint16_t)halReadBatteryRaw(); // до adc1_ulp_enable()
+            ulpStartMs = timeNowMs();
+            ulpArmed = ulpStart(lastRaw);
+            if (ulpArmed)
+                sleep_us = config.sleep_max * 1000000ULL;
+        }
+
+        logBootTime("Awake");
+        logInfo(LOG_POWER, "Going to deep sleep for %.1f min%s", sleep_us / 60e6, dataSent ? "" : " (reading not sent)");
         esp_deep_sleep(sleep_us);
     }
 
     // === ОБЫЧНЫЙ РЕЖИМ ===
     Serial.begin(115200);
-    Serial.println("\n\n[Normal Mode]");
+    logBegin(); // дальше журнал выводит задача низкого приоритета
+    logInfo(LOG_BOOT, "Normal mode");
+#if FEATURE_TRACE
+    traceStart();
+#endif
 
     if (!LittleFS.begin(FORMAT_LITTLEFS_IF_FAILED))
     {
-        Serial.println("[FS] LittleFS Mount Failed");
+        logError(LOG_FS, "LittleFS Mount Failed");
     }
 
     loadFirmwareVersion();
     loadConfig();
+#if FEATURE_OTA
     checkAndReportPendingOta();
+#endif
 
-    setupWifi();
-    wifiConnected = (WiFi.status() == WL_CONNECTED);
+    powerBegin(config.low_power);
+    // Подключение и переподключение — в фоне (wifi_manager.h); ждём только первое
+    wifiBegin();
+    bool wifiConnected = wifiWaitConnected(WIFI_BOOT_WAIT_MS);
+    if (wifiConnected)
+    {
+        timeSync(SNTP_SERVER); // метки времени — с первого измерения
+    }
 
     initSensors();
     initMqtt();
+    httpSinkTask = sinkStart();
+#if FEATURE_WEB
     initWebServer();
+#endif
 
-    // Создаём семафор
-    sensorMutex = xSemaphoreCreateMutex();
+    // Шлюз слушает на канале своего AP — этот канал задаётся узлам
+    if (config.espnow_mode == ESPNOW_GATEWAY && wifiConnected)
+    {
+        gatewayReset();
+        if (halRadioBegin(0, gatewayReceive))
+            logInfo(LOG_ESPNOW, "Gateway listening on channel %d", WiFi.channel());
+        else
+            logError(LOG_ESPNOW, "Gateway init failed");
+    }
 
     // Запускаем задачи
     xTaskCreate(
@@ -472,7 +698,8 @@ void setup()
         1,
         NULL);
 
-    Serial.println("✓ RTOS tasks started");
+    logInfo(LOG_TASK, "RTOS tasks started");
+    logBootTime("Ready");
 }
 
 void loop() { vTaskDelay(portMAX_DELAY); }
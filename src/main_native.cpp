@@ -0,0 +1,277 @@
+// main_native.cpp — симуляция узла на Linux ([env:native])
+// Запуск: .pio/build/native/program -m localhost:1883 -p http://localhost:8080/api -i 10000 -n 10
+#include "config.h"
+#include "sensors.h"
+#include "mqtt.h"
+#include "post.h"
+#include "payload.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "task_timing.h"
+#include "sensor_registry.h"
+#include "ulp.h"
+#include "https.h"
+#include "history.h"
+#include "hal.h"
+#include "log.h"
+#include "trace.h"
+#include "sink.h"
+#include "hal_native.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+// Область данных ULP (на плате — RTC_SLOW_MEM)
+static uint32_t ulpMemory[ULP_DATA_WORDS];
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-m host[:port]] [-p post_url] [-i interval_ms] [-n cycles] [-f 0|1] [-a]\n"
+           "          [-t ntp_server] [-d clock_drift_ppm] [-u discharge_mv_per_min] [-c ca_bundle.pem]\n"
+           "          [-l influx_host[:port]] [-T trace.bin]\n", name);
+}
+
+/**
+ * @brief Глубокий сон с ULP: эталонная модель программы на разряжающейся батарее
+ * до пробуждения по порогу, заполнению истории или таймеру (макс. сон)
+ * @return длительность сна, с
+ */
+static uint32_t simulateUlpSleep(float &volts, float dischargeMvPerMin, UlpHistory &history)
+{
+    ulpArm(ulpMemory, (uint16_t)halReadBatteryRaw());
+    uint32_t maxSteps = config.sleep_max / ULP_SAMPLE_PERIOD_S;
+    uint32_t steps = 0;
+    uint8_t reason = ULP_WAKE_NONE;
+    while (reason == ULP_WAKE_NONE && steps < maxSteps)
+    {
+        // Первый запуск ULP — сразу при ulp_run(), следующие — через период
+        reason = ulpStep(ulpMemory, (uint16_t)halReadBatteryRaw());
+        volts -= dischargeMvPerMin * ULP_SAMPLE_PERIOD_S / 60 / 1000;
+        halSimSetBatteryVoltage(volts);
+        steps++;
+    }
+    if (!ulpReadHistory(ulpMemory, history))
+        history.count = 0;
+    return steps * ULP_SAMPLE_PERIOD_S;
+}
+
+/**
+ * @brief Пакет корневых сертификатов с диска — в файловую систему узла (на плате — LittleFS)
+ */
+static bool loadCaBundle(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    static char pem[TLS_CA_BUNDLE_MAX];
+    size_t len = fread(pem, 1, sizeof(pem), file);
+    fclose(file);
+    return len > 0 && halFsWrite(TLS_CA_BUNDLE_FILE, pem, len);
+}
+
+#if FEATURE_TRACE
+/**
+ * @brief Двоичный образ трассы в файл, как /api/trace.bin на плате (перевод — [env:native_trace])
+ */
+static bool writeTrace(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+    static TraceImage image;
+    static TraceStream stream;
+    traceSetEnabled(false);
+    traceSnapshot(image);
+    traceStreamBegin(stream, image, false);
+    uint8_t buf[512];
+    size_t len;
+    bool ok = true;
+    while ((len = traceStreamRead(stream, buf, sizeof(buf))) > 0)
+        ok = ok && fwrite(buf, 1, len, file) == len;
+    ok = fclose(file) == 0 && ok;
+    logInfo(LOG_SIM, "Trace: %lu events, %lu lost -> %s", (unsigned long)image.count, (unsigned long)image.lost, path);
+    return ok;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    long cycles = 0; // 0 — бесконечно
+    char mqttServer[64] = "";
+    int mqttPort = 1883;
+    char postUrl[64] = "";
+    unsigned long interval = 10000;
+    int format = PAYLOAD_TEXT;
+    bool adaptive = false;
+    char ntpServer[64] = "";
+    float ulpDischarge = 0; // мВ/мин; 0 — без симуляции сна
+    const char *tracePath = nullptr;
+    char influxHost[64] = "";
+    int influxPort = INFLUX_UDP_PORT;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:p:i:n:f:at:d:u:c:l:T:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+        {
+            strlcpy(mqttServer, optarg, sizeof(mqttServer));
+            char *colon = strchr(mqttServer, ':');
+            if (colon)
+            {
+                *colon = '\0';
+                mqttPort = atoi(colon + 1);
+            }
+            break;
+        }
+        case 'p':
+            strlcpy(postUrl, optarg, sizeof(postUrl));
+            break;
+        case 'i':
+            interval = strtoul(optarg, nullptr, 10);
+            break;
+        case 'n':
+            cycles = atol(optarg);
+            break;
+        case 'f':
+            format = atoi(optarg);
+            break;
+        case 'a':
+            adaptive = true;
+            break;
+        case 't':
+            strlcpy(ntpServer, optarg, sizeof(ntpServer));
+            break;
+        case 'd':
+            halSimSetClockDrift((float)atof(optarg));
+            break;
+        case 'u':
+            ulpDischarge = (float)atof(optarg);
+            break;
+        case 'c':
+            if (!loadCaBundle(optarg))
+            {
+                fprintf(stderr, "Cannot read %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'l':
+        {
+            strlcpy(influxHost, optarg, sizeof(influxHost));
+            char *colon = strchr(influxHost, ':');
+            if (colon)
+            {
+                *colon = '\0';
+                influxPort = atoi(colon + 1);
+            }
+            break;
+        }
+        case 'T':
+            tracePath = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    // Конфигурация проходит через saveConfig()/loadConfig() и файловую систему в памяти
+    loadConfig();
+    strlcpy(config.mqtt_server, mqttServer, sizeof(config.mqtt_server));
+    config.mqtt_port = mqttPort;
+    strlcpy(config.post_url, postUrl, sizeof(config.post_url));
+    strlcpy(config.influx_host, influxHost, sizeof(config.influx_host));
+    config.influx_port = (uint16_t)influxPort;
+    strlcpy(config.uid, "native", sizeof(config.uid));
+    config.publishingInterval = interval;
+    config.payload_format = (uint8_t)format;
+    config.adaptive_interval = adaptive;
+    config.ulp_wake = ulpDischarge > 0;
+    saveConfig();
+    loadConfig();
+
+    initSensors();
+    initMqtt();
+    reconnectMqtt(); // дальше соединение поддерживает handleMqtt()
+    schedulerReset(sampleScheduler, config.publishingInterval);
+
+    uint32_t lastSampleTime = halMillis();
+    float batteryVolts = 3.3f;
+    UlpHistory ulpHistory = {};
+    uint64_t ulpStartMs = 0;
+    taskTimingBegin(sensorTaskTiming, "sensor", TASK_OVERRUN_SKIP, halMillis());
+    for (long cycle = 0; cycles == 0 || cycle < cycles; cycle++)
+    {
+        taskTimingStart(sensorTaskTiming, halMillis(), halMicros());
+        if (ntpServer[0] != '\0' && timeSyncDue())
+            timeSync(ntpServer);
+        readSensors();
+        SensorReading reading = latestReading();
+        historyAppend(reading);
+        unsigned long next = config.publishingInterval;
+        if (config.adaptive_interval)
+        {
+            uint32_t now = halMillis();
+            ScheduleLimits limits = {config.interval_min, config.publishingInterval, config.interval_max};
+            next = schedulerUpdate(sampleScheduler, limits, now - lastSampleTime,
+                                   sampleTemperature(reading), sampleHumidity(reading),
+                                   samplePressure(reading), sampleVcc(reading));
+            lastSampleTime = now;
+        }
+
+        logInfo(LOG_SIM, "T=%.1f H=%.1f P=%.1f VCC=%.2f flags=0x%02x ts=%llu sensors=%lu ms next=%lu ms",
+                sampleTemperature(reading), sampleHumidity(reading), samplePressure(reading), sampleVcc(reading), reading.flags,
+                (unsigned long long)reading.timestamp,
+                (unsigned long)sensorCycleMs, next);
+        sinkPublish(reading);
+        sinkServeAll(); // однопоточно: HTTP тоже отсюда (на плате — задача SinkTask)
+        if (ulpHistory.count > 0)
+            publishUlpHistory(ulpHistory, ulpStartMs);
+        handleMqtt();
+
+        taskTimingEnd(sensorTaskTiming, next, halMillis(), halMicros());
+        if (ulpDischarge > 0)
+        {
+            // Сон проходит мгновенно: шаги модели ULP вместо ожидания; пробуждение — как перезагрузка
+            ulpStartMs = timeNowMs();
+            uint32_t slept = simulateUlpSleep(batteryVolts, ulpDischarge, ulpHistory);
+            logInfo(LOG_SIM, "ULP sleep %lu s, wake: %s, %u samples, VCC=%.3f", (unsigned long)slept,
+                    ulpWakeReasonName(ulpHistory.reason), ulpHistory.count, batteryVolts);
+            sinksReset();
+            historyReset();
+        }
+        else if (cycles == 0 || cycle + 1 < cycles)
+            halDelay(taskTimingWaitMs(sensorTaskTiming, halMillis()));
+    }
+    if (historyStats.appended > 0)
+        logInfo(LOG_SIM, "History: %lu appended, %lu blocks today, %lu queries, %lu rows served",
+                (unsigned long)historyStats.appended, (unsigned long)historyBlockCount(),
+                (unsigned long)historyStats.queries, (unsigned long)historyStats.rowsServed);
+    if (tlsStats.fullHandshakes + tlsStats.resumedHandshakes + tlsStats.failures > 0)
+        logInfo(LOG_SIM, "TLS: %lu full (max %lu ms), %lu resumed (max %lu ms), %lu failed, peak heap %lu B",
+                (unsigned long)tlsStats.fullHandshakes, (unsigned long)(tlsStats.maxFullUs / 1000),
+                (unsigned long)tlsStats.resumedHandshakes, (unsigned long)(tlsStats.maxResumedUs / 1000),
+                (unsigned long)tlsStats.failures, (unsigned long)tlsStats.peakHeapBytes);
+    for (uint8_t i = 0; i < SINK_COUNT; i++)
+    {
+        const SinkStats &stats = sinks[i].stats;
+        if (stats.queued + stats.limited + stats.dropped > 0)
+            logInfo(LOG_SIM, "Sink %s: %lu sent, %lu failed, %lu pending, %lu dropped, %lu limited, max %lu us",
+                    sinkName(i), (unsigned long)stats.sent, (unsigned long)stats.failed,
+                    (unsigned long)sinkPending(i), (unsigned long)stats.dropped, (unsigned long)stats.limited,
+                    (unsigned long)stats.maxUs);
+    }
+#if FEATURE_TRACE
+    if (tracePath && !writeTrace(tracePath))
+    {
+        fprintf(stderr, "Cannot write %s\n", tracePath);
+        return 1;
+    }
+#endif
+    return 0;
+}
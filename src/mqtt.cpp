@@ -1,24 +1,60 @@
 #include "mqtt.h"
 #include "config.h"
 #include "sensors.h"
-#include <ArduinoJson.h>
+#include "payload.h"
+#include "scheduler.h"
+#include "ulp.h"
+#include "espnow.h"
+#include "history.h"
+#include "hal.h"
+#include "log.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
 
-// Глобальные переменные
-WiFiClient espClient;
-PubSubClient mqttClient(espClient);
+// Время и пауза переподключения
+MqttSession mqttSession = {0, 0, 0};
 
-// Флаг первой публикации
-bool firstPublish = true;
-unsigned long lastPublishTime = 0;
+#if FEATURE_MQTT // без MQTT остаётся только состояние сессии (его сбрасывает main_native)
+
+// Запросы истории из колбэка halMqttLoop() — отвечаем после него, вне буфера клиента
+#define HISTORY_REQUEST_QUEUE 4
+
+struct HistoryRequest {
+    HistoryQuery query;
+    bool valid;
+};
+
+static HistoryRequest historyRequests[HISTORY_REQUEST_QUEUE];
+static uint8_t historyRequestCount = 0;
+static HistoryStream historyResponse; // ответы по одному; ~700 байт вне стека задачи
+
+#define LOG_MQTT_BATCH 8 // строк журнала за вызов handleMqtt()
+static uint32_t logNextLine = 0; // следующая строка истории журнала для <base>/log
+
+/**
+ * @brief Базовый топик узла по его MAC-адресу (свой или пересылаемого шлюзом)
+ */
+static size_t formatMqttBaseTopic(char *buf, size_t size, const uint8_t mac[6]) {
+    int len = snprintf(buf, size, "/iot/%02x%02x%02x%02x%02x%02x/sensors",
+                       mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return len > 0 ? (size_t)len : 0;
+}
 
 /**
  * @brief Генерация базового топика MQTT на основе MAC-адреса
  */
-String generateMqttBaseTopic() {
-    String mac = WiFi.macAddress();
-    mac.replace(":", "");
-    mac.toLowerCase();
-    return "/iot/" + mac + "/sensors";
+size_t generateMqttBaseTopic(char *buf, size_t size) {
+    uint8_t mac[6];
+    halMacAddress(mac);
+    return formatMqttBaseTopic(buf, size, mac);
+}
+
+/**
+ * @brief Состояние соединения с брокером
+ */
+bool isMqttConnected() {
+    return halMqttConnected();
 }
 
 /**
@@ -29,20 +65,72 @@ bool isMqttConfigured() {
            config.mqtt_port > 0;
 }
 
+static bool topicEndsWith(const char *topic, const char *suffix) {
+    size_t topicLen = strlen(topic), suffixLen = strlen(suffix);
+    return topicLen >= suffixLen && strcmp(topic + topicLen - suffixLen, suffix) == 0;
+}
+
+/**
+ * @brief Уровни журнала из <base>/log/set: "mqtt=debug", через запятую — несколько (logApplySetting)
+ */
+static void applyLogSettings(const char *payload, size_t len) {
+    size_t start = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i < len && payload[i] != ',')
+            continue;
+        if (i > start && !logApplySetting(payload + start, i - start))
+            logWarn(LOG_MQTT, "Bad log setting");
+        start = i + 1;
+    }
+}
+
+/**
+ * @brief Входящее сообщение: запрос истории в <base>/history/get ("from=..&to=..&limit=..&id=..")
+ *        или уровни журнала в <base>/log/set
+ */
+static void onMqttMessage(const char *topic, const uint8_t *payload, size_t len) {
+    if (topicEndsWith(topic, "/log/set")) {
+        applyLogSettings((const char *)payload, len);
+        return;
+    }
+    if (!topicEndsWith(topic, "/history/get"))
+        return;
+    if (historyRequestCount == HISTORY_REQUEST_QUEUE) {
+        logWarn(LOG_MQTT, "History request dropped, queue full");
+        return;
+    }
+    HistoryRequest &request = historyRequests[historyRequestCount++];
+    request.valid = historyParseQuery((const char *)payload, len, request.query);
+}
+
+/**
+ * @brief Пауза до следующей попытки: удвоение с «равным» дрожанием — не меньше половины
+ */
+static uint32_t reconnectBackoffMs(uint8_t failures) {
+    uint32_t base = MQTT_RECONNECT_MAX_MS;
+    if (failures <= 5 && (MQTT_RECONNECT_MIN_MS << (failures - 1)) < MQTT_RECONNECT_MAX_MS)
+        base = MQTT_RECONNECT_MIN_MS << (failures - 1);
+    return base / 2 + halRandom() % (base / 2 + 1);
+}
+
 /**
  * @brief Инициализация MQTT клиента
  */
 void initMqtt() {
     if (!isMqttConfigured()) {
-        Serial.println("[MQTT] Configuration incomplete, MQTT disabled");
+        logWarn(LOG_MQTT, "Configuration incomplete, MQTT disabled");
         return;
     }
     
-    mqttClient.setServer(config.mqtt_server, config.mqtt_port);
-    mqttClient.setBufferSize(256);
+    halMqttBegin(config.mqtt_server, config.mqtt_port);
+    halMqttOnMessage(onMqttMessage);
+    // Первое подключение из handleMqtt() — не сразу: после общего отключения питания узлы стартуют вместе
+    mqttSession.lastReconnectAttempt = halMillis();
+    mqttSession.reconnectDelayMs = halRandom() % MQTT_RECONNECT_MIN_MS;
+    mqttSession.reconnectFailures = 0;
     
-    Serial.println("[MQTT] Client initialized");
-    Serial.printf("[MQTT] Server: %s:%d\n", config.mqtt_server, config.mqtt_port);
+    logInfo(LOG_MQTT, "Client initialized");
+    logInfo(LOG_MQTT, "Server: %s:%d", config.mqtt_server, config.mqtt_port);
 }
 
 /**
@@ -52,90 +140,240 @@ void reconnectMqtt() {
     if (!isMqttConfigured())
         return;
         
-    if (mqttClient.connected())
+    if (halMqttConnected())
         return;
     
-    String clientId = "esp32_" + WiFi.macAddress();
-    clientId.replace(":", "");
+    uint8_t mac[6];
+    halMacAddress(mac);
+    char clientId[24];
+    snprintf(clientId, sizeof(clientId), "esp32_%02X%02X%02X%02X%02X%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     
     bool connected = false;
+    mqttSession.lastReconnectAttempt = halMillis();
     
     if (strlen(config.mqtt_user) > 0 && strlen(config.mqtt_password) > 0) {
-        connected = mqttClient.connect(
-            clientId.c_str(),
-            config.mqtt_user,
-            config.mqtt_password
-        );
+        connected = halMqttConnect(clientId, config.mqtt_user, config.mqtt_password);
     } else {
-        connected = mqttClient.connect(clientId.c_str());
+        connected = halMqttConnect(clientId, nullptr, nullptr);
     }
     
     if (connected) {
-        Serial.println("[MQTT] Connected successfully");
+        logInfo(LOG_MQTT, "Connected successfully");
+        mqttSession.reconnectFailures = 0;
+        mqttSession.reconnectDelayMs = halRandom() % MQTT_RECONNECT_MIN_MS; // на случай обрыва
+        char topic[MQTT_TOPIC_SIZE];
+        size_t baseLen = generateMqttBaseTopic(topic, sizeof(topic));
+        static const char *const SUBSCRIPTIONS[] = {"/history/get", "/log/set"};
+        for (const char *suffix : SUBSCRIPTIONS) {
+            strlcpy(topic + baseLen, suffix, sizeof(topic) - baseLen);
+            if (!halMqttSubscribe(topic))
+                logWarn(LOG_MQTT, "Subscribe to %s failed", topic);
+        }
     } else {
-        Serial.print("[MQTT] Connection failed, state=");
-        Serial.println(mqttClient.state());
+        if (mqttSession.reconnectFailures < UINT8_MAX)
+            mqttSession.reconnectFailures++;
+        mqttSession.reconnectDelayMs = reconnectBackoffMs(mqttSession.reconnectFailures);
+        logWarn(LOG_MQTT, "Connection failed, state=%d, retry in %lu ms", halMqttState(),
+                (unsigned long)mqttSession.reconnectDelayMs);
     }
 }
 
 /**
- * @brief Публикация данных датчиков
+ * @brief Показание в топики base (topic[0..baseLen)) в формате config.payload_format
  */
-void publishSensorData(float currentTemp, float currentHumidity, float currentPressure) {
-    if (!isMqttConfigured())
-        return;
-    
-    unsigned long now = millis();
-    
-    // В режиме сна firstPublish = true → публикуем всегда
-    // В обычном режиме — учитываем интервал
-    if (!firstPublish && (now - lastPublishTime < config.publishingInterval))
-        return;
-    
-    reconnectMqtt();
-    if (!mqttClient.connected()) {
-        Serial.println("[MQTT] Not connected, skipping publish");
-        return;
-    }
-    
-    String baseTopic = generateMqttBaseTopic();
+static bool publishReading(char *topic, size_t baseLen, const SensorReading &reading) {
     bool publishSuccess = true;
-    
-    // Публикуем температуру
-    if (!isnan(currentTemp) && currentTemp > -100 && currentTemp < 100) {
-        String tempTopic = baseTopic + "/temperature";
-        String tempValue = String(currentTemp, 1);
-        if (!mqttClient.publish(tempTopic.c_str(), tempValue.c_str(), true)) {
+    uint8_t format = config.payload_format < PAYLOAD_FORMAT_COUNT ? config.payload_format : (uint8_t)PAYLOAD_TEXT;
+    PayloadStats &stats = mqttPayloadStats[format];
+
+    if (format == PAYLOAD_MSGPACK) {
+        // Одно сообщение с фиксированной схемой вместо трёх топиков
+        uint8_t buf[PAYLOAD_MAX_SIZE];
+        unsigned long start = halMicros();
+        size_t len = encodeMqttPacked(buf, sizeof(buf), reading);
+        stats.encodeUs = halMicros() - start;
+        strlcpy(topic + baseLen, "/packed", MQTT_TOPIC_SIZE - baseLen);
+        stats.bytes = strlen(topic) + len;
+        if (len == 0 || !halMqttPublish(topic, buf, len, true)) {
             publishSuccess = false;
         }
-    }
-    
-    // Публикуем влажность
-    if (!isnan(currentHumidity) && currentHumidity >= 0 && currentHumidity <= 100) {
-        String humTopic = baseTopic + "/humidity";
-        String humValue = String(currentHumidity, 1);
-        if (!mqttClient.publish(humTopic.c_str(), humValue.c_str(), true)) {
-            publishSuccess = false;
+    } else {
+        // Публикуем температуру, влажность и давление (мм.рт.ст.) в отдельные топики
+        char values[MQTT_CH_COUNT][PAYLOAD_VALUE_SIZE];
+        unsigned long start = halMicros();
+        encodeMqttText(values, reading);
+        stats.encodeUs = halMicros() - start;
+        stats.bytes = 0;
+        for (uint8_t ch = 0; ch < MQTT_CH_COUNT; ch++) {
+            if (values[ch][0] == '\0')
+                continue;
+            strlcpy(topic + baseLen, MQTT_CHANNEL_TOPICS[ch], MQTT_TOPIC_SIZE - baseLen);
+            size_t valueLen = strlen(values[ch]);
+            stats.bytes += strlen(topic) + valueLen;
+            if (!halMqttPublish(topic, (const uint8_t *)values[ch], valueLen, true)) {
+                publishSuccess = false;
+            }
+        }
+        // Момент измерения (мс от эпохи) — значения выше относятся к нему, а не ко времени приёма
+        if (reading.timestamp) {
+            char value[24];
+            int len = snprintf(value, sizeof(value), "%llu", (unsigned long long)reading.timestamp);
+            strlcpy(topic + baseLen, "/timestamp", MQTT_TOPIC_SIZE - baseLen);
+            stats.bytes += strlen(topic) + len;
+            if (!halMqttPublish(topic, (const uint8_t *)value, len, true)) {
+                publishSuccess = false;
+            }
         }
     }
+    return publishSuccess;
+}
+
+/**
+ * @brief Публикация данных датчиков (приёмник SINK_MQTT: темп и повторы — в sink.cpp,
+ *        подключение — в handleMqtt())
+ */
+bool publishSensorData(const SensorReading &reading) {
+    if (!isMqttConfigured() || !halMqttConnected())
+        return false;
     
-    // Публикуем давление в мм.рт.ст.
-    if (!isnan(currentPressure) && currentPressure > 300 && currentPressure < 1200) {
-        String pressTopic = baseTopic + "/pressure";
-        String pressValue = String(currentPressure, 1);
-        if (!mqttClient.publish(pressTopic.c_str(), pressValue.c_str(), true)) {
+    traceBegin(TRACE_MQTT_PUBLISH);
+    char topic[MQTT_TOPIC_SIZE];
+    size_t baseLen = generateMqttBaseTopic(topic, sizeof(topic));
+    bool publishSuccess = publishReading(topic, baseLen, reading);
+
+    // Диагностика: выбранный интервал до следующего измерения, с
+    if (config.adaptive_interval) {
+        char interval[PAYLOAD_VALUE_SIZE];
+        int len = snprintf(interval, sizeof(interval), "%lu", (unsigned long)(sampleScheduler.intervalMs / 1000));
+        strlcpy(topic + baseLen, "/interval", sizeof(topic) - baseLen);
+        if (!halMqttPublish(topic, (const uint8_t *)interval, len, true)) {
             publishSuccess = false;
         }
-    }    
-    
-    // Обновляем время и флаг
-    lastPublishTime = now;
-    firstPublish = false;
-    
+    }
+
+    traceEnd(TRACE_MQTT_PUBLISH);
+
     if (publishSuccess) {
-        Serial.println("[MQTT] Data published successfully");
+        logDebug(LOG_MQTT, "Data published successfully");
     } else {
-        Serial.println("[MQTT] Partial publish failure");
+        logWarn(LOG_MQTT, "Partial publish failure");
+    }
+    return publishSuccess;
+}
+
+/**
+ * @brief Публикация истории, накопленной ULP за время сна (<base>/history/vcc)
+ */
+bool publishUlpHistory(const UlpHistory &history, uint64_t firstTimestamp) {
+    if (!isMqttConfigured() || !halMqttConnected())
+        return false;
+
+    char topic[MQTT_TOPIC_SIZE];
+    size_t baseLen = generateMqttBaseTopic(topic, sizeof(topic));
+    strlcpy(topic + baseLen, "/history/vcc", sizeof(topic) - baseLen);
+
+    char buf[ULP_HISTORY_JSON_SIZE];
+    size_t len = encodeUlpHistory(buf, sizeof(buf), history, firstTimestamp);
+    if (len == 0 || !halMqttPublish(topic, (const uint8_t *)buf, len, false)) {
+        logWarn(LOG_MQTT, "ULP history publish failed");
+        return false;
+    }
+    logInfo(LOG_MQTT, "ULP history: %u samples, wake: %s", history.count, ulpWakeReasonName(history.reason));
+    return true;
+}
+
+/**
+ * @brief Пересылка показания узла ESP-NOW в его собственные топики (шлюз)
+ */
+bool publishNodeReading(const uint8_t mac[6], const SensorReading &reading) {
+    if (!isMqttConfigured() || !halMqttConnected())
+        return false;
+
+    char topic[MQTT_TOPIC_SIZE];
+    size_t baseLen = formatMqttBaseTopic(topic, sizeof(topic), mac);
+    return publishReading(topic, baseLen, reading);
+}
+
+/**
+ * @brief Счётчики шлюза в <base>/gateway
+ */
+bool publishGatewayStats() {
+    if (!isMqttConfigured() || !halMqttConnected())
+        return false;
+
+    char topic[MQTT_TOPIC_SIZE];
+    size_t baseLen = generateMqttBaseTopic(topic, sizeof(topic));
+    strlcpy(topic + baseLen, "/gateway", sizeof(topic) - baseLen);
+    char buf[PAYLOAD_MAX_SIZE];
+    size_t len = encodeGatewayStats(buf, sizeof(buf));
+    return len > 0 && halMqttPublish(topic, (const uint8_t *)buf, len, true);
+}
+
+/**
+ * @brief Ответ на запрос истории одним сообщением в <base>/history/data.
+ *        Длина нужна заранее для заголовка PUBLISH — ответ собирается дважды
+ *        (подсчёт и отправка), в памяти только одна порция.
+ */
+static void serveHistoryRequest(HistoryRequest &request) {
+    char topic[MQTT_TOPIC_SIZE];
+    size_t baseLen = generateMqttBaseTopic(topic, sizeof(topic));
+    strlcpy(topic + baseLen, "/history/data", sizeof(topic) - baseLen);
+    if (!request.valid) {
+        const char *error = "{\"error\":\"bad request\"}";
+        halMqttPublish(topic, (const uint8_t *)error, strlen(error), false);
+        logWarn(LOG_MQTT, "Bad history request");
+        return;
+    }
+    if (request.query.limit == 0)
+        request.query.limit = HISTORY_MQTT_LIMIT;
+
+    unsigned long start = halMillis();
+    historyStreamBegin(historyResponse, request.query);
+    size_t total = historyStreamMeasure(historyResponse);
+    if (!halMqttPublishBegin(topic, total, false)) {
+        logWarn(LOG_MQTT, "History response failed");
+        return;
+    }
+    char chunk[256];
+    size_t sent = 0, len;
+    bool ok = true;
+    while (ok && sent < total && (len = historyStreamRead(historyResponse, chunk, sizeof(chunk))) > 0) {
+        if (len > total - sent)
+            len = total - sent;
+        ok = halMqttPublishWrite((const uint8_t *)chunk, len);
+        sent += len;
+    }
+    // Сегмент удалён между проходами — добиваем пробелами до объявленной длины (JSON остаётся корректным)
+    memset(chunk, ' ', sizeof(chunk));
+    while (ok && sent < total) {
+        len = total - sent < sizeof(chunk) ? total - sent : sizeof(chunk);
+        ok = halMqttPublishWrite((const uint8_t *)chunk, len);
+        sent += len;
+    }
+    ok = halMqttPublishEnd() && ok;
+    logInfo(LOG_MQTT, "History %s: %lu rows, %lu B in %lu ms", ok ? "sent" : "failed",
+            (unsigned long)historyResponse.rows, (unsigned long)total, (unsigned long)(halMillis() - start));
+}
+
+/**
+ * @brief Новые строки журнала не ниже logMqttLevel в <base>/log, по строке на сообщение
+ *        (вытесненные из истории до подключения пропускаются)
+ */
+static void publishLogLines() {
+    uint32_t oldest = logOldestLine();
+    if (logNextLine < oldest)
+        logNextLine = oldest;
+    char topic[MQTT_TOPIC_SIZE];
+    size_t baseLen = generateMqttBaseTopic(topic, sizeof(topic));
+    strlcpy(topic + baseLen, "/log", sizeof(topic) - baseLen);
+    LogLine line;
+    for (uint8_t sent = 0; sent < LOG_MQTT_BATCH && logNextLine < logStats.lines; logNextLine++) {
+        if (!logReadLine(logNextLine, line) || line.level > logMqttLevel)
+            continue;
+        if (!halMqttPublish(topic, (const uint8_t *)line.text, strlen(line.text), false))
+            return; // повторим с этой же строки
+        sent++;
     }
 }
 
@@ -147,17 +385,27 @@ void handleMqtt() {
         return;
     
     // Поддерживаем соединение
-    if (!mqttClient.connected()) {
-        static unsigned long lastReconnectAttempt = 0;
-        unsigned long now = millis();
-        
-        // Пытаемся переподключиться каждые 5 секунд
-        if (now - lastReconnectAttempt > 5000) {
-            lastReconnectAttempt = now;
+    if (!halMqttConnected()) {
+        // Пауза после неудачи растёт со случайным разбросом (reconnectBackoffMs)
+        if (halMillis() - mqttSession.lastReconnectAttempt >= mqttSession.reconnectDelayMs)
             reconnectMqtt();
-        }
     } else {
         // Обрабатываем входящие сообщения
-        mqttClient.loop();
+        halMqttLoop();
+        for (uint8_t i = 0; i < historyRequestCount; i++)
+            serveHistoryRequest(historyRequests[i]);
+        historyRequestCount = 0;
+        publishLogLines();
     }
 }
+
+uint32_t mqttServiceWaitMs() {
+    if (!isMqttConfigured() || halMqttConnected())
+        return MQTT_LOOP_PERIOD_MS;
+    uint32_t elapsed = halMillis() - mqttSession.lastReconnectAttempt;
+    if (elapsed >= mqttSession.reconnectDelayMs)
+        return 0;
+    uint32_t wait = mqttSession.reconnectDelayMs - elapsed;
+    return wait < MQTT_LOOP_PERIOD_MS ? wait : MQTT_LOOP_PERIOD_MS;
+}
+#endif
@@ -0,0 +1,244 @@
+#include "payload.h"
+#include "sample.h"
+#include "hal.h"
+#include "log.h"
+#include <ArduinoJson.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+const char *const MQTT_CHANNEL_TOPICS[MQTT_CH_COUNT] = {
+    "/temperature",
+    "/humidity",
+    "/pressure",
+};
+
+PayloadStats mqttPayloadStats[PAYLOAD_FORMAT_COUNT] = {};
+PayloadStats httpPayloadStats[PAYLOAD_FORMAT_COUNT] = {};
+
+const char *payloadFormatName(uint8_t format)
+{
+    return format == PAYLOAD_MSGPACK ? "msgpack" : "text";
+}
+
+// === Допустимые диапазоны (единые для MQTT, HTTP и веб-интерфейса) ===
+bool isValidTemperature(float value)
+{
+    return !isnan(value) && value > -100 && value < 100;
+}
+
+bool isValidHumidity(float value)
+{
+    return !isnan(value) && value >= 0 && value <= 100;
+}
+
+bool isValidPressure(float value)
+{
+    return !isnan(value) && value > 300 && value < 1200;
+}
+
+/**
+ * @brief Форматирование значения в буфер без выделения памяти (замена String(value, n))
+ */
+size_t formatSensorValue(char *buf, size_t size, float value, uint8_t decimals)
+{
+    int len = snprintf(buf, size, "%.*f", decimals, (double)value);
+    if (len < 0)
+    {
+        buf[0] = '\0';
+        return 0;
+    }
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+/**
+ * @brief Текстовые значения для отдельных топиков; пустая строка = канал не публикуется
+ * @return суммарная длина значений
+ */
+size_t encodeMqttText(char values[MQTT_CH_COUNT][PAYLOAD_VALUE_SIZE], const SensorReading &reading)
+{
+    size_t total = 0;
+    values[MQTT_CH_TEMPERATURE][0] = '\0';
+    values[MQTT_CH_HUMIDITY][0] = '\0';
+    values[MQTT_CH_PRESSURE][0] = '\0';
+
+    if (reading.flags & SAMPLE_TEMPERATURE)
+        total += formatSensorValue(values[MQTT_CH_TEMPERATURE], PAYLOAD_VALUE_SIZE, sampleTemperature(reading), 1);
+    if (reading.flags & SAMPLE_HUMIDITY)
+        total += formatSensorValue(values[MQTT_CH_HUMIDITY], PAYLOAD_VALUE_SIZE, sampleHumidity(reading), 1);
+    if (reading.flags & SAMPLE_PRESSURE)
+        total += formatSensorValue(values[MQTT_CH_PRESSURE], PAYLOAD_VALUE_SIZE, samplePressure(reading), 1);
+    return total;
+}
+
+static void addValue(JsonArray &arr, const SensorReading &reading, uint8_t channel, float value)
+{
+    if (reading.flags & channel)
+        arr.add(value);
+    else
+        arr.add(nullptr);
+}
+
+/**
+ * @brief Одно сообщение MessagePack: [schema, temp|nil, hum|nil, pres|nil, vcc|nil, timestamp|nil]
+ */
+size_t encodeMqttPacked(uint8_t *buf, size_t size, const SensorReading &reading)
+{
+    StaticJsonDocument<128> doc;
+    JsonArray arr = doc.to<JsonArray>();
+    arr.add(PAYLOAD_SCHEMA_VERSION);
+    addValue(arr, reading, SAMPLE_TEMPERATURE, sampleTemperature(reading));
+    addValue(arr, reading, SAMPLE_HUMIDITY, sampleHumidity(reading));
+    addValue(arr, reading, SAMPLE_PRESSURE, samplePressure(reading));
+    addValue(arr, reading, SAMPLE_VCC, sampleVcc(reading));
+    if (reading.timestamp)
+        arr.add(reading.timestamp);
+    else
+        arr.add(nullptr);
+    return serializeMsgPack(doc, buf, size);
+}
+
+// Элемент items тела POST: в JSON значение строкой, в MessagePack — числом
+static void addPostItem(JsonArray &items, uint8_t format, const char *name, float value, uint8_t decimals)
+{
+    JsonObject item = items.createNestedObject();
+    item["name"] = name;
+    if (format == PAYLOAD_MSGPACK)
+    {
+        item["value"] = value;
+        return;
+    }
+    char text[PAYLOAD_VALUE_SIZE];
+    formatSensorValue(text, sizeof(text), value, decimals);
+    item["value"] = text; // копируется в документ
+}
+
+/**
+ * @brief Тело POST-запроса: rssi и действительные каналы показания (vcc, температура,
+ *        влажность, давление). JSON сохраняет прежний вид (значения строками),
+ *        MessagePack передаёт ту же структуру с числовыми значениями.
+ */
+size_t encodePostPayload(uint8_t format, uint8_t *buf, size_t size,
+                         const char *uid, int rssi, const SensorReading &reading)
+{
+    StaticJsonDocument<512> doc;
+    doc["uid"] = uid;
+    if (reading.timestamp)
+        doc["timestamp"] = reading.timestamp; // мс от эпохи Unix, момент измерения
+    JsonArray items = doc.createNestedArray("items");
+    addPostItem(items, format, "rssi", rssi, 0);
+    if (reading.flags & SAMPLE_VCC)
+        addPostItem(items, format, "vcc", sampleVcc(reading), 2);
+    if (reading.flags & SAMPLE_TEMPERATURE)
+        addPostItem(items, format, "temperature", sampleTemperature(reading), 1);
+    if (reading.flags & SAMPLE_HUMIDITY)
+        addPostItem(items, format, "humidity", sampleHumidity(reading), 1);
+    if (reading.flags & SAMPLE_PRESSURE)
+        addPostItem(items, format, "pressure", samplePressure(reading), 1);
+
+    if (format == PAYLOAD_MSGPACK)
+        return serializeMsgPack(doc, buf, size);
+    return serializeJson(doc, (char *)buf, size);
+}
+
+template <typename T>
+static size_t appendLineField(char *buf, size_t size, size_t len, char &sep, const char *format, T value)
+{
+    if (len >= size)
+        return len;
+    buf[len++] = sep;
+    sep = ',';
+    int n = snprintf(buf + len, size - len, format, value);
+    return n < 0 ? size : len + n;
+}
+
+/**
+ * @brief Строка InfluxDB line protocol:
+ *        sensors,uid=<uid> temperature=21.4,humidity=48.2,pressure=755.4,vcc=3.71,rssi=-61i <нс>
+ *        Недействительные каналы не передаются; rssi есть всегда — строка не остаётся без полей.
+ *        Пустой uid — без тега (пустое значение тега line protocol не допускает).
+ *        Без метки времени момент записи назначает сервер.
+ * @return длина строки; 0 — не поместилась в буфер
+ */
+size_t encodeLineProtocol(char *buf, size_t size, const char *uid, int rssi, const SensorReading &reading)
+{
+    size_t len = strlcpy(buf, uid[0] != '\0' ? "sensors,uid=" : "sensors", size);
+    // Пробел, запятая и «=» в значении тега экранируются
+    const char *c = uid;
+    for (; *c != '\0' && len + 2 < size; c++)
+    {
+        if (*c == ' ' || *c == ',' || *c == '=')
+            buf[len++] = '\\';
+        buf[len++] = *c;
+    }
+    if (*c != '\0' || len >= size)
+        return 0;
+
+    char sep = ' '; // перед первым полем — пробел, дальше запятые
+    if (reading.flags & SAMPLE_TEMPERATURE)
+        len = appendLineField(buf, size, len, sep, "temperature=%.1f", sampleTemperature(reading));
+    if (reading.flags & SAMPLE_HUMIDITY)
+        len = appendLineField(buf, size, len, sep, "humidity=%.1f", sampleHumidity(reading));
+    if (reading.flags & SAMPLE_PRESSURE)
+        len = appendLineField(buf, size, len, sep, "pressure=%.1f", samplePressure(reading));
+    if (reading.flags & SAMPLE_VCC)
+        len = appendLineField(buf, size, len, sep, "vcc=%.2f", sampleVcc(reading));
+    len = appendLineField(buf, size, len, sep, "rssi=%di", rssi);
+    if (reading.timestamp)
+    {
+        sep = ' ';
+        len = appendLineField(buf, size, len, sep, "%llu000000", (unsigned long long)reading.timestamp); // мс → нс
+    }
+    return len < size ? len : 0;
+}
+
+/**
+ * @brief uid устройства по MAC (узлы ESP-NOW на шлюзе, устройство без заданного uid)
+ */
+size_t formatMacUid(char *buf, size_t size, const uint8_t mac[6])
+{
+    int len = snprintf(buf, size, "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return len > 0 && (size_t)len < size ? (size_t)len : 0;
+}
+
+/**
+ * @brief Кодирует текущие показания во всех форматах и сохраняет размер и время
+ *        для сравнения на странице настроек
+ */
+void measurePayloadEncodings(size_t baseTopicLen, const char *uid, int rssi, const SensorReading &reading)
+{
+    uint8_t buf[PAYLOAD_MAX_SIZE];
+    char values[MQTT_CH_COUNT][PAYLOAD_VALUE_SIZE];
+
+    unsigned long start = halMicros();
+    encodeMqttText(values, reading);
+    mqttPayloadStats[PAYLOAD_TEXT].encodeUs = halMicros() - start;
+    uint32_t textBytes = 0;
+    for (uint8_t i = 0; i < MQTT_CH_COUNT; i++)
+    {
+        if (values[i][0] != '\0')
+            textBytes += baseTopicLen + strlen(MQTT_CHANNEL_TOPICS[i]) + strlen(values[i]);
+    }
+    if (reading.timestamp)
+        textBytes += baseTopicLen + strlen("/timestamp") + 13; // 13 цифр мс до 2286 года
+    mqttPayloadStats[PAYLOAD_TEXT].bytes = textBytes;
+
+    start = halMicros();
+    size_t len = encodeMqttPacked(buf, sizeof(buf), reading);
+    mqttPayloadStats[PAYLOAD_MSGPACK].encodeUs = halMicros() - start;
+    mqttPayloadStats[PAYLOAD_MSGPACK].bytes = baseTopicLen + strlen("/packed") + len;
+
+    for (uint8_t format = 0; format < PAYLOAD_FORMAT_COUNT; format++)
+    {
+        start = halMicros();
+        len = encodePostPayload(format, buf, sizeof(buf), uid, rssi, reading);
+        httpPayloadStats[format].encodeUs = halMicros() - start;
+        httpPayloadStats[format].bytes = len;
+    }
+
+    logInfo(LOG_PAYLOAD, "MQTT text=%lu B/%lu us, msgpack=%lu B/%lu us; HTTP json=%lu B/%lu us, msgpack=%lu B/%lu us",
+            (unsigned long)mqttPayloadStats[PAYLOAD_TEXT].bytes, (unsigned long)mqttPayloadStats[PAYLOAD_TEXT].encodeUs,
+            (unsigned long)mqttPayloadStats[PAYLOAD_MSGPACK].bytes, (unsigned long)mqttPayloadStats[PAYLOAD_MSGPACK].encodeUs,
+            (unsigned long)httpPayloadStats[PAYLOAD_TEXT].bytes, (unsigned long)httpPayloadStats[PAYLOAD_TEXT].encodeUs,
+            (unsigned long)httpPayloadStats[PAYLOAD_MSGPACK].bytes, (unsigned long)httpPayloadStats[PAYLOAD_MSGPACK].encodeUs);
+}
@@ -0,0 +1,55 @@
+#include "post.h"
+#if FEATURE_HTTP_POST
+#include "config.h"
+#include "sensors.h"
+#include "payload.h"
+#include "hal.h"
+#include "trace.h"
+#include <string.h>
+
+/**
+ * @brief POST показания на post_url в формате config.payload_format
+ * @return сервер ответил 2xx
+ */
+static bool postReading(const char *uid, int rssi, const SensorReading &reading)
+{
+    uint8_t format = config.payload_format < PAYLOAD_FORMAT_COUNT ? config.payload_format : (uint8_t)PAYLOAD_TEXT;
+    uint8_t body[PAYLOAD_MAX_SIZE];
+    unsigned long start = halMicros();
+    size_t len = encodePostPayload(format, body, sizeof(body), uid, rssi, reading);
+    httpPayloadStats[format].encodeUs = halMicros() - start;
+    httpPayloadStats[format].bytes = len;
+    traceBegin(TRACE_HTTP_POST);
+    int code = halHttpPost(config.post_url, format == PAYLOAD_MSGPACK ? "application/msgpack" : "application/json",
+                           body, len, HTTP_POST_TIMEOUT_MS);
+    traceEnd(TRACE_HTTP_POST);
+    return code >= 200 && code < 300;
+}
+
+bool isPostConfigured()
+{
+    return config.post_url[0] != '\0';
+}
+
+/**
+ * @brief Отправка показания на post_url в формате config.payload_format
+ */
+bool sendPostRequest(const SensorReading &reading)
+{
+    if (!isPostConfigured() || !halNetConnected())
+        return false;
+    return postReading(config.uid, halNetRssi(), reading);
+}
+
+/**
+ * @brief То же для узла ESP-NOW (шлюз): uid — MAC узла, rssi — уровень его кадра
+ */
+bool sendNodePostRequest(const uint8_t mac[6], int rssi, const SensorReading &reading)
+{
+    if (!isPostConfigured() || !halNetConnected())
+        return false;
+    char uid[MAC_UID_SIZE];
+    formatMacUid(uid, sizeof(uid), mac);
+    return postReading(uid, rssi, reading);
+}
+#endif
@@ -0,0 +1,88 @@
+// Управление питанием ESP32: esp_pm (DFS + light sleep), блокировки на время работы, modem sleep
+#include <Arduino.h>
+#include <esp_wifi.h>
+#include <esp_pm.h>
+#include "power.h"
+#include "log.h"
+
+static bool lowPowerEnabled = false;
+static esp_pm_lock_handle_t cpuLock = nullptr;   // максимальная частота
+static esp_pm_lock_handle_t awakeLock = nullptr; // запрет light sleep
+
+/**
+ * @brief DFS и автоматический light sleep в idle; без CONFIG_PM_ENABLE — только сниженная частота
+ */
+bool powerBegin(bool lowPower)
+{
+    lowPowerEnabled = lowPower;
+    if (!lowPower)
+        return false;
+
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz = POWER_CPU_MAX_MHZ;
+    pm.min_freq_mhz = POWER_CPU_MIN_MHZ;
+    pm.light_sleep_enable = true; // нужен tickless idle (CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK)
+    {
+        // Сборка SDK без управления питанием: фиксированная частота и modem sleep
+        setCpuFrequencyMhz(POWER_CPU_MIN_MHZ);
+        logWarn(LOG_POWER, "esp_pm unavailable (%d), CPU fixed at %u MHz", err, POWER_CPU_MIN_MHZ);
+        return false;
+    }
+
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "busy", &cpuLock);
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "busy", &awakeLock);
+    logInfo(LOG_POWER, "DFS %u..%u MHz, automatic light sleep", POWER_CPU_MIN_MHZ, POWER_CPU_MAX_MHZ);
+    return true;
+}
+
+/**
+ * @brief Интервал прослушивания согласуется при ассоциации: вызывать между WiFi.begin(..., false)
+ *        и esp_wifi_connect() (WiFi.begin() собирает настройки STA заново, с нулевым интервалом)
+ */
+void powerPrepareWifiConnect()
+{
+    if (!lowPowerEnabled)
+        return;
+
+    wifi_config_t conf;
+    if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK)
+    {
+        conf.sta.listen_interval = POWER_LISTEN_INTERVAL;
+        esp_wifi_set_config(WIFI_IF_STA, &conf);
+    }
+}
+
+/**
+ * @brief Modem sleep; вызывать после подключения к AP
+ */
+void powerConfigureWifi()
+{
+    if (!lowPowerEnabled)
+        return;
+
+    esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+    logInfo(LOG_POWER, "Modem sleep: listen interval %u beacons, latency <= %u ms", POWER_LISTEN_INTERVAL,
+            POWER_LATENCY_BOUND_MS);
+}
+
+/**
+ * @brief Измерение, публикация, OTA: полная частота и без light sleep
+ * (блокировки esp_pm считают захваты — вложенные вызовы из разных задач допустимы)
+ */
+void powerBusyBegin()
+{
+    if (!cpuLock)
+        return;
+    esp_pm_lock_acquire(cpuLock);
+    esp_pm_lock_acquire(awakeLock);
+}
+
+void powerBusyEnd()
+{
+    if (!cpuLock)
+        return;
+    esp_pm_lock_release(awakeLock);
+    esp_pm_lock_release(cpuLock);
+}
@@ -0,0 +1,30 @@
+#include "publish_slot.h"
+
+/**
+ * @brief Смещение отправки узла от границы интервала
+ * FNV-1a по MAC: у соседних адресов одного производителя слоты не идут подряд
+ */
+uint32_t publishSlotOffsetMs(const uint8_t mac[6], uint32_t intervalMs)
+{
+    uint32_t window = intervalMs / 2;
+    if (window > PUBLISH_SLOT_WINDOW_MAX_MS)
+        window = PUBLISH_SLOT_WINDOW_MAX_MS;
+    uint32_t slots = window / PUBLISH_SLOT_MS;
+    if (slots <= 1)
+        return 0;
+
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        hash ^= mac[i];
+        hash *= 16777619u;
+    }
+    return (hash % slots) * PUBLISH_SLOT_MS;
+}
+
+uint32_t alignedWaitMs(uint64_t epochMs, uint32_t intervalMs)
+{
+    if (intervalMs == 0)
+        return 0;
+    return intervalMs - (uint32_t)(epochMs % intervalMs);
+}
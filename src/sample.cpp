@@ -0,0 +1,58 @@
+#include "sample.h"
+#include "payload.h"
+#include <math.h>
+
+// Границы допустимых значений — общие с payload.cpp (isValid*)
+static void setChannel(SensorReading &reading, uint8_t channel, bool valid)
+{
+    reading.flags &= (uint8_t)~(channel | channel << SAMPLE_ERROR_SHIFT);
+    reading.flags |= valid ? channel : (uint8_t)(channel << SAMPLE_ERROR_SHIFT);
+}
+
+void sampleSetTemperature(SensorReading &reading, float celsius)
+{
+    bool valid = isValidTemperature(celsius);
+    reading.tempCenti = valid ? (int16_t)lroundf(celsius * 100) : 0;
+    setChannel(reading, SAMPLE_TEMPERATURE, valid);
+}
+
+void sampleSetHumidity(SensorReading &reading, float percent)
+{
+    bool valid = isValidHumidity(percent);
+    reading.humPermille = valid ? (uint16_t)lroundf(percent * 10) : 0;
+    setChannel(reading, SAMPLE_HUMIDITY, valid);
+}
+
+void sampleSetPressure(SensorReading &reading, float pascals)
+{
+    bool valid = isValidPressure(pascals / PA_PER_MMHG);
+    reading.pressurePa = valid ? (uint32_t)lroundf(pascals) : 0;
+    setChannel(reading, SAMPLE_PRESSURE, valid);
+}
+
+void sampleSetVcc(SensorReading &reading, float volts)
+{
+    bool valid = !isnan(volts) && volts >= 0 && volts < 65.5f;
+    reading.vccMv = valid ? (uint16_t)lroundf(volts * 1000) : 0;
+    setChannel(reading, SAMPLE_VCC, valid);
+}
+
+float sampleTemperature(const SensorReading &reading)
+{
+    return reading.flags & SAMPLE_TEMPERATURE ? reading.tempCenti / 100.0f : NAN;
+}
+
+float sampleHumidity(const SensorReading &reading)
+{
+    return reading.flags & SAMPLE_HUMIDITY ? reading.humPermille / 10.0f : NAN;
+}
+
+float samplePressure(const SensorReading &reading)
+{
+    return reading.flags & SAMPLE_PRESSURE ? reading.pressurePa / PA_PER_MMHG : NAN;
+}
+
+float sampleVcc(const SensorReading &reading)
+{
+    return reading.flags & SAMPLE_VCC ? reading.vccMv / 1000.0f : NAN;
+}
@@ -0,0 +1,141 @@
+#include "scheduler.h"
+#include "payload.h"
+#include <math.h>
+
+// Скорости изменения, при которых погода считается «активной» (activity = 1.0)
+const float TEMP_RATE_ACTIVE = 2.0f;  // °C/ч
+const float HUM_RATE_ACTIVE = 10.0f;  // %/ч
+const float PRES_RATE_ACTIVE = 0.75f; // мм.рт.ст./ч (≈ 3 гПа за 3 ч — признак фронта)
+const float RATE_SMOOTHING = 0.5f;    // вес нового значения в скользящем среднем
+const uint32_t RATE_WINDOW_MS = 600000; // минимальное окно: шаг 0.1 °C за 10 с — это уже 36 °C/ч
+
+// Гистерезис по активности: вход в режим и выход из него на разных порогах
+const float FAST_ENTER = 1.0f;
+const float FAST_EXIT = 0.5f;
+const float QUIET_ENTER = 0.15f;
+const float QUIET_EXIT = 0.3f;
+
+// Гистерезис по напряжению батареи, В
+const float BATTERY_LOW_V = 2.8f;
+const float BATTERY_CRITICAL_V = 2.7f;
+const float BATTERY_HYSTERESIS_V = 0.05f;
+const float BATTERY_ABSENT_V = 1.0f; // ниже — делитель не подключён (питание от сети)
+
+void schedulerReset(SchedulerState &state, uint32_t baseMs)
+{
+    state.hasPrev = false;
+    state.prevTemp = NAN;
+    state.prevHum = NAN;
+    state.prevPres = NAN;
+    state.tempRate = 0;
+    state.humRate = 0;
+    state.presRate = 0;
+    state.activity = 0;
+    state.windowMs = 0;
+    state.level = SCHEDULE_NORMAL;
+    state.battery = BATTERY_OK;
+    state.intervalMs = baseMs;
+}
+
+const char *scheduleLevelName(uint8_t level)
+{
+    switch (level)
+    {
+    case SCHEDULE_FAST:
+        return "fast";
+    case SCHEDULE_QUIET:
+        return "quiet";
+    default:
+        return "normal";
+    }
+}
+
+static void updateRate(float &rate, float &prev, bool prevValid, bool valid, float value, float hours)
+{
+    if (!valid)
+        return;
+    if (prevValid && hours > 0)
+    {
+        float current = fabsf(value - prev) / hours;
+        rate = rate + RATE_SMOOTHING * (current - rate);
+    }
+    prev = value;
+}
+
+static uint8_t nextBatteryLevel(uint8_t battery, float vcc)
+{
+    if (isnan(vcc) || vcc < BATTERY_ABSENT_V) // NAN — напряжение не измерено
+        return BATTERY_OK;
+    // Порог выхода смещён вверх, чтобы не переключаться на шуме АЦП
+    if (battery == BATTERY_CRITICAL)
+        return vcc > BATTERY_CRITICAL_V + BATTERY_HYSTERESIS_V ? nextBatteryLevel(BATTERY_LOW, vcc) : (uint8_t)BATTERY_CRITICAL;
+    if (vcc < BATTERY_CRITICAL_V)
+        return BATTERY_CRITICAL;
+    if (battery == BATTERY_LOW)
+        return vcc > BATTERY_LOW_V + BATTERY_HYSTERESIS_V ? BATTERY_OK : BATTERY_LOW;
+    return vcc < BATTERY_LOW_V ? BATTERY_LOW : BATTERY_OK;
+}
+
+/**
+ * @brief Выбор следующего интервала опроса по скорости изменения каналов и заряду батареи
+ * @param elapsedMs время с предыдущего измерения
+ */
+uint32_t schedulerUpdate(SchedulerState &state, const ScheduleLimits &limits, uint32_t elapsedMs,
+                         float temp, float hum, float pres, float vcc)
+{
+    // Скорость считается только между двумя валидными измерениями канала,
+    // разнесёнными не меньше чем на RATE_WINDOW_MS
+    state.windowMs += elapsedMs;
+    if (!state.hasPrev || state.windowMs >= RATE_WINDOW_MS)
+    {
+        float hours = state.hasPrev ? state.windowMs / 3600000.0f : 0;
+        updateRate(state.tempRate, state.prevTemp, isValidTemperature(state.prevTemp), isValidTemperature(temp), temp, hours);
+        updateRate(state.humRate, state.prevHum, isValidHumidity(state.prevHum), isValidHumidity(hum), hum, hours);
+        updateRate(state.presRate, state.prevPres, isValidPressure(state.prevPres), isValidPressure(pres), pres, hours);
+        state.hasPrev = true;
+        state.windowMs = 0;
+    }
+
+    float activity = state.tempRate / TEMP_RATE_ACTIVE;
+    activity = fmaxf(activity, state.humRate / HUM_RATE_ACTIVE);
+    activity = fmaxf(activity, state.presRate / PRES_RATE_ACTIVE);
+    state.activity = activity;
+
+    switch (state.level)
+    {
+    case SCHEDULE_FAST:
+        if (activity < FAST_EXIT)
+            state.level = SCHEDULE_NORMAL;
+        break;
+    case SCHEDULE_QUIET:
+        if (activity > QUIET_EXIT)
+            state.level = activity >= FAST_ENTER ? SCHEDULE_FAST : SCHEDULE_NORMAL;
+        break;
+    default:
+        if (activity >= FAST_ENTER)
+            state.level = SCHEDULE_FAST;
+        else if (activity < QUIET_ENTER)
+            state.level = SCHEDULE_QUIET;
+        break;
+    }
+
+    uint32_t interval = limits.baseMs;
+    if (state.level == SCHEDULE_FAST)
+        interval = limits.minMs;
+    else if (state.level == SCHEDULE_QUIET)
+        interval = limits.maxMs;
+
+    // Низкий заряд растягивает интервал независимо от погоды
+    state.battery = nextBatteryLevel(state.battery, vcc);
+    if (state.battery == BATTERY_CRITICAL)
+        interval = limits.maxMs;
+    else if (state.battery == BATTERY_LOW && interval < limits.maxMs / 2)
+        interval = limits.maxMs / 2;
+
+    if (interval < limits.minMs)
+        interval = limits.minMs;
+    if (interval > limits.maxMs)
+        interval = limits.maxMs;
+    state.intervalMs = interval;
+    return interval;
+}
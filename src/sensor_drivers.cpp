@@ -0,0 +1,237 @@
+#include "sensor_drivers.h"
+#include "hal.h"
+#include "feature_flags.h"
+#include <math.h>
+
+// === DHT22 ===
+#if FEATURE_DHT22
+// Преобразование не запускается заранее: библиотека читает датчик за ~5 мс при вызове,
+// чаще раза в 2 с датчик не обновляет показания.
+
+static bool dht22Begin()
+{
+    return halDhtBegin();
+}
+
+static uint16_t dht22Start()
+{
+    return 0;
+}
+
+static SensorStep dht22Step(float values[SENSOR_CH_COUNT], uint16_t *)
+{
+    float temperature, humidity;
+    if (!halReadDht(temperature, humidity))
+        return SENSOR_STEP_ERROR;
+    values[SENSOR_CH_TEMPERATURE] = temperature;
+    values[SENSOR_CH_HUMIDITY] = humidity;
+    return SENSOR_STEP_DONE;
+}
+
+const SensorDriver DHT22_DRIVER = {
+    "DHT22",
+    SENSOR_CHANNEL_BIT(SENSOR_CH_TEMPERATURE) | SENSOR_CHANNEL_BIT(SENSOR_CH_HUMIDITY),
+    5,
+    2000,
+    dht22Begin,
+    dht22Start,
+    dht22Step,
+};
+#endif
+
+// === BMP180 ===
+// Две фазы: температура (4.5 мс), затем давление (25.5 мс при OSS=3).
+// Результат каждой фазы читается одной транзакцией (адрес регистра + repeated start).
+
+const uint8_t BMP180_REG_CALIBRATION = 0xAA;
+const uint8_t BMP180_REG_CHIP_ID = 0xD0;
+const uint8_t BMP180_REG_CONTROL = 0xF4;
+const uint8_t BMP180_REG_RESULT = 0xF6;
+const uint8_t BMP180_CMD_TEMPERATURE = 0x2E;
+const uint8_t BMP180_CMD_PRESSURE = 0x34;
+const uint16_t BMP180_TEMPERATURE_MS = 5;
+const uint16_t BMP180_PRESSURE_MS[4] = {5, 8, 14, 26};
+
+#if FEATURE_BMP180
+static Bmp180Calibration bmp180Cal;
+static int32_t bmp180Ut = 0;
+static bool bmp180PressurePhase = false;
+#endif
+
+void bmp180ParseCalibration(Bmp180Calibration &cal, const uint8_t raw[22])
+{
+    uint16_t words[11];
+    for (uint8_t i = 0; i < 11; i++)
+        words[i] = (uint16_t)(raw[2 * i] << 8 | raw[2 * i + 1]);
+    cal.ac1 = (int16_t)words[0];
+    cal.ac2 = (int16_t)words[1];
+    cal.ac3 = (int16_t)words[2];
+    cal.ac4 = words[3];
+    cal.ac5 = words[4];
+    cal.ac6 = words[5];
+    cal.b1 = (int16_t)words[6];
+    cal.b2 = (int16_t)words[7];
+    cal.mb = (int16_t)words[8];
+    cal.mc = (int16_t)words[9];
+    cal.md = (int16_t)words[10];
+}
+
+static int32_t bmp180B5(const Bmp180Calibration &cal, int32_t ut)
+{
+    int32_t x1 = ((ut - (int32_t)cal.ac6) * (int32_t)cal.ac5) >> 15;
+    int32_t x2 = ((int32_t)cal.mc << 11) / (x1 + cal.md);
+    return x1 + x2;
+}
+
+int32_t bmp180Temperature(const Bmp180Calibration &cal, int32_t ut)
+{
+    return (bmp180B5(cal, ut) + 8) >> 4;
+}
+
+int32_t bmp180Pressure(const Bmp180Calibration &cal, int32_t ut, int32_t up, uint8_t oss)
+{
+    int32_t b6 = bmp180B5(cal, ut) - 4000;
+    int32_t x1 = ((int32_t)cal.b2 * ((b6 * b6) >> 12)) >> 11;
+    int32_t x2 = ((int32_t)cal.ac2 * b6) >> 11;
+    int32_t x3 = x1 + x2;
+    int32_t b3 = ((((int32_t)cal.ac1 * 4 + x3) << oss) + 2) / 4;
+    x1 = ((int32_t)cal.ac3 * b6) >> 13;
+    x2 = ((int32_t)cal.b1 * ((b6 * b6) >> 12)) >> 16;
+    x3 = ((x1 + x2) + 2) >> 2;
+    uint32_t b4 = ((uint32_t)cal.ac4 * (uint32_t)(x3 + 32768)) >> 15;
+    uint32_t b7 = ((uint32_t)up - b3) * (uint32_t)(50000 >> oss);
+    if (b4 == 0)
+        return 0;
+    int32_t p = b7 < 0x80000000 ? (int32_t)((b7 * 2) / b4) : (int32_t)((b7 / b4) * 2);
+    x1 = (p >> 8) * (p >> 8);
+    x1 = (x1 * 3038) >> 16;
+    x2 = (-7357 * p) >> 16;
+    return p + ((x1 + x2 + 3791) >> 4);
+}
+
+#if FEATURE_BMP180 // пересчёт выше нужен и модели hal_native
+static bool bmp180Begin()
+{
+    uint8_t reg = BMP180_REG_CHIP_ID;
+    uint8_t id = 0;
+    if (!halI2cWriteRead(BMP180_ADDRESS, &reg, 1, &id, 1) || id != BMP180_CHIP_ID)
+        return false;
+
+    // Вся калибровка — одним чтением 22 байт
+    uint8_t raw[22];
+    reg = BMP180_REG_CALIBRATION;
+    if (!halI2cWriteRead(BMP180_ADDRESS, &reg, 1, raw, sizeof(raw)))
+        return false;
+    bmp180ParseCalibration(bmp180Cal, raw);
+    return true;
+}
+
+static uint16_t bmp180Start()
+{
+    const uint8_t cmd[2] = {BMP180_REG_CONTROL, BMP180_CMD_TEMPERATURE};
+    if (!halI2cWrite(BMP180_ADDRESS, cmd, sizeof(cmd)))
+        return SENSOR_START_FAILED;
+    bmp180PressurePhase = false;
+    return BMP180_TEMPERATURE_MS;
+}
+
+static SensorStep bmp180Step(float values[SENSOR_CH_COUNT], uint16_t *waitMs)
+{
+    uint8_t reg = BMP180_REG_RESULT;
+    uint8_t raw[3];
+
+    if (!bmp180PressurePhase)
+    {
+        if (!halI2cWriteRead(BMP180_ADDRESS, &reg, 1, raw, 2))
+            return SENSOR_STEP_ERROR;
+        bmp180Ut = (int32_t)(raw[0] << 8 | raw[1]);
+
+        const uint8_t cmd[2] = {BMP180_REG_CONTROL, (uint8_t)(BMP180_CMD_PRESSURE | (BMP180_OSS << 6))};
+        if (!halI2cWrite(BMP180_ADDRESS, cmd, sizeof(cmd)))
+            return SENSOR_STEP_ERROR;
+        bmp180PressurePhase = true;
+        *waitMs = BMP180_PRESSURE_MS[BMP180_OSS];
+        return SENSOR_STEP_WAIT;
+    }
+
+    if (!halI2cWriteRead(BMP180_ADDRESS, &reg, 1, raw, 3))
+        return SENSOR_STEP_ERROR;
+    int32_t up = (int32_t)(((uint32_t)raw[0] << 16 | (uint32_t)raw[1] << 8 | raw[2]) >> (8 - BMP180_OSS));
+    int32_t pressurePa = bmp180Pressure(bmp180Cal, bmp180Ut, up, BMP180_OSS);
+    if (pressurePa <= 0)
+        return SENSOR_STEP_ERROR;
+
+    values[SENSOR_CH_PRESSURE] = (float)pressurePa;
+    return SENSOR_STEP_DONE;
+}
+
+const SensorDriver BMP180_DRIVER = {
+    "BMP180",
+    SENSOR_CHANNEL_BIT(SENSOR_CH_PRESSURE),
+    (uint16_t)(BMP180_TEMPERATURE_MS + BMP180_PRESSURE_MS[BMP180_OSS]),
+    1000,
+    bmp180Begin,
+    bmp180Start,
+    bmp180Step,
+};
+#endif
+
+// === SHT3x ===
+#if FEATURE_SHT3X
+// Однократное измерение высокой точности без удержания SCL (15 мс),
+// температура и влажность с CRC — одним чтением 6 байт.
+
+const uint16_t SHT3X_CMD_MEASURE = 0x2400;
+const uint16_t SHT3X_CMD_STATUS = 0xF32D;
+const uint16_t SHT3X_MEASURE_MS = 15;
+
+static uint8_t sht3xCrc(const uint8_t *data)
+{
+    uint8_t crc = 0xFF;
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static bool sht3xCommand(uint16_t command)
+{
+    const uint8_t cmd[2] = {(uint8_t)(command >> 8), (uint8_t)command};
+    return halI2cWrite(SHT3X_ADDRESS, cmd, sizeof(cmd));
+}
+
+static bool sht3xBegin()
+{
+    uint8_t status[3];
+    return sht3xCommand(SHT3X_CMD_STATUS) && halI2cRead(SHT3X_ADDRESS, status, sizeof(status)) &&
+           sht3xCrc(status) == status[2];
+}
+
+static uint16_t sht3xStart()
+{
+    return sht3xCommand(SHT3X_CMD_MEASURE) ? SHT3X_MEASURE_MS : SENSOR_START_FAILED;
+}
+
+static SensorStep sht3xStep(float values[SENSOR_CH_COUNT], uint16_t *)
+{
+    uint8_t raw[6];
+    if (!halI2cRead(SHT3X_ADDRESS, raw, sizeof(raw)) || sht3xCrc(raw) != raw[2] || sht3xCrc(raw + 3) != raw[5])
+        return SENSOR_STEP_ERROR;
+    values[SENSOR_CH_TEMPERATURE] = -45.0f + 175.0f * (uint16_t)(raw[0] << 8 | raw[1]) / 65535.0f;
+    values[SENSOR_CH_HUMIDITY] = 100.0f * (uint16_t)(raw[3] << 8 | raw[4]) / 65535.0f;
+    return SENSOR_STEP_DONE;
+}
+
+const SensorDriver SHT3X_DRIVER = {
+    "SHT3x",
+    SENSOR_CHANNEL_BIT(SENSOR_CH_TEMPERATURE) | SENSOR_CHANNEL_BIT(SENSOR_CH_HUMIDITY),
+    SHT3X_MEASURE_MS,
+    1000,
+    sht3xBegin,
+    sht3xStart,
+    sht3xStep,
+};
+#endif
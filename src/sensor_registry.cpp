@@ -0,0 +1,210 @@
+#include "sensor_registry.h"
+#include "hal.h"
+#include "log.h"
+#include <math.h>
+
+SensorSlot sensorSlots[SENSOR_MAX_DRIVERS];
+uint8_t sensorSlotCount = 0;
+uint32_t sensorCycleMs = 0;
+
+// === Исправность датчиков ===
+static void sensorSucceeded(SensorSlot &slot)
+{
+    if (slot.health == SENSOR_FAILED)
+    {
+        slot.recoveries++;
+        logInfo(LOG_SENSORS, "%s: recovered after %u failures", slot.driver->name, (unsigned)slot.failures);
+    }
+    slot.health = SENSOR_HEALTHY;
+    slot.failures = 0;
+    slot.backoffMs = 0;
+    slot.valid = true;
+    slot.reads++;
+}
+
+/**
+ * @brief Неудача измерения или поиска; probe — не найден при begin()
+ */
+static void sensorFailed(SensorSlot &slot, uint32_t now, bool probe)
+{
+    slot.valid = false;
+    slot.errors++;
+    if (slot.failures < UINT8_MAX)
+        slot.failures++;
+    if (!probe && slot.failures < SENSOR_FAIL_THRESHOLD)
+    {
+        slot.health = SENSOR_DEGRADED;
+        return;
+    }
+
+    // Следующая попытка — заново с begin(): датчик мог быть переподключён или сброшен
+    if (slot.health != SENSOR_FAILED)
+        slot.backoffMs = slot.driver->periodMs > SENSOR_BACKOFF_MIN_MS ? slot.driver->periodMs : SENSOR_BACKOFF_MIN_MS;
+    else
+        slot.backoffMs = slot.backoffMs < SENSOR_BACKOFF_MAX_MS / 2 ? slot.backoffMs * 2 : SENSOR_BACKOFF_MAX_MS;
+    if (slot.health != SENSOR_FAILED || slot.backoffMs == SENSOR_BACKOFF_MAX_MS)
+        logWarn(LOG_SENSORS, "%s: failed (%u in a row), next probe in %lu s", slot.driver->name,
+                (unsigned)slot.failures, (unsigned long)(slot.backoffMs / 1000));
+    slot.health = SENSOR_FAILED;
+    slot.ready = false;
+    slot.nextDue = now + slot.backoffMs;
+}
+
+const char *sensorHealthName(uint8_t health)
+{
+    switch (health)
+    {
+    case SENSOR_HEALTHY:
+        return "healthy";
+    case SENSOR_DEGRADED:
+        return "degraded";
+    default:
+        return "failed";
+    }
+}
+
+/**
+ * @brief Добавление драйвера; begin() вызывается сразу, при неудаче — повторно с нарастающей паузой
+ * @return true, если датчик найден
+ */
+bool sensorRegister(const SensorDriver *driver, bool optional)
+{
+    if (sensorSlotCount >= SENSOR_MAX_DRIVERS)
+        return false;
+
+    bool ready = driver->begin();
+    if (!ready && optional)
+    {
+        logWarn(LOG_SENSORS, "%s: not present", driver->name);
+        return false;
+    }
+
+    SensorSlot &slot = sensorSlots[sensorSlotCount++];
+    slot = {};
+    slot.driver = driver;
+    slot.ready = ready;
+    slot.nextDue = halMillis();
+    for (uint8_t ch = 0; ch < SENSOR_CH_COUNT; ch++)
+        slot.values[ch] = NAN;
+    if (!ready)
+        sensorFailed(slot, slot.nextDue, true);
+
+    logInfo(LOG_SENSORS, "%s: %s, conversion %u ms, period %lu ms", driver->name, slot.ready ? "ok" : "not found",
+            (unsigned)driver->conversionMs, (unsigned long)driver->periodMs);
+    return slot.ready;
+}
+
+/**
+ * @brief Запуск преобразований у всех датчиков, которым пора
+ */
+void sensorsStart(uint32_t now)
+{
+    for (uint8_t i = 0; i < sensorSlotCount; i++)
+    {
+        SensorSlot &slot = sensorSlots[i];
+        if (slot.active || (int32_t)(now - slot.nextDue) < 0)
+            continue;
+        slot.nextDue = now + slot.driver->periodMs;
+
+        if (!slot.ready)
+        {
+            slot.probes++;
+            slot.ready = slot.driver->begin();
+            if (!slot.ready)
+            {
+                sensorFailed(slot, now, true);
+                continue;
+            }
+        }
+        uint16_t wait = slot.driver->start();
+        if (wait == SENSOR_START_FAILED)
+        {
+            sensorFailed(slot, now, false);
+            continue;
+        }
+        slot.active = true;
+        slot.readyAt = now + wait;
+    }
+}
+
+/**
+ * @brief Сбор готовых результатов
+ * @return true — ещё есть незавершённые преобразования, *waitMs — до ближайшего
+ */
+bool sensorsPoll(uint32_t now, uint32_t *waitMs)
+{
+    bool pending = false;
+    uint32_t minWait = UINT32_MAX;
+
+    for (uint8_t i = 0; i < sensorSlotCount; i++)
+    {
+        SensorSlot &slot = sensorSlots[i];
+        if (!slot.active)
+            continue;
+
+        int32_t remaining = (int32_t)(slot.readyAt - now);
+        if (remaining <= 0)
+        {
+            uint16_t wait = 0;
+            SensorStep result = slot.driver->step(slot.values, &wait);
+            if (result == SENSOR_STEP_WAIT)
+            {
+                slot.readyAt = now + wait;
+                remaining = wait;
+            }
+            else
+            {
+                slot.active = false;
+                if (result == SENSOR_STEP_DONE)
+                    sensorSucceeded(slot);
+                else
+                    sensorFailed(slot, now, false);
+                continue;
+            }
+        }
+        pending = true;
+        if ((uint32_t)remaining < minWait)
+            minWait = (uint32_t)remaining;
+    }
+
+    if (waitMs)
+        *waitMs = pending ? minWait : 0;
+    return pending;
+}
+
+/**
+ * @brief Полный цикл: запуск, ожидание самого медленного датчика, сбор результатов
+ */
+void sensorsSample()
+{
+    uint32_t start = halMillis();
+    uint32_t now = start;
+    sensorsStart(now);
+
+    // Время цикла отсчитывается по выполненным ожиданиям: в симуляции halDelay() может не ждать
+    uint32_t wait;
+    while (sensorsPoll(now, &wait))
+    {
+        halDelay(wait + 1); // vTaskDelay() может вернуться на тик раньше
+        now += wait;
+        uint32_t real = halMillis();
+        if ((int32_t)(real - now) > 0)
+            now = real;
+    }
+
+    sensorCycleMs = halMillis() - start;
+}
+
+/**
+ * @brief Значение канала от первого исправного драйвера (в порядке регистрации)
+ */
+float sensorValue(SensorChannel channel)
+{
+    for (uint8_t i = 0; i < sensorSlotCount; i++)
+    {
+        const SensorSlot &slot = sensorSlots[i];
+        if (slot.valid && (slot.driver->channels & SENSOR_CHANNEL_BIT(channel)) && !isnan(slot.values[channel]))
+            return slot.values[channel];
+    }
+    return NAN;
+}
@@ -1,84 +1,117 @@
 #include "sensors.h"
 #include "config.h"
-#include <DHT.h>
-#include <Adafruit_BMP085.h>
-
-// === ПИНЫ ===
-// DHT22 подключён к GPIO18
-const uint8_t DHT_PIN = 18;
-
-// Глобальные объекты
-DHT dht22(DHT_PIN, DHT22);
-Adafruit_BMP085 bmp180;
+#include "hal.h"
+#include "sensor_registry.h"
+#include "sensor_drivers.h"
+#include "timebase.h"
+#include "feature_flags.h"
+#include "trace.h"
+#include <math.h>
 
 // Глобальные переменные
-float currentTemp = -999.0;
-float currentHumidity = -999.0;
-float currentPressure = -999.0;
-float currentVcc = 0.0;
-String lastError = "";
 bool sensorsInitialized = false;
 
+// === Снимок последнего показания ===
+// Две копии и счётчик (seqlock-защёлка). Писатель один — readSensors() в задаче измерений.
+// Читатель (веб в AsyncTCP, MQTT, HTTP) берёт копию seq & 1, которую писатель в этот момент
+// не изменяет, и повторяет чтение, только если за это время вышло новое показание —
+// ни одна сторона не ждёт другую, даже если писатель вытеснен посреди записи.
+static_assert(sizeof(SensorReading) % sizeof(uint32_t) == 0, "SensorReading is copied by words");
+static const size_t READING_WORDS = sizeof(SensorReading) / sizeof(uint32_t);
+
+union ReadingCopy
+{
+    SensorReading reading;
+    uint32_t words[READING_WORDS];
+};
+
+static ReadingCopy readingCopies[2] = {}; // flags = 0: ни одного действительного канала
+static uint32_t readingSeq = 0;
+static uint32_t sampleCount = 0;
+
+static void storeReading(const SensorReading &reading)
+{
+    ReadingCopy next;
+    next.reading = reading;
+    for (uint8_t copy = 0; copy < 2; copy++) {
+        // Нечётный seq уводит читателей на копию 1, пока пишется копия 0; чётный — обратно
+        __atomic_store_n(&readingSeq, readingSeq + 1, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (size_t i = 0; i < READING_WORDS; i++)
+            __atomic_store_n(&readingCopies[copy].words[i], next.words[i], __ATOMIC_RELAXED);
+    }
+}
+
+SensorReading latestReading()
+{
+    ReadingCopy snapshot;
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&readingSeq, __ATOMIC_ACQUIRE);
+        const ReadingCopy &copy = readingCopies[seq & 1];
+        for (size_t i = 0; i < READING_WORDS; i++)
+            snapshot.words[i] = __atomic_load_n(&copy.words[i], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (seq != __atomic_load_n(&readingSeq, __ATOMIC_RELAXED));
+    return snapshot.reading;
+}
+
 void initSensors()
 {
     if (sensorsInitialized) return;
 
-    // Инициализация I2C (SDA=21, SCL=22 на вашей плате)
-    Wire.begin(21, 22); // явно указываем пины для MH-ET LIVE D1 Mini ESP32
+    // Общая шина I2C для барометра и дополнительных датчиков
+    halI2cBegin(I2C_BUS_FREQUENCY);
 
-    // Инициализация DHT22
-    dht22.begin();
-
-    // Инициализация BMP180
-    if (!bmp180.begin()) {
-        lastError = "BMP180 not found!";
-        sensorsInitialized = false;
-        return;
+    // Порядок регистрации = приоритет источника канала: SHT3x точнее DHT22
+    if (sensorSlotCount == 0) {
+#if FEATURE_SHT3X
+        sensorRegister(&SHT3X_DRIVER, true); // есть не на всех площадках
+#endif
+#if FEATURE_DHT22
+        sensorRegister(&DHT22_DRIVER);
+#endif
+#if FEATURE_BMP180
+        sensorRegister(&BMP180_DRIVER);
+#endif
     }
 
     sensorsInitialized = true;
-    lastError = "";
 }
 
-void readBatteryVoltage()
+float readBatteryVoltage()
 {
-    int raw = analogRead(34);
-    float voltage = (raw * 3.3f / 4095.0f) * 2.0f; // 100k+100k
-    currentVcc = voltage;
+    int raw = halReadBatteryRaw();
+    return (raw * 3.3f / 4095.0f) * 2.0f; // 100k+100k
 }
 
 void readSensors()
 {
     if (!sensorsInitialized) {
         initSensors();
-        if (!sensorsInitialized) return;
     }
 
+    traceBegin(TRACE_SENSOR_READ);
+    SensorReading reading = {};
+    reading.sample = ++sampleCount;
+
     // Измеряем напряжение батареи
-    readBatteryVoltage();
-
-    // === Чтение DHT22 ===
-    float humidity = dht22.readHumidity();
-    float temp = dht22.readTemperature();
-
-    if (isnan(humidity) || isnan(temp)) {
-        lastError = "DHT22 error or disconnected!";
-        currentTemp = -999.0;
-        currentHumidity = -999.0;
-    } else {
-        currentTemp = temp + config.temp_offset;
-        currentHumidity = humidity;
-    }
+    sampleSetVcc(reading, readBatteryVoltage());
 
-    // === Чтение BMP180 ===
-    // readPressure() возвращает давление в **Паскалях**
-    int32_t pressure_pa = bmp180.readPressure(); // тип int32_t!
+    // Все датчики, которым пора, измеряют одновременно
+    sensorsSample();
+    reading.timestamp = timeNowMs();
 
-    if (pressure_pa <= 0) {
-        lastError += (lastError.length() > 0 ? " | " : "") + String("BMP180 read error");
-        currentPressure = -999.0;
-    } else {
-        // Переводим в мм. рт. ст.
-        currentPressure = pressure_pa / 133.3f; // теперь в мм. рт. ст.
-    }
+    // Канал без единого драйвера остаётся без флагов, иначе — значение или ошибка
+    uint8_t provided = 0;
+    for (uint8_t i = 0; i < sensorSlotCount; i++)
+        provided |= sensorSlots[i].driver->channels;
+    if (provided & SENSOR_CHANNEL_BIT(SENSOR_CH_TEMPERATURE))
+        sampleSetTemperature(reading, sensorValue(SENSOR_CH_TEMPERATURE) + config.temp_offset);
+    if (provided & SENSOR_CHANNEL_BIT(SENSOR_CH_HUMIDITY))
+        sampleSetHumidity(reading, sensorValue(SENSOR_CH_HUMIDITY));
+    if (provided & SENSOR_CHANNEL_BIT(SENSOR_CH_PRESSURE))
+        sampleSetPressure(reading, sensorValue(SENSOR_CH_PRESSURE));
+    storeReading(reading);
+    traceEnd(TRACE_SENSOR_READ);
 }
@@ -0,0 +1,268 @@
+#include "sink.h"
+#include "config.h"
+#include "mqtt.h"
+#include "post.h"
+#include "payload.h"
+#include "hal.h"
+#include "log.h"
+#include <string.h>
+
+static_assert((SINK_QUEUE_SIZE & (SINK_QUEUE_SIZE - 1)) == 0, "SINK_QUEUE_SIZE must be a power of two");
+
+Sink sinks[SINK_COUNT];
+
+static SinkWakeFn wakeWorker = nullptr;
+
+enum SinkResult : uint8_t
+{
+    SINK_SENT = 0,
+    SINK_FAILED,
+    SINK_OFFLINE // нет связи: показание ждёт в очереди, ошибкой не считается
+};
+
+// === Приёмники ===
+static SinkResult sendMqtt(const SinkEntry &entry)
+{
+    if (!isMqttConnected())
+        return SINK_OFFLINE;
+    bool sent = entry.node ? publishNodeReading(entry.mac, entry.reading) : publishSensorData(entry.reading);
+    return sent ? SINK_SENT : SINK_FAILED;
+}
+
+static SinkResult sendHttp(const SinkEntry &entry)
+{
+    if (!halNetConnected())
+        return SINK_OFFLINE;
+    bool sent = entry.node ? sendNodePostRequest(entry.mac, entry.rssi, entry.reading)
+                           : sendPostRequest(entry.reading);
+    return sent ? SINK_SENT : SINK_FAILED;
+}
+
+static SinkResult sendUdp(const SinkEntry &entry)
+{
+    if (!halNetConnected())
+        return SINK_OFFLINE;
+    // uid узла — его MAC; своё показание без заданного uid — тоже по MAC, иначе серии устройств сольются
+    char macUid[MAC_UID_SIZE];
+    const char *uid = config.uid;
+    if (entry.node)
+    {
+        formatMacUid(macUid, sizeof(macUid), entry.mac);
+        uid = macUid;
+    }
+    else if (uid[0] == '\0')
+    {
+        uint8_t mac[6];
+        halMacAddress(mac);
+        formatMacUid(macUid, sizeof(macUid), mac);
+        uid = macUid;
+    }
+    char line[PAYLOAD_MAX_SIZE];
+    size_t len = encodeLineProtocol(line, sizeof(line), uid, entry.node ? entry.rssi : halNetRssi(), entry.reading);
+    if (len == 0 || !halUdpSend(config.influx_host, config.influx_port, (const uint8_t *)line, len))
+        return SINK_FAILED;
+    return SINK_SENT;
+}
+
+struct SinkDriver
+{
+    const char *name;
+    SinkResult (*send)(const SinkEntry &entry);
+    bool retry; // неудачное показание повторяется; иначе отбрасывается
+};
+
+static const SinkDriver SINK_DRIVERS[SINK_COUNT] = {
+    {"mqtt", sendMqtt, true},
+    {"http", sendHttp, true},
+    {"udp", sendUdp, false},
+};
+
+const char *sinkName(uint8_t sink)
+{
+    return sink < SINK_COUNT ? SINK_DRIVERS[sink].name : "?";
+}
+
+bool sinkEnabled(uint8_t sink)
+{
+    switch (sink)
+    {
+    case SINK_MQTT:
+        return isMqttConfigured();
+    case SINK_HTTP:
+        return isPostConfigured();
+    case SINK_UDP:
+        return config.influx_host[0] != '\0' && config.influx_port > 0;
+    default:
+        return false;
+    }
+}
+
+void sinksReset()
+{
+    memset(sinks, 0, sizeof(sinks));
+}
+
+void sinkSetWake(SinkWakeFn wake)
+{
+    __atomic_store_n(&wakeWorker, wake, __ATOMIC_RELEASE);
+}
+
+// === Очередь и темп ===
+static uint32_t minIntervalMs(uint8_t sink)
+{
+    if (config.sink_min_interval[sink] > 0)
+        return config.sink_min_interval[sink];
+    unsigned long interval = config.adaptive_interval ? config.interval_min : config.publishingInterval;
+    return interval - interval / 8; // допуск на дрожание старта задачи и подстройку дедлайна по часам
+}
+
+static bool enqueue(Sink &s, const SinkEntry &entry)
+{
+    uint32_t head = s.head;
+    if (head - __atomic_load_n(&s.tail, __ATOMIC_ACQUIRE) == SINK_QUEUE_SIZE)
+        return false;
+    s.queue[head & (SINK_QUEUE_SIZE - 1)] = entry;
+    __atomic_store_n(&s.head, head + 1, __ATOMIC_RELEASE);
+    s.stats.queued++;
+    return true;
+}
+
+static void wakeHttp(uint8_t accepted)
+{
+    SinkWakeFn wake = __atomic_load_n(&wakeWorker, __ATOMIC_ACQUIRE);
+    if (wake && (accepted & (1 << SINK_HTTP)))
+        wake();
+}
+
+/**
+ * @brief Показание — в очереди всех настроенных приёмников, которым позволяет темп
+ */
+uint8_t sinkPublish(const SensorReading &reading)
+{
+    uint32_t now = halMillis();
+    SinkEntry entry = {};
+    entry.reading = reading;
+    uint8_t accepted = 0;
+    for (uint8_t i = 0; i < SINK_COUNT; i++)
+    {
+        if (!sinkEnabled(i))
+            continue;
+        Sink &s = sinks[i];
+        if (s.paced && now - s.lastAcceptMs < minIntervalMs(i))
+        {
+            s.stats.limited++;
+            continue;
+        }
+        s.paced = true;
+        s.lastAcceptMs = now;
+
+        if (!enqueue(s, entry))
+        {
+            s.stats.dropped++;
+            continue;
+        }
+        accepted |= 1 << i;
+    }
+    wakeHttp(accepted);
+    return accepted;
+}
+
+/**
+ * @brief Показание узла ESP-NOW — в очереди настроенных приёмников, ещё не принявших его
+ */
+bool sinkPublishNode(const uint8_t mac[6], int rssi, const SensorReading &reading, uint8_t &accepted)
+{
+    SinkEntry entry = {};
+    entry.reading = reading;
+    memcpy(entry.mac, mac, sizeof(entry.mac));
+    entry.rssi = (int8_t)rssi;
+    entry.node = true;
+    uint8_t added = 0;
+    bool all = true;
+    for (uint8_t i = 0; i < SINK_COUNT; i++)
+    {
+        if (!sinkEnabled(i) || (accepted & (1 << i)))
+            continue;
+        if (enqueue(sinks[i], entry))
+            added |= 1 << i;
+        else
+            all = false; // шлюз предложит снова при следующей пересылке
+    }
+    accepted |= added;
+    wakeHttp(added);
+    return all;
+}
+
+/**
+ * @brief Пауза до повтора: удвоение от SINK_RETRY_MIN_MS до SINK_RETRY_MAX_MS
+ */
+static uint32_t retryDelayMs(uint8_t failures)
+{
+    if (failures > 7 || (SINK_RETRY_MIN_MS << (failures - 1)) > SINK_RETRY_MAX_MS)
+        return SINK_RETRY_MAX_MS;
+    return SINK_RETRY_MIN_MS << (failures - 1);
+}
+
+/**
+ * @brief Отправка очереди приёмника по порядку, пока не опустеет, не пропадёт связь
+ *        или отправка не сорвётся
+ */
+uint32_t sinkServe(uint8_t sink)
+{
+    if (sink >= SINK_COUNT)
+        return SINK_IDLE;
+    Sink &s = sinks[sink];
+    const SinkDriver &driver = SINK_DRIVERS[sink];
+    for (;;)
+    {
+        uint32_t tail = s.tail;
+        if (tail == __atomic_load_n(&s.head, __ATOMIC_ACQUIRE))
+            return SINK_IDLE;
+        uint32_t now = halMillis();
+        if (s.failures > 0 && (int32_t)(s.retryAtMs - now) > 0)
+            return s.retryAtMs - now;
+
+        unsigned long start = halMicros();
+        SinkResult result = driver.send(s.queue[tail & (SINK_QUEUE_SIZE - 1)]);
+        if (result == SINK_OFFLINE)
+            return SINK_OFFLINE_POLL_MS;
+        s.stats.lastUs = halMicros() - start;
+        if (s.stats.lastUs > s.stats.maxUs)
+            s.stats.maxUs = s.stats.lastUs;
+
+        if (result == SINK_SENT)
+        {
+            s.stats.sent++;
+            if (s.failures > 0)
+                logInfo(LOG_SINK, "%s: recovered after %u failures", driver.name, s.failures);
+            s.failures = 0;
+        }
+        else
+        {
+            s.stats.failed++;
+            if (driver.retry)
+            {
+                if (s.failures < UINT8_MAX)
+                    s.failures++;
+                uint32_t delay = retryDelayMs(s.failures);
+                s.retryAtMs = now + delay;
+                if (s.failures == 1)
+                    logWarn(LOG_SINK, "%s: send failed, %lu queued, retry in %lu ms", driver.name,
+                            (unsigned long)sinkPending(sink), (unsigned long)delay);
+                return delay;
+            }
+        }
+        __atomic_store_n(&s.tail, tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+uint32_t sinkPending(uint8_t sink)
+{
+    return __atomic_load_n(&sinks[sink].head, __ATOMIC_ACQUIRE) - __atomic_load_n(&sinks[sink].tail, __ATOMIC_ACQUIRE);
+}
+
+void sinkServeAll()
+{
+    for (uint8_t i = 0; i < SINK_COUNT; i++)
+        sinkServe(i);
+}
@@ -0,0 +1,46 @@
+// Приёмники на плате: HTTP POST — в своей задаче, чтобы запрос с TLS (до HTTP_POST_TIMEOUT_MS)
+// не задерживал измерение, MQTT и UDP (их отправляет задача измерения, sinkServe())
+#include <Arduino.h>
+#include "sink.h"
+#include "post.h"
+#include "power.h"
+#include "log.h"
+
+#define SINK_TASK_STACK 8192 // mbedTLS: рукопожатие идёт в стеке вызывающей задачи
+
+static TaskHandle_t sinkTask = nullptr;
+
+static void wakeSinkTask()
+{
+    xTaskNotifyGive(sinkTask);
+}
+
+static void sinkTaskLoop(void *)
+{
+    for (;;)
+    {
+        powerBusyBegin();
+        uint32_t waitMs = sinkServe(SINK_HTTP);
+        powerBusyEnd();
+        // sinkPublish() будит задачу, поставив показание в очередь HTTP
+        ulTaskNotifyTake(pdTRUE, waitMs == SINK_IDLE ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+    }
+}
+
+/**
+ * @brief Задача HTTP; без post_url (или в сборке без HTTP POST) не нужна
+ */
+bool sinkStart()
+{
+    if (sinkTask)
+        return true;
+    if (!isPostConfigured())
+        return false;
+    if (xTaskCreate(sinkTaskLoop, "SinkTask", SINK_TASK_STACK, NULL, 1, &sinkTask) != pdPASS)
+    {
+        logError(LOG_SINK, "SinkTask not started, HTTP sends from the sensor task");
+        return false;
+    }
+    sinkSetWake(wakeSinkTask);
+    return true;
+}
@@ -0,0 +1,81 @@
+#include "task_timing.h"
+#include "hal.h"
+#include "log.h"
+
+TaskTiming sensorTaskTiming;
+TaskTiming systemTaskTiming;
+
+/**
+ * @brief Первый дедлайн — сейчас
+ */
+void taskTimingBegin(TaskTiming &t, const char *name, uint8_t policy, uint32_t nowMs)
+{
+    memset(&t, 0, sizeof(t));
+    t.name = name;
+    t.policy = policy;
+    t.deadlineMs = nowMs;
+}
+
+void taskTimingStart(TaskTiming &t, uint32_t nowMs, uint32_t nowUs)
+{
+    int32_t late = (int32_t)(nowMs - t.deadlineMs);
+    t.jitterLastMs = late > 0 ? (uint32_t)late : 0;
+    if (t.jitterLastMs > t.jitterMaxMs)
+        t.jitterMaxMs = t.jitterLastMs;
+    t.jitterSumMs += t.jitterLastMs;
+    t.startUs = nowUs;
+    t.runs++;
+}
+
+/**
+ * @brief Конец итерации: сдвиг дедлайна на период (с учётом политики перерасхода)
+ * @return приращение дедлайна, мс — аргумент vTaskDelayUntil()
+ */
+uint32_t taskTimingEnd(TaskTiming &t, uint32_t periodMs, uint32_t nowMs, uint32_t nowUs)
+{
+    t.execLastUs = nowUs - t.startUs;
+    if (t.execLastUs > t.execMaxUs)
+        t.execMaxUs = t.execLastUs;
+    t.periodMs = periodMs;
+
+    uint32_t increment = periodMs;
+    int32_t late = (int32_t)(nowMs - (t.deadlineMs + periodMs));
+    if (late >= 0 && periodMs > 0)
+    {
+        t.overruns++;
+        uint32_t missed = (uint32_t)late / periodMs + 1; // дедлайны, оставшиеся в прошлом
+        uint32_t keep = t.policy == TASK_OVERRUN_CATCH_UP ? TASK_MAX_CATCH_UP : 0;
+        if (missed > keep)
+        {
+            // Без серии запусков подряд: следующий — на ближайшем дедлайне сетки в будущем
+            uint32_t skip = missed - keep;
+            increment += skip * periodMs;
+            t.skipped += skip;
+        }
+        logWarn(LOG_TASK, "%s overrun: exec %lu us, period %lu ms, skipped %lu", t.name,
+                (unsigned long)t.execLastUs, (unsigned long)periodMs, (unsigned long)t.skipped);
+    }
+    t.deadlineMs += increment;
+
+    if (t.runs % TASK_TIMING_REPORT_RUNS == 0)
+    {
+        logInfo(LOG_TASK, "%s: runs %lu, jitter avg %lu / max %lu ms, overruns %lu, skipped %lu, WCET %lu us", t.name,
+                (unsigned long)t.runs, (unsigned long)taskTimingJitterAvgMs(t), (unsigned long)t.jitterMaxMs,
+                (unsigned long)t.overruns, (unsigned long)t.skipped, (unsigned long)t.execMaxUs);
+    }
+    return increment;
+}
+
+/**
+ * @brief Ожидание до текущего дедлайна (для платформ без vTaskDelayUntil)
+ */
+uint32_t taskTimingWaitMs(const TaskTiming &t, uint32_t nowMs)
+{
+    int32_t wait = (int32_t)(t.deadlineMs - nowMs);
+    return wait > 0 ? (uint32_t)wait : 0;
+}
+
+uint32_t taskTimingJitterAvgMs(const TaskTiming &t)
+{
+    return t.runs ? (uint32_t)(t.jitterSumMs / t.runs) : 0;
+}
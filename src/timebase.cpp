@@ -0,0 +1,115 @@
+#include "timebase.h"
+#include "hal.h"
+#include "log.h"
+
+// Секунды между 1900-01-01 (эпоха NTP) и 1970-01-01
+const uint64_t NTP_UNIX_DELTA_S = 2208988800ULL;
+const size_t SNTP_PACKET_SIZE = 48;
+
+static uint64_t ntpToUnixUs(const uint8_t *p)
+{
+    uint32_t seconds = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    uint32_t fraction = (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+    return ((uint64_t)seconds - NTP_UNIX_DELTA_S) * 1000000ULL + (((uint64_t)fraction * 1000000ULL) >> 32);
+}
+
+// Эпоха по локальным часам clockUs с поправкой на уход
+static int64_t predictUs(uint64_t clockUs)
+{
+    int64_t elapsed = (int64_t)(clockUs - timeBase.syncClockUs);
+    int64_t correction = (int64_t)((double)elapsed * timeBase.driftPpm / 1e6);
+    return (int64_t)clockUs + timeBase.offsetUs + correction;
+}
+
+/**
+ * @brief Запрос SNTP и пересчёт смещения; со второй синхронизации — оценка ухода часов
+ */
+bool timeSync(const char *server)
+{
+    uint8_t request[SNTP_PACKET_SIZE] = {0};
+    uint8_t response[SNTP_PACKET_SIZE];
+    request[0] = 0x23; // LI=0, версия 4, режим 3 (клиент)
+
+    // Своё время отправки в transmit timestamp: сервер вернёт его в originate
+    uint64_t t1 = halClockUs();
+    for (uint8_t i = 0; i < 8; i++)
+        request[40 + i] = (uint8_t)(t1 >> (56 - 8 * i));
+
+    int len = halUdpRequest(server, SNTP_PORT, request, sizeof(request), response, sizeof(response), SNTP_TIMEOUT_MS);
+    uint64_t t4 = halClockUs();
+
+    if (len < (int)SNTP_PACKET_SIZE || (response[0] & 0x07) != 4 || response[1] == 0 || response[1] > 15 ||
+        memcmp(response + 24, request + 40, 8) != 0)
+    {
+        logWarn(LOG_TIME, "SNTP %s: no valid response", server);
+        return false;
+    }
+
+    // Смещение по четырём меткам; задержка сети делится пополам
+    int64_t t2 = (int64_t)ntpToUnixUs(response + 32);
+    int64_t t3 = (int64_t)ntpToUnixUs(response + 40);
+    int64_t offset = ((t2 - (int64_t)t1) + (t3 - (int64_t)t4)) / 2;
+    int64_t delay = ((int64_t)t4 - (int64_t)t1) - (t3 - t2);
+
+    bool valid = timeBase.synced && t4 > timeBase.syncClockUs;
+    if (valid)
+    {
+        int64_t error = (int64_t)t4 + offset - predictUs(t4);
+        uint64_t span = t4 - timeBase.syncClockUs;
+        timeBase.lastErrorUs = (int32_t)(error > INT32_MAX ? INT32_MAX : error < INT32_MIN ? INT32_MIN : error);
+        if (span >= TIME_DRIFT_MIN_SPAN_S * 1000000ULL)
+        {
+            float measured = timeBase.driftPpm + (float)((double)error * 1e6 / (double)span);
+            timeBase.driftPpm = timeBase.driftKnown ? (timeBase.driftPpm + measured) / 2 : measured;
+            if (timeBase.driftPpm > TIME_DRIFT_MAX_PPM)
+                timeBase.driftPpm = TIME_DRIFT_MAX_PPM;
+            if (timeBase.driftPpm < -TIME_DRIFT_MAX_PPM)
+                timeBase.driftPpm = -TIME_DRIFT_MAX_PPM;
+            timeBase.driftKnown = true;
+        }
+    }
+    else
+    {
+        // Первая синхронизация или часы сброшены (питание): уход неизвестен
+        timeBase.driftPpm = 0;
+        timeBase.driftKnown = false;
+        timeBase.lastErrorUs = 0;
+    }
+
+    timeBase.synced = true;
+    timeBase.syncClockUs = t4;
+    timeBase.offsetUs = offset;
+    timeBase.lastDelayUs = delay > 0 ? (uint32_t)delay : 0;
+    timeBase.syncCount++;
+
+    logInfo(LOG_TIME, "SNTP %s: error %ld us, delay %lu us, drift %.1f ppm%s", server, (long)timeBase.lastErrorUs,
+            (unsigned long)timeBase.lastDelayUs, timeBase.driftPpm, timeBase.driftKnown ? "" : " (unknown)");
+    return true;
+}
+
+bool timeSyncDue()
+{
+    if (!timeBase.synced)
+        return true;
+    uint64_t clock = halClockUs();
+    if (clock < timeBase.syncClockUs)
+        return true; // локальные часы начались заново
+    uint64_t interval = timeBase.driftKnown ? TIME_SYNC_INTERVAL_S : TIME_SYNC_FIRST_INTERVAL_S;
+    return clock - timeBase.syncClockUs >= interval * 1000000ULL;
+}
+
+uint64_t timeNowUs()
+{
+    if (!timeBase.synced)
+        return 0;
+    uint64_t clock = halClockUs();
+    if (clock < timeBase.syncClockUs)
+        return 0;
+    int64_t now = predictUs(clock);
+    return now > 0 ? (uint64_t)now : 0;
+}
+
+uint64_t timeNowMs()
+{
+    return timeNowUs() / 1000;
+}
@@ -0,0 +1,361 @@
+#include "trace.h"
+#include "hal.h"
+#include <stdio.h>
+#include <string.h>
+
+static_assert((TRACE_EVENTS & (TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS must be a power of two");
+
+static const char *const TRACE_SPAN_NAMES[TRACE_SPAN_COUNT] = {"sensor_read", "mqtt_publish", "http_post", "flash_write"};
+
+#if FEATURE_TRACE
+TraceEvent traceBuffer[TRACE_EVENTS];
+uint32_t traceWriteIndex = 0;
+bool traceEnabled = true; // с загрузки: заминка в начале работы тоже попадает в буфер
+
+void traceBegin(TraceSpan span)
+{
+    traceRecord(halMicros(), TRACE_BEGIN, halCpuCore(), halTaskId(), span);
+}
+
+void traceEnd(TraceSpan span)
+{
+    traceRecord(halMicros(), TRACE_END, halCpuCore(), halTaskId(), span);
+}
+
+void traceSetEnabled(bool enabled)
+{
+    __atomic_store_n(&traceEnabled, enabled, __ATOMIC_RELAXED);
+}
+
+static uint16_t addTask(TraceImage &image, uint32_t id)
+{
+    for (uint16_t i = 0; i < image.taskCount; i++)
+    {
+        if (image.tasks[i].id == id)
+            return i;
+    }
+    if (image.taskCount == TRACE_TASKS_MAX)
+        return image.taskCount;
+    TraceTask &task = image.tasks[image.taskCount];
+    task.id = id;
+    task.name[0] = '\0';
+    return image.taskCount++;
+}
+
+static void nameTask(uint32_t id, const char *name, void *ctx)
+{
+    TraceImage &image = *(TraceImage *)ctx;
+    for (uint16_t i = 0; i < image.taskCount; i++)
+    {
+        if (image.tasks[i].id == id)
+            strlcpy(image.tasks[i].name, name, TRACE_TASK_NAME_SIZE);
+    }
+}
+
+/**
+ * @brief Кольцо как образ для выгрузки; имена — у задач, существующих сейчас
+ *        (удалённые к этому моменту остаются с пустым именем и выводятся по хендлу)
+ */
+void traceSnapshot(TraceImage &image)
+{
+    uint32_t end = __atomic_load_n(&traceWriteIndex, __ATOMIC_RELAXED);
+    image.events = traceBuffer;
+    image.capacity = TRACE_EVENTS;
+    image.count = end < TRACE_EVENTS ? end : TRACE_EVENTS;
+    image.first = end - image.count;
+    image.lost = image.first;
+    image.taskCount = 0;
+    for (uint32_t i = 0; i < image.count; i++)
+    {
+        const TraceEvent &e = traceBuffer[(image.first + i) & (TRACE_EVENTS - 1)];
+        if (e.type <= TRACE_END)
+            addTask(image, e.arg);
+    }
+    halTaskForEach(nameTask, &image);
+}
+#endif
+
+const char *traceSpanName(uint16_t span)
+{
+    return span < TRACE_SPAN_COUNT ? TRACE_SPAN_NAMES[span] : "?";
+}
+
+bool traceLoad(TraceImage &image, const uint8_t *data, size_t len)
+{
+    TraceFileHeader header;
+    if (len < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION || header.taskCount > TRACE_TASKS_MAX)
+        return false;
+    size_t tasksSize = header.taskCount * sizeof(TraceTask);
+    if (len < sizeof(header) + tasksSize || (len - sizeof(header) - tasksSize) / sizeof(TraceEvent) < header.eventCount)
+        return false; // обрезанный файл (деление — без переполнения на 32-битной платформе)
+
+    memcpy(image.tasks, data + sizeof(header), tasksSize);
+    for (uint16_t i = 0; i < header.taskCount; i++)
+        image.tasks[i].name[TRACE_TASK_NAME_SIZE - 1] = '\0';
+    image.taskCount = header.taskCount;
+    image.events = (const TraceEvent *)(data + sizeof(header) + tasksSize);
+    // Индекс события по маске: ёмкость — степень двойки не меньше числа событий
+    image.capacity = 1;
+    while (image.capacity < header.eventCount)
+        image.capacity <<= 1;
+    image.first = 0;
+    image.count = header.eventCount;
+    image.lost = header.lost;
+    return true;
+}
+
+// === Выгрузка ===
+static const TraceEvent &eventAt(const TraceImage &image, uint32_t i)
+{
+    return image.events[(image.first + i) & (image.capacity - 1)];
+}
+
+static uint16_t taskIndex(const TraceImage &image, uint32_t id)
+{
+    for (uint16_t i = 0; i < image.taskCount; i++)
+    {
+        if (image.tasks[i].id == id)
+            return i;
+    }
+    return image.taskCount; // не поместилась в таблицу
+}
+
+// Имя задачи строкой JSON: худший случай — все символы управляющие (\u00XX)
+#define TRACE_NAME_JSON_SIZE (TRACE_TASK_NAME_SIZE * 6)
+
+static void taskName(const TraceImage &image, uint16_t index, char *buf, size_t size)
+{
+    char raw[TRACE_TASK_NAME_SIZE];
+    if (index < image.taskCount && image.tasks[index].name[0])
+        snprintf(raw, sizeof(raw), "%s", image.tasks[index].name);
+    else if (index < image.taskCount)
+        snprintf(raw, sizeof(raw), "task %08lx", (unsigned long)image.tasks[index].id);
+    else
+        snprintf(raw, sizeof(raw), "other");
+
+    // Кавычка и обратная косая черта экранируются, управляющие символы — \u00XX
+    size_t len = 0;
+    for (const char *c = raw; *c && len + 7 <= size; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            buf[len++] = '\\';
+            buf[len++] = *c;
+        }
+        else if ((uint8_t)*c < 0x20)
+        {
+            len += snprintf(buf + len, size - len, "\\u%04x", (uint8_t)*c);
+        }
+        else
+        {
+            buf[len++] = *c;
+        }
+    }
+    buf[len] = '\0';
+}
+
+static void setText(TraceStream &stream, int len)
+{
+    stream.textLen = len < 0 ? 0 : len < TRACE_TEXT_SIZE ? (uint16_t)len : TRACE_TEXT_SIZE - 1;
+    stream.textPos = 0;
+}
+
+static void setBytes(TraceStream &stream, const void *data, size_t len)
+{
+    memcpy(stream.text, data, len);
+    stream.textLen = (uint16_t)len;
+    stream.textPos = 0;
+}
+
+// Время события от первого в образе: разность по модулю 2^32 между соседними событиями
+static uint64_t advanceTime(TraceStream &stream, uint32_t timeUs)
+{
+    int32_t delta = (int32_t)(timeUs - stream.lastUs);
+    stream.lastUs = timeUs;
+    if (delta > 0 || (uint64_t)-delta <= stream.nowUs)
+        stream.nowUs += delta; // события разных ядер могут лечь в кольцо чуть не по порядку
+    return stream.nowUs;
+}
+
+/**
+ * @brief Выполнение задачи на ядре — "X"-событие в процессе CPU (pid 0, поток = ядро)
+ */
+static int formatRun(TraceStream &stream, uint8_t core, uint16_t running, uint64_t start, uint64_t endUs)
+{
+    char name[TRACE_NAME_JSON_SIZE];
+    taskName(*stream.image, running - 1, name, sizeof(name));
+    return snprintf(stream.text, TRACE_TEXT_SIZE, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",
+                    name, core, (unsigned long long)start, (unsigned long long)(endUs - start));
+}
+
+static bool nextJson(TraceStream &stream)
+{
+    const TraceImage &image = *stream.image;
+    char name[TRACE_NAME_JSON_SIZE];
+    switch (stream.phase)
+    {
+    case TRACE_PHASE_HEADER:
+        setText(stream, snprintf(stream.text, TRACE_TEXT_SIZE,
+                                 "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"lost_events\":%lu},\"traceEvents\":[\n"
+                                 "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n"
+                                 "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Tasks\"}}",
+                                 (unsigned long)image.lost));
+        stream.phase = TRACE_PHASE_TASKS;
+        stream.index = 0;
+        return true;
+
+    case TRACE_PHASE_TASKS:
+        // Имена потоков: ядра и их прерывания в процессе CPU, задачи (и «other» сверх таблицы) — в Tasks
+        if (stream.index < 2 * TRACE_CORES)
+        {
+            uint32_t core = stream.index % TRACE_CORES;
+            setText(stream, snprintf(stream.text, TRACE_TEXT_SIZE,
+                                     ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%lu,\"args\":{\"name\":\"%sCPU%lu\"}}",
+                                     (unsigned long)stream.index, stream.index < TRACE_CORES ? "" : "ISR ", (unsigned long)core));
+            stream.index++;
+            return true;
+        }
+        if (stream.index - 2 * TRACE_CORES <= image.taskCount)
+        {
+            uint16_t task = stream.index - 2 * TRACE_CORES;
+            taskName(image, task, name, sizeof(name));
+            setText(stream, snprintf(stream.text, TRACE_TEXT_SIZE,
+                                     ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                                     task, name));
+            stream.index++;
+            return true;
+        }
+        stream.phase = TRACE_PHASE_EVENTS;
+        stream.index = 0;
+        if (image.count > 0)
+            stream.lastUs = eventAt(image, 0).timeUs;
+        // fallthrough
+    case TRACE_PHASE_EVENTS:
+        while (stream.index < image.count)
+        {
+            const TraceEvent &e = eventAt(image, stream.index++);
+            uint64_t ts = advanceTime(stream, e.timeUs);
+            uint8_t core = e.core < TRACE_CORES ? e.core : TRACE_CORES - 1;
+            switch (e.type)
+            {
+            case TRACE_SWITCH:
+            {
+                uint16_t previous = stream.running[core];
+                uint64_t since = stream.runningSince[core];
+                stream.running[core] = taskIndex(image, e.arg) + 1;
+                stream.runningSince[core] = ts;
+                if (previous == 0)
+                    continue;
+                setText(stream, formatRun(stream, core, previous, since, ts));
+                return true;
+            }
+            case TRACE_BEGIN:
+            case TRACE_END:
+                setText(stream, snprintf(stream.text, TRACE_TEXT_SIZE,
+                                         ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"args\":{\"core\":%u}}",
+                                         traceSpanName(e.id), e.type == TRACE_BEGIN ? 'B' : 'E', taskIndex(image, e.arg),
+                                         (unsigned long long)ts, e.core));
+                return true;
+            case TRACE_ISR_ENTER:
+            case TRACE_ISR_EXIT:
+                setText(stream, snprintf(stream.text, TRACE_TEXT_SIZE,
+                                         ",\n{\"name\":\"isr %u\",\"ph\":\"%c\",\"pid\":0,\"tid\":%u,\"ts\":%llu}",
+                                         e.id, e.type == TRACE_ISR_ENTER ? 'B' : 'E', TRACE_CORES + core, (unsigned long long)ts));
+                return true;
+            default:
+                continue;
+            }
+        }
+        stream.phase = TRACE_PHASE_FOOTER;
+        stream.index = 0;
+        // fallthrough
+    case TRACE_PHASE_FOOTER:
+        // Задачи, выполнявшиеся в момент выгрузки, — до последнего события
+        while (stream.index < TRACE_CORES)
+        {
+            uint8_t core = stream.index++;
+            if (stream.running[core] == 0 || stream.runningSince[core] == stream.nowUs)
+                continue;
+            setText(stream, formatRun(stream, core, stream.running[core], stream.runningSince[core], stream.nowUs));
+            return true;
+        }
+        setText(stream, snprintf(stream.text, TRACE_TEXT_SIZE, "\n]}\n"));
+        stream.phase = TRACE_PHASE_DONE;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static bool nextBinary(TraceStream &stream)
+{
+    const TraceImage &image = *stream.image;
+    switch (stream.phase)
+    {
+    case TRACE_PHASE_HEADER:
+    {
+        TraceFileHeader header = {TRACE_MAGIC, TRACE_VERSION, image.taskCount, image.count, image.lost};
+        setBytes(stream, &header, sizeof(header));
+        stream.phase = TRACE_PHASE_TASKS;
+        stream.index = 0;
+        return true;
+    }
+    case TRACE_PHASE_TASKS:
+        if (stream.index < image.taskCount)
+        {
+            setBytes(stream, &image.tasks[stream.index++], sizeof(TraceTask));
+            return true;
+        }
+        stream.phase = TRACE_PHASE_EVENTS;
+        stream.index = 0;
+        // fallthrough
+    case TRACE_PHASE_EVENTS:
+    {
+        // Событиями порциями по размеру буфера
+        size_t n = image.count - stream.index;
+        if (n == 0)
+        {
+            stream.phase = TRACE_PHASE_DONE;
+            return false;
+        }
+        if (n > TRACE_TEXT_SIZE / sizeof(TraceEvent))
+            n = TRACE_TEXT_SIZE / sizeof(TraceEvent);
+        for (size_t i = 0; i < n; i++)
+            memcpy(stream.text + i * sizeof(TraceEvent), &eventAt(image, stream.index++), sizeof(TraceEvent));
+        stream.textLen = (uint16_t)(n * sizeof(TraceEvent));
+        stream.textPos = 0;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void traceStreamBegin(TraceStream &stream, const TraceImage &image, bool json)
+{
+    memset(&stream, 0, sizeof(stream));
+    stream.image = &image;
+    stream.json = json;
+    stream.phase = TRACE_PHASE_HEADER;
+}
+
+size_t traceStreamRead(TraceStream &stream, uint8_t *buf, size_t size)
+{
+    size_t len = 0;
+    while (len < size)
+    {
+        if (stream.textPos == stream.textLen && !(stream.json ? nextJson(stream) : nextBinary(stream)))
+            break;
+        size_t n = stream.textLen - stream.textPos;
+        if (n > size - len)
+            n = size - len;
+        memcpy(buf + len, stream.text + stream.textPos, n);
+        stream.textPos += (uint16_t)n;
+        len += n;
+    }
+    return len;
+}
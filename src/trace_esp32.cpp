@@ -0,0 +1,48 @@
+// Трассировка на плате: смена задач по хуку тика FreeRTOS на каждом ядре, события прерываний.
+// Хуки трассировки FreeRTOS (traceTASK_SWITCHED_IN) собраны в библиотеку SDK Arduino
+// и без пересборки ESP-IDF недоступны: хук тика видит, какая задача была текущей в момент
+// тика, — переключения видны с точностью до периода тика (1 мс), короткие запуски между
+// тиками не видны.
+#include "feature_flags.h"
+#if FEATURE_TRACE
+#include <Arduino.h>
+#include <esp_freertos_hooks.h>
+#include <esp_timer.h>
+#include "trace.h"
+#include "log.h"
+
+static TaskHandle_t lastTask[TRACE_CORES] = {};
+
+static void IRAM_ATTR traceTick()
+{
+    uint8_t core = (uint8_t)xPortGetCoreID();
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task == lastTask[core])
+        return;
+    lastTask[core] = task;
+    traceRecord((uint32_t)esp_timer_get_time(), TRACE_SWITCH, core, (uint32_t)task, 0);
+}
+
+void IRAM_ATTR traceIsrEnter(uint16_t isr)
+{
+    traceRecord((uint32_t)esp_timer_get_time(), TRACE_ISR_ENTER, (uint8_t)xPortGetCoreID(), 0, isr);
+}
+
+void IRAM_ATTR traceIsrExit(uint16_t isr)
+{
+    traceRecord((uint32_t)esp_timer_get_time(), TRACE_ISR_EXIT, (uint8_t)xPortGetCoreID(), 0, isr);
+}
+
+/**
+ * @brief Хук тика на обоих ядрах
+ */
+void traceStart()
+{
+    for (uint8_t core = 0; core < portNUM_PROCESSORS && core < TRACE_CORES; core++)
+    {
+        if (esp_register_freertos_tick_hook_for_cpu(traceTick, core) != ESP_OK)
+            logError(LOG_TASK, "Trace tick hook on CPU%u failed", core);
+    }
+    logInfo(LOG_TASK, "Trace: %u events in RAM, /api/trace", TRACE_EVENTS);
+}
+#endif
@@ -0,0 +1,72 @@
+// trace_native.cpp — перевод двоичной трассы в JSON Chrome trace на компьютере ([env:native_trace])
+// Запуск: .pio/build/native_trace/program trace.bin > trace.json
+// Образ — /api/trace.bin с узла или файл симуляции (program -T trace.bin); перевод — тот же
+// код, что отдаёт /api/trace на плате (trace.cpp).
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint8_t *readFile(const char *path, size_t &len)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return nullptr;
+    uint8_t *data = nullptr;
+    len = 0;
+    size_t capacity = 0;
+    for (;;)
+    {
+        if (len == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64 * 1024;
+            uint8_t *grown = (uint8_t *)realloc(data, capacity);
+            if (!grown)
+            {
+                free(data);
+                fclose(file);
+                return nullptr;
+            }
+            data = grown;
+        }
+        size_t n = fread(data + len, 1, capacity - len, file);
+        if (n == 0)
+            break;
+        len += n;
+    }
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        printf("Usage: %s trace.bin > trace.json\n", argv[0]);
+        return 1;
+    }
+    size_t len;
+    uint8_t *data = readFile(argv[1], len);
+    if (!data)
+    {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return 1;
+    }
+    static TraceImage image;
+    if (!traceLoad(image, data, len))
+    {
+        fprintf(stderr, "%s: not a trace image (version %d)\n", argv[1], TRACE_VERSION);
+        free(data);
+        return 1;
+    }
+
+    static TraceStream stream;
+    traceStreamBegin(stream, image, true);
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = traceStreamRead(stream, buf, sizeof(buf))) > 0)
+        fwrite(buf, 1, n, stdout);
+    fprintf(stderr, "%lu events, %u tasks, %lu lost\n", (unsigned long)image.count, image.taskCount,
+            (unsigned long)image.lost);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "ulp.h"
+#include <stdio.h>
+
+// Делитель 100k+100k, опорное 3.3 В на 4095 (как в readBatteryVoltage())
+uint16_t ulpMillivoltsToRaw(uint16_t mv)
+{
+    uint32_t raw = (uint32_t)mv * 4095 / 6600;
+    return raw > 4095 ? 4095 : (uint16_t)raw;
+}
+
+uint16_t ulpRawToMillivolts(uint16_t raw)
+{
+    return (uint16_t)((uint32_t)raw * 6600 / 4095);
+}
+
+/**
+ * @brief Сброс истории и окно порогов ±ULP_WAKE_DELTA_MV вокруг последнего отсчёта
+ */
+void ulpArm(uint32_t *data, uint16_t lastRaw)
+{
+    uint16_t delta = ulpMillivoltsToRaw(ULP_WAKE_DELTA_MV);
+    data[ULP_VAR_LOW] = lastRaw > delta ? lastRaw - delta : 0;
+    data[ULP_VAR_HIGH] = lastRaw + delta < 4095 ? lastRaw + delta : 4095;
+    data[ULP_VAR_COUNT] = 0;
+    data[ULP_VAR_LAST] = lastRaw;
+    data[ULP_VAR_REASON] = ULP_WAKE_NONE;
+}
+
+/**
+ * @brief Разбор области данных после пробуждения
+ * @return false — данные повреждены (например, после сброса питания)
+ */
+bool ulpReadHistory(const uint32_t *data, UlpHistory &history)
+{
+    uint16_t count = (uint16_t)data[ULP_VAR_COUNT];
+    uint16_t reason = (uint16_t)data[ULP_VAR_REASON];
+    if (count > ULP_HISTORY_SIZE || reason > ULP_WAKE_FULL)
+        return false;
+
+    history.reason = (uint8_t)reason;
+    history.count = (uint8_t)count;
+    for (uint8_t i = 0; i < count; i++)
+        history.samples[i] = (uint16_t)data[ULP_VAR_HISTORY + i] & 0x0FFF;
+    return true;
+}
+
+/**
+ * @brief Эталонная модель одного запуска программы ULP (те же шаги и 16-битная арифметика)
+ * @return причина пробуждения или ULP_WAKE_NONE
+ */
+uint8_t ulpStep(uint32_t *data, uint16_t raw)
+{
+    uint16_t count = (uint16_t)data[ULP_VAR_COUNT];
+    uint8_t reason = ULP_WAKE_NONE;
+
+    if (count >= ULP_HISTORY_SIZE)
+    {
+        reason = ULP_WAKE_FULL; // история не перезаписывается
+    }
+    else
+    {
+        data[ULP_VAR_LAST] = raw;
+        data[ULP_VAR_HISTORY + count] = raw;
+        data[ULP_VAR_COUNT] = ++count;
+
+        // SUBR + переход по переполнению: raw < low, high < raw
+        if (raw < (uint16_t)data[ULP_VAR_LOW] || (uint16_t)data[ULP_VAR_HIGH] < raw)
+            reason = ULP_WAKE_THRESHOLD;
+        else if (count >= ULP_HISTORY_SIZE)
+            reason = ULP_WAKE_FULL;
+    }
+
+    if (reason != ULP_WAKE_NONE)
+        data[ULP_VAR_REASON] = reason;
+    return reason;
+}
+
+const char *ulpWakeReasonName(uint8_t reason)
+{
+    switch (reason)
+    {
+    case ULP_WAKE_THRESHOLD:
+        return "threshold";
+    case ULP_WAKE_FULL:
+        return "history full";
+    default:
+        return "none";
+    }
+}
+
+/**
+ * @brief История для MQTT: {"t0":<мс первого отсчёта>,"period":<мс>,"reason":"...","vcc":[мВ,...]}
+ */
+size_t encodeUlpHistory(char *buf, size_t size, const UlpHistory &history, uint64_t firstTimestamp)
+{
+    int len = snprintf(buf, size, "{\"t0\":%llu,\"period\":%lu,\"reason\":\"%s\",\"vcc\":[",
+                       (unsigned long long)firstTimestamp, (unsigned long)ULP_SAMPLE_PERIOD_S * 1000,
+                       ulpWakeReasonName(history.reason));
+    for (uint8_t i = 0; i < history.count && len > 0 && (size_t)len < size; i++)
+        len += snprintf(buf + len, size - len, i ? ",%u" : "%u", ulpRawToMillivolts(history.samples[i]));
+    if (len > 0 && (size_t)len < size)
+        len += snprintf(buf + len, size - len, "]}");
+    if (len < 0 || (size_t)len >= size)
+        return 0;
+    return (size_t)len;
+}
@@ -0,0 +1,104 @@
+// Программа ULP для ESP32: собирается макросами esp32/ulp.h, грузится в начало RTC_SLOW_MEM.
+// Шаги и раскладка данных совпадают с эталонной моделью ulpStep() (ulp.cpp).
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <esp32/ulp.h>
+#include <driver/adc.h>
+#include <soc/rtc_cntl_reg.h>
+#include "ulp.h"
+#include "log.h"
+
+const adc1_channel_t VBAT_ADC_CHANNEL = ADC1_CHANNEL_6; // GPIO34, как VBAT_PIN в hal_esp32.cpp
+
+enum
+{
+    LBL_THRESHOLD,
+    LBL_FULL,
+    LBL_WAKE
+};
+
+uint32_t *ulpData()
+{
+    return RTC_SLOW_MEM + ULP_DATA_OFFSET;
+}
+
+/**
+ * @brief Загрузка программы, окно порогов вокруг lastRaw и запуск по таймеру ULP
+ */
+bool ulpStart(uint16_t lastRaw)
+{
+    const ulp_insn_t program[] = {
+        I_MOVI(R3, ULP_DATA_OFFSET),
+        I_LD(R0, R3, ULP_VAR_COUNT),
+        M_BGE(LBL_FULL, ULP_HISTORY_SIZE), // история не перезаписывается
+
+        // Среднее из 4 отсчётов АЦП
+        I_MOVI(R1, 0),
+        I_ADC(R2, 0, VBAT_ADC_CHANNEL),
+        I_ADDR(R1, R1, R2),
+        I_ADC(R2, 0, VBAT_ADC_CHANNEL),
+        I_ADDR(R1, R1, R2),
+        I_ADC(R2, 0, VBAT_ADC_CHANNEL),
+        I_ADDR(R1, R1, R2),
+        I_ADC(R2, 0, VBAT_ADC_CHANNEL),
+        I_ADDR(R1, R1, R2),
+        I_RSHI(R1, R1, 2),
+
+        // last = raw; history[count] = raw; count++
+        I_ST(R1, R3, ULP_VAR_LAST),
+        I_ADDR(R2, R3, R0),
+        I_ST(R1, R2, ULP_VAR_HISTORY),
+        I_ADDI(R0, R0, 1),
+        I_ST(R0, R3, ULP_VAR_COUNT),
+
+        // raw - low и high - raw: заём (переполнение) — значение вне окна
+        I_LD(R2, R3, ULP_VAR_LOW),
+        I_SUBR(R2, R1, R2),
+        M_BXF(LBL_THRESHOLD),
+        I_LD(R2, R3, ULP_VAR_HIGH),
+        I_SUBR(R2, R2, R1),
+        M_BXF(LBL_THRESHOLD),
+
+        M_BGE(LBL_FULL, ULP_HISTORY_SIZE),
+        I_HALT(),
+
+        M_LABEL(LBL_THRESHOLD),
+        I_MOVI(R0, ULP_WAKE_THRESHOLD),
+        M_BX(LBL_WAKE),
+        M_LABEL(LBL_FULL),
+        I_MOVI(R0, ULP_WAKE_FULL),
+        M_LABEL(LBL_WAKE),
+        I_ST(R0, R3, ULP_VAR_REASON),
+        I_WAKE(),
+        I_END(), // таймер ULP остановлен до следующего ulpStart()
+        I_HALT(),
+    };
+
+    memset(ulpData(), 0, ULP_DATA_WORDS * sizeof(uint32_t));
+    ulpArm(ulpData(), lastRaw);
+
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(VBAT_ADC_CHANNEL, ADC_ATTEN_DB_11);
+    adc1_ulp_enable();
+
+    size_t size = sizeof(program) / sizeof(ulp_insn_t);
+    esp_err_t err = ulp_process_macros_and_load(0, program, &size);
+    if (err != ESP_OK || size > ULP_PROGRAM_MAX_WORDS)
+    {
+        logError(LOG_ULP, "Program load failed: %d (%u words)", err, (unsigned)size);
+        return false;
+    }
+
+    ulp_set_wakeup_period(0, ULP_SAMPLE_PERIOD_S * 1000000UL);
+    esp_sleep_enable_ulp_wakeup();
+    err = ulp_run(0);
+    if (err != ESP_OK)
+    {
+        logError(LOG_ULP, "Start failed: %d", err);
+        return false;
+    }
+    logInfo(LOG_ULP, "Armed: %u words, window %u..%u mV, every %u s", (unsigned)size,
+            ulpRawToMillivolts((uint16_t)ulpData()[ULP_VAR_LOW]),
+            ulpRawToMillivolts((uint16_t)ulpData()[ULP_VAR_HIGH]), ULP_SAMPLE_PERIOD_S);
+    return true;
+}
@@ -1,205 +1,95 @@
+#include "feature_flags.h"
+#if FEATURE_WEB
 #include "web.h"
 #include "config.h"
-#include "sensors.h"
+#include "payload.h"
+#include "espnow.h"
+#include "html.h"
+#include "web_pages.h"
+#include "api.h"
+#include "history.h"
+#include "log.h"
+#include "trace.h"
+#include "wifi_manager.h"
 #include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
 
 AsyncWebServer server(80);
 
-// === Стили (без изменений) ===
-const char MAIN_STYLE[] PROGMEM = R"rawliteral(
-<style>
-:root {
-  --primary: #10B981;
-  --secondary: #0EA5E9;
-  --gray-100: #f3f4f6;
-  --gray-200: #e5e7eb;
-  --gray-700: #374151;
-  --gray-900: #111827;
-  --danger: #ef4444;
-}
-* { box-sizing: border-box; margin: 0; padding: 0; }
-body {
-  font-family: -apple-system, BlinkMacSystemFont, 'Segoe UI', Roboto, sans-serif;
-  background-color: var(--gray-100);
-  color: var(--gray-900);
-  line-height: 1.5;
-  padding: 1rem;
-}
-.container {
-  max-width: 800px;
-  margin: 0 auto;
-}
-.card {
-  background: white;
-  border-radius: 0.75rem;
-  box-shadow: 0 4px 6px -1px rgba(0,0,0,0.1);
-  padding: 1.5rem;
-  margin-bottom: 1.5rem;
-}
-h1 {
-  font-size: 1.875rem;
-  font-weight: 700;
-  text-align: center;
-  margin-bottom: 1rem;
-  color: var(--primary);
-}
-.nav-tabs {
-  display: flex;
-  flex-wrap: wrap;
-  gap: 0.5rem;
-  justify-content: center;
-  margin-bottom: 1.5rem;
-}
-.nav-tab {
-  padding: 0.5rem 1rem;
-  text-decoration: none;
-  color: var(--gray-700);
-  background: var(--gray-200);
-  border-radius: 0.5rem;
-  font-size: 0.875rem;
-}
-.nav-tab:hover {
-  background: var(--primary);
-  color: white;
-}
-.form-group {
-  margin-bottom: 1rem;
-}
-.form-group label {
-  display: block;
-  margin-bottom: 0.5rem;
-  font-weight: 600;
-}
-input, select, button {
-  width: 100%;
-  padding: 0.75rem;
-  border: 1px solid var(--gray-200);
-  border-radius: 0.5rem;
-  font-size: 1rem;
-}
-input:focus, select:focus {
-  outline: 2px solid var(--primary);
-}
-.btn {
-  display: inline-block;
-  padding: 0.75rem 1.5rem;
-  font-weight: 600;
-  text-align: center;
-  text-decoration: none;
-  border-radius: 0.5rem;
-  cursor: pointer;
-  transition: opacity 0.2s;
-}
-.btn-primary {
-  background-color: var(--primary);
-  color: white;
-  border: none;
-}
-.btn-primary:hover {
-  opacity: 0.9;
-}
-.btn-outline {
-  background: transparent;
-  border: 1px solid var(--gray-200);
-  color: var(--gray-700);
-}
-.grid {
-  display: grid;
-  grid-template-columns: repeat(auto-fit, minmax(180px, 1fr));
-  gap: 1.25rem;
-  margin: 1.5rem 0;
-}
-.metric-card {
-  background: white;
-  padding: 1.25rem;
-  border-radius: 0.75rem;
-  text-align: center;
-  box-shadow: 0 1px 3px rgba(0,0,0,0.1);
-}
-.metric-label {
-  font-size: 0.875rem;
-  color: var(--gray-700);
-  margin-bottom: 0.5rem;
-}
-.metric-value {
-  font-size: 1.5rem;
-  font-weight: 700;
-}
-.error {
-  background: #fee;
-  color: var(--danger);
-  padding: 0.75rem;
-  border-radius: 0.5rem;
-  margin-bottom: 1rem;
-  text-align: center;
-}
-.status-connected { color: var(--primary); }
-.status-disconnected { color: var(--danger); }
-.status-ap { color: var(--secondary); }
-</style>
-)rawliteral";
-
-String getWebHeader(const String &title)
-{
-  return String(R"rawliteral(
-<!DOCTYPE html>
-<html lang="ru">
-<head>
-  <meta charset="utf-8">
-  <meta name="viewport" content="width=device-width, initial-scale=1">
-  <title>)rawliteral") +
-         title + R"rawliteral(</title>
-)rawliteral" +
-         String(MAIN_STYLE) + R"rawliteral(
-</head>
-<body>
-  <div class="container">
-    <h1>)rawliteral" +
-         title + R"rawliteral(</h1>
-    <div class="nav-tabs">
-      <a href="/" class="nav-tab">Dashboard</a>
-      <a href="/options/base" class="nav-tab">Base</a>
-      <a href="/options/wifi" class="nav-tab">Wi-Fi</a>
-      <a href="/options/mqtt" class="nav-tab">MQTT</a>
-    </div>
-)rawliteral";
-}
-
-String getWebFooter()
+// === Потоковая отдача страниц ===
+// Страница рендерится порциями прямо в буфер chunked-ответа: статические фрагменты
+// копируются из флеша, в куче на запрос — только WebPageStream.
+struct WebPageStream
 {
-  return R"rawliteral(
-  </div>
-</body>
-</html>
-)rawliteral";
-}
-
-String getWifiNetworksOptions()
+  HtmlRenderer renderer;
+  WebPageContext context;
+  uint32_t heapStart; // свободная куча до начала запроса
+  uint32_t heapMin;   // минимум свободной кучи за время отдачи
+  uint32_t startMs;
+};
+
+void sendPage(AsyncWebServerRequest *request, const char *const *parts, HtmlFieldFn field, const char *title)
 {
-  String options = "";
-  int n = WiFi.scanNetworks();
-  if (n == 0)
+  uint32_t heapStart = ESP.getFreeHeap();
+  WebPageStream *page = (WebPageStream *)malloc(sizeof(WebPageStream));
+  if (!page)
   {
-    options = "<option>Сети не найдены</option>";
+    request->send(503, "text/plain", "Out of memory");
+    return;
   }
-  else
+  page->context.title = title;
+  page->context.reading = latestReading(); // снимок без блокировок: измерение не ждёт веб
+  htmlBegin(page->renderer, parts, field, &page->context);
+  page->heapStart = heapStart;
+  page->heapMin = heapStart;
+  page->startMs = millis();
+  request->_tempObject = page; // освобождается вместе с запросом
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+      "text/html; charset=utf-8",
+      [request, page](uint8_t *buf, size_t maxLen, size_t index) -> size_t
+      {
+        size_t len = htmlRender(page->renderer, buf, maxLen);
+        uint32_t heap = ESP.getFreeHeap();
+        if (heap < page->heapMin)
+          page->heapMin = heap;
+        if (len == 0)
+        {
+          logDebug(LOG_WEB, "%s: %lu B in %lu ms, peak heap %lu B", request->url().c_str(),
+                   (unsigned long)page->renderer.total, (unsigned long)(millis() - page->startMs),
+                   (unsigned long)(page->heapStart - page->heapMin));
+        }
+        return len;
+      });
+  request->send(response);
+}
+
+// Список сетей из последнего сканирования (wifi_manager.h), остальные поля — общие
+bool wifiPageField(void *ctx, const char *name, size_t nameLen, uint16_t index, char *out, size_t size, size_t *len)
+{
+  if (!htmlFieldIs(name, nameLen, "networks"))
+    return webPageField(ctx, name, nameLen, index, out, size, len);
+
+  WifiScanEntry network;
+  uint8_t n = wifiManagerScanEntry(wifiManager, (uint8_t)index, network);
+  if (index >= n)
   {
-    for (int i = 0; i < n; i++)
-    {
-      String ssid = WiFi.SSID(i);
-      ssid.replace("\"", "&quot;");
-      String selected = (ssid == config.ssid) ? " selected" : "";
-      options += "<option value=\"" + ssid + "\"" + selected + ">" + ssid + " (" + String(WiFi.RSSI(i)) + " dBm)</option>";
-    }
+    // Список мог смениться между порциями ответа — тогда хвост просто короче
+    *len = index == 0 ? htmlFormat(out, size, "<option>Сети не найдены</option>") : 0;
+    return false;
   }
-  return options;
+  char ssid[WIFI_SSID_SIZE * 6];
+  htmlEscape(ssid, sizeof(ssid), network.ssid);
+  *len = htmlFormat(out, size, "<option value=\"%s\"%s>%s (%d dBm)</option>", ssid,
+                    strcmp(network.ssid, config.ssid) == 0 ? " selected" : "", ssid, (int)network.rssi);
+  return index + 1 < n;
 }
 
 void restartAfterDelay(void *pvParameter)
 {
   delay(2000); // даём время на отправку
+  logDrain();
   ESP.restart();
   vTaskDelete(NULL);
 }
@@ -214,7 +104,7 @@ bool isAuthorized(AsyncWebServerRequest *request)
     if (!request->authenticate(username, password, "Secure Area"))
     {        // Запрашиваем логин/пароль
         request->requestAuthentication();
-        return true;
+        return false; // ответ 401 уже отправлен
     }
 
     return true;
@@ -224,173 +114,193 @@ bool isAuthorized(AsyncWebServerRequest *request)
 
 void handleRoot(AsyncWebServerRequest *request)
 {
-  String status = "Не подключено";
-  String statusClass = "status-disconnected";
-  if (WiFi.status() == WL_CONNECTED)
-  {
-    status = "Подключено";
-    statusClass = "status-connected";
-  }
-
-  String html = getWebHeader("Дашборд");
-  html += R"rawliteral(
-        <div class="card">
-          <div class="grid">
-            <div class="metric-card">
-              <div class="metric-label">Температура</div>
-              <div class="metric-value" style="color:var(--primary);">)rawliteral" +
-          (isnan(currentTemp) ? "--" : String(currentTemp, 1)) + R"rawliteral(°C</div>
-            </div>
-            <div class="metric-card">
-              <div class="metric-label">Влажность</div>
-              <div class="metric-value" style="color:var(--secondary);">)rawliteral" +
-          (currentHumidity > 0 ? String(currentHumidity, 1) : "--") + R"rawliteral(%</div>
-            </div>
-            <div class="metric-card">
-              <div class="metric-label">Давление</div>
-              <div class="metric-value" style="color:var(--primary);">)rawliteral" +
-          (isnan(currentPressure) ? "--" : String(currentPressure, 1)) + R"rawliteral( мм.рт.ст.</div>
-            </div>
-            <div class="metric-card">
-              <div class="metric-label">VCC</div>
-              <div class="metric-value">)rawliteral" +
-          String(currentVcc, 2) + R"rawliteral( V</div>
-            </div>
-            <div class="metric-card">
-              <div class="metric-label">RSSI</div>
-              <div class="metric-value">)rawliteral" +
-          String(WiFi.RSSI()) + R"rawliteral( dBm</div>
-            </div>
-          </div>
-          <p style="text-align:center; margin-top:1rem;">
-            <span class=")rawliteral" +
-          statusClass + R"rawliteral(">Статус Wi-Fi: )rawliteral" + status + R"rawliteral(</span>
-          </p>
-        </div>
-    )rawliteral";
-  html += getWebFooter();
-  html += R"rawliteral(<script>setTimeout(() => location.reload(), 5000);</script>)rawliteral";
-
-  request->send(200, "text/html; charset=utf-8", html);
+  sendPage(request, PAGE_ROOT, webPageField, "Дашборд");
 }
 
 void handleWifiOptions(AsyncWebServerRequest *request)
 {
-  String networkOptions = getWifiNetworksOptions();
-  String checked = (strlen(config.ssid) == 0) ? "checked" : "";
-
-  String html = getWebHeader("Настройки Wi-Fi");
-  html += R"rawliteral(
-        <div class="card">
-            <form method="POST" action="/save/wifi">
-                <div class="form-group">
-                  <label class="checkbox-container">
-                    <input type="checkbox" name="ap_mode" value="1" )rawliteral" +
-          checked + R"rawliteral(>
-                    Режим точки доступа (AP)
-                  </label>
-                </div>
-                <div class="form-group">
-                    <label>Wi-Fi сеть</label>
-                    <select name="ssid" class="input">
-                      <option value="">-- Выберите сеть --</option>
-                      )rawliteral" +
-          networkOptions + R"rawliteral(
-                    </select>
-                </div>
-                <div class="form-group">
-                    <label>Пароль</label>
-                    <input type="password" name="password" value=")rawliteral" +
-          String(config.password) + R"rawliteral(" class="input">
-                </div>
-                <button type="submit" class="btn btn-primary">Сохранить и перезагрузить</button>
-            </form>
-        </div>
-    )rawliteral";
-  html += getWebFooter();
-
-  request->send(200, "text/html; charset=utf-8", html);
+  wifiRequestScan(); // не в обработчике AsyncTCP: сканирует задача Wi-Fi
+  sendPage(request, PAGE_WIFI, wifiPageField, "Настройки Wi-Fi");
 }
 
 void handleBaseOptions(AsyncWebServerRequest *request)
 {
-  String html = getWebHeader("Базовые настройки");
-  html += R"rawliteral(
-        <div class="card">
-            <form method="POST" action="/save/options">
-                <div class="form-group">
-                    <label>Device UID *</label>
-                    <input name="uid" value=")rawliteral" +
-          String(config.uid) + R"rawliteral(" required>
-                    <p class="text-sm text-gray-500 mt-1">Обязательный уникальный идентификатор</p>
-                </div>
-                <div class="form-group">
-                    <label>API URL</label>
-                    <input name="post_url" value=")rawliteral" +
-          String(config.post_url) + R"rawliteral(" >
-                </div>
-                <div class="form-group">
-                    <label>OTA URL</label>
-                    <input name="ota_url" value=")rawliteral" +
-          String(config.ota_url) + R"rawliteral(" >
-                </div>
-                <div class="form-group">
-                    <label>OTA RESULT URL</label>
-                    <input name="ota_result_url" value=")rawliteral" +
-          String(config.ota_result_url) + R"rawliteral(" >
-                </div>
-                <div class="form-group">
-                    <label>Интервал публикации (мс)</label>
-                    <input name="publishing_interval" value=")rawliteral" +
-          String(config.publishingInterval) + R"rawliteral(" type="number">
-                </div>
-                <div class="form-group">
-                    <label>Смещение температуры</label>
-                    <input name="temp_offset" value=")rawliteral" +
-          String(config.temp_offset, 2) + R"rawliteral(" step="0.1" type="number">
-                </div>
-                <button type="submit" class="btn btn-primary">Сохранить и перезагрузить</button>
-            </form>
-        </div>
-    )rawliteral";
-  html += getWebFooter();
-
-  request->send(200, "text/html; charset=utf-8", html);
+  sendPage(request, PAGE_BASE, webPageField, "Базовые настройки");
 }
 
 void handleMqttOptions(AsyncWebServerRequest *request)
 {
-  String html = getWebHeader("Настройки MQTT");
-  html += R"rawliteral(
-        <div class="card">
-            <form method="POST" action="/save/mqtt">
-                <div class="form-group">
-                    <label>Сервер</label>
-                    <input name="mqtt_server" value=")rawliteral" +
-          String(config.mqtt_server) + R"rawliteral(" required>
-                </div>
-                <div class="form-group">
-                    <label>Порт</label>
-                    <input name="mqtt_port" value=")rawliteral" +
-          String(config.mqtt_port) + R"rawliteral(" type="number" required>
-                </div>
-                <div class="form-group">
-                    <label>Пользователь</label>
-                    <input name="mqtt_user" value=")rawliteral" +
-          String(config.mqtt_user) + R"rawliteral(">
-                </div>
-                <div class="form-group">
-                    <label>Пароль</label>
-                    <input type="password" name="mqtt_password" value=")rawliteral" +
-          String(config.mqtt_password) + R"rawliteral(">
-                </div>
-                <button type="submit" class="btn btn-primary">Сохранить и перезагрузить</button>
-            </form>
-        </div>
-    )rawliteral";
-  html += getWebFooter();
+  sendPage(request, PAGE_MQTT, webPageField, "Настройки MQTT");
+}
 
-  request->send(200, "text/html; charset=utf-8", html);
+// === REST API ===
+// ETag сверяется до сборки JSON: неизменившийся узел отвечает пустым 304
+void sendApi(AsyncWebServerRequest *request, ApiEndpoint endpoint)
+{
+  SensorReading reading = latestReading();
+  char etag[API_ETAG_SIZE];
+  apiEtag(endpoint, reading, etag, sizeof(etag));
+
+  if (request->hasHeader("If-None-Match") && apiEtagMatches(request->header("If-None-Match").c_str(), etag))
+  {
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    response->addHeader("ETag", etag);
+    request->send(response);
+    apiStats[endpoint].notModified++;
+    return;
+  }
+
+  char body[API_BODY_SIZE];
+  size_t len = apiBody(endpoint, reading, body, sizeof(body));
+  if (len == 0)
+  {
+    request->send(500, "text/plain", "Response too large");
+    return;
+  }
+  AsyncWebServerResponse *response = request->beginResponse(200, "application/json", String(body));
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache"); // кэшировать можно, но только с проверкой ETag
+  request->send(response);
+  apiStats[endpoint].responses++;
+}
+
+// История за интервал: /api/history?from=&to=[&limit=][&id=] (мс от эпохи Unix).
+// Записи читаются из флеша порциями по мере отправки — в куче только HistoryStream.
+void handleHistory(AsyncWebServerRequest *request)
+{
+  HistoryQuery query;
+  historyQueryInit(query);
+  for (size_t i = 0; i < request->params(); i++)
+  {
+    AsyncWebParameter *param = request->getParam(i);
+    if (!historySetParam(query, param->name().c_str(), param->value().c_str()))
+    {
+      request->send(400, "text/plain", "Bad parameter: " + param->name());
+      return;
+    }
+  }
+  if (query.from > query.to)
+  {
+    request->send(400, "text/plain", "from > to");
+    return;
+  }
+
+  HistoryStream *stream = (HistoryStream *)malloc(sizeof(HistoryStream));
+  if (!stream)
+  {
+    request->send(503, "text/plain", "Out of memory");
+    return;
+  }
+  historyStreamBegin(*stream, query);
+  request->_tempObject = stream; // освобождается вместе с запросом
+  uint32_t startMs = millis();
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+      "application/json",
+      [stream, startMs](uint8_t *buf, size_t maxLen, size_t index) -> size_t
+      {
+        size_t len = historyStreamRead(*stream, (char *)buf, maxLen);
+        if (len == 0)
+          logInfo(LOG_API, "/api/history: %lu rows, %lu B in %lu ms", (unsigned long)stream->rows,
+                  (unsigned long)index, (unsigned long)(millis() - startMs));
+        return len;
+      });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+// Журнал: /api/logs?since=N[&level=warn] — строки истории с номера N (text/plain).
+// X-Log-Next — номер, с которого продолжать следующий запрос; строки, вытесненные раньше, пропускаются.
+void handleLogs(AsyncWebServerRequest *request)
+{
+  uint32_t since = request->hasParam("since") ? strtoul(request->getParam("since")->value().c_str(), nullptr, 10) : 0;
+  int level = LOG_DEBUG;
+  if (request->hasParam("level") && (level = logParseLevel(request->getParam("level")->value().c_str())) < 0)
+  {
+    request->send(400, "text/plain", "Bad level");
+    return;
+  }
+
+  LogCursor *cursor = (LogCursor *)malloc(sizeof(LogCursor));
+  if (!cursor)
+  {
+    request->send(503, "text/plain", "Out of memory");
+    return;
+  }
+  logCursorBegin(*cursor, since, level);
+  request->_tempObject = cursor; // освобождается вместе с запросом
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+      "text/plain; charset=utf-8",
+      [cursor](uint8_t *buf, size_t maxLen, size_t) -> size_t
+      {
+        return logCursorRead(*cursor, (char *)buf, maxLen);
+      });
+  response->addHeader("X-Log-Next", String(cursor->end));
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+#if FEATURE_TRACE
+// Трасса: образ кольца, отдаваемый порциями; запись приостановлена, пока идёт ответ
+struct TraceDownload
+{
+  TraceImage image;
+  TraceStream stream;
+};
+
+// /api/trace — JSON Chrome trace (chrome://tracing, ui.perfetto.dev), /api/trace.bin — двоичный образ
+void handleTrace(AsyncWebServerRequest *request, bool json)
+{
+  TraceDownload *download = (TraceDownload *)malloc(sizeof(TraceDownload));
+  if (!download)
+  {
+    request->send(503, "text/plain", "Out of memory");
+    return;
+  }
+  traceSetEnabled(false);
+  traceSnapshot(download->image);
+  traceStreamBegin(download->stream, download->image, json);
+  request->_tempObject = download; // освобождается вместе с запросом
+  request->onDisconnect([]() { traceSetEnabled(true); });
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse(
+      json ? "application/json" : "application/octet-stream",
+      [download](uint8_t *buf, size_t maxLen, size_t index) -> size_t
+      {
+        size_t len = traceStreamRead(download->stream, buf, maxLen);
+        if (len == 0)
+        {
+          traceSetEnabled(true);
+          logInfo(LOG_API, "/api/trace: %lu events, %lu lost, %lu B", (unsigned long)download->image.count,
+                  (unsigned long)download->image.lost, (unsigned long)index);
+        }
+        return len;
+      });
+  response->addHeader("Content-Disposition", json ? "attachment; filename=trace.json" : "attachment; filename=trace.bin");
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+#endif
+
+// Уровни журнала: POST module=<модуль|*|topic>&level=<none..debug>; ответ — все пороги, "модуль=уровень" по строке
+void handleLogLevel(AsyncWebServerRequest *request)
+{
+  if (request->hasParam("module", true) && request->hasParam("level", true))
+  {
+    String setting = request->getParam("module", true)->value() + "=" + request->getParam("level", true)->value();
+    if (!logApplySetting(setting.c_str(), setting.length()))
+    {
+      request->send(400, "text/plain", "Bad module or level");
+      return;
+    }
+  }
+
+  String body;
+  for (uint8_t module = 0; module < LOG_MODULE_COUNT; module++)
+    body += String(logModuleName(module)) + "=" + logLevelName(logLevels[module]) + "\n";
+  body += String("topic=") + logLevelName(logMqttLevel) + "\n";
+  request->send(200, "text/plain", body);
 }
 
 // === Обработчики POST ===
@@ -398,19 +308,20 @@ void handleSaveWifi(AsyncWebServerRequest *request)
 {
   if (request->hasParam("ap_mode", true))
   {
+    // Только точка доступа: запасные сети тоже забываются
     config.ssid[0] = '\0';
     config.password[0] = '\0';
+    memset(config.wifi_extra, 0, sizeof(config.wifi_extra));
   }
-  else
+  else if (request->hasParam("ssid", true))
   {
-    if (request->hasParam("ssid", true))
-    {
-      strlcpy(config.ssid, request->getParam("ssid", true)->value().c_str(), sizeof(config.ssid));
-    }
-    if (request->hasParam("password", true))
-    {
-      strlcpy(config.password, request->getParam("password", true)->value().c_str(), sizeof(config.password));
-    }
+    String ssid = request->getParam("ssid", true)->value();
+    String password = request->hasParam("password", true) ? request->getParam("password", true)->value() : String(config.password);
+    configSetNetwork(ssid.c_str(), password.c_str());
+  }
+  else if (request->hasParam("password", true))
+  {
+    strlcpy(config.password, request->getParam("password", true)->value().c_str(), sizeof(config.password));
   }
   saveConfig();
 
@@ -440,6 +351,15 @@ void handleSaveBase(AsyncWebServerRequest *request)
   {
     strlcpy(config.post_url, request->getParam("post_url", true)->value().c_str(), sizeof(config.post_url));
   }
+  if (request->hasParam("influx_host", true))
+  {
+    strlcpy(config.influx_host, request->getParam("influx_host", true)->value().c_str(), sizeof(config.influx_host));
+  }
+  if (request->hasParam("influx_port", true))
+  {
+    long port = request->getParam("influx_port", true)->value().toInt();
+    config.influx_port = (port > 0 && port <= 65535) ? (uint16_t)port : INFLUX_UDP_PORT;
+  }
   if (request->hasParam("ota_url", true))
   {
     strlcpy(config.ota_url, request->getParam("ota_url", true)->value().c_str(), sizeof(config.ota_url));
@@ -456,6 +376,52 @@ void handleSaveBase(AsyncWebServerRequest *request)
   {
     config.temp_offset = request->getParam("temp_offset", true)->value().toFloat();
   }
+  // Чекбокс не передаётся, если снят
+  config.adaptive_interval = request->hasParam("adaptive_interval", true);
+  config.align_interval = request->hasParam("align_interval", true);
+  if (request->hasParam("interval_min", true))
+  {
+    config.interval_min = request->getParam("interval_min", true)->value().toInt();
+  }
+  if (request->hasParam("interval_max", true))
+  {
+    config.interval_max = request->getParam("interval_max", true)->value().toInt();
+  }
+  static const char *const SINK_INTERVAL_PARAMS[SINK_COUNT] = {"mqtt_min_interval", "post_min_interval",
+                                                               "influx_min_interval"};
+  for (uint8_t i = 0; i < SINK_COUNT; i++)
+  {
+    if (request->hasParam(SINK_INTERVAL_PARAMS[i], true))
+    {
+      long interval = request->getParam(SINK_INTERVAL_PARAMS[i], true)->value().toInt();
+      config.sink_min_interval[i] = interval > 0 ? (unsigned long)interval : 0;
+    }
+  }
+  if (request->hasParam("sleep_min", true))
+  {
+    config.sleep_min = request->getParam("sleep_min", true)->value().toInt();
+  }
+  if (request->hasParam("sleep_max", true))
+  {
+    config.sleep_max = request->getParam("sleep_max", true)->value().toInt();
+  }
+  config.ulp_wake = request->hasParam("ulp_wake", true);
+  config.low_power = request->hasParam("low_power", true);
+  if (request->hasParam("espnow_mode", true))
+  {
+    long mode = request->getParam("espnow_mode", true)->value().toInt();
+    config.espnow_mode = (mode >= ESPNOW_OFF && mode <= ESPNOW_GATEWAY) ? (uint8_t)mode : (uint8_t)ESPNOW_OFF;
+  }
+  if (request->hasParam("espnow_channel", true))
+  {
+    long channel = request->getParam("espnow_channel", true)->value().toInt();
+    config.espnow_channel = (channel >= 1 && channel <= 13) ? (uint8_t)channel : 1;
+  }
+  if (request->hasParam("payload_format", true))
+  {
+    long format = request->getParam("payload_format", true)->value().toInt();
+    config.payload_format = (format >= 0 && format < PAYLOAD_FORMAT_COUNT) ? (uint8_t)format : (uint8_t)PAYLOAD_TEXT;
+  }
   saveConfig();
 
   String html = R"rawliteral(
@@ -529,6 +495,43 @@ void initWebServer()
         handleMqttOptions(request);
     });
 
+    apiBegin(esp_random());
+    for (uint8_t endpoint = 0; endpoint < API_ENDPOINT_COUNT; endpoint++)
+    {
+        server.on(apiEndpointPath((ApiEndpoint)endpoint), HTTP_GET, [endpoint](AsyncWebServerRequest *request){
+            if (!isAuthorized(request)) return;
+            sendApi(request, (ApiEndpoint)endpoint);
+        });
+    }
+
+    server.on("/api/history", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (!isAuthorized(request)) return;
+        handleHistory(request);
+    });
+
+    // /api/logs/level — раньше /api/logs: обработчик принимает и вложенные пути
+    server.on("/api/logs/level", HTTP_GET | HTTP_POST, [](AsyncWebServerRequest *request){
+        if (!isAuthorized(request)) return;
+        handleLogLevel(request);
+    });
+
+    server.on("/api/logs", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (!isAuthorized(request)) return;
+        handleLogs(request);
+    });
+
+#if FEATURE_TRACE
+    server.on("/api/trace.bin", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (!isAuthorized(request)) return;
+        handleTrace(request, false);
+    });
+
+    server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (!isAuthorized(request)) return;
+        handleTrace(request, true);
+    });
+#endif
+
     server.on("/save/wifi", HTTP_POST, [](AsyncWebServerRequest *request){
         if (!isAuthorized(request)) return;
         handleSaveWifi(request);
@@ -545,5 +548,6 @@ void initWebServer()
     });
 
     server.begin();
-    Serial.println("[WebServer] Async server started on port 80 with authentication");
+    logInfo(LOG_WEB, "Async server started on port 80 with authentication");
 }
+#endif
@@ -0,0 +1,499 @@
+#include "web_pages.h"
+#include "config.h"
+#include "sensors.h"
+#include "payload.h"
+#include "scheduler.h"
+#include "hal.h"
+#include "task_timing.h"
+#include "espnow.h"
+#include <math.h>
+#include <string.h>
+
+// === Общие фрагменты ===
+const char PAGE_HEAD[] PROGMEM = R"rawliteral(
+<!DOCTYPE html>
+<html lang="ru">
+<head>
+  <meta charset="utf-8">
+  <meta name="viewport" content="width=device-width, initial-scale=1">
+  <title>{{title}}</title>
+)rawliteral";
+
+// === Стили (без изменений) ===
+const char MAIN_STYLE[] PROGMEM = R"rawliteral(
+<style>
+:root {
+  --primary: #10B981;
+  --secondary: #0EA5E9;
+  --gray-100: #f3f4f6;
+  --gray-200: #e5e7eb;
+  --gray-700: #374151;
+  --gray-900: #111827;
+  --danger: #ef4444;
+}
+* { box-sizing: border-box; margin: 0; padding: 0; }
+body {
+  font-family: -apple-system, BlinkMacSystemFont, 'Segoe UI', Roboto, sans-serif;
+  background-color: var(--gray-100);
+  color: var(--gray-900);
+  line-height: 1.5;
+  padding: 1rem;
+}
+.container {
+  max-width: 800px;
+  margin: 0 auto;
+}
+.card {
+  background: white;
+  border-radius: 0.75rem;
+  box-shadow: 0 4px 6px -1px rgba(0,0,0,0.1);
+  padding: 1.5rem;
+  margin-bottom: 1.5rem;
+}
+h1 {
+  font-size: 1.875rem;
+  font-weight: 700;
+  text-align: center;
+  margin-bottom: 1rem;
+  color: var(--primary);
+}
+.nav-tabs {
+  display: flex;
+  flex-wrap: wrap;
+  gap: 0.5rem;
+  justify-content: center;
+  margin-bottom: 1.5rem;
+}
+.nav-tab {
+  padding: 0.5rem 1rem;
+  text-decoration: none;
+  color: var(--gray-700);
+  background: var(--gray-200);
+  border-radius: 0.5rem;
+  font-size: 0.875rem;
+}
+.nav-tab:hover {
+  background: var(--primary);
+  color: white;
+}
+.form-group {
+  margin-bottom: 1rem;
+}
+.form-group label {
+  display: block;
+  margin-bottom: 0.5rem;
+  font-weight: 600;
+}
+input, select, button {
+  width: 100%;
+  padding: 0.75rem;
+  border: 1px solid var(--gray-200);
+  border-radius: 0.5rem;
+  font-size: 1rem;
+}
+input:focus, select:focus {
+  outline: 2px solid var(--primary);
+}
+.btn {
+  display: inline-block;
+  padding: 0.75rem 1.5rem;
+  font-weight: 600;
+  text-align: center;
+  text-decoration: none;
+  border-radius: 0.5rem;
+  cursor: pointer;
+  transition: opacity 0.2s;
+}
+.btn-primary {
+  background-color: var(--primary);
+  color: white;
+  border: none;
+}
+.btn-primary:hover {
+  opacity: 0.9;
+}
+.btn-outline {
+  background: transparent;
+  border: 1px solid var(--gray-200);
+  color: var(--gray-700);
+}
+.grid {
+  display: grid;
+  grid-template-columns: repeat(auto-fit, minmax(180px, 1fr));
+  gap: 1.25rem;
+  margin: 1.5rem 0;
+}
+.metric-card {
+  background: white;
+  padding: 1.25rem;
+  border-radius: 0.75rem;
+  text-align: center;
+  box-shadow: 0 1px 3px rgba(0,0,0,0.1);
+}
+.metric-label {
+  font-size: 0.875rem;
+  color: var(--gray-700);
+  margin-bottom: 0.5rem;
+}
+.metric-value {
+  font-size: 1.5rem;
+  font-weight: 700;
+}
+.error {
+  background: #fee;
+  color: var(--danger);
+  padding: 0.75rem;
+  border-radius: 0.5rem;
+  margin-bottom: 1rem;
+  text-align: center;
+}
+.status-connected { color: var(--primary); }
+.status-disconnected { color: var(--danger); }
+.status-ap { color: var(--secondary); }
+</style>
+)rawliteral";
+
+const char PAGE_NAV[] PROGMEM = R"rawliteral(
+</head>
+<body>
+  <div class="container">
+    <h1>{{title}}</h1>
+    <div class="nav-tabs">
+      <a href="/" class="nav-tab">Dashboard</a>
+      <a href="/options/base" class="nav-tab">Base</a>
+      <a href="/options/wifi" class="nav-tab">Wi-Fi</a>
+      <a href="/options/mqtt" class="nav-tab">MQTT</a>
+    </div>
+)rawliteral";
+
+const char PAGE_FOOTER[] PROGMEM = R"rawliteral(
+  </div>
+</body>
+</html>
+)rawliteral";
+
+// === Дашборд ===
+const char ROOT_BODY[] PROGMEM = R"rawliteral(
+        <div class="card">
+          <div class="grid">
+            <div class="metric-card">
+              <div class="metric-label">Температура</div>
+              <div class="metric-value" style="color:var(--primary);">{{temp}}°C</div>
+            </div>
+            <div class="metric-card">
+              <div class="metric-label">Влажность</div>
+              <div class="metric-value" style="color:var(--secondary);">{{hum}}%</div>
+            </div>
+            <div class="metric-card">
+              <div class="metric-label">Давление</div>
+              <div class="metric-value" style="color:var(--primary);">{{pres}} мм.рт.ст.</div>
+            </div>
+            <div class="metric-card">
+              <div class="metric-label">VCC</div>
+              <div class="metric-value">{{vcc}} V</div>
+            </div>
+            <div class="metric-card">
+              <div class="metric-label">RSSI</div>
+              <div class="metric-value">{{rssi}} dBm</div>
+            </div>
+            <div class="metric-card">
+              <div class="metric-label">Интервал</div>
+              <div class="metric-value">{{interval}}</div>
+            </div>
+          </div>
+          <p style="text-align:center; margin-top:1rem;">
+            <span class="{{wifi_class}}">Статус Wi-Fi: {{wifi_status}}</span>
+          </p>
+          <p class="metric-label" style="text-align:center; margin-top:0.5rem;">{{tasks}}</p>
+        </div>
+    )rawliteral";
+
+const char ROOT_RELOAD[] PROGMEM = R"rawliteral(<script>setTimeout(() => location.reload(), 5000);</script>)rawliteral";
+
+// === Настройки Wi-Fi ===
+const char WIFI_BODY[] PROGMEM = R"rawliteral(
+        <div class="card">
+            <form method="POST" action="/save/wifi">
+                <div class="form-group">
+                  <label class="checkbox-container">
+                    <input type="checkbox" name="ap_mode" value="1" {{ap_checked}}>
+                    Режим точки доступа (AP)
+                  </label>
+                </div>
+                <div class="form-group">
+                    <label>Wi-Fi сеть</label>
+                    <select name="ssid" class="input">
+                      <option value="">-- Выберите сеть --</option>
+                      {{networks}}
+                    </select>
+                </div>
+                <div class="form-group">
+                    <label>Пароль</label>
+                    <input type="password" name="password" value="{{password}}" class="input">
+                </div>
+                <button type="submit" class="btn btn-primary">Сохранить и перезагрузить</button>
+            </form>
+        </div>
+    )rawliteral";
+
+// === Базовые настройки ===
+const char BASE_BODY[] PROGMEM = R"rawliteral(
+        <div class="card">
+            <form method="POST" action="/save/options">
+                <div class="form-group">
+                    <label>Device UID *</label>
+                    <input name="uid" value="{{uid}}" required>
+                    <p class="text-sm text-gray-500 mt-1">Обязательный уникальный идентификатор</p>
+                </div>
+                <div class="form-group">
+                    <label>API URL</label>
+                    <input name="post_url" value="{{post_url}}" >
+                </div>
+                <div class="form-group">
+                    <label>InfluxDB по UDP (line protocol): хост, порт</label>
+                    <input name="influx_host" value="{{influx_host}}" >
+                    <input name="influx_port" value="{{influx_port}}" type="number" min="1" max="65535">
+                </div>
+                <div class="form-group">
+                    <label>OTA URL</label>
+                    <input name="ota_url" value="{{ota_url}}" >
+                </div>
+                <div class="form-group">
+                    <label>OTA RESULT URL</label>
+                    <input name="ota_result_url" value="{{ota_result_url}}" >
+                </div>
+                <div class="form-group">
+                    <label>Интервал публикации (мс)</label>
+                    <input name="publishing_interval" value="{{publishing_interval}}" type="number">
+                </div>
+                <div class="form-group">
+                  <label class="checkbox-container">
+                    <input type="checkbox" name="adaptive_interval" value="1" {{adaptive_checked}}>
+                    Адаптивный интервал (по скорости изменения и заряду батареи)
+                  </label>
+                </div>
+                <div class="form-group">
+                  <label class="checkbox-container">
+                    <input type="checkbox" name="align_interval" value="1" {{align_checked}}>
+                    Измерять по часам (на границах интервала), отправлять в слоте узла
+                  </label>
+                </div>
+                <div class="form-group">
+                    <label>Мин./макс. интервал (мс)</label>
+                    <input name="interval_min" value="{{interval_min}}" type="number">
+                    <input name="interval_max" value="{{interval_max}}" type="number">
+                </div>
+                <div class="form-group">
+                    <label>Мин. интервал отправки MQTT / HTTP / UDP (мс, 0 — по интервалу измерений)</label>
+                    <input name="mqtt_min_interval" value="{{mqtt_min_interval}}" type="number" min="0">
+                    <input name="post_min_interval" value="{{post_min_interval}}" type="number" min="0">
+                    <input name="influx_min_interval" value="{{influx_min_interval}}" type="number" min="0">
+                </div>
+                <div class="form-group">
+                    <label>Мин./макс. глубокий сон (с)</label>
+                    <input name="sleep_min" value="{{sleep_min}}" type="number">
+                    <input name="sleep_max" value="{{sleep_max}}" type="number">
+                </div>
+                <div class="form-group">
+                  <label class="checkbox-container">
+                    <input type="checkbox" name="ulp_wake" value="1" {{ulp_checked}}>
+                    Во сне будить по изменению напряжения (ULP), иначе — раз в макс. сон
+                  </label>
+                </div>
+                <div class="form-group">
+                  <label class="checkbox-container">
+                    <input type="checkbox" name="low_power" value="1" {{low_power_checked}}>
+                    Энергосбережение без сна: modem sleep, light sleep, DFS (ответ до 0.4 с)
+                  </label>
+                </div>
+                <div class="form-group">
+                    <label>ESP-NOW / канал Wi-Fi шлюза</label>
+                    <select name="espnow_mode">
+                      {{espnow_modes}}
+                    </select>
+                    <input name="espnow_channel" value="{{espnow_channel}}" type="number" min="1" max="13">
+                </div>
+                <div class="form-group">
+                    <label>Смещение температуры</label>
+                    <input name="temp_offset" value="{{temp_offset}}" step="0.1" type="number">
+                </div>
+                <div class="form-group">
+                    <label>Формат данных</label>
+                    <select name="payload_format">
+                      {{payload_formats}}
+                    </select>
+                </div>
+                <button type="submit" class="btn btn-primary">Сохранить и перезагрузить</button>
+            </form>
+        </div>
+    )rawliteral";
+
+// === Настройки MQTT ===
+const char MQTT_BODY[] PROGMEM = R"rawliteral(
+        <div class="card">
+            <form method="POST" action="/save/mqtt">
+                <div class="form-group">
+                    <label>Сервер</label>
+                    <input name="mqtt_server" value="{{mqtt_server}}" required>
+                </div>
+                <div class="form-group">
+                    <label>Порт</label>
+                    <input name="mqtt_port" value="{{mqtt_port}}" type="number" required>
+                </div>
+                <div class="form-group">
+                    <label>Пользователь</label>
+                    <input name="mqtt_user" value="{{mqtt_user}}">
+                </div>
+                <div class="form-group">
+                    <label>Пароль</label>
+                    <input type="password" name="mqtt_password" value="{{mqtt_password}}">
+                </div>
+                <button type="submit" class="btn btn-primary">Сохранить и перезагрузить</button>
+            </form>
+        </div>
+    )rawliteral";
+
+const char *const PAGE_ROOT[] = {PAGE_HEAD, MAIN_STYLE, PAGE_NAV, ROOT_BODY, PAGE_FOOTER, ROOT_RELOAD, nullptr};
+const char *const PAGE_BASE[] = {PAGE_HEAD, MAIN_STYLE, PAGE_NAV, BASE_BODY, PAGE_FOOTER, nullptr};
+const char *const PAGE_WIFI[] = {PAGE_HEAD, MAIN_STYLE, PAGE_NAV, WIFI_BODY, PAGE_FOOTER, nullptr};
+const char *const PAGE_MQTT[] = {PAGE_HEAD, MAIN_STYLE, PAGE_NAV, MQTT_BODY, PAGE_FOOTER, nullptr};
+
+// === Подстановка полей ===
+
+static size_t formatReading(char *out, size_t size, float value, int decimals, bool valid)
+{
+  if (!valid)
+    return htmlFormat(out, size, "--");
+  return htmlFormat(out, size, "%.*f", decimals, value);
+}
+
+// Статистика периодических задач: по строке на задачу
+static bool taskTimingLine(uint16_t index, char *out, size_t size, size_t *len)
+{
+  const TaskTiming *const tasks[] = {&sensorTaskTiming, &systemTaskTiming};
+  const uint16_t count = sizeof(tasks) / sizeof(tasks[0]);
+  const TaskTiming &t = *tasks[index];
+  *len = htmlFormat(out, size, "%s%s: дрожание %lu/%lu мс, перерасходов %lu, пропусков %lu, WCET %lu мкс",
+                    index ? "<br>" : "", t.name ? t.name : "-", (unsigned long)taskTimingJitterAvgMs(t),
+                    (unsigned long)t.jitterMaxMs, (unsigned long)t.overruns, (unsigned long)t.skipped,
+                    (unsigned long)t.execMaxUs);
+  return index + 1 < count;
+}
+
+// Список форматов данных: по одному <option> на элемент
+static bool payloadFormatOption(uint16_t index, char *out, size_t size, size_t *len)
+{
+  uint8_t format = (uint8_t)index;
+  *len = htmlFormat(out, size,
+                    "<option value=\"%u\"%s>%s (MQTT %lu B / %lu мкс, HTTP %lu B / %lu мкс)</option>",
+                    (unsigned)format, format == config.payload_format ? " selected" : "", payloadFormatName(format),
+                    (unsigned long)mqttPayloadStats[format].bytes, (unsigned long)mqttPayloadStats[format].encodeUs,
+                    (unsigned long)httpPayloadStats[format].bytes, (unsigned long)httpPayloadStats[format].encodeUs);
+  return index + 1 < PAYLOAD_FORMAT_COUNT;
+}
+
+static bool espNowModeOption(uint16_t index, char *out, size_t size, size_t *len)
+{
+  static const char *const names[ESPNOW_GATEWAY + 1] = {"Выключено", "Узел: кадр шлюзу вместо Wi-Fi", "Шлюз: приём и пересылка"};
+  *len = htmlFormat(out, size, "<option value=\"%u\"%s>%s</option>", (unsigned)index,
+                    index == config.espnow_mode ? " selected" : "", names[index]);
+  return index < ESPNOW_GATEWAY;
+}
+
+bool webPageField(void *ctx, const char *name, size_t nameLen, uint16_t index,
+                  char *out, size_t size, size_t *len)
+{
+#define FIELD(expected) htmlFieldIs(name, nameLen, expected)
+  const WebPageContext *page = (const WebPageContext *)ctx;
+  const SensorReading &reading = page->reading;
+  if (FIELD("title"))
+    *len = htmlEscape(out, size, page->title);
+  // Показания
+  else if (FIELD("temp"))
+    *len = formatReading(out, size, sampleTemperature(reading), 1, reading.flags & SAMPLE_TEMPERATURE);
+  else if (FIELD("hum"))
+    *len = formatReading(out, size, sampleHumidity(reading), 1, reading.flags & SAMPLE_HUMIDITY);
+  else if (FIELD("pres"))
+    *len = formatReading(out, size, samplePressure(reading), 1, reading.flags & SAMPLE_PRESSURE);
+  else if (FIELD("vcc"))
+    *len = formatReading(out, size, sampleVcc(reading), 2, reading.flags & SAMPLE_VCC);
+  else if (FIELD("rssi"))
+    *len = htmlFormat(out, size, "%d", halNetRssi());
+  else if (FIELD("interval"))
+  {
+    if (config.adaptive_interval)
+      *len = htmlFormat(out, size, "%lu с (%s)", (unsigned long)(sampleScheduler.intervalMs / 1000),
+                        scheduleLevelName(sampleScheduler.level));
+    else
+      *len = htmlFormat(out, size, "%lu с", config.publishingInterval / 1000);
+  }
+  else if (FIELD("wifi_class"))
+    *len = htmlFormat(out, size, "%s", halNetConnected() ? "status-connected" : "status-disconnected");
+  else if (FIELD("tasks"))
+    return taskTimingLine(index, out, size, len);
+  else if (FIELD("wifi_status"))
+    *len = htmlFormat(out, size, "%s", halNetConnected() ? "Подключено" : "Не подключено");
+  // Базовые настройки
+  else if (FIELD("uid"))
+    *len = htmlEscape(out, size, config.uid);
+  else if (FIELD("post_url"))
+    *len = htmlEscape(out, size, config.post_url);
+  else if (FIELD("influx_host"))
+    *len = htmlEscape(out, size, config.influx_host);
+  else if (FIELD("influx_port"))
+    *len = htmlFormat(out, size, "%u", config.influx_port);
+  else if (FIELD("ota_url"))
+    *len = htmlEscape(out, size, config.ota_url);
+  else if (FIELD("ota_result_url"))
+    *len = htmlEscape(out, size, config.ota_result_url);
+  else if (FIELD("publishing_interval"))
+    *len = htmlFormat(out, size, "%lu", config.publishingInterval);
+  else if (FIELD("adaptive_checked"))
+    *len = htmlFormat(out, size, "%s", config.adaptive_interval ? "checked" : "");
+  else if (FIELD("align_checked"))
+    *len = htmlFormat(out, size, "%s", config.align_interval ? "checked" : "");
+  else if (FIELD("interval_min"))
+    *len = htmlFormat(out, size, "%lu", config.interval_min);
+  else if (FIELD("interval_max"))
+    *len = htmlFormat(out, size, "%lu", config.interval_max);
+  else if (FIELD("mqtt_min_interval"))
+    *len = htmlFormat(out, size, "%lu", config.sink_min_interval[SINK_MQTT]);
+  else if (FIELD("post_min_interval"))
+    *len = htmlFormat(out, size, "%lu", config.sink_min_interval[SINK_HTTP]);
+  else if (FIELD("influx_min_interval"))
+    *len = htmlFormat(out, size, "%lu", config.sink_min_interval[SINK_UDP]);
+  else if (FIELD("sleep_min"))
+    *len = htmlFormat(out, size, "%lu", config.sleep_min);
+  else if (FIELD("sleep_max"))
+    *len = htmlFormat(out, size, "%lu", config.sleep_max);
+  else if (FIELD("ulp_checked"))
+    *len = htmlFormat(out, size, "%s", config.ulp_wake ? "checked" : "");
+  else if (FIELD("low_power_checked"))
+    *len = htmlFormat(out, size, "%s", config.low_power ? "checked" : "");
+  else if (FIELD("espnow_modes"))
+    return espNowModeOption(index, out, size, len);
+  else if (FIELD("espnow_channel"))
+    *len = htmlFormat(out, size, "%u", config.espnow_channel);
+  else if (FIELD("temp_offset"))
+    *len = htmlFormat(out, size, "%.2f", config.temp_offset);
+  else if (FIELD("payload_formats"))
+    return payloadFormatOption(index, out, size, len);
+  // Wi-Fi
+  else if (FIELD("ap_checked"))
+    *len = htmlFormat(out, size, "%s", strlen(config.ssid) == 0 ? "checked" : "");
+  else if (FIELD("password"))
+    *len = htmlEscape(out, size, config.password);
+  // MQTT
+  else if (FIELD("mqtt_server"))
+    *len = htmlEscape(out, size, config.mqtt_server);
+  else if (FIELD("mqtt_port"))
+    *len = htmlFormat(out, size, "%d", config.mqtt_port);
+  else if (FIELD("mqtt_user"))
+    *len = htmlEscape(out, size, config.mqtt_user);
+  else if (FIELD("mqtt_password"))
+    *len = htmlEscape(out, size, config.mqtt_password);
+  else
+    *len = 0;
+#undef FIELD
+  return false;
+}
@@ -0,0 +1,221 @@
+// Обвязка wifi_manager на плате: события WiFi.onEvent — в очередь, автомат и действия
+// (сканирование, WiFi.begin(), точка доступа) — в отдельной задаче
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include "wifi_manager.h"
+#include "config.h"
+#include "power.h"
+#include "log.h"
+
+#define WIFI_TASK_STACK 4096
+#define WIFI_EVENT_QUEUE 8
+#define WIFI_SCAN_CHANNEL_MS 120 // активное сканирование: ~1.7 с на 14 каналов
+
+enum WifiEventCode : uint8_t
+{
+  WIFI_EV_SCAN_DONE = 0,
+  WIFI_EV_GOT_IP,
+  WIFI_EV_DISCONNECTED,
+  WIFI_EV_SCAN_REQUEST // страница настроек (wifiRequestScan())
+};
+
+static QueueHandle_t wifiEvents = nullptr;
+static const WifiCredentials *networks[WIFI_NETWORKS_MAX];
+static volatile bool staConnected = false;
+
+// Основная сеть из настроек, за ней — запасные; сеть без пароля не используется (как раньше)
+static uint8_t loadNetworks()
+{
+    static WifiCredentials primary;
+    uint8_t count = 0;
+    strlcpy(primary.ssid, config.ssid, sizeof(primary.ssid));
+    strlcpy(primary.password, config.password, sizeof(primary.password));
+    if (primary.ssid[0] != '\0' && primary.password[0] != '\0')
+        networks[count++] = &primary;
+    for (uint8_t i = 0; i < WIFI_EXTRA_NETWORKS && count < WIFI_NETWORKS_MAX; i++)
+    {
+        if (config.wifi_extra[i].ssid[0] != '\0' && config.wifi_extra[i].password[0] != '\0')
+            networks[count++] = &config.wifi_extra[i];
+    }
+    return count;
+}
+
+// Из задачи событий Wi-Fi: только в очередь
+static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+    uint8_t code;
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_SCAN_DONE:
+        code = WIFI_EV_SCAN_DONE;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        staConnected = true;
+        code = WIFI_EV_GOT_IP;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        staConnected = false;
+        // Отключение, вызванное нашим же WiFi.begin() (сброс прошлой попытки), — не неудача
+        if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE)
+            return;
+        code = WIFI_EV_DISCONNECTED;
+        break;
+    default:
+        return;
+    }
+    xQueueSend(wifiEvents, &code, 0);
+}
+
+// Результаты драйвера читаются и освобождаются только здесь: RSSI сетей из настроек — автомату,
+// список найденных — странице настроек
+static void scanResults(int8_t rssi[])
+{
+    for (uint8_t i = 0; i < wifiManager.networkCount; i++)
+        rssi[i] = WIFI_RSSI_UNSEEN;
+    WifiScanList list = {};
+    int found = WiFi.scanComplete();
+    for (int j = 0; j < found; j++)
+    {
+        String ssid = WiFi.SSID(j);
+        int level = WiFi.RSSI(j);
+        wifiScanListAdd(list, ssid.c_str(), level);
+        for (uint8_t i = 0; i < wifiManager.networkCount; i++)
+        {
+            if (ssid == networks[i]->ssid && level > rssi[i])
+                rssi[i] = (int8_t)level;
+        }
+    }
+    WiFi.scanDelete();
+    if (found >= 0)
+        wifiManagerStoreScan(wifiManager, list);
+}
+
+static void startAp()
+{
+    uint8_t mac[6];
+    char name[24];
+    WiFi.macAddress(mac);
+    snprintf(name, sizeof(name), "Sensor_%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.softAP(name);
+    logInfo(LOG_WIFI, "Access point %s started", name);
+}
+
+static void apply(uint8_t actions)
+{
+    if (actions & WIFI_ACTION_AP_START)
+        startAp();
+    if (actions & WIFI_ACTION_AP_STOP)
+    {
+        WiFi.softAPdisconnect(true);
+        WiFi.mode(WIFI_STA);
+        logInfo(LOG_WIFI, "Access point stopped");
+    }
+    if (actions & WIFI_ACTION_SCAN)
+    {
+        if (WiFi.scanNetworks(true, false, false, WIFI_SCAN_CHANNEL_MS) == WIFI_SCAN_FAILED)
+        {
+            int8_t rssi[WIFI_NETWORKS_MAX];
+            memset(rssi, WIFI_RSSI_UNSEEN, sizeof(rssi));
+            apply(wifiManagerScanDone(wifiManager, rssi, millis()));
+        }
+    }
+    if (actions & WIFI_ACTION_CONNECT)
+    {
+        const WifiCredentials *network = networks[wifiManager.network];
+        logInfo(LOG_WIFI, "Connecting to %s (%d dBm)", network->ssid, wifiManager.rssi[wifiManager.network]);
+        // Без подключения в WiFi.begin(): интервал прослушивания нужен уже при ассоциации
+        WiFi.begin(network->ssid, network->password, 0, nullptr, false);
+        powerPrepareWifiConnect();
+        esp_wifi_connect();
+    }
+}
+
+static void wifiTask(void *parameter)
+{
+    bool powerConfigured = false;
+    while (true)
+    {
+        uint32_t wait = wifiManagerWaitMs(wifiManager, millis());
+        uint8_t code;
+        uint8_t actions;
+        if (xQueueReceive(wifiEvents, &code, wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait)) != pdTRUE)
+        {
+            actions = wifiManagerPoll(wifiManager, millis());
+        }
+        else if (code == WIFI_EV_SCAN_DONE)
+        {
+            // Чужое сканирование (не запрошенное автоматом) не трогаем: результаты освобождает его владелец
+            actions = WIFI_ACTION_NONE;
+            if (wifiManagerScanExpected(wifiManager))
+            {
+                int8_t rssi[WIFI_NETWORKS_MAX];
+                scanResults(rssi);
+                actions = wifiManagerScanDone(wifiManager, rssi, millis());
+            }
+        }
+        else if (code == WIFI_EV_SCAN_REQUEST)
+        {
+            actions = wifiManagerRequestScan(wifiManager, millis());
+        }
+        else if (code == WIFI_EV_GOT_IP)
+        {
+            actions = wifiManagerConnected(wifiManager, millis());
+            logInfo(LOG_WIFI, "Connected to %s (%d dBm): attempt %lu ms, offline %lu ms", WiFi.SSID().c_str(),
+                    WiFi.RSSI(), (unsigned long)wifiManager.lastConnectMs, (unsigned long)wifiManager.lastOutageMs);
+            if (!powerConfigured)
+            {
+                powerConfigured = true;
+                powerConfigureWifi();
+            }
+        }
+        else
+        {
+            if (wifiManager.state == WIFI_STATE_CONNECTED)
+                logWarn(LOG_WIFI, "Connection lost");
+            actions = wifiManagerDisconnected(wifiManager, millis());
+        }
+        apply(actions);
+    }
+}
+
+/**
+ * @brief Запуск менеджера; подключение идёт в фоне (см. wifiWaitConnected())
+ */
+void wifiBegin()
+{
+    wifiEvents = xQueueCreate(WIFI_EVENT_QUEUE, sizeof(uint8_t));
+    WiFi.persistent(false);     // настройки сети — только из config.json
+    WiFi.setAutoReconnect(false); // переподключением управляет автомат
+    WiFi.mode(WIFI_STA);
+    WiFi.onEvent(onWifiEvent);
+    apply(wifiManagerBegin(wifiManager, loadNetworks(), millis()));
+    xTaskCreate(wifiTask, "WifiTask", WIFI_TASK_STACK, NULL, 2, NULL);
+}
+
+/**
+ * @brief Запрос свежего списка сетей; страница показывает уже имеющийся, новый — при следующей загрузке
+ */
+void wifiRequestScan()
+{
+    uint8_t code = WIFI_EV_SCAN_REQUEST;
+    if (wifiEvents)
+        xQueueSend(wifiEvents, &code, 0);
+}
+
+bool wifiIsConnected()
+{
+    return staConnected;
+}
+
+/**
+ * @brief Ожидание подключения при загрузке (синхронизация времени до первого измерения)
+ */
+bool wifiWaitConnected(uint32_t timeoutMs)
+{
+    unsigned long start = millis();
+    while (!staConnected && millis() - start < timeoutMs && wifiManager.state != WIFI_STATE_AP_ONLY)
+        delay(100);
+    return staConnected;
+}
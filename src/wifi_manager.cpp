@@ -0,0 +1,282 @@
+#include "wifi_manager.h"
+#include "hal.h"
+#include "log.h"
+#include <string.h>
+
+WifiManager wifiManager = {};
+
+static void enterState(WifiManager &m, uint8_t state, uint32_t now)
+{
+    m.state = state;
+    m.stateSinceMs = now;
+}
+
+// AP нужен, пока нет связи дольше WIFI_AP_AFTER_MS
+static uint8_t apAction(WifiManager &m, uint32_t now)
+{
+    bool wanted = m.state == WIFI_STATE_AP_ONLY ||
+                  (m.state != WIFI_STATE_CONNECTED && now - m.downSinceMs >= WIFI_AP_AFTER_MS);
+    if (wanted == m.apActive)
+        return WIFI_ACTION_NONE;
+    m.apActive = wanted;
+    return wanted ? WIFI_ACTION_AP_START : WIFI_ACTION_AP_STOP;
+}
+
+static uint8_t startScan(WifiManager &m, uint32_t now)
+{
+    enterState(m, WIFI_STATE_SCANNING, now);
+    m.scanAtMs = now;
+    return WIFI_ACTION_SCAN | apAction(m, now);
+}
+
+static uint8_t tryCandidate(WifiManager &m, uint32_t now)
+{
+    if (m.candidatePos >= m.candidateCount)
+    {
+        // Обход не удался — пауза с удвоением
+        if (m.failures < UINT8_MAX)
+            m.failures++;
+        m.backoffMs = m.backoffMs == 0 ? WIFI_BACKOFF_MIN_MS
+                                       : (m.backoffMs < WIFI_BACKOFF_MAX_MS / 2 ? m.backoffMs * 2 : WIFI_BACKOFF_MAX_MS);
+        m.retryAtMs = now + m.backoffMs;
+        enterState(m, WIFI_STATE_WAITING, now);
+        logWarn(LOG_WIFI, "No network available, retry in %lu s", (unsigned long)(m.backoffMs / 1000));
+        return apAction(m, now);
+    }
+    m.network = m.candidates[m.candidatePos++];
+    m.attempts++;
+    enterState(m, WIFI_STATE_CONNECTING, now);
+    return WIFI_ACTION_CONNECT | apAction(m, now);
+}
+
+/**
+ * @brief Начало работы: сканирование или, без сетей, точка доступа
+ */
+uint8_t wifiManagerBegin(WifiManager &m, uint8_t networkCount, uint32_t now)
+{
+    memset(&m, 0, sizeof(m));
+    m.networkCount = networkCount < WIFI_NETWORKS_MAX ? networkCount : WIFI_NETWORKS_MAX;
+    m.downSinceMs = now;
+    if (m.networkCount == 0)
+    {
+        enterState(m, WIFI_STATE_AP_ONLY, now);
+        return apAction(m, now);
+    }
+    return startScan(m, now);
+}
+
+/**
+ * @brief Итог сканирования: порядок попыток по убыванию RSSI
+ * Не найденные сети пробуются, только если не найдена ни одна (скрытый SSID не виден сканированию)
+ */
+uint8_t wifiManagerScanDone(WifiManager &m, const int8_t rssi[], uint32_t now)
+{
+    m.listScan = false;
+    if (m.state != WIFI_STATE_SCANNING)
+        return WIFI_ACTION_NONE;
+    bool anySeen = false;
+    for (uint8_t i = 0; i < m.networkCount; i++)
+        anySeen |= rssi[i] != WIFI_RSSI_UNSEEN;
+
+    m.candidateCount = 0;
+    m.candidatePos = 0;
+    for (uint8_t i = 0; i < m.networkCount; i++)
+    {
+        m.rssi[i] = rssi[i];
+        if (anySeen && rssi[i] == WIFI_RSSI_UNSEEN)
+            continue;
+        // Вставка с сохранением порядка настроек при равном RSSI
+        uint8_t pos = m.candidateCount++;
+        while (pos > 0 && m.rssi[m.candidates[pos - 1]] < rssi[i])
+        {
+            m.candidates[pos] = m.candidates[pos - 1];
+            pos--;
+        }
+        m.candidates[pos] = i;
+    }
+    return tryCandidate(m, now);
+}
+
+uint8_t wifiManagerConnected(WifiManager &m, uint32_t now)
+{
+    if (m.state == WIFI_STATE_AP_ONLY)
+        return WIFI_ACTION_NONE;
+    // Адрес может прийти и вне попытки (переподключение драйвером) — связь есть в любом случае
+    if (m.state == WIFI_STATE_CONNECTING)
+        m.lastConnectMs = now - m.stateSinceMs;
+    if (m.state != WIFI_STATE_CONNECTED)
+    {
+        m.connects++;
+        m.lastOutageMs = now - m.downSinceMs;
+        if (m.lastOutageMs > m.maxOutageMs)
+            m.maxOutageMs = m.lastOutageMs;
+    }
+    m.failures = 0;
+    m.backoffMs = 0;
+    enterState(m, WIFI_STATE_CONNECTED, now);
+    return apAction(m, now);
+}
+
+/**
+ * @brief Отключение или неудачная попытка: следующая сеть, после потери связи — новое сканирование
+ */
+uint8_t wifiManagerDisconnected(WifiManager &m, uint32_t now)
+{
+    switch (m.state)
+    {
+    case WIFI_STATE_CONNECTED:
+        m.disconnects++;
+        m.downSinceMs = now;
+        return startScan(m, now);
+    case WIFI_STATE_CONNECTING:
+        return tryCandidate(m, now);
+    default:
+        return WIFI_ACTION_NONE; // отключение от прошлой попытки
+    }
+}
+
+uint8_t wifiManagerPoll(WifiManager &m, uint32_t now)
+{
+    if (m.state == WIFI_STATE_SCANNING && now - m.stateSinceMs >= WIFI_CONNECT_TIMEOUT_MS)
+    {
+        // Сканирование не завершилось — пробуем сети в порядке настроек
+        int8_t unseen[WIFI_NETWORKS_MAX];
+        memset(unseen, WIFI_RSSI_UNSEEN, sizeof(unseen));
+        return wifiManagerScanDone(m, unseen, now);
+    }
+    if (m.state == WIFI_STATE_CONNECTING && now - m.stateSinceMs >= WIFI_CONNECT_TIMEOUT_MS)
+        return tryCandidate(m, now);
+    if (m.state == WIFI_STATE_WAITING && (int32_t)(now - m.retryAtMs) >= 0)
+        return startScan(m, now);
+    return apAction(m, now);
+}
+
+/**
+ * @brief Сканирование для страницы настроек: только вне обхода (в нём список обновляется и так)
+ */
+uint8_t wifiManagerRequestScan(WifiManager &m, uint32_t now)
+{
+    if (m.state != WIFI_STATE_CONNECTED && m.state != WIFI_STATE_AP_ONLY)
+        return WIFI_ACTION_NONE;
+    // Сканирование на время прерывает обмен в STA — по обновлению страницы не чаще WIFI_SCAN_REFRESH_MS
+    if (m.scanSeq != 0 && now - m.scanAtMs < WIFI_SCAN_REFRESH_MS)
+        return WIFI_ACTION_NONE;
+    m.listScan = true;
+    m.scanAtMs = now;
+    return WIFI_ACTION_SCAN;
+}
+
+bool wifiManagerScanExpected(const WifiManager &m)
+{
+    return m.state == WIFI_STATE_SCANNING || m.listScan;
+}
+
+/**
+ * @brief Сеть из результатов драйвера в список страницы: по убыванию RSSI, при равном — в порядке
+ *        сканирования; скрытые SSID пропускаются
+ */
+void wifiScanListAdd(WifiScanList &list, const char *ssid, int rssi)
+{
+    if (ssid[0] == '\0')
+        return;
+    if (rssi < WIFI_RSSI_UNSEEN + 1)
+        rssi = WIFI_RSSI_UNSEEN + 1;
+    if (rssi > 0)
+        rssi = 0;
+    for (uint8_t i = 0; i < list.count; i++)
+    {
+        if (strncmp(list.entries[i].ssid, ssid, WIFI_SSID_SIZE - 1) != 0)
+            continue;
+        if (list.entries[i].rssi >= rssi)
+            return;
+        // Более сильная точка доступа той же сети: старая запись уходит
+        memmove(&list.entries[i], &list.entries[i + 1], (list.count - i - 1) * sizeof(WifiScanEntry));
+        list.count--;
+        break;
+    }
+    uint8_t pos = 0;
+    while (pos < list.count && list.entries[pos].rssi >= rssi)
+        pos++;
+    if (pos >= WIFI_SCAN_LIST_MAX)
+        return;
+    uint8_t moved = (list.count < WIFI_SCAN_LIST_MAX ? list.count : WIFI_SCAN_LIST_MAX - 1) - pos;
+    memmove(&list.entries[pos + 1], &list.entries[pos], moved * sizeof(WifiScanEntry));
+    strlcpy(list.entries[pos].ssid, ssid, sizeof(list.entries[pos].ssid));
+    list.entries[pos].rssi = (int8_t)rssi;
+    if (list.count < WIFI_SCAN_LIST_MAX)
+        list.count++;
+}
+
+void wifiManagerStoreScan(WifiManager &m, const WifiScanList &list)
+{
+    const uint8_t *src = (const uint8_t *)&list;
+    for (uint8_t copy = 0; copy < 2; copy++)
+    {
+        // Нечётный seq уводит читателей на копию 1, пока пишется копия 0; чётный — обратно
+        __atomic_store_n(&m.scanSeq, m.scanSeq + 1, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        uint8_t *dst = (uint8_t *)&m.scanCopies[copy];
+        for (size_t i = 0; i < sizeof(WifiScanList); i++)
+            __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Сеть index из последнего списка; возвращает число сетей в нём (index за ним — entry не заполнен)
+ */
+uint8_t wifiManagerScanEntry(const WifiManager &m, uint8_t index, WifiScanEntry &entry)
+{
+    uint8_t count;
+    uint32_t seq;
+    do
+    {
+        seq = __atomic_load_n(&m.scanSeq, __ATOMIC_ACQUIRE);
+        const WifiScanList &list = m.scanCopies[seq & 1];
+        count = __atomic_load_n(&list.count, __ATOMIC_RELAXED);
+        if (index < count && index < WIFI_SCAN_LIST_MAX)
+        {
+            const uint8_t *src = (const uint8_t *)&list.entries[index];
+            uint8_t *dst = (uint8_t *)&entry;
+            for (size_t i = 0; i < sizeof(WifiScanEntry); i++)
+                dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (seq != __atomic_load_n(&m.scanSeq, __ATOMIC_RELAXED));
+    return count < WIFI_SCAN_LIST_MAX ? count : WIFI_SCAN_LIST_MAX;
+}
+
+uint32_t wifiManagerWaitMs(const WifiManager &m, uint32_t now)
+{
+    uint32_t wait = UINT32_MAX;
+    if (m.state == WIFI_STATE_SCANNING || m.state == WIFI_STATE_CONNECTING)
+    {
+        uint32_t elapsed = now - m.stateSinceMs;
+        wait = elapsed < WIFI_CONNECT_TIMEOUT_MS ? WIFI_CONNECT_TIMEOUT_MS - elapsed : 0;
+    }
+    else if (m.state == WIFI_STATE_WAITING)
+        wait = (int32_t)(m.retryAtMs - now) > 0 ? m.retryAtMs - now : 0;
+    if (m.state != WIFI_STATE_CONNECTED && m.state != WIFI_STATE_AP_ONLY && !m.apActive)
+    {
+        uint32_t apWait = now - m.downSinceMs < WIFI_AP_AFTER_MS ? m.downSinceMs + WIFI_AP_AFTER_MS - now : 0;
+        if (apWait < wait)
+            wait = apWait;
+    }
+    return wait;
+}
+
+const char *wifiStateName(uint8_t state)
+{
+    switch (state)
+    {
+    case WIFI_STATE_AP_ONLY:
+        return "ap";
+    case WIFI_STATE_SCANNING:
+        return "scanning";
+    case WIFI_STATE_CONNECTING:
+        return "connecting";
+    case WIFI_STATE_CONNECTED:
+        return "connected";
+    default:
+        return "waiting";
+    }
+}
@@ -0,0 +1,266 @@
+// Кадр ESP-NOW и разбор на шлюзе (espnow.cpp): кодирование и проверка кадра, повторы
+// в пределах GATEWAY_DUPLICATE_MS, переход seq через 0 и счёт потерь, вытеснение из полной таблицы узлов.
+// Запуск: pio test -e native_test -f test_espnow
+#include <unity.h>
+#include "espnow.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <string.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+static const uint64_t NOW_TIMESTAMP = 1700000000000ULL;
+
+static SensorReading fullReading()
+{
+    SensorReading reading = {};
+    reading.timestamp = 1699999999123ULL;
+    reading.pressurePa = 101325;
+    reading.tempCenti = -1234;
+    reading.humPermille = 456;
+    reading.vccMv = 3700;
+    reading.flags = SAMPLE_TEMPERATURE | SAMPLE_HUMIDITY | SAMPLE_PRESSURE | SAMPLE_VCC;
+    return reading;
+}
+
+static void nodeMac(uint8_t mac[6], uint8_t id)
+{
+    const uint8_t base[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[5] = id;
+}
+
+/**
+ * @brief Кадр узла id в эфир и разбор очереди шлюзом в момент nowMs
+ * @return число принятых (не повторных) кадров
+ */
+static uint8_t deliver(uint8_t id, uint16_t seq, uint32_t nowMs)
+{
+    uint8_t mac[6];
+    nodeMac(mac, id);
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    encodeNodeFrame(frame, sizeof(frame), seq, fullReading());
+    gatewayReceive(mac, -60, frame, sizeof(frame));
+    return gatewayPoll(nowMs, NOW_TIMESTAMP);
+}
+
+static GatewayNode *findNode(uint8_t id)
+{
+    uint8_t mac[6];
+    nodeMac(mac, id);
+    for (uint8_t i = 0; i < gatewayNodeCount; i++)
+    {
+        if (memcmp(gatewayNodes[i].mac, mac, 6) == 0)
+            return &gatewayNodes[i];
+    }
+    return nullptr;
+}
+
+void setUp()
+{
+    gatewayReset();
+}
+
+void tearDown() {}
+
+// === Кадр ===
+void test_frame_round_trip()
+{
+    SensorReading in = fullReading();
+    in.sample = 77; // номер показания в кадр не входит
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    TEST_ASSERT_EQUAL_size_t(ESPNOW_FRAME_SIZE, encodeNodeFrame(frame, sizeof(frame), 0xBEEF, in));
+    TEST_ASSERT_EQUAL_HEX8(ESPNOW_FRAME_MAGIC, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(ESPNOW_FRAME_VERSION, frame[1]);
+
+    uint16_t seq = 0;
+    SensorReading out;
+    TEST_ASSERT_TRUE(decodeNodeFrame(frame, sizeof(frame), seq, out));
+    TEST_ASSERT_EQUAL_UINT16(0xBEEF, seq);
+    TEST_ASSERT_EQUAL_UINT8(in.flags, out.flags);
+    TEST_ASSERT_EQUAL_INT16(in.tempCenti, out.tempCenti);
+    TEST_ASSERT_EQUAL_UINT16(in.humPermille, out.humPermille);
+    TEST_ASSERT_EQUAL_UINT32(in.pressurePa, out.pressurePa);
+    TEST_ASSERT_EQUAL_UINT16(in.vccMv, out.vccMv);
+    TEST_ASSERT_TRUE(in.timestamp == out.timestamp);
+    TEST_ASSERT_EQUAL_UINT32(0, out.sample);
+}
+
+void test_frame_drops_channels_without_flag()
+{
+    SensorReading in = fullReading();
+    in.flags = SAMPLE_VCC | SAMPLE_TEMPERATURE_ERROR | SAMPLE_HUMIDITY_ERROR;
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    encodeNodeFrame(frame, sizeof(frame), 1, in);
+
+    uint16_t seq;
+    SensorReading out;
+    TEST_ASSERT_TRUE(decodeNodeFrame(frame, sizeof(frame), seq, out));
+    TEST_ASSERT_EQUAL_UINT8(in.flags, out.flags);
+    TEST_ASSERT_EQUAL_INT16(0, out.tempCenti);
+    TEST_ASSERT_EQUAL_UINT16(0, out.humPermille);
+    TEST_ASSERT_EQUAL_UINT32(0, out.pressurePa);
+    TEST_ASSERT_EQUAL_UINT16(in.vccMv, out.vccMv);
+}
+
+void test_frame_rejects_bad_magic_version_and_short_frame()
+{
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    TEST_ASSERT_EQUAL_size_t(0, encodeNodeFrame(frame, ESPNOW_FRAME_SIZE - 1, 1, fullReading()));
+    encodeNodeFrame(frame, sizeof(frame), 1, fullReading());
+
+    uint16_t seq;
+    SensorReading out;
+    TEST_ASSERT_FALSE(decodeNodeFrame(frame, ESPNOW_FRAME_SIZE - 1, seq, out));
+    frame[0] = ESPNOW_FRAME_MAGIC ^ 0xFF;
+    TEST_ASSERT_FALSE(decodeNodeFrame(frame, sizeof(frame), seq, out));
+    frame[0] = ESPNOW_FRAME_MAGIC;
+    frame[1] = ESPNOW_FRAME_VERSION - 1;
+    TEST_ASSERT_FALSE(decodeNodeFrame(frame, sizeof(frame), seq, out));
+
+    // Шлюз считает такие кадры повреждёнными и узел не заводит
+    uint8_t mac[6];
+    nodeMac(mac, 1);
+    gatewayReceive(mac, -60, frame, sizeof(frame));
+    frame[1] = ESPNOW_FRAME_VERSION;
+    gatewayReceive(mac, -60, frame, 10);
+    TEST_ASSERT_EQUAL_UINT8(0, gatewayPoll(1000, NOW_TIMESTAMP));
+    TEST_ASSERT_EQUAL_UINT32(2, gatewayStats.malformed);
+    TEST_ASSERT_EQUAL_UINT8(0, gatewayNodeCount);
+}
+
+// === Повторы ===
+void test_repeats_within_duplicate_window_are_dropped()
+{
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 5, 1000));
+    // ESPNOW_NODE_REPEATS копий одного кадра
+    TEST_ASSERT_EQUAL_UINT8(0, deliver(1, 5, 1010));
+    TEST_ASSERT_EQUAL_UINT8(0, deliver(1, 5, 1020));
+    // Запоздавший старый кадр
+    TEST_ASSERT_EQUAL_UINT8(0, deliver(1, 4, 1000 + GATEWAY_DUPLICATE_MS - 1));
+    TEST_ASSERT_EQUAL_UINT32(3, gatewayStats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(1, gatewayStats.accepted);
+    TEST_ASSERT_EQUAL_UINT32(1, findNode(1)->frames);
+}
+
+void test_same_seq_after_duplicate_window_is_new_cycle()
+{
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 5, 1000));
+    // Узел сбросился и начал с того же seq (окно отсчитывается от последнего принятого кадра)
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 5, 1000 + GATEWAY_DUPLICATE_MS));
+    TEST_ASSERT_EQUAL_UINT32(0, gatewayStats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(2, findNode(1)->frames);
+}
+
+void test_frame_without_timestamp_gets_receive_time()
+{
+    uint8_t mac[6];
+    nodeMac(mac, 1);
+    SensorReading reading = fullReading();
+    reading.timestamp = 0;
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    encodeNodeFrame(frame, sizeof(frame), 1, reading);
+    gatewayReceive(mac, -71, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_UINT8(1, gatewayPoll(1000, NOW_TIMESTAMP));
+
+    GatewayNode *node = findNode(1);
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_TRUE(node->reading.timestamp == NOW_TIMESTAMP);
+    TEST_ASSERT_EQUAL_INT(-71, node->rssi);
+    TEST_ASSERT_TRUE(node->pending);
+}
+
+// === seq: переход через 0 и потери ===
+void test_seq_wrap_is_not_loss()
+{
+    uint32_t now = 0;
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 65534, now += 60000));
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 65535, now += 60000));
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 0, now += 60000));
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 1, now += 60000));
+    TEST_ASSERT_EQUAL_UINT32(0, gatewayStats.lost);
+    // Повтор кадра до перехода — всё ещё повтор
+    TEST_ASSERT_EQUAL_UINT8(0, deliver(1, 65535, now + 10));
+    TEST_ASSERT_EQUAL_UINT32(1, gatewayStats.duplicates);
+}
+
+void test_seq_gaps_count_as_loss()
+{
+    uint32_t now = 0;
+    deliver(1, 65533, now += 60000);
+    deliver(1, 1, now += 60000); // пропущены 65534, 65535, 0
+    TEST_ASSERT_EQUAL_UINT32(3, gatewayStats.lost);
+    TEST_ASSERT_EQUAL_UINT32(3, findNode(1)->lost);
+
+    deliver(2, 10, now);
+    deliver(2, 12, now += 60000);
+    TEST_ASSERT_EQUAL_UINT32(4, gatewayStats.lost);
+    TEST_ASSERT_EQUAL_UINT32(1, findNode(2)->lost);
+}
+
+void test_seq_jump_beyond_window_is_restart()
+{
+    uint32_t now = 0;
+    deliver(1, 100, now += 60000);
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 100 + GATEWAY_SEQ_WINDOW + 1, now += 60000));
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 0, now += 60000)); // перезапуск узла с нуля
+    TEST_ASSERT_EQUAL_UINT32(0, gatewayStats.lost);
+}
+
+// === Таблица узлов ===
+void test_full_table_evicts_longest_silent_node()
+{
+    uint32_t now = 1000;
+    for (uint8_t id = 0; id < GATEWAY_MAX_NODES; id++)
+        deliver(id, 1, now += 100);
+    TEST_ASSERT_EQUAL_UINT8(GATEWAY_MAX_NODES, gatewayNodeCount);
+    deliver(0, 2, now += 100); // узел 0 снова на связи: дольше всех молчит узел 1
+
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(GATEWAY_MAX_NODES, 1, now += 100));
+    TEST_ASSERT_EQUAL_UINT8(GATEWAY_MAX_NODES, gatewayNodeCount);
+    TEST_ASSERT_EQUAL_UINT32(1, gatewayStats.evicted);
+    TEST_ASSERT_NULL(findNode(1));
+    TEST_ASSERT_NOT_NULL(findNode(0));
+    GatewayNode *added = findNode(GATEWAY_MAX_NODES);
+    TEST_ASSERT_NOT_NULL(added);
+    TEST_ASSERT_EQUAL_UINT32(1, added->frames);
+    TEST_ASSERT_EQUAL_UINT32(0, added->lost);
+
+    // Вытесненный узел возвращается новой записью, вытесняя следующего молчуна (узел 2)
+    TEST_ASSERT_EQUAL_UINT8(1, deliver(1, 2, now += 100));
+    TEST_ASSERT_EQUAL_UINT32(2, gatewayStats.evicted);
+    TEST_ASSERT_NULL(findNode(2));
+    TEST_ASSERT_EQUAL_UINT32(0, findNode(1)->lost);
+}
+
+void test_receive_queue_overflow_is_counted()
+{
+    uint8_t mac[6];
+    nodeMac(mac, 1);
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    for (uint16_t seq = 0; seq < GATEWAY_QUEUE_SIZE; seq++)
+    {
+        encodeNodeFrame(frame, sizeof(frame), seq, fullReading());
+        gatewayReceive(mac, -60, frame, sizeof(frame));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, gatewayStats.overflows); // в кольце на одно место меньше размера
+    TEST_ASSERT_EQUAL_UINT8(GATEWAY_QUEUE_SIZE - 1, gatewayPoll(1000, NOW_TIMESTAMP));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_round_trip);
+    RUN_TEST(test_frame_drops_channels_without_flag);
+    RUN_TEST(test_frame_rejects_bad_magic_version_and_short_frame);
+    RUN_TEST(test_repeats_within_duplicate_window_are_dropped);
+    RUN_TEST(test_same_seq_after_duplicate_window_is_new_cycle);
+    RUN_TEST(test_frame_without_timestamp_gets_receive_time);
+    RUN_TEST(test_seq_wrap_is_not_loss);
+    RUN_TEST(test_seq_gaps_count_as_loss);
+    RUN_TEST(test_seq_jump_beyond_window_is_restart);
+    RUN_TEST(test_full_table_evicts_longest_silent_node);
+    RUN_TEST(test_receive_queue_overflow_is_counted);
+    return UNITY_END();
+}
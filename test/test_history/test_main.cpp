@@ -0,0 +1,335 @@
+// История во флеше (history.cpp) на файловой системе симулятора: выборка через границу суток,
+// двоичный поиск начала внутри сегмента, чтение заполняемого блока (HISTORY_OPEN_FILE),
+// удаление суток сверх HISTORY_SEGMENTS, восстановление после сбоя — оборванный последний блок,
+// заполняемый блок после перезагрузки. Каждый тест — на чистой файловой системе нового узла.
+// Запуск: pio test -e native_test -f test_history
+#include <unity.h>
+#include "history.h"
+#include "hal.h"
+#include "hal_native.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <stdio.h>
+#include <string.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+#define DAY HISTORY_SEGMENT_MS
+#define MINUTE 60000ULL
+#define ROWS_MAX 4096
+
+static const uint32_t FIRST_DAY = 19700; // 2023-12-08 UTC
+static SensorReading rows[ROWS_MAX];
+
+static SensorReading makeReading(uint64_t timestamp, uint32_t sample)
+{
+    SensorReading r = {};
+    r.timestamp = timestamp;
+    r.sample = sample;
+    sampleSetTemperature(r, 20.0f + (sample % 50) * 0.1f);
+    sampleSetHumidity(r, 40.0f + (sample % 7));
+    sampleSetPressure(r, 100000.0f + (sample % 13) * 10.0f);
+    sampleSetVcc(r, 3.7f);
+    return r;
+}
+
+/**
+ * @brief Показания раз в минуту начиная с start; номер показания — его минута от start
+ */
+static void appendMinutes(uint64_t start, uint32_t count, uint32_t firstSample = 0)
+{
+    for (uint32_t i = 0; i < count; i++)
+        TEST_ASSERT_TRUE(historyAppend(makeReading(start + (uint64_t)i * MINUTE, firstSample + i)));
+}
+
+/**
+ * @brief Весь ответ на запрос [from, to], порциями historyRead()
+ */
+static size_t query(uint64_t from, uint64_t to)
+{
+    HistoryCursor cursor;
+    TEST_ASSERT_TRUE(historySeek(cursor, from, to));
+    size_t total = 0;
+    for (int calls = 0; calls < 10000; calls++)
+    {
+        size_t n = historyRead(cursor, rows + total, HISTORY_CHUNK_RECORDS);
+        TEST_ASSERT_LESS_OR_EQUAL(HISTORY_CHUNK_RECORDS, n);
+        total += n;
+        TEST_ASSERT_LESS_OR_EQUAL(ROWS_MAX - HISTORY_CHUNK_RECORDS, total);
+        if (cursor.done)
+            return total;
+    }
+    TEST_FAIL_MESSAGE("cursor never finished");
+    return total;
+}
+
+/**
+ * @brief Ответ — показания раз в минуту подряд, с first по first + count - 1
+ */
+static void assertMinutes(size_t total, uint64_t first, size_t count)
+{
+    TEST_ASSERT_EQUAL_size_t(count, total);
+    for (size_t i = 0; i < total; i++)
+    {
+        TEST_ASSERT_TRUE(rows[i].timestamp == first + i * MINUTE);
+        SensorReading expected = makeReading(rows[i].timestamp, rows[i].sample);
+        TEST_ASSERT_EQUAL_INT16(expected.tempCenti, rows[i].tempCenti);
+        TEST_ASSERT_EQUAL_UINT32(expected.pressurePa, rows[i].pressurePa);
+        TEST_ASSERT_EQUAL_HEX8(expected.flags, rows[i].flags);
+    }
+}
+
+static bool segmentExists(uint32_t day)
+{
+    char path[24];
+    snprintf(path, sizeof(path), "/h%lu.dat", (unsigned long)day);
+    return halFsExists(path);
+}
+
+static size_t segmentSize(uint32_t day)
+{
+    char path[24];
+    snprintf(path, sizeof(path), "/h%lu.dat", (unsigned long)day);
+    return halFsSize(path);
+}
+
+// Показания до заполнения blocks блоков в текущих сутках; возвращает их число (последнее —
+// уже в новом заполняемом блоке)
+static uint32_t appendUntilBlocks(uint64_t start, uint32_t blocks)
+{
+    uint32_t count = 0;
+    while (historyBlockCount() < blocks)
+    {
+        TEST_ASSERT_TRUE(historyAppend(makeReading(start + (uint64_t)count * MINUTE, count)));
+        count++;
+    }
+    return count;
+}
+
+void setUp()
+{
+    halSimSelectNode(halSimCreateNode()); // пустая файловая система
+    historyReset();
+    historyStats = {};
+}
+
+void tearDown() {}
+
+// === Граница суток ===
+void test_query_spans_day_boundary()
+{
+    uint64_t midnight = (uint64_t)(FIRST_DAY + 1) * DAY;
+    appendMinutes(midnight - 90 * MINUTE, 180);
+
+    // Незаполненный блок суток закрыт при смене суток: сегмент — только свои сутки
+    TEST_ASSERT_TRUE(segmentExists(FIRST_DAY));
+    TEST_ASSERT_EQUAL_size_t(0, segmentSize(FIRST_DAY) % CODEC_BLOCK_SIZE);
+    TEST_ASSERT_FALSE(segmentExists(FIRST_DAY + 2));
+
+    size_t total = query(midnight - 20 * MINUTE, midnight + 20 * MINUTE);
+    assertMinutes(total, midnight - 20 * MINUTE, 41);
+
+    // Всё целиком и интервал, кончающийся ровно в полночь
+    assertMinutes(query(0, UINT64_MAX), midnight - 90 * MINUTE, 180);
+    assertMinutes(query(midnight - MINUTE, midnight), midnight - MINUTE, 2);
+    TEST_ASSERT_EQUAL_size_t(0, query(midnight + 1, midnight + MINUTE - 1));
+}
+
+void test_query_skips_day_without_readings()
+{
+    uint64_t day0 = (uint64_t)FIRST_DAY * DAY;
+    appendMinutes(day0 + 23 * 60 * MINUTE, 10);
+    appendMinutes(day0 + 2 * DAY, 10, 10); // сутки FIRST_DAY + 1 пропущены
+    TEST_ASSERT_FALSE(segmentExists(FIRST_DAY + 1));
+
+    size_t total = query(day0, day0 + 3 * DAY);
+    TEST_ASSERT_EQUAL_size_t(20, total);
+    TEST_ASSERT_TRUE(rows[9].timestamp == day0 + 23 * 60 * MINUTE + 9 * MINUTE);
+    TEST_ASSERT_TRUE(rows[10].timestamp == day0 + 2 * DAY);
+}
+
+// === Поиск начала интервала ===
+void test_seek_starts_inside_segment()
+{
+    uint64_t day0 = (uint64_t)FIRST_DAY * DAY;
+    appendMinutes(day0, 1200); // ~30 блоков
+    uint32_t blocks = historyBlockCount();
+    TEST_ASSERT_GREATER_THAN(10, blocks);
+
+    char path[24];
+    snprintf(path, sizeof(path), "/h%lu.dat", (unsigned long)FIRST_DAY);
+    const uint64_t starts[] = {day0 + 700 * MINUTE + 1, day0 + 1 * MINUTE, day0 + 1100 * MINUTE};
+    for (uint64_t from : starts)
+    {
+        HistoryCursor cursor;
+        TEST_ASSERT_TRUE(historySeek(cursor, from, UINT64_MAX));
+        // Блок курсора начинается не позже from, следующий — не раньше: остальные блоки не читаются
+        uint8_t header[CODEC_HEADER_SIZE];
+        TEST_ASSERT_EQUAL_size_t(sizeof(header), halFsReadAt(path, (size_t)cursor.block * CODEC_BLOCK_SIZE, header,
+                                                             sizeof(header)));
+        TEST_ASSERT_TRUE(codecBlockFirstTimestamp(header) <= from);
+        if (cursor.block + 1 < blocks)
+        {
+            halFsReadAt(path, (size_t)(cursor.block + 1) * CODEC_BLOCK_SIZE, header, sizeof(header));
+            TEST_ASSERT_TRUE(codecBlockFirstTimestamp(header) >= from);
+        }
+    }
+
+    uint64_t from = day0 + 700 * MINUTE + 1; // между показаниями
+    assertMinutes(query(from, day0 + 799 * MINUTE), day0 + 701 * MINUTE, 99);
+
+    // Начало ровно на первом показании блока и до первого показания суток
+    uint8_t header[CODEC_HEADER_SIZE];
+    halFsReadAt(path, 5 * CODEC_BLOCK_SIZE, header, sizeof(header));
+    uint64_t blockStart = codecBlockFirstTimestamp(header);
+    assertMinutes(query(blockStart, blockStart + 9 * MINUTE), blockStart, 10);
+    assertMinutes(query(day0 - DAY, day0 + 4 * MINUTE), day0, 5);
+}
+
+// === Заполняемый блок ===
+void test_read_includes_open_block()
+{
+    uint64_t day0 = (uint64_t)FIRST_DAY * DAY;
+    appendMinutes(day0, 5);
+    TEST_ASSERT_EQUAL_UINT32(0, historyBlockCount());
+    TEST_ASSERT_TRUE(halFsExists(HISTORY_OPEN_FILE));
+    assertMinutes(query(day0, UINT64_MAX), day0, 5);
+
+    // Заполненные блоки и заполняемый — подряд, без повторов
+    uint32_t count = appendUntilBlocks(day0 + 5 * MINUTE, 2);
+    appendMinutes(day0 + (5 + count) * MINUTE, 3, count);
+    assertMinutes(query(0, UINT64_MAX), day0, 5 + count + 3);
+    assertMinutes(query(day0 + (5 + count) * MINUTE, UINT64_MAX), day0 + (5 + count) * MINUTE, 3);
+}
+
+void test_cursor_snapshot_survives_open_block_sealed_after_seek()
+{
+    uint64_t day0 = (uint64_t)FIRST_DAY * DAY;
+    appendMinutes(day0, 10);
+    HistoryCursor cursor;
+    TEST_ASSERT_TRUE(historySeek(cursor, 0, UINT64_MAX));
+    TEST_ASSERT_TRUE(cursor.to == day0 + 9 * MINUTE);
+
+    // После поиска заполняемый блок ушёл в сегмент, начат новый
+    appendUntilBlocks(day0 + 10 * MINUTE, 1);
+    appendMinutes(day0 + 500 * MINUTE, 2, 500);
+
+    size_t total = 0;
+    while (!cursor.done)
+        total += historyRead(cursor, rows + total, HISTORY_CHUNK_RECORDS);
+    assertMinutes(total, day0, 10);
+}
+
+// === Срок хранения ===
+void test_retention_drops_days_beyond_limit()
+{
+    const uint32_t days = HISTORY_SEGMENTS + 5;
+    for (uint32_t d = 0; d < days; d++)
+        TEST_ASSERT_TRUE(historyAppend(makeReading((uint64_t)(FIRST_DAY + d) * DAY + 12 * 60 * MINUTE, d)));
+
+    uint32_t lastDay = FIRST_DAY + days - 1;
+    uint32_t keepFrom = lastDay - (HISTORY_SEGMENTS - 1);
+    for (uint32_t d = FIRST_DAY; d < keepFrom; d++)
+        TEST_ASSERT_FALSE(segmentExists(d));
+    for (uint32_t d = keepFrom; d < lastDay; d++) // последние сутки — ещё в заполняемом блоке
+        TEST_ASSERT_TRUE(segmentExists(d));
+
+    uint32_t meta[2] = {};
+    TEST_ASSERT_EQUAL_size_t(sizeof(meta), halFsRead(HISTORY_META_FILE, (char *)meta, sizeof(meta)));
+    TEST_ASSERT_EQUAL_UINT32(keepFrom, meta[0]);
+    TEST_ASSERT_EQUAL_UINT32(lastDay, meta[1]);
+
+    size_t total = query(0, UINT64_MAX);
+    TEST_ASSERT_EQUAL_size_t(HISTORY_SEGMENTS, total);
+    TEST_ASSERT_TRUE(rows[0].timestamp == (uint64_t)keepFrom * DAY + 12 * 60 * MINUTE);
+    TEST_ASSERT_EQUAL_UINT32(keepFrom - FIRST_DAY, rows[0].sample);
+
+    // Перерыв длиннее срока хранения: удаляется всё прежнее
+    TEST_ASSERT_TRUE(historyAppend(makeReading((uint64_t)(lastDay + 200) * DAY, 0)));
+    for (uint32_t d = keepFrom; d <= lastDay; d++)
+        TEST_ASSERT_FALSE(segmentExists(d));
+    TEST_ASSERT_EQUAL_size_t(1, query(0, UINT64_MAX));
+}
+
+// === Восстановление после сбоя ===
+void test_torn_trailing_block_repaired_on_begin()
+{
+    uint64_t day0 = (uint64_t)FIRST_DAY * DAY;
+    uint32_t count = appendUntilBlocks(day0, 3);
+    appendMinutes(day0 + count * MINUTE, 4, count);
+    count += 4;
+
+    // Сбой посреди записи следующего блока: в сегменте его начало, в HISTORY_OPEN_FILE — он целиком
+    uint8_t open[sizeof(uint32_t) + CODEC_BLOCK_SIZE];
+    TEST_ASSERT_EQUAL_size_t(sizeof(open), halFsRead(HISTORY_OPEN_FILE, (char *)open, sizeof(open)));
+    char path[24];
+    snprintf(path, sizeof(path), "/h%lu.dat", (unsigned long)FIRST_DAY);
+    TEST_ASSERT_TRUE(halFsAppend(path, open + sizeof(uint32_t), 100));
+
+    historyReset();
+    TEST_ASSERT_TRUE(historyBegin());
+    TEST_ASSERT_EQUAL_UINT32(1, historyStats.repaired);
+    TEST_ASSERT_EQUAL_UINT32(3, historyBlockCount());
+    TEST_ASSERT_EQUAL_size_t(3 * CODEC_BLOCK_SIZE, segmentSize(FIRST_DAY));
+    TEST_ASSERT_FALSE(halFsExists("/h.tmp"));
+    assertMinutes(query(0, UINT64_MAX), day0, count);
+
+    // Запись продолжается с заполняемого блока; метки раньше последней по-прежнему отклоняются
+    TEST_ASSERT_FALSE(historyAppend(makeReading(day0 + (count - 2) * MINUTE, 0)));
+    TEST_ASSERT_EQUAL_UINT32(1, historyStats.outOfOrder);
+    appendMinutes(day0 + count * MINUTE, 3, count);
+    assertMinutes(query(0, UINT64_MAX), day0, count + 3);
+}
+
+void test_restart_restores_or_drops_open_block()
+{
+    uint64_t day0 = (uint64_t)FIRST_DAY * DAY;
+    uint32_t count = appendUntilBlocks(day0, 1);
+    appendMinutes(day0 + count * MINUTE, 6, count);
+    count += 6;
+
+    // Обычная перезагрузка: заполняемый блок восстановлен
+    historyReset();
+    TEST_ASSERT_TRUE(historyBegin());
+    assertMinutes(query(0, UINT64_MAX), day0, count);
+
+    // Сбой между записью блока в сегмент и началом нового: в HISTORY_OPEN_FILE — копия записанного
+    uint8_t open[sizeof(uint32_t) + CODEC_BLOCK_SIZE];
+    char path[24];
+    snprintf(path, sizeof(path), "/h%lu.dat", (unsigned long)FIRST_DAY);
+    memcpy(open, &FIRST_DAY, sizeof(uint32_t));
+    TEST_ASSERT_EQUAL_size_t(CODEC_BLOCK_SIZE, halFsReadAt(path, 0, open + sizeof(uint32_t), CODEC_BLOCK_SIZE));
+    TEST_ASSERT_TRUE(halFsWrite(HISTORY_OPEN_FILE, (const char *)open, sizeof(open)));
+    historyReset();
+    TEST_ASSERT_TRUE(historyBegin());
+    TEST_ASSERT_FALSE(halFsExists(HISTORY_OPEN_FILE));
+    uint32_t sealed = count - 7; // показание, закрывшее блок, — в заполняемом
+    assertMinutes(query(0, UINT64_MAX), day0, sealed); // без повтора блока
+
+    // Повреждённый заполняемый блок отбрасывается, сегмент цел
+    appendMinutes(day0 + sealed * MINUTE, 2, sealed);
+    TEST_ASSERT_EQUAL_size_t(sizeof(open), halFsRead(HISTORY_OPEN_FILE, (char *)open, sizeof(open)));
+    open[sizeof(uint32_t) + 8] = 0xFF; // число показаний больше, чем в потоке бит
+    halFsWrite(HISTORY_OPEN_FILE, (const char *)open, sizeof(open));
+    historyReset();
+    TEST_ASSERT_TRUE(historyBegin());
+    assertMinutes(query(0, UINT64_MAX), day0, sealed);
+    appendMinutes(day0 + (sealed + 2) * MINUTE, 1, sealed + 2);
+    TEST_ASSERT_EQUAL_size_t(sealed + 1, query(0, UINT64_MAX));
+}
+
+int main(int, char **)
+{
+    halSimSetLogEnabled(false);
+    UNITY_BEGIN();
+    RUN_TEST(test_query_spans_day_boundary);
+    RUN_TEST(test_query_skips_day_without_readings);
+    RUN_TEST(test_seek_starts_inside_segment);
+    RUN_TEST(test_read_includes_open_block);
+    RUN_TEST(test_cursor_snapshot_survives_open_block_sealed_after_seek);
+    RUN_TEST(test_retention_drops_days_beyond_limit);
+    RUN_TEST(test_torn_trailing_block_repaired_on_begin);
+    RUN_TEST(test_restart_restores_or_drops_open_block);
+    return UNITY_END();
+}
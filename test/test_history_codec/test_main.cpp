@@ -0,0 +1,291 @@
+// Сжатие истории (history_codec.cpp): декодирование без потерь через границы блоков, смена флагов,
+// недействительные каналы, полный блок не меняется, возобновление готового и заполняемого блока.
+// Скорость кодирования и размер на показание — в бенчмарке ([env:native_bench]).
+// Запуск: pio test -e native_test -f test_history_codec
+#include <unity.h>
+#include "history_codec.h"
+#include "sample.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <math.h>
+#include <string.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+#define READINGS 3000
+#define BLOCKS_MAX (READINGS / 8)
+
+static SensorReading readings[READINGS];
+static uint8_t blocks[BLOCKS_MAX][CODEC_BLOCK_SIZE];
+static uint32_t seed;
+
+static int randomRange(int range) // [-range, range]
+{
+    seed = seed * 1103515245u + 12345u;
+    return (int)((seed >> 16) % (2 * range + 1)) - range;
+}
+
+/**
+ * @brief Показания раз в минуту с джиттером опроса и шумом датчиков, как в бенчмарке
+ */
+static void makeReadings(size_t count)
+{
+    seed = 12345;
+    float temp = 21.0f, hum = 45.0f, pres = 755.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        SensorReading &r = readings[i];
+        r = {};
+        r.timestamp = 1700000000000ULL + i * 60000ULL + randomRange(40);
+        r.sample = (uint32_t)i + 1;
+        temp += randomRange(5) * 0.01f;
+        hum += randomRange(3) * 0.1f;
+        pres += randomRange(2) * 0.05f;
+        sampleSetTemperature(r, temp);
+        sampleSetHumidity(r, hum < 0 ? 0 : hum > 100 ? 100 : hum);
+        sampleSetPressure(r, pres * PA_PER_MMHG);
+        sampleSetVcc(r, 3.7f + randomRange(10) * 0.001f);
+    }
+}
+
+/**
+ * @brief Кодирование по блокам, как historyAppend(): не поместилось — новый блок
+ * @return число блоков
+ */
+static size_t encodeAll(const SensorReading *in, size_t count)
+{
+    size_t blockCount = 0;
+    CodecState state;
+    codecBlockBegin(blocks[0], state);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!codecBlockAppend(blocks[blockCount], state, in[i]))
+        {
+            codecBlockBegin(blocks[++blockCount], state);
+            TEST_ASSERT_TRUE(codecBlockAppend(blocks[blockCount], state, in[i])); // в пустой блок — всегда
+        }
+    }
+    return blockCount + 1;
+}
+
+static void assertReadingEqual(const SensorReading &expected, const SensorReading &actual)
+{
+    TEST_ASSERT_TRUE(expected.timestamp == actual.timestamp);
+    TEST_ASSERT_EQUAL_UINT32(expected.sample, actual.sample);
+    TEST_ASSERT_EQUAL_HEX8(expected.flags, actual.flags);
+    TEST_ASSERT_EQUAL_INT16(expected.tempCenti, actual.tempCenti);
+    TEST_ASSERT_EQUAL_UINT16(expected.humPermille, actual.humPermille);
+    TEST_ASSERT_EQUAL_UINT32(expected.pressurePa, actual.pressurePa);
+    TEST_ASSERT_EQUAL_UINT16(expected.vccMv, actual.vccMv);
+}
+
+/**
+ * @brief Все блоки по порядку совпадают с исходными показаниями
+ */
+static void assertDecodes(size_t blockCount, const SensorReading *expected, size_t count)
+{
+    size_t decoded = 0;
+    for (size_t b = 0; b < blockCount; b++)
+    {
+        TEST_ASSERT_TRUE(codecBlockFirstTimestamp(blocks[b]) == expected[decoded].timestamp);
+        CodecState state;
+        SensorReading r;
+        codecDecodeBegin(blocks[b], state);
+        while (codecDecodeNext(blocks[b], state, r))
+        {
+            TEST_ASSERT_LESS_THAN(count, decoded);
+            assertReadingEqual(expected[decoded++], r);
+        }
+        TEST_ASSERT_EQUAL_UINT16(codecBlockCount(blocks[b]), state.count);
+        TEST_ASSERT_EQUAL_UINT16(codecBlockBits(blocks[b]), state.bitPos);
+    }
+    TEST_ASSERT_EQUAL_size_t(count, decoded);
+}
+
+void setUp()
+{
+    memset(blocks, 0, sizeof(blocks));
+}
+
+void tearDown() {}
+
+// === Границы блоков ===
+void test_round_trip_across_block_boundaries()
+{
+    makeReadings(READINGS);
+    size_t blockCount = encodeAll(readings, READINGS);
+    TEST_ASSERT_GREATER_THAN(10, blockCount);
+    assertDecodes(blockCount, readings, READINGS);
+}
+
+void test_full_block_is_left_unchanged()
+{
+    makeReadings(READINGS);
+    CodecState state;
+    codecBlockBegin(blocks[0], state);
+    size_t i = 0;
+    while (codecBlockAppend(blocks[0], state, readings[i]))
+        i++;
+    TEST_ASSERT_GREATER_THAN(8, i);
+    TEST_ASSERT_LESS_OR_EQUAL(CODEC_BLOCK_BITS, codecBlockBits(blocks[0]));
+
+    uint8_t copy[CODEC_BLOCK_SIZE];
+    memcpy(copy, blocks[0], sizeof(copy));
+    CodecState before = state;
+    TEST_ASSERT_FALSE(codecBlockAppend(blocks[0], state, readings[i]));
+    TEST_ASSERT_EQUAL_MEMORY(copy, blocks[0], sizeof(copy));
+    TEST_ASSERT_EQUAL_MEMORY(&before, &state, sizeof(state));
+    assertDecodes(1, readings, i);
+}
+
+void test_unencodable_reading_is_rejected()
+{
+    makeReadings(3);
+    CodecState state;
+    codecBlockBegin(blocks[0], state);
+    TEST_ASSERT_TRUE(codecBlockAppend(blocks[0], state, readings[0]));
+    TEST_ASSERT_TRUE(codecBlockAppend(blocks[0], state, readings[1]));
+
+    SensorReading earlier = readings[2];
+    earlier.timestamp = readings[1].timestamp - 1; // метки не убывают
+    TEST_ASSERT_FALSE(codecBlockAppend(blocks[0], state, earlier));
+    SensorReading far = readings[2];
+    far.timestamp += 1ULL << 40; // разность разностей вне 32 бит
+    TEST_ASSERT_FALSE(codecBlockAppend(blocks[0], state, far));
+
+    TEST_ASSERT_TRUE(codecBlockAppend(blocks[0], state, readings[2]));
+    assertDecodes(1, readings, 3);
+}
+
+// === Флаги и недействительные каналы ===
+void test_flag_changes_round_trip()
+{
+    makeReadings(12);
+    sampleSetHumidity(readings[2], NAN);            // сбой канала
+    readings[3].flags &= ~SAMPLE_PRESSURE;          // датчик пропал
+    readings[3].pressurePa = 0;
+    readings[4].flags &= ~(SAMPLE_PRESSURE | SAMPLE_VCC);
+    readings[4].pressurePa = 0;
+    readings[4].vccMv = 0;
+    readings[5].flags = 0;                          // ни одного канала
+    readings[5].tempCenti = 0;
+    readings[5].humPermille = 0;
+    readings[5].pressurePa = 0;
+    readings[5].vccMv = 0;
+    sampleSetTemperature(readings[6], 99.99f);      // скачок после пропуска
+    sampleSetTemperature(readings[7], -40.0f);
+    readings[8].flags |= SAMPLE_VCC_ERROR;          // флаг ошибки вместе с действительным каналом
+
+    size_t blockCount = encodeAll(readings, 12);
+    TEST_ASSERT_EQUAL_size_t(1, blockCount);
+    assertDecodes(1, readings, 12);
+}
+
+void test_invalid_channel_values_are_not_stored()
+{
+    makeReadings(4);
+    SensorReading garbage[4];
+    memcpy(garbage, readings, sizeof(garbage));
+    for (size_t i = 0; i < 4; i++)
+    {
+        readings[i].flags &= ~SAMPLE_PRESSURE;
+        readings[i].flags |= SAMPLE_PRESSURE_ERROR;
+        readings[i].pressurePa = 0;
+        garbage[i].flags = readings[i].flags;
+        garbage[i].pressurePa = 0xDEADBEEF; // значение без флага канала
+    }
+    encodeAll(readings, 4);
+    uint8_t clean[CODEC_BLOCK_SIZE];
+    memcpy(clean, blocks[0], sizeof(clean));
+
+    encodeAll(garbage, 4);
+    TEST_ASSERT_EQUAL_MEMORY(clean, blocks[0], sizeof(clean));
+    assertDecodes(1, readings, 4); // после декодирования — 0
+}
+
+void test_unknown_flag_bits_round_trip()
+{
+    makeReadings(3);
+    readings[1].flags = 0xF0; // только ошибки всех каналов
+    readings[1].tempCenti = 0;
+    readings[1].humPermille = 0;
+    readings[1].pressurePa = 0;
+    readings[1].vccMv = 0;
+    encodeAll(readings, 3);
+    assertDecodes(1, readings, 3);
+}
+
+// === Возобновление после перезагрузки ===
+void test_sealed_block_reopen()
+{
+    makeReadings(READINGS);
+    CodecState state;
+    codecBlockBegin(blocks[0], state);
+    size_t sealedCount = 0;
+    while (codecBlockAppend(blocks[0], state, readings[sealedCount]))
+        sealedCount++;
+
+    // Готовый блок: состояние восстанавливается, дописать в него нельзя, метка последнего показания известна
+    CodecState resumed;
+    TEST_ASSERT_TRUE(codecBlockResume(blocks[0], resumed));
+    TEST_ASSERT_EQUAL_UINT16(state.count, resumed.count);
+    TEST_ASSERT_EQUAL_UINT16(state.bitPos, resumed.bitPos);
+    TEST_ASSERT_TRUE(resumed.timestamp == readings[sealedCount - 1].timestamp);
+    TEST_ASSERT_FALSE(codecBlockAppend(blocks[0], resumed, readings[sealedCount]));
+
+    // Следующий, заполняемый блок: сбой после 5 показаний, продолжение с восстановленным состоянием
+    const SensorReading *rest = readings + sealedCount;
+    codecBlockBegin(blocks[1], state);
+    for (size_t i = 0; i < 5; i++)
+        TEST_ASSERT_TRUE(codecBlockAppend(blocks[1], state, rest[i]));
+    uint8_t reopened[CODEC_BLOCK_SIZE];
+    memcpy(reopened, blocks[1], sizeof(reopened));
+    TEST_ASSERT_TRUE(codecBlockResume(reopened, resumed));
+    TEST_ASSERT_EQUAL_MEMORY(&state, &resumed, sizeof(state));
+
+    for (size_t i = 5; i < 20; i++)
+    {
+        TEST_ASSERT_TRUE(codecBlockAppend(blocks[1], state, rest[i]));
+        TEST_ASSERT_TRUE(codecBlockAppend(reopened, resumed, rest[i]));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(blocks[1], reopened, CODEC_BLOCK_SIZE);
+    assertDecodes(2, readings, sealedCount + 20);
+}
+
+void test_corrupted_block_is_not_resumed()
+{
+    makeReadings(10);
+    encodeAll(readings, 10);
+    CodecState state;
+
+    uint8_t block[CODEC_BLOCK_SIZE];
+    memcpy(block, blocks[0], sizeof(block));
+    block[8]++; // показаний больше, чем в потоке бит
+    TEST_ASSERT_FALSE(codecBlockResume(block, state));
+
+    memcpy(block, blocks[0], sizeof(block));
+    block[10]++; // поток бит длиннее записанного
+    TEST_ASSERT_FALSE(codecBlockResume(block, state));
+
+    memcpy(block, blocks[0], sizeof(block));
+    block[10] = 0xFF;
+    block[11] = 0xFF; // за пределами блока
+    SensorReading r;
+    codecDecodeBegin(block, state);
+    TEST_ASSERT_FALSE(codecDecodeNext(block, state, r));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_across_block_boundaries);
+    RUN_TEST(test_full_block_is_left_unchanged);
+    RUN_TEST(test_unencodable_reading_is_rejected);
+    RUN_TEST(test_flag_changes_round_trip);
+    RUN_TEST(test_invalid_channel_values_are_not_stored);
+    RUN_TEST(test_unknown_flag_bits_round_trip);
+    RUN_TEST(test_sealed_block_reopen);
+    RUN_TEST(test_corrupted_block_is_not_resumed);
+    return UNITY_END();
+}
@@ -0,0 +1,252 @@
+// HTTPS симулятора (hal_native.cpp) против TLS-сервера, запущенного тестом: полное рукопожатие,
+// возобновление сессии на втором POST, отказ при сервере не из пакета корневых сертификатов.
+// Сертификаты создаются тестом (самоподписанные, CN и SAN — localhost).
+// Запуск: pio test -e native_test -f test_https
+#include <unity.h>
+#include "https.h"
+#include "hal.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+#define POST_TIMEOUT_MS 5000
+
+static const uint8_t BODY[] = "{\"temperature\":21.5}";
+
+struct TestIdentity
+{
+    EVP_PKEY *key;
+    X509 *cert;
+};
+
+static TestIdentity trusted;   // в пакете корневых сертификатов узла
+static TestIdentity untrusted; // тот же CN, но в пакет не входит
+static pid_t serverPid = -1;
+static uint16_t serverPort = 0;
+
+// === Сертификаты ===
+static EVP_PKEY *makeKey()
+{
+    EVP_PKEY *key = nullptr;
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (ctx && EVP_PKEY_keygen_init(ctx) == 1 && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) == 1)
+        EVP_PKEY_keygen(ctx, &key);
+    EVP_PKEY_CTX_free(ctx);
+    return key;
+}
+
+static bool addExtension(X509 *cert, int nid, const char *value)
+{
+    X509V3_CTX v3;
+    X509V3_set_ctx_nodb(&v3);
+    X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+    X509_EXTENSION *ext = X509V3_EXT_conf_nid(nullptr, &v3, nid, value);
+    if (!ext)
+        return false;
+    bool ok = X509_add_ext(cert, ext, -1) == 1;
+    X509_EXTENSION_free(ext);
+    return ok;
+}
+
+static TestIdentity makeIdentity(long serial)
+{
+    TestIdentity id = {makeKey(), X509_new()};
+    X509 *cert = id.cert;
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), serial);
+    X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 86400);
+    X509_set_pubkey(cert, id.key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    addExtension(cert, NID_basic_constraints, "critical,CA:TRUE");
+    addExtension(cert, NID_subject_alt_name, "DNS:localhost");
+    X509_sign(cert, id.key, EVP_sha256());
+    return id;
+}
+
+/**
+ * @brief Сертификат в файл пакета (TLS_CA_BUNDLE_FILE), как loadCaBundle() в main_native
+ */
+static bool writeCaBundle(X509 *cert)
+{
+    BIO *bio = BIO_new(BIO_s_mem());
+    PEM_write_bio_X509(bio, cert);
+    char *pem = nullptr;
+    long len = BIO_get_mem_data(bio, &pem);
+    bool ok = len > 0 && halFsWrite(TLS_CA_BUNDLE_FILE, pem, (size_t)len);
+    BIO_free(bio);
+    return ok;
+}
+
+// === Сервер: дочерний процесс, соединения по очереди, ответ 200 на любой запрос ===
+static void serveRequest(SSL *ssl)
+{
+    char request[1024];
+    size_t received = 0;
+    for (;;)
+    {
+        int n = SSL_read(ssl, request + received, (int)(sizeof(request) - 1 - received));
+        if (n <= 0)
+            return;
+        received += n;
+        request[received] = '\0';
+        const char *headerEnd = strstr(request, "\r\n\r\n");
+        if (!headerEnd)
+            continue;
+        const char *length = strstr(request, "Content-Length: ");
+        size_t bodyLen = length ? (size_t)atol(length + 16) : 0;
+        if (received >= (size_t)(headerEnd + 4 - request) + bodyLen || received == sizeof(request) - 1)
+            break;
+    }
+    static const char RESPONSE[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    SSL_write(ssl, RESPONSE, sizeof(RESPONSE) - 1);
+    SSL_shutdown(ssl);
+}
+
+static void serverLoop(int listener, const TestIdentity &identity, int connections)
+{
+    signal(SIGPIPE, SIG_IGN);
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(ctx, identity.cert);
+    SSL_CTX_use_PrivateKey(ctx, identity.key);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER); // ID; тикеты включены по умолчанию
+    for (int i = 0; i < connections; i++)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+            break;
+        SSL *ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, fd);
+        if (SSL_accept(ssl) == 1)
+            serveRequest(ssl);
+        SSL_free(ssl);
+        close(fd);
+    }
+    SSL_CTX_free(ctx);
+}
+
+static bool startServer(const TestIdentity &identity, int connections)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressLen = sizeof(address);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 4) != 0 ||
+        getsockname(listener, (struct sockaddr *)&address, &addressLen) != 0)
+        return false;
+    serverPort = ntohs(address.sin_port);
+    fflush(stdout);
+    serverPid = fork();
+    if (serverPid == 0)
+    {
+        serverLoop(listener, identity, connections);
+        _exit(0);
+    }
+    close(listener);
+    return serverPid > 0;
+}
+
+static void stopServer()
+{
+    if (serverPid <= 0)
+        return;
+    kill(serverPid, SIGTERM);
+    waitpid(serverPid, nullptr, 0);
+    serverPid = -1;
+}
+
+static int post()
+{
+    char url[64];
+    snprintf(url, sizeof(url), "https://localhost:%u/api", serverPort);
+    return halHttpPost(url, "application/json", BODY, sizeof(BODY) - 1, POST_TIMEOUT_MS);
+}
+
+static bool sessionSaved()
+{
+    size_t len = 0;
+    return tlsSessionFor("localhost", serverPort, &len) != nullptr && len > 0;
+}
+
+void setUp()
+{
+    memset(&tlsStats, 0, sizeof(tlsStats));
+    tlsSessionClear();
+    writeCaBundle(trusted.cert);
+}
+
+void tearDown()
+{
+    stopServer();
+}
+
+// === Тесты ===
+void test_first_post_full_handshake()
+{
+    TEST_ASSERT_TRUE(startServer(trusted, 1));
+    TEST_ASSERT_EQUAL(200, post());
+    TEST_ASSERT_EQUAL_UINT32(1, tlsStats.fullHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(0, tlsStats.resumedHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(0, tlsStats.failures);
+    TEST_ASSERT_TRUE(sessionSaved());
+}
+
+void test_second_post_resumes_session()
+{
+    TEST_ASSERT_TRUE(startServer(trusted, 2));
+    TEST_ASSERT_EQUAL(200, post());
+    TEST_ASSERT_EQUAL(200, post());
+    TEST_ASSERT_EQUAL_UINT32(1, tlsStats.fullHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(1, tlsStats.resumedHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(0, tlsStats.failures);
+    TEST_ASSERT_TRUE(sessionSaved());
+}
+
+void test_server_outside_ca_bundle_fails_cleanly()
+{
+    TEST_ASSERT_TRUE(startServer(untrusted, 1));
+    TEST_ASSERT_LESS_THAN(0, post());
+    TEST_ASSERT_EQUAL_UINT32(0, tlsStats.fullHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(0, tlsStats.resumedHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(1, tlsStats.failures);
+    TEST_ASSERT_FALSE(sessionSaved());
+}
+
+void test_no_ca_bundle_refuses_https()
+{
+    halFsRemove(TLS_CA_BUNDLE_FILE);
+    TEST_ASSERT_TRUE(startServer(trusted, 1));
+    TEST_ASSERT_LESS_THAN(0, post());
+    TEST_ASSERT_EQUAL_UINT32(0, tlsStats.fullHandshakes);
+    TEST_ASSERT_EQUAL_UINT32(1, tlsStats.failures);
+}
+
+int main(int, char **)
+{
+    trusted = makeIdentity(1);
+    untrusted = makeIdentity(2);
+    UNITY_BEGIN();
+    RUN_TEST(test_first_post_full_handshake);
+    RUN_TEST(test_second_post_resumes_session);
+    RUN_TEST(test_server_outside_ca_bundle_fails_cleanly);
+    RUN_TEST(test_no_ca_bundle_refuses_https);
+    return UNITY_END();
+}
@@ -0,0 +1,217 @@
+// Приёмники (sink.cpp) и строка line protocol (payload.cpp): экранирование тега uid, строка без uid,
+// пересылка показаний узлов ESP-NOW шлюзом через очереди приёмников с uid по MAC узла.
+// UDP-приёмник шлёт на сокет, открытый тестом; MQTT и HTTP не настроены.
+// Запуск: pio test -e native_test -f test_sink
+#include <unity.h>
+#include "sink.h"
+#include "espnow.h"
+#include "payload.h"
+#include "config.h"
+#include "hal.h"
+#include "hal_native.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+static const uint8_t DEVICE_MAC[6] = {0x24, 0x0A, 0xC4, 0x12, 0x34, 0x56};
+static int udpSocket = -1;
+
+static SensorReading testReading()
+{
+    SensorReading reading = {};
+    reading.timestamp = 1700000000000ULL;
+    reading.tempCenti = 2140;
+    reading.humPermille = 482;
+    reading.pressurePa = 100711; // 755.4 мм рт. ст.
+    reading.vccMv = 3710;
+    reading.flags = SAMPLE_TEMPERATURE | SAMPLE_HUMIDITY | SAMPLE_PRESSURE | SAMPLE_VCC;
+    return reading;
+}
+
+static void nodeMac(uint8_t mac[6], uint8_t id)
+{
+    const uint8_t base[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[5] = id;
+}
+
+static void deliverFrame(uint8_t id, int rssi)
+{
+    uint8_t mac[6];
+    nodeMac(mac, id);
+    uint8_t frame[ESPNOW_FRAME_SIZE];
+    encodeNodeFrame(frame, sizeof(frame), 1, testReading());
+    gatewayReceive(mac, rssi, frame, sizeof(frame));
+}
+
+/**
+ * @brief Следующая строка, принятая тестовым сокетом; "" — строк нет
+ */
+static const char *receiveLine()
+{
+    static char line[PAYLOAD_MAX_SIZE + 1];
+    ssize_t n = recv(udpSocket, line, sizeof(line) - 1, MSG_DONTWAIT);
+    line[n > 0 ? n : 0] = '\0';
+    return line;
+}
+
+void setUp()
+{
+    udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressLen = sizeof(address);
+    bind(udpSocket, (struct sockaddr *)&address, sizeof(address));
+    getsockname(udpSocket, (struct sockaddr *)&address, &addressLen);
+
+    config = Config();
+    strlcpy(config.influx_host, "127.0.0.1", sizeof(config.influx_host));
+    config.influx_port = ntohs(address.sin_port);
+    config.publishingInterval = 60000;
+    halSimSetMac(DEVICE_MAC);
+    sinksReset();
+    gatewayReset();
+}
+
+void tearDown()
+{
+    close(udpSocket);
+}
+
+// === Строка line protocol ===
+void test_line_protocol_escapes_uid_tag()
+{
+    char line[PAYLOAD_MAX_SIZE];
+    size_t len = encodeLineProtocol(line, sizeof(line), "node 1,a=b", -61, testReading());
+    TEST_ASSERT_EQUAL_STRING("sensors,uid=node\\ 1\\,a\\=b temperature=21.4,humidity=48.2,pressure=755.4,vcc=3.71,"
+                             "rssi=-61i 1700000000000000000",
+                             line);
+    TEST_ASSERT_EQUAL_size_t(strlen(line), len);
+}
+
+void test_line_protocol_without_uid_omits_tag()
+{
+    char line[PAYLOAD_MAX_SIZE];
+    SensorReading reading = testReading();
+    reading.flags = SAMPLE_VCC | SAMPLE_TEMPERATURE_ERROR;
+    reading.timestamp = 0;
+    TEST_ASSERT_GREATER_THAN(0, encodeLineProtocol(line, sizeof(line), "", -61, reading));
+    TEST_ASSERT_EQUAL_STRING("sensors vcc=3.71,rssi=-61i", line);
+
+    reading.flags = 0; // без каналов остаётся rssi
+    encodeLineProtocol(line, sizeof(line), "", -61, reading);
+    TEST_ASSERT_EQUAL_STRING("sensors rssi=-61i", line);
+}
+
+void test_line_protocol_reports_overflow()
+{
+    char line[PAYLOAD_MAX_SIZE];
+    size_t len = encodeLineProtocol(line, sizeof(line), "a,b", -61, testReading());
+    TEST_ASSERT_EQUAL_size_t(0, encodeLineProtocol(line, len, "a,b", -61, testReading())); // без места под '\0'
+    TEST_ASSERT_EQUAL_size_t(0, encodeLineProtocol(line, 16, "a,b,c,d,e,f", -61, testReading())); // обрезан тег
+}
+
+void test_mac_uid()
+{
+    char uid[MAC_UID_SIZE];
+    TEST_ASSERT_EQUAL_size_t(12, formatMacUid(uid, sizeof(uid), DEVICE_MAC));
+    TEST_ASSERT_EQUAL_STRING("240ac4123456", uid);
+    TEST_ASSERT_EQUAL_size_t(0, formatMacUid(uid, sizeof(uid) - 1, DEVICE_MAC));
+}
+
+// === Свои показания ===
+void test_own_reading_without_uid_is_tagged_by_device_mac()
+{
+    TEST_ASSERT_EQUAL_UINT8(1 << SINK_UDP, sinkPublish(testReading()));
+    TEST_ASSERT_EQUAL_UINT32(SINK_IDLE, sinkServe(SINK_UDP));
+    const char *line = receiveLine();
+    TEST_ASSERT_EQUAL_STRING_LEN("sensors,uid=240ac4123456 temperature=21.4,", line, 42);
+    TEST_ASSERT_NOT_NULL(strstr(line, ",rssi=-55i "));
+
+    strlcpy(config.uid, "garden", sizeof(config.uid));
+    sinksReset();
+    sinkPublish(testReading());
+    sinkServe(SINK_UDP);
+    TEST_ASSERT_EQUAL_STRING_LEN("sensors,uid=garden ", receiveLine(), 19);
+}
+
+// === Показания узлов ESP-NOW ===
+void test_gateway_forwards_nodes_through_sinks()
+{
+    deliverFrame(1, -70);
+    deliverFrame(2, -80);
+    TEST_ASSERT_EQUAL_UINT8(2, gatewayPoll(1000, 0));
+    // Темп своих показаний к узлам не относится: оба в очереди сразу
+    TEST_ASSERT_EQUAL_UINT8(2, gatewayForward());
+    TEST_ASSERT_EQUAL_UINT32(2, sinkPending(SINK_UDP));
+    TEST_ASSERT_EQUAL_UINT32(0, sinkPending(SINK_MQTT));
+    TEST_ASSERT_EQUAL_UINT32(0, sinkPending(SINK_HTTP));
+
+    sinkServe(SINK_UDP);
+    const char *line = receiveLine();
+    TEST_ASSERT_EQUAL_STRING_LEN("sensors,uid=240ac4000001 ", line, 25);
+    TEST_ASSERT_NOT_NULL(strstr(line, ",rssi=-70i "));
+    line = receiveLine();
+    TEST_ASSERT_EQUAL_STRING_LEN("sensors,uid=240ac4000002 ", line, 25);
+    TEST_ASSERT_NOT_NULL(strstr(line, ",rssi=-80i "));
+    TEST_ASSERT_EQUAL_STRING("", receiveLine());
+
+    // Пересланное не повторяется
+    TEST_ASSERT_EQUAL_UINT8(0, gatewayForward());
+    TEST_ASSERT_EQUAL_UINT32(0, sinkPending(SINK_UDP));
+}
+
+void test_full_queue_keeps_node_pending_without_duplicates()
+{
+    const uint8_t nodes = SINK_QUEUE_SIZE + 2;
+    for (uint8_t id = 1; id <= nodes; id++)
+        deliverFrame(id, -60);
+    gatewayPoll(1000, 0);
+
+    TEST_ASSERT_EQUAL_UINT8(SINK_QUEUE_SIZE, gatewayForward());
+    TEST_ASSERT_EQUAL_UINT32(0, sinks[SINK_UDP].stats.dropped); // не потеряны — ждут на шлюзе
+    sinkServe(SINK_UDP);
+    TEST_ASSERT_EQUAL_UINT8(nodes - SINK_QUEUE_SIZE, gatewayForward());
+    sinkServe(SINK_UDP);
+
+    uint32_t lines = 0;
+    while (receiveLine()[0] != '\0')
+        lines++;
+    TEST_ASSERT_EQUAL_UINT32(nodes, lines);
+    TEST_ASSERT_EQUAL_UINT32(nodes, sinks[SINK_UDP].stats.sent);
+    TEST_ASSERT_EQUAL_UINT32(nodes, gatewayStats.forwarded);
+}
+
+void test_node_readings_do_not_pace_own_readings()
+{
+    deliverFrame(1, -60);
+    gatewayPoll(1000, 0);
+    gatewayForward();
+    // Первое своё показание после загрузки проходит сразу, хотя узел уже в очереди
+    TEST_ASSERT_EQUAL_UINT8(1 << SINK_UDP, sinkPublish(testReading()));
+    TEST_ASSERT_EQUAL_UINT8(0, sinkPublish(testReading()));
+    TEST_ASSERT_EQUAL_UINT32(1, sinks[SINK_UDP].stats.limited);
+}
+
+int main(int, char **)
+{
+    halSimSetLogEnabled(false);
+    UNITY_BEGIN();
+    RUN_TEST(test_line_protocol_escapes_uid_tag);
+    RUN_TEST(test_line_protocol_without_uid_omits_tag);
+    RUN_TEST(test_line_protocol_reports_overflow);
+    RUN_TEST(test_mac_uid);
+    RUN_TEST(test_own_reading_without_uid_is_tagged_by_device_mac);
+    RUN_TEST(test_gateway_forwards_nodes_through_sinks);
+    RUN_TEST(test_full_queue_keeps_node_pending_without_duplicates);
+    RUN_TEST(test_node_readings_do_not_pace_own_readings);
+    return UNITY_END();
+}
@@ -0,0 +1,398 @@
+// Перевод трассы (trace.cpp) по синтетическим образам: отказ от обрезанного и чужого файла,
+// монотонное время через переполнение 32-битных микросекунд, экранирование имён задач
+// и корректность JSON Chrome trace; двоичная выгрузка воспроизводит исходный образ.
+// Запуск: pio test -e native_test -f test_trace
+#include <unity.h>
+#include "trace.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+#define IMAGE_MAX 4096
+#define OUTPUT_MAX 16384
+
+static uint8_t file[IMAGE_MAX];
+static char output[OUTPUT_MAX];
+static TraceImage image;
+
+static const uint32_t TASK_A = 0x3FFB1000;
+static const uint32_t TASK_B = 0x3FFB2000;
+
+/**
+ * @brief Образ в формате /api/trace.bin: заголовок, задачи, события
+ * @return длина образа
+ */
+static size_t buildImage(const TraceTask *tasks, uint16_t taskCount, const TraceEvent *events, uint32_t eventCount)
+{
+    TraceFileHeader header = {TRACE_MAGIC, TRACE_VERSION, taskCount, eventCount, 7};
+    size_t len = 0;
+    memcpy(file + len, &header, sizeof(header));
+    len += sizeof(header);
+    if (taskCount)
+        memcpy(file + len, tasks, taskCount * sizeof(TraceTask));
+    len += taskCount * sizeof(TraceTask);
+    if (eventCount)
+        memcpy(file + len, events, eventCount * sizeof(TraceEvent));
+    len += eventCount * sizeof(TraceEvent);
+    return len;
+}
+
+static TraceTask task(uint32_t id, const char *name)
+{
+    TraceTask t = {};
+    t.id = id;
+    strncpy(t.name, name, sizeof(t.name) - 1);
+    return t;
+}
+
+static TraceEvent event(uint32_t timeUs, uint8_t type, uint8_t core, uint32_t arg, uint16_t id)
+{
+    TraceEvent e = {timeUs, arg, type, core, id};
+    return e;
+}
+
+/**
+ * @brief Выгрузка целиком мелкими порциями (как ответ веб-сервера)
+ * @return длина выгрузки
+ */
+static size_t streamAll(bool json)
+{
+    TraceStream stream;
+    traceStreamBegin(stream, image, json);
+    size_t len = 0;
+    size_t n;
+    while ((n = traceStreamRead(stream, (uint8_t *)output + len, 7)) > 0 && len + n < OUTPUT_MAX - 7)
+        len += n;
+    output[len] = '\0';
+    return len;
+}
+
+// === Проверка JSON (RFC 8259) ===
+static bool parseValue(const char *&p);
+
+static void skipSpace(const char *&p)
+{
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+        p++;
+}
+
+static bool parseString(const char *&p)
+{
+    if (*p++ != '"')
+        return false;
+    while (*p != '"')
+    {
+        if (*p == '\0' || (uint8_t)*p < 0x20)
+            return false;
+        if (*p == '\\')
+        {
+            p++;
+            if (*p == 'u')
+            {
+                for (int i = 1; i <= 4; i++)
+                {
+                    if (!isxdigit((uint8_t)p[i]))
+                        return false;
+                }
+                p += 4;
+            }
+            else if (*p == '\0' || !strchr("\"\\/bfnrt", *p))
+            {
+                return false;
+            }
+        }
+        p++;
+    }
+    p++;
+    return true;
+}
+
+static bool parseNumber(const char *&p)
+{
+    if (*p == '-')
+        p++;
+    if (!isdigit((uint8_t)*p))
+        return false;
+    while (isdigit((uint8_t)*p))
+        p++;
+    if (*p == '.')
+    {
+        p++;
+        if (!isdigit((uint8_t)*p))
+            return false;
+        while (isdigit((uint8_t)*p))
+            p++;
+    }
+    return true;
+}
+
+static bool parseList(const char *&p, char close, bool object)
+{
+    p++;
+    skipSpace(p);
+    if (*p == close)
+    {
+        p++;
+        return true;
+    }
+    for (;;)
+    {
+        skipSpace(p);
+        if (object)
+        {
+            if (!parseString(p))
+                return false;
+            skipSpace(p);
+            if (*p++ != ':')
+                return false;
+        }
+        if (!parseValue(p))
+            return false;
+        skipSpace(p);
+        if (*p == close)
+        {
+            p++;
+            return true;
+        }
+        if (*p++ != ',')
+            return false;
+    }
+}
+
+static bool parseValue(const char *&p)
+{
+    skipSpace(p);
+    switch (*p)
+    {
+    case '{':
+        return parseList(p, '}', true);
+    case '[':
+        return parseList(p, ']', false);
+    case '"':
+        return parseString(p);
+    case 't':
+        return strncmp(p, "true", 4) == 0 && (p += 4);
+    case 'f':
+        return strncmp(p, "false", 5) == 0 && (p += 5);
+    case 'n':
+        return strncmp(p, "null", 4) == 0 && (p += 4);
+    default:
+        return parseNumber(p);
+    }
+}
+
+static bool isJson(const char *text)
+{
+    const char *p = text;
+    if (!parseValue(p))
+        return false;
+    skipSpace(p);
+    return *p == '\0';
+}
+
+/**
+ * @brief Значения "ts" по порядку появления в выгрузке
+ */
+static size_t timestamps(const char *json, unsigned long long *ts, size_t max)
+{
+    size_t n = 0;
+    for (const char *p = strstr(json, "\"ts\":"); p && n < max; p = strstr(p + 5, "\"ts\":"))
+        ts[n++] = strtoull(p + 5, nullptr, 10);
+    return n;
+}
+
+void setUp()
+{
+    memset(&image, 0, sizeof(image));
+}
+
+void tearDown() {}
+
+// === Загрузка образа ===
+void test_load_accepts_valid_image()
+{
+    TraceTask tasks[] = {task(TASK_A, "SensorTask")};
+    TraceEvent events[] = {event(100, TRACE_BEGIN, 0, TASK_A, TRACE_SENSOR_READ),
+                           event(200, TRACE_END, 0, TASK_A, TRACE_SENSOR_READ)};
+    size_t len = buildImage(tasks, 1, events, 2);
+    TEST_ASSERT_TRUE(traceLoad(image, file, len));
+    TEST_ASSERT_EQUAL_UINT16(1, image.taskCount);
+    TEST_ASSERT_EQUAL_UINT32(2, image.count);
+    TEST_ASSERT_EQUAL_UINT32(7, image.lost);
+    TEST_ASSERT_EQUAL_UINT32(200, image.events[1].timeUs);
+}
+
+void test_load_rejects_truncated_image()
+{
+    TraceTask tasks[] = {task(TASK_A, "SensorTask")};
+    TraceEvent events[] = {event(100, TRACE_BEGIN, 0, TASK_A, 0), event(200, TRACE_END, 0, TASK_A, 0)};
+    size_t len = buildImage(tasks, 1, events, 2);
+    TEST_ASSERT_FALSE(traceLoad(image, file, len - 1));                   // последнее событие неполное
+    TEST_ASSERT_FALSE(traceLoad(image, file, sizeof(TraceFileHeader) + 4)); // обрезана таблица задач
+    TEST_ASSERT_FALSE(traceLoad(image, file, sizeof(TraceFileHeader) - 1));
+    TEST_ASSERT_FALSE(traceLoad(image, file, 0));
+
+    // Число событий из заголовка больше, чем в файле, — в том числе с переполнением при умножении
+    TraceFileHeader header;
+    memcpy(&header, file, sizeof(header));
+    header.eventCount = 0xFFFFFFFF;
+    memcpy(file, &header, sizeof(header));
+    TEST_ASSERT_FALSE(traceLoad(image, file, len));
+}
+
+void test_load_rejects_bad_magic_version_and_task_count()
+{
+    TraceEvent events[] = {event(100, TRACE_BEGIN, 0, TASK_A, 0)};
+    size_t len = buildImage(nullptr, 0, events, 1);
+    TraceFileHeader header;
+    memcpy(&header, file, sizeof(header));
+
+    TraceFileHeader bad = header;
+    bad.magic ^= 1;
+    memcpy(file, &bad, sizeof(bad));
+    TEST_ASSERT_FALSE(traceLoad(image, file, len));
+
+    bad = header;
+    bad.version = TRACE_VERSION + 1;
+    memcpy(file, &bad, sizeof(bad));
+    TEST_ASSERT_FALSE(traceLoad(image, file, len));
+
+    bad = header;
+    bad.taskCount = TRACE_TASKS_MAX + 1;
+    memcpy(file, &bad, sizeof(bad));
+    TEST_ASSERT_FALSE(traceLoad(image, file, IMAGE_MAX));
+}
+
+// === Время ===
+void test_timestamps_monotonic_across_32bit_wrap()
+{
+    TraceTask tasks[] = {task(TASK_A, "SensorTask")};
+    TraceEvent events[] = {
+        event(0xFFFFFF00u, TRACE_BEGIN, 0, TASK_A, TRACE_SENSOR_READ),
+        event(0xFFFFFFF0u, TRACE_END, 0, TASK_A, TRACE_SENSOR_READ),
+        event(0x00000010u, TRACE_BEGIN, 0, TASK_A, TRACE_MQTT_PUBLISH), // после переполнения halMicros()
+        event(0x00000100u, TRACE_END, 0, TASK_A, TRACE_MQTT_PUBLISH),
+    };
+    TEST_ASSERT_TRUE(traceLoad(image, file, buildImage(tasks, 1, events, 4)));
+    streamAll(true);
+    TEST_ASSERT_TRUE(isJson(output));
+
+    unsigned long long ts[8];
+    TEST_ASSERT_EQUAL_size_t(4, timestamps(output, ts, 8));
+    TEST_ASSERT_TRUE(ts[0] == 0);
+    TEST_ASSERT_TRUE(ts[1] == 0xF0);
+    TEST_ASSERT_TRUE(ts[2] == 0x110);
+    TEST_ASSERT_TRUE(ts[3] == 0x200);
+}
+
+void test_task_run_spans_wrap()
+{
+    TraceTask tasks[] = {task(TASK_A, "SensorTask"), task(TASK_B, "IDLE0")};
+    TraceEvent events[] = {
+        event(0xFFFFF000u, TRACE_SWITCH, 0, TASK_A, 0),
+        event(0x00001000u, TRACE_SWITCH, 0, TASK_B, 0), // SensorTask выполнялась 0x2000 мкс
+        event(0x00001800u, TRACE_SWITCH, 0, TASK_A, 0),
+    };
+    TEST_ASSERT_TRUE(traceLoad(image, file, buildImage(tasks, 2, events, 3)));
+    streamAll(true);
+    TEST_ASSERT_TRUE(isJson(output));
+    TEST_ASSERT_NOT_NULL(strstr(output, "{\"name\":\"SensorTask\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":0,\"dur\":8192}"));
+    TEST_ASSERT_NOT_NULL(strstr(output, "{\"name\":\"IDLE0\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":8192,\"dur\":2048}"));
+}
+
+void test_out_of_order_events_are_not_taken_for_wrap()
+{
+    TraceTask tasks[] = {task(TASK_A, "SensorTask"), task(TASK_B, "SinkTask")};
+    TraceEvent events[] = {
+        event(1000, TRACE_BEGIN, 0, TASK_A, TRACE_SENSOR_READ),
+        event(1500, TRACE_BEGIN, 1, TASK_B, TRACE_HTTP_POST),
+        event(1400, TRACE_END, 0, TASK_A, TRACE_SENSOR_READ), // ядро 0 записало позже
+        event(2000, TRACE_END, 1, TASK_B, TRACE_HTTP_POST),
+    };
+    TEST_ASSERT_TRUE(traceLoad(image, file, buildImage(tasks, 2, events, 4)));
+    streamAll(true);
+    // Шаг назад — разброс между ядрами, а не переполнение на 2^32 мкс вперёд
+    unsigned long long ts[8];
+    TEST_ASSERT_EQUAL_size_t(4, timestamps(output, ts, 8));
+    TEST_ASSERT_TRUE(ts[0] == 0);
+    TEST_ASSERT_TRUE(ts[1] == 500);
+    TEST_ASSERT_TRUE(ts[2] == 400);
+    TEST_ASSERT_TRUE(ts[3] == 1000);
+}
+
+// === Имена задач и JSON ===
+void test_task_names_are_escaped()
+{
+    TraceTask tasks[] = {task(TASK_A, "bad\"na\\me"), task(TASK_B, "tab\there"), task(0x1234ABCD, "")};
+    TraceEvent events[] = {
+        event(10, TRACE_BEGIN, 0, TASK_A, TRACE_FLASH_WRITE),
+        event(20, TRACE_END, 0, TASK_A, TRACE_FLASH_WRITE),
+        event(30, TRACE_SWITCH, 1, TASK_B, 0),
+        event(40, TRACE_SWITCH, 1, 0x1234ABCD, 0),
+        event(50, TRACE_SWITCH, 1, 0xDEAD0000, 0), // задачи нет в таблице
+        event(60, TRACE_ISR_ENTER, 1, 0, 3),
+        event(70, TRACE_ISR_EXIT, 1, 0, 3),
+    };
+    TEST_ASSERT_TRUE(traceLoad(image, file, buildImage(tasks, 3, events, 7)));
+    streamAll(true);
+    TEST_ASSERT_TRUE_MESSAGE(isJson(output), output);
+    TEST_ASSERT_NOT_NULL(strstr(output, "\"args\":{\"name\":\"bad\\\"na\\\\me\"}"));
+    TEST_ASSERT_NOT_NULL(strstr(output, "\"name\":\"tab\\u0009here\",\"ph\":\"X\""));
+    TEST_ASSERT_NOT_NULL(strstr(output, "\"args\":{\"name\":\"task 1234abcd\"}"));
+    TEST_ASSERT_NOT_NULL(strstr(output, "\"name\":\"other\",\"ph\":\"X\""));
+    TEST_ASSERT_NOT_NULL(strstr(output, "\"name\":\"isr 3\",\"ph\":\"B\",\"pid\":0,\"tid\":3"));
+    TEST_ASSERT_NOT_NULL(strstr(output, "\"otherData\":{\"lost_events\":7}"));
+}
+
+void test_empty_image_is_valid_json()
+{
+    TEST_ASSERT_TRUE(traceLoad(image, file, buildImage(nullptr, 0, nullptr, 0)));
+    streamAll(true);
+    TEST_ASSERT_TRUE_MESSAGE(isJson(output), output);
+}
+
+void test_json_checker_rejects_broken_json()
+{
+    TEST_ASSERT_TRUE(isJson("{\"a\":[1,-2.5,\"x\\\"y\\u0009\",true,null],\"b\":{}}"));
+    TEST_ASSERT_FALSE(isJson("{\"a\":\"x\"y\"}"));
+    TEST_ASSERT_FALSE(isJson("{\"a\":\"x\\y\"}"));
+    TEST_ASSERT_FALSE(isJson("{\"a\":[1,]}"));
+    TEST_ASSERT_FALSE(isJson("{\"a\":1"));
+}
+
+// === Двоичная выгрузка ===
+void test_binary_stream_reproduces_image()
+{
+    TraceTask tasks[] = {task(TASK_A, "SensorTask"), task(TASK_B, "SinkTask")};
+    TraceEvent events[64];
+    for (uint32_t i = 0; i < 64; i++) // больше одной порции TRACE_TEXT_SIZE
+        events[i] = event(0xFFFFFF00u + i * 16, (uint8_t)(i % 3), i & 1, i & 1 ? TASK_B : TASK_A, i % TRACE_SPAN_COUNT);
+    size_t len = buildImage(tasks, 2, events, 64);
+    static uint8_t original[IMAGE_MAX];
+    memcpy(original, file, len);
+    TEST_ASSERT_TRUE(traceLoad(image, original, len));
+
+    TEST_ASSERT_EQUAL_size_t(len, streamAll(false));
+    TEST_ASSERT_EQUAL_MEMORY(original, output, len);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_load_accepts_valid_image);
+    RUN_TEST(test_load_rejects_truncated_image);
+    RUN_TEST(test_load_rejects_bad_magic_version_and_task_count);
+    RUN_TEST(test_timestamps_monotonic_across_32bit_wrap);
+    RUN_TEST(test_task_run_spans_wrap);
+    RUN_TEST(test_out_of_order_events_are_not_taken_for_wrap);
+    RUN_TEST(test_task_names_are_escaped);
+    RUN_TEST(test_empty_image_is_valid_json);
+    RUN_TEST(test_json_checker_rejects_broken_json);
+    RUN_TEST(test_binary_stream_reproduces_image);
+    return UNITY_END();
+}
@@ -0,0 +1,185 @@
+// Эталонная модель программы ULP (ulp.cpp): окно порогов, пробуждение по порогу и по заполнению
+// истории, раскладка области данных в RTC_SLOW_MEM и передача истории в JSON для MQTT.
+// Запуск: pio test -e native_test -f test_ulp
+#include <unity.h>
+#include "ulp.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <string.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+// Память сопроцессора, зарезервированная Arduino-ESP32 (CONFIG_ULP_COPROC_RESERVE_MEM = 512 байт):
+// программа и данные должны поместиться в неё целиком
+#define ULP_RESERVED_WORDS (512 / sizeof(uint32_t))
+#define SENTINEL 0xDEADBEEFu
+
+static uint32_t rtcSlowMem[ULP_RESERVED_WORDS + 16]; // с запасом: запись за резерв видна
+static uint32_t *data = rtcSlowMem + ULP_DATA_OFFSET;
+
+static const uint16_t LAST_RAW = 2295; // ~3.7 В
+static uint16_t delta;
+
+void setUp()
+{
+    for (size_t i = 0; i < sizeof(rtcSlowMem) / sizeof(rtcSlowMem[0]); i++)
+        rtcSlowMem[i] = SENTINEL;
+    delta = ulpMillivoltsToRaw(ULP_WAKE_DELTA_MV);
+    ulpArm(data, LAST_RAW);
+}
+
+void tearDown() {}
+
+// === Окно порогов ===
+void test_arm_sets_window_around_last_sample()
+{
+    TEST_ASSERT_EQUAL_UINT32(LAST_RAW - delta, data[ULP_VAR_LOW]);
+    TEST_ASSERT_EQUAL_UINT32(LAST_RAW + delta, data[ULP_VAR_HIGH]);
+    TEST_ASSERT_EQUAL_UINT32(0, data[ULP_VAR_COUNT]);
+    TEST_ASSERT_EQUAL_UINT32(LAST_RAW, data[ULP_VAR_LAST]);
+    TEST_ASSERT_EQUAL_UINT32(ULP_WAKE_NONE, data[ULP_VAR_REASON]);
+
+    ulpArm(data, 10);
+    TEST_ASSERT_EQUAL_UINT32(0, data[ULP_VAR_LOW]);
+    ulpArm(data, 4090);
+    TEST_ASSERT_EQUAL_UINT32(4095, data[ULP_VAR_HIGH]);
+}
+
+// === Пробуждение по порогу ===
+void test_threshold_wake_below_window()
+{
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_NONE, ulpStep(data, LAST_RAW));
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_NONE, ulpStep(data, LAST_RAW - delta)); // граница — в окне
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_THRESHOLD, ulpStep(data, LAST_RAW - delta - 1));
+
+    UlpHistory history;
+    TEST_ASSERT_TRUE(ulpReadHistory(data, history));
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_THRESHOLD, history.reason);
+    TEST_ASSERT_EQUAL_UINT8(3, history.count);
+    TEST_ASSERT_EQUAL_UINT16(LAST_RAW - delta - 1, history.samples[2]); // отсчёт, разбудивший процессор
+    TEST_ASSERT_EQUAL_UINT32(LAST_RAW - delta - 1, data[ULP_VAR_LAST]);
+}
+
+void test_threshold_wake_above_window()
+{
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_NONE, ulpStep(data, LAST_RAW + delta));
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_THRESHOLD, ulpStep(data, LAST_RAW + delta + 1));
+    TEST_ASSERT_EQUAL_UINT32(ULP_WAKE_THRESHOLD, data[ULP_VAR_REASON]);
+    TEST_ASSERT_EQUAL_UINT32(2, data[ULP_VAR_COUNT]);
+}
+
+// === Пробуждение по заполнению истории ===
+void test_wake_on_full_history()
+{
+    for (uint8_t i = 0; i < ULP_HISTORY_SIZE - 1; i++)
+        TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_NONE, ulpStep(data, LAST_RAW + (i & 1)));
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_FULL, ulpStep(data, LAST_RAW));
+    TEST_ASSERT_EQUAL_UINT32(ULP_HISTORY_SIZE, data[ULP_VAR_COUNT]);
+
+    // Следующий запуск до пробуждения не перезаписывает историю — даже отсчётом вне окна
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_FULL, ulpStep(data, 0));
+    TEST_ASSERT_EQUAL_UINT32(ULP_HISTORY_SIZE, data[ULP_VAR_COUNT]);
+    TEST_ASSERT_EQUAL_UINT32(LAST_RAW, data[ULP_VAR_LAST]);
+
+    UlpHistory history;
+    TEST_ASSERT_TRUE(ulpReadHistory(data, history));
+    TEST_ASSERT_EQUAL_UINT8(ULP_WAKE_FULL, history.reason);
+    TEST_ASSERT_EQUAL_UINT8(ULP_HISTORY_SIZE, history.count);
+    TEST_ASSERT_EQUAL_UINT16(LAST_RAW + 1, history.samples[1]);
+}
+
+// === Раскладка области данных ===
+void test_data_layout_fits_reserved_memory()
+{
+    TEST_ASSERT_GREATER_OR_EQUAL(ULP_PROGRAM_MAX_WORDS, ULP_DATA_OFFSET);
+    TEST_ASSERT_LESS_OR_EQUAL(ULP_RESERVED_WORDS, ULP_DATA_OFFSET + ULP_DATA_WORDS);
+    TEST_ASSERT_EQUAL(ULP_VAR_HISTORY + ULP_HISTORY_SIZE, ULP_DATA_WORDS);
+
+    while (ulpStep(data, LAST_RAW) == ULP_WAKE_NONE)
+        ;
+    // Программа и память за областью данных не тронуты, история — по ULP_VAR_HISTORY + i
+    for (size_t i = 0; i < ULP_DATA_OFFSET; i++)
+        TEST_ASSERT_EQUAL_HEX32(SENTINEL, rtcSlowMem[i]);
+    for (size_t i = ULP_DATA_OFFSET + ULP_DATA_WORDS; i < sizeof(rtcSlowMem) / sizeof(rtcSlowMem[0]); i++)
+        TEST_ASSERT_EQUAL_HEX32(SENTINEL, rtcSlowMem[i]);
+    for (size_t i = 0; i < ULP_HISTORY_SIZE; i++)
+        TEST_ASSERT_EQUAL_UINT32(LAST_RAW, rtcSlowMem[ULP_DATA_OFFSET + ULP_VAR_HISTORY + i]);
+}
+
+void test_read_history_masks_upper_half_words()
+{
+    ulpStep(data, 1234);
+    ulpStep(data, LAST_RAW);
+    // Команда ST ULP пишет в старшие 16 бит слова адрес инструкции
+    for (size_t i = 0; i < ULP_DATA_WORDS; i++)
+        data[i] |= 0x00C80000u;
+
+    UlpHistory history;
+    TEST_ASSERT_TRUE(ulpReadHistory(data, history));
+    TEST_ASSERT_EQUAL_UINT8(2, history.count);
+    TEST_ASSERT_EQUAL_UINT16(1234, history.samples[0]);
+    TEST_ASSERT_EQUAL_UINT16(LAST_RAW, history.samples[1]);
+}
+
+void test_read_history_rejects_corrupt_data()
+{
+    UlpHistory history;
+    data[ULP_VAR_COUNT] = ULP_HISTORY_SIZE + 1;
+    TEST_ASSERT_FALSE(ulpReadHistory(data, history));
+    data[ULP_VAR_COUNT] = 0;
+    data[ULP_VAR_REASON] = ULP_WAKE_FULL + 1;
+    TEST_ASSERT_FALSE(ulpReadHistory(data, history));
+}
+
+// === Передача истории в JSON ===
+void test_history_json_handoff()
+{
+    UlpHistory history = {};
+    history.reason = ULP_WAKE_THRESHOLD;
+    history.count = 3;
+    history.samples[0] = 2295;
+    history.samples[1] = 2290;
+    history.samples[2] = 2200;
+
+    char buf[ULP_HISTORY_JSON_SIZE];
+    size_t len = encodeUlpHistory(buf, sizeof(buf), history, 1700000000000ULL);
+    TEST_ASSERT_EQUAL_STRING("{\"t0\":1700000000000,\"period\":60000,\"reason\":\"threshold\",\"vcc\":[3698,3690,3545]}",
+                             buf);
+    TEST_ASSERT_EQUAL_size_t(strlen(buf), len);
+
+    history.count = 0;
+    history.reason = ULP_WAKE_NONE;
+    encodeUlpHistory(buf, sizeof(buf), history, 0);
+    TEST_ASSERT_EQUAL_STRING("{\"t0\":0,\"period\":60000,\"reason\":\"none\",\"vcc\":[]}", buf);
+}
+
+void test_full_history_json_fits_and_overflow_is_reported()
+{
+    UlpHistory history = {};
+    history.reason = ULP_WAKE_FULL;
+    history.count = ULP_HISTORY_SIZE;
+    for (uint8_t i = 0; i < ULP_HISTORY_SIZE; i++)
+        history.samples[i] = 4095; // самые длинные числа
+    char buf[ULP_HISTORY_JSON_SIZE];
+    size_t len = encodeUlpHistory(buf, sizeof(buf), history, UINT64_MAX / 1000);
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_EQUAL('}', buf[len - 1]);
+
+    TEST_ASSERT_EQUAL_size_t(0, encodeUlpHistory(buf, len, history, UINT64_MAX / 1000)); // без места под '\0'
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_arm_sets_window_around_last_sample);
+    RUN_TEST(test_threshold_wake_below_window);
+    RUN_TEST(test_threshold_wake_above_window);
+    RUN_TEST(test_wake_on_full_history);
+    RUN_TEST(test_data_layout_fits_reserved_memory);
+    RUN_TEST(test_read_history_masks_upper_half_words);
+    RUN_TEST(test_read_history_rejects_corrupt_data);
+    RUN_TEST(test_history_json_handoff);
+    RUN_TEST(test_full_history_json_fits_and_overflow_is_reported);
+    return UNITY_END();
+}
@@ -0,0 +1,300 @@
+// Автомат подключения к Wi-Fi (wifi_manager.cpp): пауза с удвоением, порядок сетей по RSSI,
+// попытка не найденных сетей, точка доступа настройки, устаревшие события, список сетей страницы.
+// Время задаётся тестом, Wi-Fi не вызывается — действия проверяются по возвращаемой маске.
+// Запуск: pio test -e native_test -f test_wifi_manager
+#include <unity.h>
+#include "wifi_manager.h"
+#include "hal_native.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include <stdio.h>
+#include <string.h>
+
+SchedulerState sampleScheduler;
+TimeBase timeBase;
+
+static WifiManager m;
+static const int8_t U = WIFI_RSSI_UNSEEN;
+
+/**
+ * @brief Все попытки обхода проваливаются; возвращает действия последнего события
+ */
+static uint8_t failAllCandidates(uint32_t now)
+{
+    uint8_t actions = WIFI_ACTION_NONE;
+    while (m.state == WIFI_STATE_CONNECTING)
+        actions = wifiManagerDisconnected(m, now);
+    return actions;
+}
+
+static void assertAttemptOrder(const uint8_t *expected, uint8_t count, uint32_t now)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTING, m.state);
+        TEST_ASSERT_EQUAL_UINT8(expected[i], m.network);
+        wifiManagerDisconnected(m, now);
+    }
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_WAITING, m.state);
+}
+
+void setUp()
+{
+    memset(&m, 0, sizeof(m));
+}
+
+void tearDown() {}
+
+// === Пауза между обходами ===
+void test_backoff_doubles_from_min_and_caps_at_max()
+{
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_SCAN, wifiManagerBegin(m, 1, 0));
+    const int8_t rssi[] = {-60};
+    uint32_t now = 0;
+    const uint32_t expected[] = {2000, 4000, 8000, 16000, 32000, 60000, 60000};
+    for (uint8_t round = 0; round < sizeof(expected) / sizeof(expected[0]); round++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_SCANNING, m.state);
+        TEST_ASSERT_TRUE(wifiManagerScanDone(m, rssi, now) & WIFI_ACTION_CONNECT);
+        failAllCandidates(now);
+        TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_WAITING, m.state);
+        TEST_ASSERT_EQUAL_UINT32(expected[round], m.backoffMs);
+        TEST_ASSERT_EQUAL_UINT8(round + 1, m.failures);
+
+        // До срока — ничего, в срок — новое сканирование
+        TEST_ASSERT_FALSE(wifiManagerPoll(m, now + expected[round] - 1) & WIFI_ACTION_SCAN);
+        now += expected[round];
+        TEST_ASSERT_TRUE(wifiManagerPoll(m, now) & WIFI_ACTION_SCAN);
+    }
+
+    // Подключение сбрасывает паузу: следующий обход снова с WIFI_BACKOFF_MIN_MS
+    wifiManagerScanDone(m, rssi, now);
+    wifiManagerConnected(m, now);
+    TEST_ASSERT_EQUAL_UINT32(0, m.backoffMs);
+    TEST_ASSERT_EQUAL_UINT8(0, m.failures);
+    wifiManagerDisconnected(m, now);
+    wifiManagerScanDone(m, rssi, now);
+    failAllCandidates(now);
+    TEST_ASSERT_EQUAL_UINT32(WIFI_BACKOFF_MIN_MS, m.backoffMs);
+}
+
+// === Порядок сетей ===
+void test_candidates_ordered_by_rssi_ties_in_config_order()
+{
+    wifiManagerBegin(m, 3, 0);
+    const int8_t rssi[] = {-70, -50, -70};
+    TEST_ASSERT_TRUE(wifiManagerScanDone(m, rssi, 0) & WIFI_ACTION_CONNECT);
+    const uint8_t order[] = {1, 0, 2};
+    TEST_ASSERT_EQUAL_UINT8(3, m.candidateCount);
+    assertAttemptOrder(order, 3, 0);
+    TEST_ASSERT_EQUAL_UINT32(3, m.attempts);
+}
+
+void test_unseen_networks_skipped_when_any_seen()
+{
+    wifiManagerBegin(m, 3, 0);
+    const int8_t rssi[] = {-80, U, -60};
+    wifiManagerScanDone(m, rssi, 0);
+    const uint8_t order[] = {2, 0};
+    TEST_ASSERT_EQUAL_UINT8(2, m.candidateCount);
+    assertAttemptOrder(order, 2, 0);
+}
+
+void test_unseen_networks_tried_when_none_seen()
+{
+    // Скрытый SSID не виден сканированию — пробуются все сети в порядке настроек
+    wifiManagerBegin(m, 3, 0);
+    const int8_t rssi[] = {U, U, U};
+    TEST_ASSERT_TRUE(wifiManagerScanDone(m, rssi, 0) & WIFI_ACTION_CONNECT);
+    const uint8_t order[] = {0, 1, 2};
+    assertAttemptOrder(order, 3, 0);
+}
+
+void test_scan_timeout_falls_back_to_config_order()
+{
+    wifiManagerBegin(m, 2, 0);
+    TEST_ASSERT_EQUAL_UINT32(WIFI_CONNECT_TIMEOUT_MS, wifiManagerWaitMs(m, 0));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerPoll(m, WIFI_CONNECT_TIMEOUT_MS - 1));
+    TEST_ASSERT_TRUE(wifiManagerPoll(m, WIFI_CONNECT_TIMEOUT_MS) & WIFI_ACTION_CONNECT);
+    TEST_ASSERT_EQUAL_UINT8(0, m.network);
+    TEST_ASSERT_EQUAL_INT8(U, m.rssi[0]);
+}
+
+// === Точка доступа ===
+void test_ap_starts_after_outage_and_stops_on_connect()
+{
+    wifiManagerBegin(m, 1, 1000);
+    const int8_t rssi[] = {-60};
+    wifiManagerScanDone(m, rssi, 1000);
+    failAllCandidates(1000);
+    TEST_ASSERT_FALSE(m.apActive);
+    // Ожидание ограничено и моментом подъёма AP, а не только паузой обхода
+    TEST_ASSERT_EQUAL_UINT32(WIFI_BACKOFF_MIN_MS, wifiManagerWaitMs(m, 1000));
+
+    uint32_t apAt = 1000 + WIFI_AP_AFTER_MS;
+    TEST_ASSERT_FALSE(wifiManagerPoll(m, apAt - 1) & WIFI_ACTION_AP_START);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_SCANNING, m.state); // пауза 2 с истекла раньше
+    wifiManagerScanDone(m, rssi, apAt - 1);
+    TEST_ASSERT_EQUAL_UINT32(1, wifiManagerWaitMs(m, apAt - 1));
+    uint8_t actions = wifiManagerPoll(m, apAt);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_AP_START, actions);
+    TEST_ASSERT_TRUE(m.apActive);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTING, m.state); // попытки в STA продолжаются
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerPoll(m, apAt + 1)); // AP поднимается один раз
+
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_AP_STOP, wifiManagerConnected(m, apAt + 500));
+    TEST_ASSERT_FALSE(m.apActive);
+    TEST_ASSERT_EQUAL_UINT32(WIFI_AP_AFTER_MS + 500, m.lastOutageMs);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, wifiManagerWaitMs(m, apAt + 500));
+}
+
+void test_no_networks_is_ap_only()
+{
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_AP_START, wifiManagerBegin(m, 0, 0));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_AP_ONLY, m.state);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, wifiManagerWaitMs(m, 0));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerPoll(m, 100000));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerConnected(m, 100000));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_AP_ONLY, m.state);
+}
+
+// === Устаревшие события ===
+void test_stale_disconnect_while_waiting_is_ignored()
+{
+    wifiManagerBegin(m, 2, 0);
+    const int8_t rssi[] = {-60, -70};
+    wifiManagerScanDone(m, rssi, 0);
+    failAllCandidates(100);
+    uint32_t retryAt = m.retryAtMs;
+    uint32_t attempts = m.attempts;
+
+    // Отключение от прошлой попытки пришло уже в паузе
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerDisconnected(m, 200));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_WAITING, m.state);
+    TEST_ASSERT_EQUAL_UINT32(retryAt, m.retryAtMs);
+    TEST_ASSERT_EQUAL_UINT32(attempts, m.attempts);
+    TEST_ASSERT_EQUAL_UINT32(WIFI_BACKOFF_MIN_MS, m.backoffMs);
+    TEST_ASSERT_EQUAL_UINT32(0, m.disconnects);
+
+    // И во время сканирования — тоже
+    wifiManagerPoll(m, retryAt);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerDisconnected(m, retryAt + 1));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_SCANNING, m.state);
+}
+
+void test_scan_done_outside_scanning_is_ignored()
+{
+    wifiManagerBegin(m, 1, 0);
+    const int8_t rssi[] = {-60};
+    wifiManagerScanDone(m, rssi, 0);
+    wifiManagerConnected(m, 10);
+    TEST_ASSERT_FALSE(wifiManagerScanExpected(m));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerScanDone(m, rssi, 20));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTED, m.state);
+}
+
+// === Список сетей для страницы настроек ===
+void test_scan_list_sorted_deduplicated_and_capped()
+{
+    WifiScanList list = {};
+    wifiScanListAdd(list, "home", -70);
+    wifiScanListAdd(list, "", -30);         // скрытая сеть
+    wifiScanListAdd(list, "office", -50);
+    wifiScanListAdd(list, "cafe", -70);     // равный RSSI — после home
+    wifiScanListAdd(list, "home", -40);     // вторая точка доступа сильнее
+    wifiScanListAdd(list, "office", -90);   // слабее — не меняет запись
+    TEST_ASSERT_EQUAL_UINT8(3, list.count);
+    TEST_ASSERT_EQUAL_STRING("home", list.entries[0].ssid);
+    TEST_ASSERT_EQUAL_INT8(-40, list.entries[0].rssi);
+    TEST_ASSERT_EQUAL_STRING("office", list.entries[1].ssid);
+    TEST_ASSERT_EQUAL_STRING("cafe", list.entries[2].ssid);
+
+    char ssid[8];
+    for (int i = 0; i < WIFI_SCAN_LIST_MAX + 4; i++)
+    {
+        snprintf(ssid, sizeof(ssid), "n%d", i);
+        wifiScanListAdd(list, ssid, -60 - i);
+    }
+    TEST_ASSERT_EQUAL_UINT8(WIFI_SCAN_LIST_MAX, list.count);
+    for (uint8_t i = 1; i < list.count; i++)
+        TEST_ASSERT_TRUE(list.entries[i - 1].rssi >= list.entries[i].rssi);
+    TEST_ASSERT_EQUAL_STRING("home", list.entries[0].ssid); // сильные не вытеснены
+    wifiScanListAdd(list, "weak", -100);
+    TEST_ASSERT_EQUAL_STRING("n9", list.entries[WIFI_SCAN_LIST_MAX - 1].ssid); // home, office, n0..n9
+
+    // SSID максимальной длины (32) обрезается только завершающим нулём
+    const char *longSsid = "0123456789abcdef0123456789abcdef";
+    wifiScanListAdd(list, longSsid, -1);
+    TEST_ASSERT_EQUAL_STRING(longSsid, list.entries[0].ssid);
+}
+
+void test_scan_list_snapshot()
+{
+    wifiManagerBegin(m, 1, 0);
+    WifiScanEntry entry;
+    TEST_ASSERT_EQUAL_UINT8(0, wifiManagerScanEntry(m, 0, entry)); // до первого сканирования
+
+    WifiScanList list = {};
+    wifiScanListAdd(list, "home", -40);
+    wifiScanListAdd(list, "office", -50);
+    wifiManagerStoreScan(m, list);
+    TEST_ASSERT_EQUAL_UINT8(2, wifiManagerScanEntry(m, 1, entry));
+    TEST_ASSERT_EQUAL_STRING("office", entry.ssid);
+    TEST_ASSERT_EQUAL_INT8(-50, entry.rssi);
+    TEST_ASSERT_EQUAL_UINT32(0, m.scanSeq & 1);
+
+    // Новый список заменяет старый целиком
+    list = {};
+    wifiScanListAdd(list, "cafe", -60);
+    wifiManagerStoreScan(m, list);
+    TEST_ASSERT_EQUAL_UINT8(1, wifiManagerScanEntry(m, 1, entry));
+    TEST_ASSERT_EQUAL_UINT8(1, wifiManagerScanEntry(m, 0, entry));
+    TEST_ASSERT_EQUAL_STRING("cafe", entry.ssid);
+}
+
+void test_page_scan_only_outside_round_and_rate_limited()
+{
+    wifiManagerBegin(m, 1, 0);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerRequestScan(m, 0)); // обход уже сканирует
+    TEST_ASSERT_TRUE(wifiManagerScanExpected(m));
+    const int8_t rssi[] = {-60};
+    WifiScanList list = {};
+    wifiManagerStoreScan(m, list);
+    wifiManagerScanDone(m, rssi, 100);
+    wifiManagerConnected(m, 200);
+
+    // Список свежий — страница его и показывает
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerRequestScan(m, WIFI_SCAN_REFRESH_MS - 1));
+    TEST_ASSERT_FALSE(wifiManagerScanExpected(m));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_SCAN, wifiManagerRequestScan(m, WIFI_SCAN_REFRESH_MS));
+    TEST_ASSERT_TRUE(wifiManagerScanExpected(m));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerRequestScan(m, WIFI_SCAN_REFRESH_MS + 1));
+
+    // Итог сканирования страницы не трогает подключение
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_NONE, wifiManagerScanDone(m, rssi, WIFI_SCAN_REFRESH_MS + 2000));
+    TEST_ASSERT_FALSE(wifiManagerScanExpected(m));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STATE_CONNECTED, m.state);
+
+    // Без сетей в настройках (только AP) первый запрос сканирует сразу
+    wifiManagerBegin(m, 0, 0);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_ACTION_SCAN, wifiManagerRequestScan(m, 0));
+}
+
+int main(int, char **)
+{
+    halSimSetLogEnabled(false);
+    UNITY_BEGIN();
+    RUN_TEST(test_backoff_doubles_from_min_and_caps_at_max);
+    RUN_TEST(test_candidates_ordered_by_rssi_ties_in_config_order);
+    RUN_TEST(test_unseen_networks_skipped_when_any_seen);
+    RUN_TEST(test_unseen_networks_tried_when_none_seen);
+    RUN_TEST(test_scan_timeout_falls_back_to_config_order);
+    RUN_TEST(test_ap_starts_after_outage_and_stops_on_connect);
+    RUN_TEST(test_no_networks_is_ap_only);
+    RUN_TEST(test_stale_disconnect_while_waiting_is_ignored);
+    RUN_TEST(test_scan_done_outside_scanning_is_ignored);
+    RUN_TEST(test_scan_list_sorted_deduplicated_and_capped);
+    RUN_TEST(test_scan_list_snapshot);
+    RUN_TEST(test_page_scan_only_outside_round_and_rate_limited);
+    return UNITY_END();
+}